@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "sd-bus.h"
+
+#include "analyze.h"
+#include "analyze-generators.h"
+#include "ansi-color.h"
+#include "bus-error.h"
+#include "bus-locator.h"
+#include "bus-util.h"
+#include "errno-list.h"
+#include "format-table.h"
+#include "log.h"
+#include "pager.h"
+#include "runtime-scope.h"
+#include "time-util.h"
+
+int verb_generators(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_(table_unrefp) Table *table = NULL;
+        usec_t first = USEC_INFINITY;
+        const char *path;
+        uint64_t start, finish;
+        int32_t status;
+        TableCell *cell;
+        int r;
+
+        r = acquire_bus(&bus, NULL);
+        if (r < 0)
+                return bus_log_connect_error(r, arg_transport, arg_runtime_scope);
+
+        r = bus_get_property(bus, bus_systemd_mgr, "GeneratorTimings", &error, &reply, "a(stti)");
+        if (r < 0)
+                return log_error_errno(r, "Failed to get generator timings: %s", bus_error_message(&error, r));
+
+        /* Timestamps are shown relative to the first generator that was started, hence find that first */
+        r = sd_bus_message_enter_container(reply, 'a', "(stti)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        while ((r = sd_bus_message_read(reply, "(stti)", &path, &start, &finish, &status)) > 0)
+                first = MIN(first, start);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        if (first == USEC_INFINITY) {
+                log_info("No generator timings available.");
+                return 0;
+        }
+
+        r = sd_bus_message_rewind(reply, /* complete= */ false);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        table = table_new("time", "started", "status", "generator");
+        if (!table)
+                return log_oom();
+
+        FOREACH_ELEMENT(column, ((const size_t[]) { 0, 1 })) {
+                assert_se(cell = table_get_cell(table, 0, *column));
+                r = table_set_align_percent(table, cell, 100);
+                if (r < 0)
+                        return r;
+        }
+
+        r = table_set_sort(table, (size_t) 0);
+        if (r < 0)
+                return r;
+
+        r = table_set_reverse(table, 0, true);
+        if (r < 0)
+                return r;
+
+        while ((r = sd_bus_message_read(reply, "(stti)", &path, &start, &finish, &status)) > 0) {
+                r = table_add_many(table,
+                                   TABLE_TIMESPAN_MSEC, usec_sub_unsigned(finish, start),
+                                   TABLE_TIMESPAN_MSEC, usec_sub_unsigned(start, first));
+                if (r < 0)
+                        return table_log_add_error(r);
+
+                if (status >= 0)
+                        r = table_add_many(table,
+                                           TABLE_INT32, status,
+                                           TABLE_SET_COLOR, status > 0 ? ansi_highlight_red() : NULL);
+                else
+                        r = table_add_many(table,
+                                           TABLE_STRING, ERRNO_NAME(status),
+                                           TABLE_SET_COLOR, ansi_highlight_red());
+                if (r < 0)
+                        return table_log_add_error(r);
+
+                r = table_add_cell(table, NULL, TABLE_PATH, path);
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        pager_open(arg_pager_flags);
+
+        r = table_print(table, NULL);
+        if (r < 0)
+                return r;
+
+        return 0;
+}
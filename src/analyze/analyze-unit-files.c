@@ -33,7 +33,7 @@ int verb_unit_files(int argc, char *argv[], void *userdata) {
         if (r < 0)
                 return r;
 
-        r = unit_file_build_name_map(&lp, NULL, &unit_ids, &unit_names, NULL);
+        r = unit_file_build_name_map(&lp, NULL, NULL, &unit_ids, &unit_names, NULL);
         if (r < 0)
                 return log_error_errno(r, "unit_file_build_name_map() failed: %m");
 
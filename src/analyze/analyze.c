@@ -28,6 +28,7 @@
 #include "analyze-exit-status.h"
 #include "analyze-fdstore.h"
 #include "analyze-filesystems.h"
+#include "analyze-generators.h"
 #include "analyze-has-tpm2.h"
 #include "analyze-image-policy.h"
 #include "analyze-inspect-elf.h"
@@ -216,6 +217,8 @@ static int help(int argc, char *argv[], void *userdata) {
                "                             time to init\n"
                "  critical-chain [UNIT...]   Print a tree of the time critical chain\n"
                "                             of units\n"
+               "  generators                 Print list of generators ordered by\n"
+               "                             time taken\n"
                "\n%3$sDependency Analysis:%4$s\n"
                "  plot                       Output SVG graphic showing service\n"
                "                             initialization\n"
@@ -777,6 +780,7 @@ static int run(int argc, char *argv[]) {
                 { "time",               VERB_ANY, 1,        VERB_DEFAULT, verb_time                    },
                 { "blame",              VERB_ANY, 1,        0,            verb_blame                   },
                 { "critical-chain",     VERB_ANY, VERB_ANY, 0,            verb_critical_chain          },
+                { "generators",         VERB_ANY, 1,        0,            verb_generators              },
                 { "plot",               VERB_ANY, 1,        0,            verb_plot                    },
                 { "dot",                VERB_ANY, VERB_ANY, 0,            verb_dot                     },
                 /* ↓ The following seven verbs are deprecated, from here … ↓ */
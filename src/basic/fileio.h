@@ -150,7 +150,10 @@ static inline int read_nul_string(FILE *f, size_t limit, char **ret) {
         return read_line_full(f, limit, READ_LINE_ONLY_NUL, ret);
 }
 
-int read_stripped_line(FILE *f, size_t limit, char **ret);
+int read_stripped_line_full(FILE *f, size_t limit, ReadLineFlags flags, char **ret);
+static inline int read_stripped_line(FILE *f, size_t limit, char **ret) {
+        return read_stripped_line_full(f, limit, 0, ret);
+}
 
 static inline bool file_offset_beyond_memory_size(off_t x) {
         if (x < 0) /* off_t is signed, filter that out */
@@ -12,12 +12,47 @@ struct pool {
         struct pool *next;
         size_t n_tiles;
         size_t n_used;
+        size_t n_free; /* how many of the n_used tiles are in the freelist */
 };
 
 static void* pool_ptr(struct pool *p) {
         return ((uint8_t*) ASSERT_PTR(p)) + ALIGN(sizeof(struct pool));
 }
 
+static bool pool_contains(struct mempool *mp, struct pool *p, void *ptr) {
+        size_t off;
+        void *a;
+
+        assert(mp);
+        assert(p);
+
+        if (!ptr)
+                return false;
+
+        a = pool_ptr(p);
+        if ((uint8_t*) ptr < (uint8_t*) a)
+                return false;
+
+        off = (uint8_t*) ptr - (uint8_t*) a;
+        if (off >= mp->tile_size * p->n_tiles)
+                return false;
+
+        assert(off % mp->tile_size == 0);
+        return true;
+}
+
+static struct pool* mempool_find_pool(struct mempool *mp, void *ptr) {
+        assert(mp);
+
+        /* Chunks grow in size and the newest one comes first, hence most tiles are found in the first few
+         * chunks. */
+        for (struct pool *p = mp->first_pool; p; p = p->next)
+                if (pool_contains(mp, p, ptr))
+                        return p;
+
+        assert_not_reached();
+}
+
 void* mempool_alloc_tile(struct mempool *mp) {
         size_t i;
 
@@ -29,10 +64,16 @@ void* mempool_alloc_tile(struct mempool *mp) {
         assert(mp->at_least > 0);
 
         if (mp->freelist) {
+                struct pool *p;
                 void *t;
 
                 t = mp->freelist;
                 mp->freelist = *(void**) mp->freelist;
+
+                p = mempool_find_pool(mp, t);
+                assert(p->n_free > 0);
+                p->n_free--;
+
                 return t;
         }
 
@@ -43,6 +84,8 @@ void* mempool_alloc_tile(struct mempool *mp) {
 
                 n = mp->first_pool ? mp->first_pool->n_tiles : 0;
                 n = MAX(mp->at_least, n * 2);
+                if (mp->at_most > 0)
+                        n = MIN(n, MAX(mp->at_least, mp->at_most));
                 size = PAGE_ALIGN(ALIGN(sizeof(struct pool)) + n*mp->tile_size);
                 n = (size - ALIGN(sizeof(struct pool))) / mp->tile_size;
 
@@ -53,6 +96,7 @@ void* mempool_alloc_tile(struct mempool *mp) {
                 p->next = mp->first_pool;
                 p->n_tiles = n;
                 p->n_used = 0;
+                p->n_free = 0;
 
                 mp->first_pool = p;
         }
@@ -77,92 +121,55 @@ void* mempool_free_tile(struct mempool *mp, void *p) {
         if (!p)
                 return NULL;
 
+        mempool_find_pool(mp, p)->n_free++;
+
         *(void**) p = mp->freelist;
         mp->freelist = p;
 
         return NULL;
 }
 
-static bool pool_contains(struct mempool *mp, struct pool *p, void *ptr) {
-        size_t off;
-        void *a;
-
-        assert(mp);
-        assert(p);
-
-        if (!ptr)
-                return false;
-
-        a = pool_ptr(p);
-        if ((uint8_t*) ptr < (uint8_t*) a)
-                return false;
-
-        off = (uint8_t*) ptr - (uint8_t*) a;
-        if (off >= mp->tile_size * p->n_tiles)
-                return false;
-
-        assert(off % mp->tile_size == 0);
-        return true;
-}
-
-static bool pool_is_unused(struct mempool *mp, struct pool *p) {
-        assert(mp);
+static bool pool_is_unused(struct pool *p) {
         assert(p);
 
-        if (p->n_used == 0)
-                return true;
-
-        /* Check if all tiles in this specific pool are in the freelist. */
-        size_t n = 0;
-        void *i = mp->freelist;
-        while (i) {
-                if (pool_contains(mp, p, i))
-                        n++;
-
-                i = *(void**) i;
-        }
-
-        assert(n <= p->n_used);
-
-        return n == p->n_used;
+        /* All tiles handed out from this pool were returned */
+        assert(p->n_free <= p->n_used);
+        return p->n_free == p->n_used;
 }
 
-static void pool_unlink(struct mempool *mp, struct pool *p) {
-        size_t m = 0;
+void mempool_trim(struct mempool *mp) {
+        size_t trimmed = 0, left = 0;
+        bool any = false;
 
         assert(mp);
-        assert(p);
 
-        if (p->n_used == 0)
+        for (struct pool *p = mp->first_pool; p; p = p->next)
+                if (pool_is_unused(p)) {
+                        any = true;
+                        break;
+                }
+
+        if (!any)
                 return;
 
+        /* Drop the tiles of the unused pools from the freelist in a single pass. This is the only part that
+         * isn't O(number of pools), but it is only done if there's something to release. */
         void **i = &mp->freelist;
         while (*i) {
                 void *d = *i;
 
-                if (pool_contains(mp, p, d)) {
+                if (pool_is_unused(mempool_find_pool(mp, d)))
                         *i = *(void**) d;
-                        m++;
-
-                        if (m == p->n_used)
-                                break;
-                } else
+                else
                         i = (void**) d;
         }
-}
-
-void mempool_trim(struct mempool *mp) {
-        size_t trimmed = 0, left = 0;
-
-        assert(mp);
 
         struct pool **p = &mp->first_pool;
         while (*p) {
                 struct pool *d = *p;
 
-                if (pool_is_unused(mp, d)) {
+                if (pool_is_unused(d)) {
                         trimmed += d->n_tiles * mp->tile_size;
-                        pool_unlink(mp, d);
                         *p = d->next;
                         free(d);
                 } else {
@@ -173,3 +180,16 @@ void mempool_trim(struct mempool *mp) {
 
         log_debug("Trimmed %s from memory pool %p. (%s left)", FORMAT_BYTES(trimmed), mp, FORMAT_BYTES(left));
 }
+
+size_t mempool_allocated(const struct mempool *mp) {
+        size_t n = 0;
+
+        assert(mp);
+
+        /* Returns the memory allocated for tiles, whether they are in use or not */
+
+        for (struct pool *p = mp->first_pool; p; p = p->next)
+                n += p->n_tiles * mp->tile_size;
+
+        return n;
+}
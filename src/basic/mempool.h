@@ -10,6 +10,7 @@ struct mempool {
         void *freelist;
         size_t tile_size;
         size_t at_least;
+        size_t at_most; /* if non-zero, chunks stop growing at this many tiles */
 };
 
 void* mempool_alloc_tile(struct mempool *mp);
@@ -25,3 +26,4 @@ static struct mempool pool_name = { \
 bool mempool_enabled(void) _weak_ _pure_;
 
 void mempool_trim(struct mempool *mp);
+size_t mempool_allocated(const struct mempool *mp);
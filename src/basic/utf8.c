@@ -134,6 +134,25 @@ char* utf8_is_valid_n(const char *str, size_t len_bytes) {
         for (size_t i = 0; len_bytes != SIZE_MAX ? i < len_bytes : str[i] != '\0'; ) {
                 int len;
 
+                /* If the length is known, skip over runs of plain ASCII a word at a time. Most strings we
+                 * validate (unit names, paths, D-Bus strings) are pure ASCII, so this is the common case. */
+                if (len_bytes != SIZE_MAX) {
+                        while (len_bytes - i >= sizeof(uint64_t)) {
+                                uint64_t w;
+
+                                memcpy(&w, str + i, sizeof(w));
+                                if (w & UINT64_C(0x8080808080808080))
+                                        break;
+                                if (_unlikely_((w - UINT64_C(0x0101010101010101)) & ~w & UINT64_C(0x8080808080808080)))
+                                        return NULL; /* embedded NUL */
+
+                                i += sizeof(w);
+                        }
+
+                        if (i >= len_bytes)
+                                break;
+                }
+
                 if (_unlikely_(str[i] == '\0'))
                         return NULL; /* embedded NUL */
 
@@ -23,6 +23,7 @@
 #include "cgroup.h"
 #include "cgroup-setup.h"
 #include "cgroup-util.h"
+#include "critical-path.h"
 #include "devnum-util.h"
 #include "errno-util.h"
 #include "extract-word.h"
@@ -124,18 +125,89 @@ bool unit_has_startup_cgroup_constraints(Unit *u) {
                c->startup_memory_low_set;
 }
 
-static int set_attribute_and_warn(Unit *u, const char *attribute, const char *value) {
+void unit_flush_cgroup_attributes_written(Unit *u) {
+        assert(u);
+
+        /* Forgets which values we wrote to the unit's cgroup attributes, so that all of them are written
+         * again on the next realization. */
+
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (!crt)
+                return;
+
+        crt->cgroup_attributes_written = hashmap_free(crt->cgroup_attributes_written);
+}
+
+static void unit_flush_accounting_cache(Unit *u) {
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (!crt)
+                return;
+
+        /* Values read from a previous incarnation of the cgroup must not be handed out for the new one,
+         * see unit_accounting_cache_fresh(). The *_last values stay, as they are needed as fallback. */
+        crt->cpu_usage_timestamp = 0;
+        crt->io_accounting_timestamp = 0;
+        zero(crt->memory_accounting_timestamp);
+        crt->tasks_current_timestamp = 0;
+}
+
+static int unit_cgroup_set_attribute(Unit *u, const char *attribute, const char *key, const char *value) {
+        _cleanup_free_ char *cache_key = NULL;
+        char *old_key;
         int r;
 
         assert(u);
         assert(attribute);
         assert(value);
 
+        /* Writes a cgroup attribute of the unit, unless we wrote the very same value to it before. Attributes
+         * that take one line per device are tracked per 'key'. */
+
         CGroupRuntime *crt = unit_get_cgroup_runtime(u);
         if (!crt || !crt->cgroup_path)
                 return -EOWNERDEAD;
 
-        r = cg_set_attribute(crt->cgroup_path, attribute, value);
+        cache_key = key ? strjoin(attribute, " ", key) : strdup(attribute);
+        if (!cache_key)
+                return -ENOMEM;
+
+        if (streq_ptr(hashmap_get(crt->cgroup_attributes_written, cache_key), value)) {
+                u->manager->n_cgroup_attribute_writes_elided++;
+                return 0;
+        }
+
+        /* Whatever happens below, we don't know the value of the attribute anymore */
+        free(hashmap_remove2(crt->cgroup_attributes_written, cache_key, (void**) &old_key));
+        free(old_key);
+
+        /* See cg_set_attribute() for the reason for the nonblocking open */
+        if (crt->cgroup_apply_fd >= 0)
+                r = write_string_file_at(crt->cgroup_apply_fd, attribute, value,
+                                         WRITE_STRING_FILE_DISABLE_BUFFER|WRITE_STRING_FILE_OPEN_NONBLOCKING);
+        else
+                r = cg_set_attribute(crt->cgroup_path, attribute, value);
+        u->manager->n_cgroup_attribute_writes++;
+        if (r < 0)
+                return r;
+
+        if (hashmap_put_strdup_full(&crt->cgroup_attributes_written, &string_hash_ops_free_free, cache_key, value) < 0)
+                log_oom_debug();
+
+        return 0;
+}
+
+static int set_keyed_attribute_and_warn(Unit *u, const char *attribute, const char *key, const char *value) {
+        int r;
+
+        assert(u);
+        assert(attribute);
+        assert(value);
+
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (!crt || !crt->cgroup_path)
+                return -EOWNERDEAD;
+
+        r = unit_cgroup_set_attribute(u, attribute, key, value);
         if (r < 0)
                 log_unit_full_errno(u, LOG_LEVEL_CGROUP_WRITE(r), r, "Failed to set '%s' attribute on '%s' to '%.*s': %m",
                                     attribute, empty_to_root(crt->cgroup_path), (int) strcspn(value, NEWLINE), value);
@@ -143,6 +215,10 @@ static int set_attribute_and_warn(Unit *u, const char *attribute, const char *va
         return r;
 }
 
+static int set_attribute_and_warn(Unit *u, const char *attribute, const char *value) {
+        return set_keyed_attribute_and_warn(u, attribute, /* key= */ NULL, value);
+}
+
 void cgroup_context_init(CGroupContext *c) {
         assert(c);
 
@@ -994,6 +1070,14 @@ static bool cgroup_context_has_allowed_mems(CGroupContext *c) {
         return c->cpuset_mems.set || c->startup_cpuset_mems.set;
 }
 
+static bool unit_critical_path_boosted(Unit *u, ManagerState state) {
+        assert(u);
+
+        /* Units on the predicted critical path of the boot get a higher weight while booting, see
+         * critical-path.c */
+        return u->on_critical_path && IN_SET(state, MANAGER_STARTING, MANAGER_INITIALIZING);
+}
+
 uint64_t cgroup_context_cpu_weight(CGroupContext *c, ManagerState state) {
         assert(c);
 
@@ -1083,7 +1167,7 @@ static void cgroup_apply_cpu_idle(Unit *u, uint64_t weight) {
 
         is_idle = weight == CGROUP_WEIGHT_IDLE;
         idle_val = one_zero(is_idle);
-        r = cg_set_attribute(crt->cgroup_path, "cpu.idle", idle_val);
+        r = unit_cgroup_set_attribute(u, "cpu.idle", /* key= */ NULL, idle_val);
         if (r < 0 && (r != -ENOENT || is_idle))
                 log_unit_full_errno(u, LOG_LEVEL_CGROUP_WRITE(r), r, "Failed to set '%s' attribute on '%s' to '%s': %m",
                                     "cpu.idle", empty_to_root(crt->cgroup_path), idle_val);
@@ -1135,7 +1219,7 @@ static uint64_t cgroup_context_io_weight(CGroupContext *c, ManagerState state) {
 }
 
 static int set_bfq_weight(Unit *u, dev_t dev, uint64_t io_weight) {
-        char buf[DECIMAL_STR_MAX(dev_t)*2+2+DECIMAL_STR_MAX(uint64_t)+STRLEN("\n")];
+        char buf[DECIMAL_STR_MAX(dev_t)*2+2+DECIMAL_STR_MAX(uint64_t)+STRLEN("\n")], key[DECIMAL_STR_MAX(dev_t)*2+2];
         uint64_t bfq_weight;
         int r;
 
@@ -1151,12 +1235,14 @@ static int set_bfq_weight(Unit *u, dev_t dev, uint64_t io_weight) {
         /* Adjust to kernel range is 1..1000, the default is 100. */
         bfq_weight = BFQ_WEIGHT(io_weight);
 
+        xsprintf(key, DEVNUM_FORMAT_STR, DEVNUM_FORMAT_VAL(dev));
+
         if (major(dev) > 0)
-                xsprintf(buf, DEVNUM_FORMAT_STR " %" PRIu64 "\n", DEVNUM_FORMAT_VAL(dev), bfq_weight);
+                xsprintf(buf, "%s %" PRIu64 "\n", key, bfq_weight);
         else
                 xsprintf(buf, "%" PRIu64 "\n", bfq_weight);
 
-        r = cg_set_attribute(crt->cgroup_path, "io.bfq.weight", buf);
+        r = unit_cgroup_set_attribute(u, "io.bfq.weight", major(dev) > 0 ? key : NULL, buf);
         if (r >= 0 && io_weight != bfq_weight)
                 log_unit_debug(u, "%s=%" PRIu64 " scaled to io.bfq.weight=%" PRIu64,
                                major(dev) > 0 ? "IODeviceWeight" : "IOWeight",
@@ -1165,7 +1251,7 @@ static int set_bfq_weight(Unit *u, dev_t dev, uint64_t io_weight) {
 }
 
 static void cgroup_apply_io_device_weight(Unit *u, const char *dev_path, uint64_t io_weight) {
-        char buf[DECIMAL_STR_MAX(dev_t)*2+2+DECIMAL_STR_MAX(uint64_t)+1];
+        char buf[DECIMAL_STR_MAX(dev_t)*2+2+DECIMAL_STR_MAX(uint64_t)+1], key[DECIMAL_STR_MAX(dev_t)*2+2];
         dev_t dev;
         int r, r1, r2;
 
@@ -1180,8 +1266,9 @@ static void cgroup_apply_io_device_weight(Unit *u, const char *dev_path, uint64_
 
         r1 = set_bfq_weight(u, dev, io_weight);
 
-        xsprintf(buf, DEVNUM_FORMAT_STR " %" PRIu64 "\n", DEVNUM_FORMAT_VAL(dev), io_weight);
-        r2 = cg_set_attribute(crt->cgroup_path, "io.weight", buf);
+        xsprintf(key, DEVNUM_FORMAT_STR, DEVNUM_FORMAT_VAL(dev));
+        xsprintf(buf, "%s %" PRIu64 "\n", key, io_weight);
+        r2 = unit_cgroup_set_attribute(u, "io.weight", key, buf);
 
         /* Look at the configured device, when both fail, prefer io.weight errno. */
         r = r2 == -EOPNOTSUPP ? r1 : r2;
@@ -1193,7 +1280,7 @@ static void cgroup_apply_io_device_weight(Unit *u, const char *dev_path, uint64_
 }
 
 static void cgroup_apply_io_device_latency(Unit *u, const char *dev_path, usec_t target) {
-        char buf[DECIMAL_STR_MAX(dev_t)*2+2+7+DECIMAL_STR_MAX(uint64_t)+1];
+        char buf[DECIMAL_STR_MAX(dev_t)*2+2+7+DECIMAL_STR_MAX(uint64_t)+1], key[DECIMAL_STR_MAX(dev_t)*2+2];
         dev_t dev;
         int r;
 
@@ -1201,17 +1288,20 @@ static void cgroup_apply_io_device_latency(Unit *u, const char *dev_path, usec_t
         if (r < 0)
                 return;
 
+        xsprintf(key, DEVNUM_FORMAT_STR, DEVNUM_FORMAT_VAL(dev));
+
         if (target != USEC_INFINITY)
-                xsprintf(buf, DEVNUM_FORMAT_STR " target=%" PRIu64 "\n", DEVNUM_FORMAT_VAL(dev), target);
+                xsprintf(buf, "%s target=%" PRIu64 "\n", key, target);
         else
-                xsprintf(buf, DEVNUM_FORMAT_STR " target=max\n", DEVNUM_FORMAT_VAL(dev));
+                xsprintf(buf, "%s target=max\n", key);
 
-        (void) set_attribute_and_warn(u, "io.latency", buf);
+        (void) set_keyed_attribute_and_warn(u, "io.latency", key, buf);
 }
 
 static void cgroup_apply_io_device_limit(Unit *u, const char *dev_path, uint64_t *limits) {
         char limit_bufs[_CGROUP_IO_LIMIT_TYPE_MAX][DECIMAL_STR_MAX(uint64_t)],
-             buf[DECIMAL_STR_MAX(dev_t)*2+2+(6+DECIMAL_STR_MAX(uint64_t)+1)*4];
+             buf[DECIMAL_STR_MAX(dev_t)*2+2+(6+DECIMAL_STR_MAX(uint64_t)+1)*4],
+             key[DECIMAL_STR_MAX(dev_t)*2+2];
         dev_t dev;
 
         if (lookup_block_device(dev_path, &dev) < 0)
@@ -1223,10 +1313,11 @@ static void cgroup_apply_io_device_limit(Unit *u, const char *dev_path, uint64_t
                 else
                         xsprintf(limit_bufs[type], "%s", limits[type] == CGROUP_LIMIT_MAX ? "max" : "0");
 
-        xsprintf(buf, DEVNUM_FORMAT_STR " rbps=%s wbps=%s riops=%s wiops=%s\n", DEVNUM_FORMAT_VAL(dev),
+        xsprintf(key, DEVNUM_FORMAT_STR, DEVNUM_FORMAT_VAL(dev));
+        xsprintf(buf, "%s rbps=%s wbps=%s riops=%s wiops=%s\n", key,
                  limit_bufs[CGROUP_IO_RBPS_MAX], limit_bufs[CGROUP_IO_WBPS_MAX],
                  limit_bufs[CGROUP_IO_RIOPS_MAX], limit_bufs[CGROUP_IO_WIOPS_MAX]);
-        (void) set_attribute_and_warn(u, "io.max", buf);
+        (void) set_keyed_attribute_and_warn(u, "io.max", key, buf);
 }
 
 static bool cgroup_context_has_memory_config(CGroupContext *c) {
@@ -1427,6 +1518,13 @@ static void cgroup_context_apply(
         if (!crt || !crt->cgroup_path)
                 return;
 
+        /* Open the cgroup directory once, and write all attributes relative to it. If that fails, the
+         * attributes are written by their full path, and we'll log about any failure there. */
+        _cleanup_free_ char *cgroup_full_path = NULL;
+        assert(crt->cgroup_apply_fd < 0);
+        if (cg_get_path(crt->cgroup_path, /* suffix= */ NULL, &cgroup_full_path) >= 0)
+                crt->cgroup_apply_fd = open(cgroup_full_path, O_DIRECTORY|O_PATH|O_CLOEXEC);
+
         /* We generally ignore errors caused by read-only mounted cgroup trees (assuming we are running in a container
          * then), and missing cgroups, i.e. EROFS and ENOENT. */
 
@@ -1434,8 +1532,11 @@ static void cgroup_context_apply(
         if ((apply_mask & CGROUP_MASK_CPU) && !is_local_root) {
                 uint64_t weight;
 
+                /* Explicitly configured weights always win over the boost */
                 if (cgroup_context_has_cpu_weight(c))
                         weight = cgroup_context_cpu_weight(c, state);
+                else if (unit_critical_path_boosted(u, state))
+                        weight = CGROUP_WEIGHT_CRITICAL_PATH;
                 else
                         weight = CGROUP_WEIGHT_DEFAULT;
 
@@ -1460,6 +1561,8 @@ static void cgroup_context_apply(
 
                 if (has_io)
                         weight = cgroup_context_io_weight(c, state);
+                else if (unit_critical_path_boosted(u, state))
+                        weight = CGROUP_WEIGHT_CRITICAL_PATH;
                 else
                         weight = CGROUP_WEIGHT_DEFAULT;
 
@@ -1562,6 +1665,8 @@ static void cgroup_context_apply(
         if (apply_mask & CGROUP_MASK_BPF_BIND_NETWORK_INTERFACE)
                 cgroup_apply_bind_network_interface(u);
 
+        crt->cgroup_apply_fd = safe_close(crt->cgroup_apply_fd);
+
         unit_modify_nft_set(u, /* add= */ true);
 }
 
@@ -1649,14 +1754,16 @@ static CGroupMask unit_get_cgroup_mask(Unit *u) {
         /* Figure out which controllers we need, based on the cgroup context object */
 
         if (cgroup_context_has_cpu_weight(c) ||
-            c->cpu_quota_per_sec_usec != USEC_INFINITY)
+            c->cpu_quota_per_sec_usec != USEC_INFINITY ||
+            u->on_critical_path)
                 mask |= CGROUP_MASK_CPU;
 
         if (cgroup_context_has_allowed_cpus(c) || cgroup_context_has_allowed_mems(c))
                 mask |= CGROUP_MASK_CPUSET;
 
         if (c->io_accounting ||
-            cgroup_context_has_io_config(c))
+            cgroup_context_has_io_config(c) ||
+            u->on_critical_path)
                 mask |= CGROUP_MASK_IO;
 
         if (c->memory_accounting ||
@@ -2057,6 +2164,13 @@ static int unit_update_cgroup(
                 return log_unit_error_errno(u, r, "Failed to create cgroup %s: %m", empty_to_root(cgroup));
         created = r;
 
+        /* A new cgroup has the kernel defaults for all attributes, not what we might have written before,
+         * and none of the resource usage we might have read before */
+        if (created) {
+                unit_flush_cgroup_attributes_written(u);
+                unit_flush_accounting_cache(u);
+        }
+
         if (set_path) {
                 r = unit_set_cgroup_path(u, cgroup);
                 if (r == -EEXIST)
@@ -2527,6 +2641,7 @@ static int unit_realize_cgroup_now(Unit *u, ManagerState state) {
 }
 
 unsigned manager_dispatch_cgroup_realize_queue(Manager *m) {
+        uint64_t n_writes, n_elided;
         ManagerState state;
         unsigned n = 0;
         Unit *i;
@@ -2535,6 +2650,8 @@ unsigned manager_dispatch_cgroup_realize_queue(Manager *m) {
         assert(m);
 
         state = manager_state(m);
+        n_writes = m->n_cgroup_attribute_writes;
+        n_elided = m->n_cgroup_attribute_writes_elided;
 
         while ((i = m->cgroup_realize_queue)) {
                 assert(i->in_cgroup_realize_queue);
@@ -2552,6 +2669,10 @@ unsigned manager_dispatch_cgroup_realize_queue(Manager *m) {
                 n++;
         }
 
+        if (n > 0)
+                log_debug("Realized cgroups of %u units, wrote %" PRIu64 " attributes, skipped %" PRIu64 " unchanged ones.",
+                          n, m->n_cgroup_attribute_writes - n_writes, m->n_cgroup_attribute_writes_elided - n_elided);
+
         return n;
 }
 
@@ -2649,6 +2770,8 @@ void unit_release_cgroup(Unit *u, bool drop_cgroup_runtime) {
                 crt->cgroup_path = mfree(crt->cgroup_path);
         }
 
+        crt->cgroup_attributes_written = hashmap_free(crt->cgroup_attributes_written);
+
         if (crt->cgroup_control_inotify_wd >= 0) {
                 if (inotify_rm_watch(u->manager->cgroup_inotify_fd, crt->cgroup_control_inotify_wd) < 0)
                         log_unit_debug_errno(u, errno, "Failed to remove cgroup control inotify watch %i for %s, ignoring: %m", crt->cgroup_control_inotify_wd, u->id);
@@ -3466,6 +3589,19 @@ int unit_get_memory_available(Unit *u, uint64_t *ret) {
         return 0;
 }
 
+static bool unit_accounting_cache_fresh(Unit *u, usec_t timestamp) {
+        assert(u);
+
+        /* Returns true if an accounting value read at the specified time may be returned to a client
+         * instead of reading it from the cgroup again. Callers that pass ret == NULL to the
+         * unit_get_xyz() calls below ask for the cached values to be refreshed, and always bypass this. */
+
+        if (u->manager->accounting_cache_usec == 0 || timestamp == 0)
+                return false;
+
+        return usec_add(timestamp, u->manager->accounting_cache_usec) > now(CLOCK_MONOTONIC);
+}
+
 int unit_get_memory_accounting(Unit *u, CGroupMemoryAccountingMetric metric, uint64_t *ret) {
 
         static const char* const attributes_table[_CGROUP_MEMORY_ACCOUNTING_METRIC_MAX] = {
@@ -3506,10 +3642,19 @@ int unit_get_memory_accounting(Unit *u, CGroupMemoryAccountingMetric metric, uin
         if (!FLAGS_SET(crt->cgroup_realized_mask, CGROUP_MASK_MEMORY))
                 return -ENODATA;
 
+        if (ret && unit_accounting_cache_fresh(u, crt->memory_accounting_timestamp[metric])) {
+                *ret = crt->memory_accounting_cache[metric];
+                return 0;
+        }
+
         r = cg_get_attribute_as_uint64(crt->cgroup_path, attributes_table[metric], &bytes);
         if (r < 0 && r != -ENODATA)
                 return r;
         updated = r >= 0;
+        if (updated) {
+                crt->memory_accounting_cache[metric] = bytes;
+                crt->memory_accounting_timestamp[metric] = now(CLOCK_MONOTONIC);
+        }
 
 finish:
         if (metric <= _CGROUP_MEMORY_ACCOUNTING_METRIC_CACHED_LAST) {
@@ -3532,6 +3677,8 @@ finish:
 }
 
 int unit_get_tasks_current(Unit *u, uint64_t *ret) {
+        int r;
+
         assert(u);
         assert(ret);
 
@@ -3549,7 +3696,18 @@ int unit_get_tasks_current(Unit *u, uint64_t *ret) {
         if ((crt->cgroup_realized_mask & CGROUP_MASK_PIDS) == 0)
                 return -ENODATA;
 
-        return cg_get_attribute_as_uint64(crt->cgroup_path, "pids.current", ret);
+        if (unit_accounting_cache_fresh(u, crt->tasks_current_timestamp)) {
+                *ret = crt->tasks_current_cache;
+                return 0;
+        }
+
+        r = cg_get_attribute_as_uint64(crt->cgroup_path, "pids.current", ret);
+        if (r < 0)
+                return r;
+
+        crt->tasks_current_cache = *ret;
+        crt->tasks_current_timestamp = now(CLOCK_MONOTONIC);
+        return 0;
 }
 
 static int unit_get_cpu_usage_raw(const Unit *u, const CGroupRuntime *crt, nsec_t *ret) {
@@ -3596,6 +3754,11 @@ int unit_get_cpu_usage(Unit *u, nsec_t *ret) {
         if (!crt)
                 return -ENODATA;
 
+        if (ret && crt->cpu_usage_last != NSEC_INFINITY && unit_accounting_cache_fresh(u, crt->cpu_usage_timestamp)) {
+                *ret = crt->cpu_usage_last;
+                return 0;
+        }
+
         r = unit_get_cpu_usage_raw(u, crt, &ns);
         if (r == -ENODATA && crt->cpu_usage_last != NSEC_INFINITY) {
                 /* If we can't get the CPU usage anymore (because the cgroup was already removed, for example), use our
@@ -3614,6 +3777,7 @@ int unit_get_cpu_usage(Unit *u, nsec_t *ret) {
                 ns = 0;
 
         crt->cpu_usage_last = ns;
+        crt->cpu_usage_timestamp = now(CLOCK_MONOTONIC);
         if (ret)
                 *ret = ns;
 
@@ -3794,12 +3958,38 @@ static int unit_get_io_accounting_raw(
         return 0;
 }
 
+static int unit_update_io_accounting(Unit *u, CGroupRuntime *crt, bool use_cache) {
+        uint64_t raw[_CGROUP_IO_ACCOUNTING_METRIC_MAX];
+        int r;
+
+        assert(u);
+        assert(crt);
+
+        /* All IO metrics are read at once from io.stat, hence they share a single timestamp */
+        if (use_cache && unit_accounting_cache_fresh(u, crt->io_accounting_timestamp))
+                return 0;
+
+        r = unit_get_io_accounting_raw(u, crt, raw);
+        if (r < 0)
+                return r;
+
+        for (CGroupIOAccountingMetric i = 0; i < _CGROUP_IO_ACCOUNTING_METRIC_MAX; i++) {
+                /* Saturated subtraction */
+                if (raw[i] > crt->io_accounting_base[i])
+                        crt->io_accounting_last[i] = raw[i] - crt->io_accounting_base[i];
+                else
+                        crt->io_accounting_last[i] = 0;
+        }
+
+        crt->io_accounting_timestamp = now(CLOCK_MONOTONIC);
+        return 0;
+}
+
 int unit_get_io_accounting(
                 Unit *u,
                 CGroupIOAccountingMetric metric,
                 uint64_t *ret) {
 
-        uint64_t raw[_CGROUP_IO_ACCOUNTING_METRIC_MAX];
         int r;
 
         /*
@@ -3818,20 +4008,12 @@ int unit_get_io_accounting(
         if (!crt)
                 return -ENODATA;
 
-        r = unit_get_io_accounting_raw(u, crt, raw);
+        r = unit_update_io_accounting(u, crt, /* use_cache= */ ret);
         if (r == -ENODATA && metric >= 0 && crt->io_accounting_last[metric] != UINT64_MAX)
                 goto done;
         if (r < 0)
                 return r;
 
-        for (CGroupIOAccountingMetric i = 0; i < _CGROUP_IO_ACCOUNTING_METRIC_MAX; i++) {
-                /* Saturated subtraction */
-                if (raw[i] > crt->io_accounting_base[i])
-                        crt->io_accounting_last[i] = raw[i] - crt->io_accounting_base[i];
-                else
-                        crt->io_accounting_last[i] = 0;
-        }
-
 done:
         if (ret)
                 *ret = crt->io_accounting_last[metric];
@@ -3839,6 +4021,30 @@ done:
         return 0;
 }
 
+int unit_get_io_accounting_all(Unit *u, uint64_t ret[static _CGROUP_IO_ACCOUNTING_METRIC_MAX]) {
+        int r;
+
+        assert(u);
+        assert(ret);
+
+        /* Like unit_get_io_accounting(), but returns all IO counters from a single read of io.stat. Counters
+         * that are not known are set to UINT64_MAX. */
+
+        if (!UNIT_CGROUP_BOOL(u, io_accounting))
+                return -ENODATA;
+
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (!crt)
+                return -ENODATA;
+
+        r = unit_update_io_accounting(u, crt, /* use_cache= */ true);
+        if (r < 0 && r != -ENODATA)
+                return r;
+
+        memcpy(ret, crt->io_accounting_last, sizeof(crt->io_accounting_last));
+        return 0;
+}
+
 static int unit_reset_cpu_accounting(Unit *unit, CGroupRuntime *crt) {
         int r;
 
@@ -3846,6 +4052,7 @@ static int unit_reset_cpu_accounting(Unit *unit, CGroupRuntime *crt) {
 
         crt->cpu_usage_base = 0;
         crt->cpu_usage_last = NSEC_INFINITY;
+        crt->cpu_usage_timestamp = 0;
 
         if (unit) {
                 r = unit_get_cpu_usage_raw(unit, crt, &crt->cpu_usage_base);
@@ -3864,6 +4071,7 @@ static int unit_reset_io_accounting(Unit *unit, CGroupRuntime *crt) {
         zero(crt->io_accounting_base);
         FOREACH_ELEMENT(i, crt->io_accounting_last)
                 *i = UINT64_MAX;
+        crt->io_accounting_timestamp = 0;
 
         if (unit) {
                 r = unit_get_io_accounting_raw(unit, crt, crt->io_accounting_base);
@@ -3879,6 +4087,8 @@ static void cgroup_runtime_reset_memory_accounting_last(CGroupRuntime *crt) {
 
         FOREACH_ELEMENT(i, crt->memory_accounting_last)
                 *i = UINT64_MAX;
+
+        zero(crt->memory_accounting_timestamp);
 }
 
 static int cgroup_runtime_reset_ip_accounting(CGroupRuntime *crt) {
@@ -3924,6 +4134,11 @@ bool unit_invalidate_cgroup(Unit *u, CGroupMask m) {
         if (!crt)
                 return false;
 
+        /* Something asked for the attributes to be applied again, hence write them all, even if we
+         * believe they have the right value already. Do this even if the controllers are invalidated
+         * already, as attributes might have been written for other controllers since. */
+        crt->cgroup_attributes_written = hashmap_free(crt->cgroup_attributes_written);
+
         /* If all controllers shall be invalidated, let's unconditionally submit the unit to realize queue.
          * We initialize the field to _CGROUP_MASK_ALL after all, and semantically it makes sense to use
          * it as a special signal to forcibly re-realize cgroup. */
@@ -4126,6 +4341,7 @@ CGroupRuntime* cgroup_runtime_new(void) {
                 return NULL;
 
         *crt = (CGroupRuntime) {
+                .cgroup_apply_fd = -EBADF,
                 .cgroup_control_inotify_wd = -1,
                 .cgroup_memory_inotify_wd = -1,
 
@@ -4178,6 +4394,8 @@ CGroupRuntime* cgroup_runtime_free(CGroupRuntime *crt) {
         bpf_firewall_close(crt);
 
         free(crt->cgroup_path);
+        hashmap_free(crt->cgroup_attributes_written);
+        safe_close(crt->cgroup_apply_fd);
 
         return mfree(crt);
 }
@@ -266,6 +266,16 @@ typedef struct CGroupRuntime {
         uint64_t io_accounting_base[_CGROUP_IO_ACCOUNTING_METRIC_MAX];
         uint64_t io_accounting_last[_CGROUP_IO_ACCOUNTING_METRIC_MAX]; /* the most recently read value */
 
+        /* When the accounting data above was last read from the cgroup (CLOCK_MONOTONIC), and the values
+         * that aren't kept above anyway. Clients asking for the accounting data of a unit are served from
+         * these for up to Manager.accounting_cache_usec, see unit_accounting_cache_fresh(). */
+        usec_t cpu_usage_timestamp;
+        usec_t io_accounting_timestamp;
+        uint64_t memory_accounting_cache[_CGROUP_MEMORY_ACCOUNTING_METRIC_MAX];
+        usec_t memory_accounting_timestamp[_CGROUP_MEMORY_ACCOUNTING_METRIC_MAX];
+        uint64_t tasks_current_cache;
+        usec_t tasks_current_timestamp;
+
         /* Counterparts in the cgroup filesystem */
         char *cgroup_path;
         uint64_t cgroup_id;
@@ -274,6 +284,15 @@ typedef struct CGroupRuntime {
         CGroupMask cgroup_invalidated_mask;        /* A mask specifying controllers which shall be considered invalidated, and require re-realization */
         CGroupMask cgroup_members_mask;            /* A cache for the controllers required by all children of this cgroup (only relevant for slice units) */
 
+        /* The values we last successfully wrote to the cgroup's attributes, so that we can skip writing the
+         * same value again when the unit is realized once more. Attribute (plus device for per-device
+         * attributes) → value. Flushed whenever the cgroup is invalidated or recreated. */
+        Hashmap *cgroup_attributes_written;
+
+        /* The cgroup directory, while attributes are applied, so that all writes for this cgroup are
+         * relative to it instead of resolving the full path each time */
+        int cgroup_apply_fd;
+
         /* Inotify watch descriptors for watching cgroup.events and memory.events on cgroupv2 */
         int cgroup_control_inotify_wd;
         int cgroup_memory_inotify_wd;
@@ -415,6 +434,7 @@ int unit_get_memory_accounting(Unit *u, CGroupMemoryAccountingMetric metric, uin
 int unit_get_tasks_current(Unit *u, uint64_t *ret);
 int unit_get_cpu_usage(Unit *u, nsec_t *ret);
 int unit_get_io_accounting(Unit *u, CGroupIOAccountingMetric metric, uint64_t *ret);
+int unit_get_io_accounting_all(Unit *u, uint64_t ret[static _CGROUP_IO_ACCOUNTING_METRIC_MAX]);
 int unit_get_ip_accounting(Unit *u, CGroupIPAccountingMetric metric, uint64_t *ret);
 int unit_get_effective_limit(Unit *u, CGroupLimitType type, uint64_t *ret);
 
@@ -432,6 +452,7 @@ bool unit_has_host_root_cgroup(const Unit *u);
 bool unit_has_startup_cgroup_constraints(Unit *u);
 
 bool unit_invalidate_cgroup(Unit *u, CGroupMask m);
+void unit_flush_cgroup_attributes_written(Unit *u);
 void unit_invalidate_cgroup_bpf_firewall(Unit *u);
 
 void manager_invalidate_startup_units(Manager *m);
@@ -43,6 +43,7 @@ typedef struct KillContext KillContext;
 typedef struct Manager Manager;
 typedef struct MountImage MountImage;
 typedef struct PathSpec PathSpec;
+typedef struct PooledExecutor PooledExecutor;
 typedef struct Scope Scope;
 typedef struct Service Service;
 typedef struct Socket Socket;
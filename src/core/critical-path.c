@@ -0,0 +1,299 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <stdio.h>
+
+#include "alloc-util.h"
+#include "cgroup.h"
+#include "critical-path.h"
+#include "extract-word.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "initrd-util.h"
+#include "job.h"
+#include "log.h"
+#include "manager.h"
+#include "memstream-util.h"
+#include "parse-util.h"
+#include "prioq.h"
+#include "set.h"
+#include "string-util.h"
+#include "time-util.h"
+#include "unit.h"
+
+/* Boot-time job scheduling based on the activation times of the previous boot: once the initial transaction
+ * is queued, we predict for each unit how long it takes until the last unit ordered after it (transitively)
+ * is up, using the time each unit took to activate during the previous boot. Jobs of units with the
+ * longest such chain are dispatched first, and the units on the longest chain overall, i.e. the predicted
+ * critical path of the boot, get more CPU and IO while booting. */
+
+#define ACTIVATION_TIMES_PATH "/var/lib/systemd/activation-times"
+#define ACTIVATION_TIMES_MAGIC "systemd-activation-times-v1"
+
+static bool manager_use_critical_path(Manager *m) {
+        assert(m);
+
+        /* /var/ of the initrd is gone after the switch, and for a different root the units wouldn't be
+         * ours. */
+        return m->critical_path_scheduling &&
+                MANAGER_IS_SYSTEM(m) &&
+                !MANAGER_IS_TEST_RUN(m) &&
+                !m->lookup_paths.root_dir &&
+                !in_initrd();
+}
+
+static bool unit_has_start_job(Unit *u) {
+        assert(u);
+
+        return u->job && u->job->type == JOB_START;
+}
+
+int manager_load_activation_times(Manager *m, const char *path) {
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ char *magic = NULL;
+        unsigned n = 0;
+        int r;
+
+        assert(m);
+        assert(path);
+
+        /* The format is line based: a magic line, then one line "USEC UNIT" per unit. */
+
+        f = fopen(path, "re");
+        if (!f)
+                return errno == ENOENT ? 0 : -errno;
+
+        r = read_line(f, LONG_LINE_MAX, &magic);
+        if (r < 0)
+                return r;
+        if (!streq(magic, ACTIVATION_TIMES_MAGIC))
+                return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG), "%s has unknown format, ignoring.", path);
+
+        for (;;) {
+                _cleanup_free_ char *line = NULL, *word = NULL;
+                const char *p;
+                usec_t usec;
+                Unit *u;
+
+                r = read_line(f, LONG_LINE_MAX, &line);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                p = line;
+                r = extract_first_word(&p, &word, NULL, 0);
+                if (r <= 0 || isempty(p) || safe_atou64(word, &usec) < 0) {
+                        log_debug("Invalid line in %s, ignoring: %s", path, line);
+                        continue;
+                }
+
+                u = manager_get_unit(m, p);
+                if (!u)
+                        continue;
+
+                u->predicted_activation_usec = usec;
+                n++;
+        }
+
+        return n;
+}
+
+usec_t unit_critical_path_length(Unit *u) {
+        usec_t longest = 0;
+        Unit *other;
+
+        assert(u);
+
+        if (u->critical_path_computed)
+                return u->critical_path_usec;
+
+        /* Mark the unit first, so that we don't loop forever on ordering cycles. The transaction breaks
+         * those among the jobs it queues, but better be safe. */
+        u->critical_path_computed = true;
+        u->critical_path_usec = u->predicted_activation_usec;
+
+        UNIT_FOREACH_DEPENDENCY(other, u, UNIT_ATOM_BEFORE) {
+                if (!unit_has_start_job(other))
+                        continue;
+
+                longest = MAX(longest, unit_critical_path_length(other));
+        }
+
+        u->critical_path_usec = usec_add(u->predicted_activation_usec, longest);
+        return u->critical_path_usec;
+}
+
+static void unit_boost_critical_path(Unit *u) {
+        assert(u);
+
+        u->on_critical_path = true;
+
+        if (!unit_get_cgroup_context(u))
+                return;
+
+        /* Make sure the weights are reset once the boot is complete, see manager_invalidate_startup_units() */
+        if (set_ensure_put(&u->manager->startup_units, NULL, u) < 0)
+                log_oom_debug();
+
+        unit_invalidate_cgroup_members_masks(u);
+        (void) unit_invalidate_cgroup(u, CGROUP_MASK_CPU|CGROUP_MASK_IO);
+}
+
+int manager_select_critical_path(Manager *m) {
+        _cleanup_free_ Job **queued = NULL;
+        Unit *u, *first = NULL;
+        unsigned n_path = 0;
+        size_t n_queued = 0;
+        Job *j;
+
+        assert(m);
+
+        /* Returns the number of units on the predicted critical path of the queued start jobs, which are
+         * boosted. */
+
+        /* The run queue is ordered by the critical path length (see compare_job_priority()), which we are
+         * about to change, hence take all jobs out first and put them back afterwards. */
+        queued = new(Job*, prioq_size(m->run_queue));
+        if (!queued)
+                return -ENOMEM;
+
+        while ((j = prioq_pop(m->run_queue))) {
+                j->in_run_queue = false;
+                queued[n_queued++] = j;
+        }
+
+        HASHMAP_FOREACH(j, m->jobs) {
+                if (j->type != JOB_START)
+                        continue;
+
+                if (unit_critical_path_length(j->unit) > (first ? first->critical_path_usec : 0))
+                        first = j->unit;
+        }
+
+        FOREACH_ARRAY(i, queued, n_queued)
+                job_add_to_run_queue(*i);
+
+        if (!first)
+                return 0;
+
+        m->critical_path_predicted_usec = first->critical_path_usec;
+        m->critical_path_start_usec = now(CLOCK_MONOTONIC);
+
+        /* Follow the longest chain from the start */
+        for (u = first; u && !u->on_critical_path; n_path++) {
+                Unit *other, *next = NULL;
+
+                unit_boost_critical_path(u);
+
+                UNIT_FOREACH_DEPENDENCY(other, u, UNIT_ATOM_BEFORE)
+                        if (unit_has_start_job(other) &&
+                            (!next || other->critical_path_usec > next->critical_path_usec))
+                                next = other;
+
+                u = next;
+        }
+
+        log_debug("Predicted critical path of %u units, starting with %s, boot predicted to take %s.",
+                  n_path, first->id, FORMAT_TIMESPAN(m->critical_path_predicted_usec, USEC_PER_MSEC));
+        return n_path;
+}
+
+void manager_predict_critical_path(Manager *m) {
+        int r;
+
+        assert(m);
+
+        if (!manager_use_critical_path(m))
+                return;
+
+        /* /var/ might not be mounted yet, in which case we just go without predictions */
+        r = manager_load_activation_times(m, ACTIVATION_TIMES_PATH);
+        if (r < 0)
+                return (void) log_debug_errno(r, "Failed to load %s, ignoring: %m", ACTIVATION_TIMES_PATH);
+        if (r == 0)
+                return (void) log_debug("No activation times of a previous boot known, not predicting critical path.");
+
+        r = manager_select_critical_path(m);
+        if (r < 0)
+                log_debug_errno(r, "Failed to predict critical path, ignoring: %m");
+}
+
+int manager_save_activation_times(Manager *m, const char *path) {
+        _cleanup_(memstream_done) MemStream ms = {};
+        _cleanup_free_ char *buf = NULL;
+        const char *k;
+        unsigned n = 0;
+        FILE *f;
+        Unit *u;
+        int r;
+
+        assert(m);
+        assert(path);
+
+        f = memstream_init(&ms);
+        if (!f)
+                return -ENOMEM;
+
+        fputs(ACTIVATION_TIMES_MAGIC "\n", f);
+
+        HASHMAP_FOREACH_KEY(u, k, m->units) {
+                /* ignore aliases */
+                if (k != u->id)
+                        continue;
+
+                if (!dual_timestamp_is_set(&u->inactive_exit_timestamp) ||
+                    !dual_timestamp_is_set(&u->active_enter_timestamp) ||
+                    u->active_enter_timestamp.monotonic < u->inactive_exit_timestamp.monotonic)
+                        continue;
+
+                fprintf(f, USEC_FMT " %s\n",
+                        u->active_enter_timestamp.monotonic - u->inactive_exit_timestamp.monotonic,
+                        u->id);
+                n++;
+        }
+
+        r = memstream_finalize(&ms, &buf, /* ret_size= */ NULL);
+        if (r < 0)
+                return r;
+
+        r = write_string_file(path, buf,
+                              WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC|
+                              WRITE_STRING_FILE_AVOID_NEWLINE|WRITE_STRING_FILE_MKDIR_0755);
+        if (r < 0)
+                return r;
+
+        log_debug("Saved activation times of %u units to %s.", n, path);
+        return 0;
+}
+
+void manager_finish_critical_path(Manager *m) {
+        Unit *u;
+        int r;
+
+        assert(m);
+
+        if (!manager_use_critical_path(m))
+                return;
+
+        if (m->critical_path_predicted_usec > 0)
+                log_info("Boot transaction took %s, %s were predicted from the previous boot.",
+                         FORMAT_TIMESPAN(usec_sub_unsigned(now(CLOCK_MONOTONIC), m->critical_path_start_usec), USEC_PER_MSEC),
+                         FORMAT_TIMESPAN(m->critical_path_predicted_usec, USEC_PER_MSEC));
+
+        /* From now on jobs are queued one by one again, there's nothing to predict. The boosted weights
+         * are reset by manager_invalidate_startup_units(). */
+        HASHMAP_FOREACH(u, m->units) {
+                if (u->on_critical_path)
+                        /* The unit doesn't need the CPU and IO controllers for the boost anymore */
+                        unit_invalidate_cgroup_members_masks(u);
+
+                u->critical_path_usec = 0;
+                u->critical_path_computed = false;
+                u->on_critical_path = false;
+        }
+
+        /* /var/ is available by now, remember the activation times for the next boot */
+        r = manager_save_activation_times(m, ACTIVATION_TIMES_PATH);
+        if (r < 0)
+                log_debug_errno(r, "Failed to save %s, ignoring: %m", ACTIVATION_TIMES_PATH);
+}
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include "core-forward.h"
+
+/* The CPU and IO weight units on the predicted critical path of the boot get, unless they configure a CPU
+ * or IO weight themselves. */
+#define CGROUP_WEIGHT_CRITICAL_PATH (CGROUP_WEIGHT_DEFAULT * 5)
+
+int manager_load_activation_times(Manager *m, const char *path);
+int manager_save_activation_times(Manager *m, const char *path);
+
+usec_t unit_critical_path_length(Unit *u);
+int manager_select_critical_path(Manager *m);
+
+void manager_predict_critical_path(Manager *m);
+void manager_finish_critical_path(Manager *m);
@@ -5,6 +5,7 @@
 #include "alloc-util.h"
 #include "bus-get-properties.h"
 #include "bus-object.h"
+#include "bus-objects.h"
 #include "bus-util.h"
 #include "dbus.h"
 #include "dbus-job.h"
@@ -233,11 +234,31 @@ static int send_changed_signal(sd_bus *bus, void *userdata) {
         return sd_bus_emit_properties_changed(bus, p, "org.freedesktop.systemd1.Job", "State", NULL);
 }
 
+void bus_job_invalidate_property_cache(Job *j) {
+        _cleanup_free_ char *p = NULL;
+
+        assert(j);
+
+        /* The job type changes when jobs are merged, and once job IDs wrap around, a new job might end up
+         * under the same path and at the same address. See bus_unit_invalidate_property_cache(). */
+
+        if (!j->manager->api_bus || bus_property_cache_isempty(j->manager->api_bus))
+                return;
+
+        p = job_dbus_path(j);
+        if (!p)
+                return (void) log_oom_debug();
+
+        bus_property_cache_invalidate(j->manager->api_bus, p);
+}
+
 void bus_job_send_change_signal(Job *j) {
         int r;
 
         assert(j);
 
+        bus_job_invalidate_property_cache(j);
+
         /* Make sure that any change signal on the unit is reflected before we send out the change signal on the job */
         bus_unit_send_pending_change_signal(j->unit, true);
 
@@ -14,6 +14,7 @@ int bus_job_method_get_waiting_jobs(sd_bus_message *message, void *userdata, sd_
 void bus_job_send_change_signal(Job *j);
 void bus_job_send_pending_change_signal(Job *j, bool including_new);
 void bus_job_send_removed_signal(Job *j);
+void bus_job_invalidate_property_cache(Job *j);
 
 int bus_job_coldplug_bus_track(Job *j);
 int bus_job_track_sender(Job *j, sd_bus_message *m);
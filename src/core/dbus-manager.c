@@ -141,6 +141,34 @@ static int property_get_tainted(
         return sd_bus_message_append(reply, "s", s);
 }
 
+static int property_get_generator_timings(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *reterr_error) {
+
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(bus);
+        assert(reply);
+
+        r = sd_bus_message_open_container(reply, 'a', "(stti)");
+        if (r < 0)
+                return r;
+
+        FOREACH_ARRAY(t, m->generator_timings, m->n_generator_timings) {
+                r = sd_bus_message_append(reply, "(stti)", t->path, t->start, t->finish, (int32_t) t->status);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_bus_message_close_container(reply);
+}
+
 static int property_set_log_target(
                 sd_bus *bus,
                 const char *path,
@@ -1595,6 +1623,51 @@ static int method_reload(sd_bus_message *message, void *userdata, sd_bus_error *
         return 1;
 }
 
+static int method_reload_unit_files(sd_bus_message *message, void *userdata, sd_bus_error *reterr_error) {
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(message);
+
+        r = mac_selinux_access_check(message, "reload", reterr_error);
+        if (r < 0)
+                return r;
+
+        r = bus_verify_reload_daemon_async(m, message, reterr_error);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return 1; /* No authorization for now, but the async polkit stuff will call us again when it has it */
+
+        log_caller(message, m, "Reload of changed unit files");
+
+        if (!ratelimit_below(&m->reload_reexec_ratelimit)) {
+                log_warning("Reloading request rejected due to rate limit.");
+                return sd_bus_error_set(reterr_error,
+                                        SD_BUS_ERROR_LIMITS_EXCEEDED,
+                                        "ReloadUnitFiles() request rejected due to rate limit.");
+        }
+
+        /* Like with Reload(), reply only once the change signals for the reloaded units went out */
+        assert(!m->pending_reload_message_dbus);
+        assert(!m->pending_reload_message_vl);
+        r = sd_bus_message_new_method_return(message, &m->pending_reload_message_dbus);
+        if (r < 0)
+                return r;
+
+        r = manager_reload_unit_files(m);
+        if (r < 0) {
+                m->pending_reload_message_dbus = sd_bus_message_unref(m->pending_reload_message_dbus);
+                return r;
+        }
+        if (r == 0) {
+                log_info("Changed units cannot be reloaded individually, reloading everything.");
+                m->objective = MANAGER_RELOAD;
+        }
+
+        return 1;
+}
+
 static int method_reexecute(sd_bus_message *message, void *userdata, sd_bus_error *reterr_error) {
         Manager *m = ASSERT_PTR(userdata);
         int r;
@@ -2884,6 +2957,7 @@ const sd_bus_vtable bus_manager_vtable[] = {
         BUS_PROPERTY_DUAL_TIMESTAMP("InitRDGeneratorsFinishTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_INITRD_GENERATORS_FINISH]), SD_BUS_VTABLE_PROPERTY_CONST),
         BUS_PROPERTY_DUAL_TIMESTAMP("InitRDUnitsLoadStartTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_INITRD_UNITS_LOAD_START]), SD_BUS_VTABLE_PROPERTY_CONST),
         BUS_PROPERTY_DUAL_TIMESTAMP("InitRDUnitsLoadFinishTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_INITRD_UNITS_LOAD_FINISH]), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("GeneratorTimings", "a(stti)", property_get_generator_timings, 0, 0),
         SD_BUS_WRITABLE_PROPERTY("LogLevel", "s", bus_property_get_log_level, property_set_log_level, 0, 0),
         SD_BUS_WRITABLE_PROPERTY("LogTarget", "s", bus_property_get_log_target, property_set_log_target, 0, 0),
         SD_BUS_PROPERTY("NNames", "u", property_get_hashmap_size, offsetof(Manager, units), 0),
@@ -3245,6 +3319,11 @@ const sd_bus_vtable bus_manager_vtable[] = {
                       NULL,
                       method_reload,
                       SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD("ReloadUnitFiles",
+                      NULL,
+                      NULL,
+                      method_reload_unit_files,
+                      SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("Reexecute",
                       NULL,
                       NULL,
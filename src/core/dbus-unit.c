@@ -8,6 +8,7 @@
 #include "bitfield.h"
 #include "bus-common-errors.h"
 #include "bus-get-properties.h"
+#include "bus-objects.h"
 #include "bus-util.h"
 #include "cgroup-util.h"
 #include "condition.h"
@@ -25,6 +26,7 @@
 #include "namespace-util.h"
 #include "path-util.h"
 #include "pidref.h"
+#include "prioq.h"
 #include "process-util.h"
 #include "selinux-access.h"
 #include "set.h"
@@ -172,10 +174,9 @@ static int property_get_dependencies(
                 void *userdata,
                 sd_bus_error *reterr_error) {
 
-        Unit *u = userdata, *other;
+        Unit *u = userdata;
+        UnitDependencySet *deps;
         UnitDependency d;
-        Hashmap *deps;
-        void *v;
         int r;
 
         assert(bus);
@@ -191,8 +192,8 @@ static int property_get_dependencies(
         if (r < 0)
                 return r;
 
-        HASHMAP_FOREACH_KEY(v, other, deps) {
-                r = sd_bus_message_append(reply, "s", other->id);
+        UNIT_DEPENDENCY_SET_FOREACH(e, deps) {
+                r = sd_bus_message_append(reply, "s", e->unit->id);
                 if (r < 0)
                         return r;
         }
@@ -1836,7 +1837,11 @@ void bus_unit_send_change_signal(Unit *u) {
         assert(u);
 
         if (u->in_dbus_queue) {
-                LIST_REMOVE(dbus_queue, u->manager->dbus_unit_queue, u);
+                if (u->in_dbus_deferred_queue) {
+                        prioq_remove(u->manager->dbus_unit_deferred_queue, u, &u->dbus_deferred_queue_idx);
+                        u->in_dbus_deferred_queue = false;
+                } else
+                        LIST_REMOVE(dbus_queue, u->manager->dbus_unit_queue, u);
                 u->in_dbus_queue = false;
 
                 /* The unit might be good to be GC once its pending signals have been sent */
@@ -1846,11 +1851,30 @@ void bus_unit_send_change_signal(Unit *u) {
         if (!u->id)
                 return;
 
+        /* Whatever changed since the unit was queued must not be served from the property cache */
+        bus_unit_invalidate_property_cache(u);
+
         r = bus_foreach_bus(u->manager, u->bus_track, u->sent_dbus_new_signal ? send_changed_signal : send_new_signal, u);
         if (r < 0)
                 log_unit_debug_errno(u, r, "Failed to send unit change signal for %s: %m", u->id);
 
         u->sent_dbus_new_signal = true;
+        u->dbus_change_signal_timestamp = now(CLOCK_MONOTONIC);
+}
+
+usec_t bus_unit_change_signal_due(Unit *u) {
+        assert(u);
+
+        /* Returns the earliest time (CLOCK_MONOTONIC) the change signal for the unit may be sent at because
+         * of PropertiesChangedIntervalSec=, or 0 if it may be sent right away. Only the latest state is sent
+         * once the interval passed, intermediate states are skipped. UnitNew is never deferred. */
+
+        if (u->manager->properties_changed_interval_usec == 0 ||
+            !u->sent_dbus_new_signal ||
+            u->dbus_change_signal_timestamp == 0)
+                return 0;
+
+        return usec_add(u->dbus_change_signal_timestamp, u->manager->properties_changed_interval_usec);
 }
 
 void bus_unit_send_pending_change_signal(Unit *u, bool including_new) {
@@ -1871,6 +1895,13 @@ void bus_unit_send_pending_change_signal(Unit *u, bool including_new) {
                                                * when we are reloading. */
                 return;
 
+        if (u->manager->properties_changed_interval_usec > 0 &&
+            !including_new && u->sent_dbus_new_signal) /* Clients asked to get at most one signal per interval,
+                                                        * hence don't force out intermediate states, the latest
+                                                        * one is sent eventually. Job signals however need to
+                                                        * be preceded by UnitNew and the unit's current state. */
+                return;
+
         bus_unit_send_change_signal(u);
 }
 
@@ -1906,12 +1937,12 @@ int bus_unit_send_pending_freezer_message(Unit *u, bool canceled) {
 static int send_removed_signal(sd_bus *bus, void *userdata) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
         _cleanup_free_ char *p = NULL;
-        Unit *u = ASSERT_PTR(userdata);
+        const char *id = ASSERT_PTR(userdata);
         int r;
 
         assert(bus);
 
-        p = unit_dbus_path(u);
+        p = unit_dbus_path_from_name(id);
         if (!p)
                 return -ENOMEM;
 
@@ -1924,28 +1955,92 @@ static int send_removed_signal(sd_bus *bus, void *userdata) {
         if (r < 0)
                 return r;
 
-        r = sd_bus_message_append(m, "so", u->id, p);
+        r = sd_bus_message_append(m, "so", id, p);
         if (r < 0)
                 return r;
 
         return sd_bus_send(bus, m, NULL);
 }
 
+void bus_unit_invalidate_property_cache(Unit *u) {
+        const char *n;
+
+        assert(u);
+
+        /* The API bus caches the constant properties of units by object path and Unit pointer. Drop them
+         * whenever the unit changes or goes away, so that neither the unit itself nor a new unit that ends
+         * up at the same address is served stale data. During reloading the whole cache is flushed anyway,
+         * see bus_invalidate_property_caches(). */
+
+        if (!u->manager->api_bus ||
+            bus_property_cache_isempty(u->manager->api_bus) ||
+            MANAGER_IS_RELOADING(u->manager))
+                return;
+
+        FOREACH_ARGUMENT(n, u->id, u->invocation_id_string) {
+                _cleanup_free_ char *p = NULL;
+
+                if (isempty(n))
+                        continue;
+
+                p = unit_dbus_path_from_name(n);
+                if (!p)
+                        return (void) log_oom_debug();
+
+                bus_property_cache_invalidate(u->manager->api_bus, p);
+        }
+
+        SET_FOREACH(n, u->aliases) {
+                _cleanup_free_ char *p = NULL;
+
+                p = unit_dbus_path_from_name(n);
+                if (!p)
+                        return (void) log_oom_debug();
+
+                bus_property_cache_invalidate(u->manager->api_bus, p);
+        }
+}
+
 void bus_unit_send_removed_signal(Unit *u) {
         int r;
         assert(u);
 
+        /* A unit nobody was told about can go away silently, there's no point in a UnitNew immediately
+         * followed by UnitRemoved. Clients that track the unit explicitly keep it from being GC'ed, hence
+         * this is only hit for units that are of no interest to anyone. */
+        if (!u->id || (!u->sent_dbus_new_signal && sd_bus_track_count(u->bus_track) <= 0))
+                return;
+
+        /* While reloading all units are freed and most of them come back right away. Only remember the
+         * name, manager_dispatch_dbus_queue() sends UnitRemoved once the reload is done if the unit didn't
+         * return, and a change signal otherwise. */
+        if (MANAGER_IS_RELOADING(u->manager)) {
+                r = set_put_strdup(&u->manager->dbus_units_freed_while_reloading, u->id);
+                if (r >= 0)
+                        return;
+
+                log_unit_debug_errno(u, r, "Failed to remember unit as removed while reloading, sending signal right-away: %m");
+        }
+
         if (!u->sent_dbus_new_signal || u->in_dbus_queue)
                 bus_unit_send_change_signal(u);
 
-        if (!u->id)
-                return;
-
-        r = bus_foreach_bus(u->manager, u->bus_track, send_removed_signal, u);
+        r = bus_foreach_bus(u->manager, u->bus_track, send_removed_signal, u->id);
         if (r < 0)
                 log_unit_debug_errno(u, r, "Failed to send unit remove signal for %s: %m", u->id);
 }
 
+void bus_send_unit_removed_signal(Manager *m, const char *id) {
+        int r;
+
+        assert(m);
+        assert(id);
+
+        r = bus_foreach_bus(m, /* track= */ NULL, send_removed_signal, (void*) id);
+        if (r < 0)
+                log_debug_errno(r, "Failed to send unit remove signal for %s: %m", id);
+}
+
 int bus_unit_queue_job_one(
                 sd_bus_message *message,
                 Unit *u,
@@ -2631,6 +2726,11 @@ int bus_unit_set_properties(
                                 goto error;
 
                         for_real = true;
+
+                        /* The execution context is about to change, don't pass a stale copy of it to the
+                         * next process we spawn */
+                        u->exec_context_serialized = mfree(u->exec_context_serialized);
+                        u->exec_context_serialized_size = 0;
                         continue;
                 }
 
@@ -2675,6 +2775,11 @@ int bus_unit_set_properties(
         if (r < 0)
                 goto error;
 
+        /* Settings changed at runtime are applied in full, i.e. all cgroup attributes are written again on
+         * the next realization, even those we believe to be set already. */
+        if (n > 0)
+                unit_flush_cgroup_attributes_written(u);
+
         if (commit && n > 0 && UNIT_VTABLE(u)->bus_commit_properties)
                 UNIT_VTABLE(u)->bus_commit_properties(u);
 
@@ -9,9 +9,12 @@ extern const sd_bus_vtable bus_unit_vtable[];
 extern const sd_bus_vtable bus_unit_cgroup_vtable[];
 
 void bus_unit_send_change_signal(Unit *u);
+usec_t bus_unit_change_signal_due(Unit *u);
 void bus_unit_send_pending_change_signal(Unit *u, bool including_new);
 int bus_unit_send_pending_freezer_message(Unit *u, bool canceled);
 void bus_unit_send_removed_signal(Unit *u);
+void bus_send_unit_removed_signal(Manager *m, const char *id);
+void bus_unit_invalidate_property_cache(Unit *u);
 
 int bus_unit_method_start_generic(sd_bus_message *message, Unit *u, JobType job_type, bool reload_if_possible, sd_bus_error *reterr_error);
 int bus_unit_method_enqueue_job(sd_bus_message *message, void *userdata, sd_bus_error *reterr_error);
@@ -10,6 +10,7 @@
 #include "bus-error.h"
 #include "bus-internal.h"
 #include "bus-object.h"
+#include "bus-objects.h"
 #include "bus-util.h"
 #include "dbus.h"
 #include "dbus-automount.h"
@@ -783,6 +784,25 @@ static int bus_setup_api(Manager *m, sd_bus *bus) {
         if (r < 0)
                 return r;
 
+        /* Monitoring tools tend to poll GetAll() on all units, let's not recalculate constant properties
+         * for each of those calls. Private connections are short-lived, hence not worth it there. */
+        r = bus_set_property_cache(bus, true);
+        if (r < 0)
+                log_warning_errno(r, "Failed to enable property cache, ignoring: %m");
+        else
+                /* The unit/self path refers to the caller's unit, hence whatever we cache for it might belong
+                 * to a unit that has been freed since. Several properties of the manager object are
+                 * declared constant but change while booting (FinishTimestamp, Tainted, …), and nothing
+                 * tells the cache about that. */
+                FOREACH_STRING(path, "/org/freedesktop/systemd1/unit/self", "/org/freedesktop/systemd1") {
+                        r = bus_property_cache_exclude(bus, path);
+                        if (r < 0) {
+                                log_warning_errno(r, "Failed to exclude %s from property cache, disabling it: %m", path);
+                                (void) bus_set_property_cache(bus, false);
+                                break;
+                        }
+                }
+
         HASHMAP_FOREACH_KEY(u, name, m->watch_bus) {
                 r = unit_install_bus_match(u, bus, name);
                 if (r < 0)
@@ -1135,6 +1155,13 @@ void bus_track_serialize(sd_bus_track *t, FILE *f, const char *prefix) {
         }
 }
 
+void bus_invalidate_property_caches(Manager *m) {
+        assert(m);
+
+        if (m->api_bus)
+                bus_property_cache_invalidate(m->api_bus, NULL);
+}
+
 uint64_t manager_bus_n_queued_write(Manager *m) {
         uint64_t c = 0;
         sd_bus *b;
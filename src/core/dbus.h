@@ -20,6 +20,8 @@ void bus_track_serialize(sd_bus_track *t, FILE *f, const char *prefix);
 
 int bus_foreach_bus(Manager *m, sd_bus_track *subscribed2, int (*send_message)(sd_bus *bus, void *userdata), void *userdata);
 
+void bus_invalidate_property_caches(Manager *m);
+
 uint64_t manager_bus_n_queued_write(Manager *m);
 
 void dump_bus_properties(FILE *f);
@@ -12,10 +12,12 @@
 #include "extract-word.h"
 #include "hashmap.h"
 #include "log.h"
+#include "log-context.h"
 #include "manager.h"
 #include "path-util.h"
 #include "serialize.h"
 #include "set.h"
+#include "siphash24.h"
 #include "string-util.h"
 #include "strv.h"
 #include "swap.h"
@@ -23,6 +25,11 @@
 #include "unit.h"
 #include "unit-name.h"
 
+/* How many uevents to pick up from the monitor in one go, so that other event sources don't starve */
+#define DEVICE_EVENT_BATCH_MAX 256U
+
+#define UDEV_PROPERTIES_HASH_KEY SD_ID128_MAKE(a4,6e,13,c2,5b,f8,4d,07,9a,31,e2,6c,58,d4,0b,7f)
+
 static const UnitActiveState state_translation_table[_DEVICE_STATE_MAX] = {
         [DEVICE_DEAD]      = UNIT_INACTIVE,
         [DEVICE_TENTATIVE] = UNIT_ACTIVATING,
@@ -486,11 +493,13 @@ static void device_dump(Unit *u, FILE *f, const char *prefix) {
                 "%sDevice State: %s\n"
                 "%sDevice Path: %s\n"
                 "%sSysfs Path: %s\n"
-                "%sFound: %s\n",
+                "%sFound: %s\n"
+                "%sudev Properties Hash: %016" PRIx64 "\n",
                 prefix, device_state_to_string(d->state),
                 prefix, strna(d->path),
                 prefix, strna(d->sysfs),
-                prefix, strna(s));
+                prefix, strna(s),
+                prefix, d->udev_properties_hash);
 
         STRV_FOREACH(i, d->wants_property)
                 fprintf(f, "%sudev SYSTEMD_WANTS: %s\n",
@@ -540,6 +549,46 @@ static int device_update_description(Unit *u, sd_device *dev, const char *path)
         return 0;
 }
 
+static const char* device_wants_property(Manager *m) {
+        return MANAGER_IS_USER(ASSERT_PTR(m)) ? "SYSTEMD_USER_WANTS" : "SYSTEMD_WANTS";
+}
+
+static void device_start_udev_wants(Device *d, char * const *added) {
+        Unit *u = UNIT(ASSERT_PTR(d));
+        int r;
+
+        if (d->state == DEVICE_DEAD)
+                return;
+
+        /* So here's a special hack, to compensate for the fact that the udev database's reload cycles are not
+         * synchronized with our own reload cycles: when we detect that the SYSTEMD_WANTS property of a device
+         * changes while the device unit is already up, let's skip to trigger units that were already listed
+         * and are active, and start units otherwise. This typically happens during the boot-time switch root
+         * transition, as udev devices will generally already be up in the initrd, but SYSTEMD_WANTS properties
+         * get then added through udev rules only available on the host system, and thus only when the initial
+         * udev coldplug trigger runs.
+         *
+         * We do this only if the device has been up already when we parse this, as otherwise the usual
+         * dependency logic that is run from the dead → plugged transition will trigger these deps. */
+        STRV_FOREACH(i, added) {
+                _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+
+                if (strv_contains(d->wants_property, *i)) {
+                        Unit *v;
+
+                        v = manager_get_unit(u->manager, *i);
+                        if (v && UNIT_IS_ACTIVE_OR_RELOADING(unit_active_state(v)))
+                                continue; /* The unit was already listed and is running. */
+                }
+
+                r = manager_add_job_by_name(u->manager, JOB_START, *i, JOB_FAIL, NULL, &error, NULL);
+                if (r < 0)
+                        log_unit_full_errno(u, sd_bus_error_has_name(&error, BUS_ERROR_NO_SUCH_UNIT) ? LOG_DEBUG : LOG_WARNING, r,
+                                            "Failed to enqueue %s job, ignoring: %s",
+                                            device_wants_property(u->manager), bus_error_message(&error, r));
+        }
+}
+
 static int device_add_udev_wants(Unit *u, sd_device *dev) {
         Device *d = ASSERT_PTR(DEVICE(u));
         _cleanup_strv_free_ char **added = NULL;
@@ -548,7 +597,7 @@ static int device_add_udev_wants(Unit *u, sd_device *dev) {
 
         assert(dev);
 
-        property = MANAGER_IS_USER(u->manager) ? "SYSTEMD_USER_WANTS" : "SYSTEMD_WANTS";
+        property = device_wants_property(u->manager);
 
         r = sd_device_get_property_value(dev, property, &wants);
         if (r < 0)
@@ -595,35 +644,39 @@ static int device_add_udev_wants(Unit *u, sd_device *dev) {
                         return log_oom();
         }
 
-        if (d->state != DEVICE_DEAD)
-                /* So here's a special hack, to compensate for the fact that the udev database's reload cycles are not
-                 * synchronized with our own reload cycles: when we detect that the SYSTEMD_WANTS property of a device
-                 * changes while the device unit is already up, let's skip to trigger units that were already listed
-                 * and are active, and start units otherwise. This typically happens during the boot-time switch root
-                 * transition, as udev devices will generally already be up in the initrd, but SYSTEMD_WANTS properties
-                 * get then added through udev rules only available on the host system, and thus only when the initial
-                 * udev coldplug trigger runs.
-                 *
-                 * We do this only if the device has been up already when we parse this, as otherwise the usual
-                 * dependency logic that is run from the dead → plugged transition will trigger these deps. */
-                STRV_FOREACH(i, added) {
-                        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        device_start_udev_wants(d, added);
 
-                        if (strv_contains(d->wants_property, *i)) {
-                                Unit *v;
+        return strv_free_and_replace(d->wants_property, added);
+}
 
-                                v = manager_get_unit(u->manager, *i);
-                                if (v && UNIT_IS_ACTIVE_OR_RELOADING(unit_active_state(v)))
-                                        continue; /* The unit was already listed and is running. */
-                        }
+static uint64_t device_udev_properties_hash(Manager *m, sd_device *dev, const char *sysfs, bool main) {
+        struct siphash state;
+        const char *v;
 
-                        r = manager_add_job_by_name(u->manager, JOB_START, *i, JOB_FAIL, NULL, &error, NULL);
-                        if (r < 0)
-                                log_unit_full_errno(u, sd_bus_error_has_name(&error, BUS_ERROR_NO_SUCH_UNIT) ? LOG_DEBUG : LOG_WARNING, r,
-                                                    "Failed to enqueue %s job, ignoring: %s", property, bus_error_message(&error, r));
-                }
+        assert(m);
+        assert(dev);
+        assert(sysfs);
 
-        return strv_free_and_replace(d->wants_property, added);
+        /* Covers everything the udev dependencies of a device unit are derived from, so that they only need
+         * to be recalculated if any of it changed. Note that other properties may well change with each
+         * uevent, but we don't care about them here. */
+
+        siphash24_init(&state, UDEV_PROPERTIES_HASH_KEY.bytes);
+        siphash24_compress_boolean(main, &state);
+        string_hash_func(sysfs, &state);
+
+        v = NULL;
+        (void) sd_device_get_property_value(dev, device_wants_property(m), &v);
+        siphash24_compress_boolean(v, &state);
+        string_hash_func(strempty(v), &state);
+
+        v = NULL;
+        (void) sd_device_get_property_value(dev, "SYSTEMD_MOUNT_DEVICE_BOUND", &v);
+        siphash24_compress_boolean(v, &state);
+        string_hash_func(strempty(v), &state);
+
+        /* Zero is reserved for "unknown" */
+        return siphash24_finalize(&state) ?: 1;
 }
 
 static bool device_is_bound_by_mounts(Device *d, sd_device *dev) {
@@ -642,15 +695,15 @@ static bool device_is_bound_by_mounts(Device *d, sd_device *dev) {
 }
 
 static void device_upgrade_mount_deps(Unit *u) {
-        Unit *other;
-        void *v;
         int r;
 
         /* Let's upgrade Requires= to BindsTo= on us. (Used when SYSTEMD_MOUNT_DEVICE_BOUND is set) */
 
         assert(u);
 
-        HASHMAP_FOREACH_KEY(v, other, unit_get_dependencies(u, UNIT_REQUIRED_BY)) {
+        UNIT_DEPENDENCY_SET_FOREACH(e, unit_get_dependencies(u, UNIT_REQUIRED_BY)) {
+                Unit *other = e->unit;
+
                 if (other->type != UNIT_MOUNT)
                         continue;
 
@@ -664,6 +717,8 @@ static int device_setup_unit(Manager *m, sd_device *dev, const char *path, bool
         _cleanup_(unit_freep) Unit *new_unit = NULL;
         _cleanup_free_ char *e = NULL;
         const char *sysfs = NULL;
+        uint64_t hash = 0;
+        bool unchanged = false;
         Unit *u;
         int r;
 
@@ -674,6 +729,8 @@ static int device_setup_unit(Manager *m, sd_device *dev, const char *path, bool
                 r = sd_device_get_syspath(dev, &sysfs);
                 if (r < 0)
                         return log_device_debug_errno(dev, r, "Couldn't get syspath from device, ignoring: %m");
+
+                hash = device_udev_properties_hash(m, dev, sysfs, main);
         }
 
         r = unit_name_from_path(path, ".device", &e);
@@ -696,9 +753,12 @@ static int device_setup_unit(Manager *m, sd_device *dev, const char *path, bool
                  * devices have the same devlink (e.g. /dev/disk/by-uuid/xxxx), adding/updating/removing one of the
                  * device causes syspath change. Hence, let's always update sysfs path. */
 
-                /* Let's remove all dependencies generated due to udev properties. We'll re-add whatever is configured
-                 * now below. */
-                unit_remove_dependencies(u, UNIT_DEPENDENCY_UDEV);
+                /* Most uevents don't change anything the udev dependencies are derived from, in which case
+                 * there's no point in dropping and recreating them. Otherwise, let's remove all dependencies
+                 * generated due to udev properties. We'll re-add whatever is configured now below. */
+                unchanged = hash != 0 && DEVICE(u)->udev_properties_hash == hash;
+                if (!unchanged)
+                        unit_remove_dependencies(u, UNIT_DEPENDENCY_UDEV);
 
         } else {
                 r = unit_new_for_name(m, sizeof(Device), e, &new_unit);
@@ -726,10 +786,16 @@ static int device_setup_unit(Manager *m, sd_device *dev, const char *path, bool
                         return log_unit_error_errno(u, r, "Failed to set sysfs path %s: %m", sysfs);
 
                 /* The additional systemd udev properties we only interpret for the main object */
-                if (main)
-                        (void) device_add_udev_wants(u, dev);
+                if (main) {
+                        if (unchanged)
+                                device_start_udev_wants(d, d->wants_property);
+                        else if (device_add_udev_wants(u, dev) < 0)
+                                hash = 0; /* Try again next time */
+                }
         }
 
+        d->udev_properties_hash = hash;
+
         (void) device_update_description(u, dev, path);
 
         /* So the user wants the mount units to be bound to the device but a mount unit might has been seen
@@ -1141,29 +1207,25 @@ static void device_remove_old_on_move(Manager *m, sd_device *dev) {
         device_update_found_by_sysfs(m, syspath_old, DEVICE_NOT_FOUND, _DEVICE_FOUND_MASK);
 }
 
-static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *userdata) {
-        Manager *m = ASSERT_PTR(userdata);
+static void device_process_uevent(Manager *m, sd_device *dev) {
         sd_device_action_t action;
         const char *sysfs;
         bool ready;
         Device *d;
         int r;
 
+        assert(m);
         assert(dev);
 
         log_device_uevent(dev, "Processing udev action");
 
         r = sd_device_get_syspath(dev, &sysfs);
-        if (r < 0) {
-                log_device_warning_errno(dev, r, "Failed to get device syspath, ignoring: %m");
-                return 0;
-        }
+        if (r < 0)
+                return (void) log_device_warning_errno(dev, r, "Failed to get device syspath, ignoring: %m");
 
         r = sd_device_get_action(dev, &action);
-        if (r < 0) {
-                log_device_warning_errno(dev, r, "Failed to get udev action, ignoring: %m");
-                return 0;
-        }
+        if (r < 0)
+                return (void) log_device_warning_errno(dev, r, "Failed to get udev action, ignoring: %m");
 
         log_device_debug(dev, "Got '%s' action on syspath '%s'.", device_action_to_string(action), sysfs);
 
@@ -1186,7 +1248,7 @@ static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *
                 } else
                         log_device_warning(dev, "systemd-udevd failed to process the device with unknown result, ignoring.");
 
-                return 0;
+                return;
         }
 
         /* A change event can signal that a device is becoming ready, in particular if the device is using
@@ -1229,6 +1291,129 @@ static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *
          * the rest around. This may be redundant for remove uevent, but should be harmless. */
         SET_FOREACH(d, not_ready_units)
                 device_update_found_one(d, DEVICE_NOT_FOUND, DEVICE_FOUND_UDEV);
+}
+
+static void device_unref_many(sd_device **devices, size_t n_devices) {
+        assert(devices || n_devices == 0);
+
+        FOREACH_ARRAY(i, devices, n_devices)
+                sd_device_unref(*i);
+
+        free(devices);
+}
+
+static bool device_event_can_coalesce(sd_device *dev) {
+        assert(dev);
+
+        /* Only plain 'change' uevents are coalesced: each of them carries the full current state of the
+         * device, hence only the last one matters. Don't let a failed one replace a good one though. */
+        return device_for_action(dev, SD_DEVICE_CHANGE) &&
+                sd_device_get_property_value(dev, "UDEV_WORKER_FAILED", NULL) < 0;
+}
+
+static int device_event_queue_add(sd_device ***queue, size_t *n_queue, Hashmap **last_by_syspath, sd_device *dev) {
+        const char *syspath;
+        bool superseded = false;
+        int r;
+
+        assert(queue);
+        assert(n_queue);
+        assert(last_by_syspath);
+        assert(dev);
+
+        /* Returns > 0 if an earlier uevent got superseded by this one */
+
+        if (!GREEDY_REALLOC(*queue, *n_queue + 1))
+                return -ENOMEM;
+
+        if (sd_device_get_syspath(dev, &syspath) < 0) {
+                (*queue)[(*n_queue)++] = sd_device_ref(dev);
+                return 0;
+        }
+
+        if (device_event_can_coalesce(dev)) {
+                void *p;
+
+                p = hashmap_get(*last_by_syspath, syspath);
+                if (p) {
+                        sd_device **prev = *queue + PTR_TO_SIZE(p) - 1;
+
+                        if (*prev && device_event_can_coalesce(*prev)) {
+                                log_device_debug(dev, "Superseding earlier 'change' uevent for the same device.");
+
+                                /* The key points into the device we are about to drop */
+                                assert_se(hashmap_remove(*last_by_syspath, syspath));
+                                *prev = sd_device_unref(*prev);
+                                superseded = true;
+                        }
+                }
+        }
+
+        /* Note the queued device owns the syspath string used as key. */
+        r = hashmap_ensure_replace(last_by_syspath, &path_hash_ops, syspath, SIZE_TO_PTR(*n_queue + 1));
+        if (r < 0)
+                return r;
+
+        (*queue)[(*n_queue)++] = sd_device_ref(dev);
+        return superseded;
+}
+
+static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        _cleanup_hashmap_free_ Hashmap *last_by_syspath = NULL;
+        sd_device **queue = NULL;
+        size_t n_queue = 0, n_superseded = 0;
+        int r;
+
+        assert(monitor);
+        assert(dev);
+
+        CLEANUP_ARRAY(queue, n_queue, device_unref_many);
+
+        /* During coldplug and on hosts with many devices uevents come in bursts, often with several 'change'
+         * uevents for the same device. Let's pick up what is already queued on the monitor in one go, so that
+         * we only process the latest state of each device. */
+
+        r = device_event_queue_add(&queue, &n_queue, &last_by_syspath, dev);
+        if (r < 0) {
+                log_oom_warning();
+                device_process_uevent(m, dev);
+                return 0;
+        }
+
+        while (n_queue < DEVICE_EVENT_BATCH_MAX) {
+                _cleanup_(sd_device_unrefp) sd_device *d = NULL;
+
+                r = sd_device_monitor_receive(monitor, &d);
+                if (r < 0) {
+                        if (!ERRNO_IS_NEG_TRANSIENT(r))
+                                log_debug_errno(r, "Failed to receive further uevents, processing what we have: %m");
+                        break;
+                }
+                if (r == 0) /* filtered out */
+                        continue;
+
+                r = device_event_queue_add(&queue, &n_queue, &last_by_syspath, d);
+                if (r < 0) {
+                        log_oom_warning();
+                        device_process_uevent(m, d);
+                } else if (r > 0)
+                        n_superseded++;
+        }
+
+        if (n_queue > 1)
+                log_debug("Processing %zu queued uevents, %zu of them superseded.", n_queue, n_superseded);
+
+        FOREACH_ARRAY(i, queue, n_queue) {
+                if (!*i)
+                        continue;
+
+                _unused_ _cleanup_(log_context_unrefp) LogContext *c = NULL;
+                if (*i != dev && log_context_enabled())
+                        c = log_context_new_strv_consume(device_make_log_fields(*i));
+
+                device_process_uevent(m, *i);
+        }
 
         return 0;
 }
@@ -35,6 +35,10 @@ typedef struct Device {
 
         /* The SYSTEMD_WANTS udev property for this device the last time we saw it */
         char **wants_property;
+
+        /* Hash of the udev properties the udev dependencies of this unit were last derived from, or 0 if
+         * they need to be recalculated on the next uevent */
+        uint64_t udev_properties_hash;
 } Device;
 
 extern const UnitVTable device_vtable;
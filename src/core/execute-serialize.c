@@ -7,6 +7,7 @@
 #include "cgroup.h"
 #include "dissect-image.h"
 #include "dynamic-user.h"
+#include "errno-util.h"
 #include "escape.h"
 #include "exec-credential.h"
 #include "execute.h"
@@ -17,6 +18,7 @@
 #include "image-policy.h"
 #include "in-addr-prefix-util.h"
 #include "log.h"
+#include "memstream-util.h"
 #include "nsflags.h"
 #include "open-file.h"
 #include "ordered-set.h"
@@ -3677,10 +3679,35 @@ static int exec_command_deserialize(ExecCommand *c, FILE *f) {
         return 0;
 }
 
+int exec_context_serialize_to_buffer(const ExecContext *c, char **ret, size_t *ret_size) {
+        _cleanup_(memstream_done) MemStream m = {};
+        FILE *f;
+        int r;
+
+        assert(c);
+        assert(ret);
+        assert(ret_size);
+
+        /* Serializes the execution context into a buffer, so that units that are started many times don't
+         * have to format the same context over and over again */
+
+        f = memstream_init(&m);
+        if (!f)
+                return -ENOMEM;
+
+        r = exec_context_serialize(c, f);
+        if (r < 0)
+                return r;
+
+        return memstream_finalize(&m, ret, ret_size);
+}
+
 int exec_serialize_invocation(
                 FILE *f,
                 FDSet *fds,
                 const ExecContext *ctx,
+                const char *ctx_serialized,
+                size_t ctx_serialized_size,
                 const ExecCommand *cmd,
                 const ExecParameters *p,
                 const ExecRuntime *rt,
@@ -3691,9 +3718,15 @@ int exec_serialize_invocation(
         assert(f);
         assert(fds);
 
-        r = exec_context_serialize(ctx, f);
-        if (r < 0)
-                return log_debug_errno(r, "Failed to serialize context: %m");
+        /* If the context has been serialized before and didn't change since, reuse that */
+        if (ctx && ctx_serialized) {
+                if (fwrite(ctx_serialized, 1, ctx_serialized_size, f) != ctx_serialized_size)
+                        return log_debug_errno(errno_or_else(EIO), "Failed to write serialized context: %m");
+        } else {
+                r = exec_context_serialize(ctx, f);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to serialize context: %m");
+        }
 
         r = exec_command_serialize(cmd, f);
         if (r < 0)
@@ -6,9 +6,13 @@
 /* These functions serialize/deserialize for invocation purposes (i.e.: serialized object is passed to a
  * child process) rather than to save state across reload/reexec. */
 
+int exec_context_serialize_to_buffer(const ExecContext *c, char **ret, size_t *ret_size);
+
 int exec_serialize_invocation(FILE *f,
         FDSet *fds,
         const ExecContext *ctx,
+        const char *ctx_serialized,
+        size_t ctx_serialized_size,
         const ExecCommand *cmd,
         const ExecParameters *p,
         const ExecRuntime *rt,
@@ -25,6 +25,7 @@
 #include "escape.h"
 #include "execute.h"
 #include "execute-serialize.h"
+#include "executor-pool.h"
 #include "fd-util.h"
 #include "fdset.h"
 #include "fileio.h"
@@ -543,7 +544,28 @@ int exec_spawn(
         if (!fdset)
                 return log_oom();
 
-        r = exec_serialize_invocation(f, fdset, context, command, params, runtime, cgroup_context);
+        /* The execution context only changes when the unit is loaded or its properties are set, hence
+         * serialize it only once and reuse it for all further spawns. */
+        bool reuse_context = unit_get_exec_context(unit) == context;
+        if (reuse_context && !unit->exec_context_serialized) {
+                r = exec_context_serialize_to_buffer(
+                                context,
+                                &unit->exec_context_serialized,
+                                &unit->exec_context_serialized_size);
+                if (r < 0)
+                        log_unit_debug_errno(unit, r, "Failed to serialize execution context for reuse, ignoring: %m");
+        }
+
+        r = exec_serialize_invocation(
+                        f,
+                        fdset,
+                        context,
+                        reuse_context ? unit->exec_context_serialized : NULL,
+                        reuse_context ? unit->exec_context_serialized_size : 0,
+                        command,
+                        params,
+                        runtime,
+                        cgroup_context);
         if (r < 0)
                 return log_unit_error_errno(unit, r, "Failed to serialize parameters: %m");
 
@@ -572,46 +594,60 @@ int exec_spawn(
         _cleanup_(pidref_done) PidRef pidref = PIDREF_NULL;
         dual_timestamp start_timestamp;
 
-        /* Restore the original ambient capability set the manager was started with to pass it to
-         * sd-executor. */
-        r = capability_ambient_set_apply(unit->manager->saved_ambient_set, /* also_inherit= */ false);
-        if (r < 0)
-                return log_unit_error_errno(unit, r, "Failed to apply the starting ambient set: %m");
-
-        /* Record the start timestamp before we fork so that it is guaranteed to be earlier than the
-         * handoff timestamp. */
+        /* Record the start timestamp before we fork (or hand the work to an already running executor) so
+         * that it is guaranteed to be earlier than the handoff timestamp. */
         dual_timestamp_now(&start_timestamp);
 
-        /* The executor binary is pinned, to avoid compatibility problems during upgrades. */
-        r = posix_spawn_wrapper(
-                        FORMAT_PROC_FD_PATH(unit->manager->executor_fd),
-                        STRV_MAKE(unit->manager->executor_path,
-                                  "--deserialize", serialization_fd_number,
-                                  "--log-level", max_log_levels,
-                                  "--log-target", log_target_to_string(manager_get_executor_log_target(unit->manager))),
-                        environ,
+        r = executor_pool_spawn(
+                        unit->manager,
+                        fileno(f),
+                        fdset,
+                        max_log_levels,
+                        log_target_to_string(manager_get_executor_log_target(unit->manager)),
                         cgtarget,
                         &pidref);
-
-        /* Drop the ambient set again, so no processes other than sd-executore spawned from the manager inherit it. */
-        (void) capability_ambient_set_apply(0, /* also_inherit= */ false);
-
-        if (r == -EUCLEAN && cgtarget)
-                return log_unit_error_errno(unit, r,
-                                            "Failed to spawn process into cgroup '%s', because the cgroup "
-                                            "or one of its parents or siblings is in the threaded mode.",
-                                            cgtarget);
         if (r < 0)
-                return log_unit_error_errno(unit, r, "Failed to spawn executor: %m");
-        /* We add the new process to the cgroup both in the child (so that we can be sure that no user code is ever
-         * executed outside of the cgroup) and in the parent (so that we can be sure that when we kill the cgroup the
-         * process will be killed too). */
-        if (r == 0 && cgtarget)
-                (void) cg_attach(cgtarget, pidref.pid);
-        /* r > 0: Already in the right cgroup thanks to CLONE_INTO_CGROUP */
-
-        log_unit_debug(unit, "Forked %s as " PID_FMT " (%s CLONE_INTO_CGROUP)",
-                       command->path, pidref.pid, r > 0 ? "via" : "without");
+                return log_unit_error_errno(unit, r, "Failed to hand work to pooled executor: %m");
+        if (r > 0)
+                log_unit_debug(unit, "Handed %s to pooled executor " PID_FMT ".", command->path, pidref.pid);
+        else {
+                /* Restore the original ambient capability set the manager was started with to pass it to
+                 * sd-executor. */
+                r = capability_ambient_set_apply(unit->manager->saved_ambient_set, /* also_inherit= */ false);
+                if (r < 0)
+                        return log_unit_error_errno(unit, r, "Failed to apply the starting ambient set: %m");
+
+                /* The executor binary is pinned, to avoid compatibility problems during upgrades. */
+                r = posix_spawn_wrapper(
+                                FORMAT_PROC_FD_PATH(unit->manager->executor_fd),
+                                STRV_MAKE(unit->manager->executor_path,
+                                          "--deserialize", serialization_fd_number,
+                                          "--log-level", max_log_levels,
+                                          "--log-target", log_target_to_string(manager_get_executor_log_target(unit->manager))),
+                                environ,
+                                cgtarget,
+                                &pidref);
+
+                /* Drop the ambient set again, so no processes other than sd-executore spawned from the manager inherit it. */
+                (void) capability_ambient_set_apply(0, /* also_inherit= */ false);
+
+                if (r == -EUCLEAN && cgtarget)
+                        return log_unit_error_errno(unit, r,
+                                                    "Failed to spawn process into cgroup '%s', because the cgroup "
+                                                    "or one of its parents or siblings is in the threaded mode.",
+                                                    cgtarget);
+                if (r < 0)
+                        return log_unit_error_errno(unit, r, "Failed to spawn executor: %m");
+                /* We add the new process to the cgroup both in the child (so that we can be sure that no user code is ever
+                 * executed outside of the cgroup) and in the parent (so that we can be sure that when we kill the cgroup the
+                 * process will be killed too). */
+                if (r == 0 && cgtarget)
+                        (void) cg_attach(cgtarget, pidref.pid);
+                /* r > 0: Already in the right cgroup thanks to CLONE_INTO_CGROUP */
+
+                log_unit_debug(unit, "Forked %s as " PID_FMT " (%s CLONE_INTO_CGROUP)",
+                               command->path, pidref.pid, r > 0 ? "via" : "without");
+        }
 
         exec_status_start(&command->exec_status, pidref.pid, &start_timestamp);
 
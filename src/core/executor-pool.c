@@ -0,0 +1,356 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "alloc-util.h"
+#include "capability-util.h"
+#include "cgroup-setup.h"
+#include "executor-pool.h"
+#include "extract-word.h"
+#include "fd-util.h"
+#include "fdset.h"
+#include "fileio.h"
+#include "iovec-util.h"
+#include "log.h"
+#include "manager.h"
+#include "parse-util.h"
+#include "process-util.h"
+#include "socket-util.h"
+#include "string-util.h"
+#include "strv.h"
+
+/* Starting sd-executor means exec'ing and dynamically linking a large binary and initializing it, for every
+ * single process we spawn. With a high rate of spawns that dominates the time between PID 1 deciding to
+ * start a process and the process actually running. Hence, if enabled with $SYSTEMD_EXECUTOR_POOL_SIZE=, we
+ * keep a few sd-executor processes around that already went through all that, and now sit in recvmsg()
+ * waiting for work. Whenever one of them is handed work, the pool is refilled once we are idle.
+ *
+ * The work is passed as a single datagram: the serialization fd and all fds referenced by it as
+ * SCM_RIGHTS, and a payload of the form "LOG-LEVELS LOG-TARGET FD…", listing the fd numbers the
+ * serialization refers to. The executor moves the received fds to these numbers before deserializing. */
+
+/* The kernel refuses to pass more than SCM_MAX_FD fds in one message */
+#define EXECUTOR_POOL_FDS_MAX 253U
+#define EXECUTOR_POOL_MESSAGE_MAX (LINE_MAX + EXECUTOR_POOL_FDS_MAX * (1 + DECIMAL_STR_MAX(int)))
+
+void pooled_executor_done(PooledExecutor *e) {
+        assert(e);
+
+        /* Closing the socket makes an idle executor exit on its own */
+        e->socket_fd = safe_close(e->socket_fd);
+        pidref_done(&e->pidref);
+}
+
+static int executor_pool_add_one(Manager *m) {
+        _cleanup_close_pair_ int pair[2] = EBADF_PAIR;
+        _cleanup_(pidref_done) PidRef pidref = PIDREF_NULL;
+        _cleanup_free_ char *max_log_levels = NULL;
+        int r;
+
+        assert(m);
+        assert(m->executor_fd >= 0);
+
+        if (!GREEDY_REALLOC(m->executor_pool, m->n_executor_pool + 1))
+                return -ENOMEM;
+
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, pair) < 0)
+                return -errno;
+
+        r = fd_cloexec(pair[1], false);
+        if (r < 0)
+                return r;
+
+        /* The log settings are only for the time until the executor gets work, they are updated then */
+        r = log_max_levels_to_string(log_get_max_level(), &max_log_levels);
+        if (r < 0)
+                return r;
+
+        char socket_fd_number[DECIMAL_STR_MAX(int)];
+        xsprintf(socket_fd_number, "%i", pair[1]);
+
+        /* Same as in exec_spawn(), pass the original ambient capabilities to the executor */
+        r = capability_ambient_set_apply(m->saved_ambient_set, /* also_inherit= */ false);
+        if (r < 0)
+                return r;
+
+        r = posix_spawn_wrapper(
+                        FORMAT_PROC_FD_PATH(m->executor_fd),
+                        STRV_MAKE(m->executor_path,
+                                  "--pool-socket", socket_fd_number,
+                                  "--log-level", max_log_levels,
+                                  "--log-target", log_target_to_string(manager_get_executor_log_target(m))),
+                        environ,
+                        /* cgroup= */ NULL,
+                        &pidref);
+
+        (void) capability_ambient_set_apply(0, /* also_inherit= */ false);
+
+        if (r < 0)
+                return r;
+
+        log_debug("Added executor " PID_FMT " to pool.", pidref.pid);
+
+        m->executor_pool[m->n_executor_pool++] = (PooledExecutor) {
+                .pidref = TAKE_PIDREF(pidref),
+                .socket_fd = TAKE_FD(pair[0]),
+        };
+
+        return 0;
+}
+
+static int on_executor_pool_refill(sd_event_source *s, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        /* Add only one executor per event loop iteration, so that we never delay anything else for long */
+        if (m->n_executor_pool < m->executor_pool_size) {
+                r = executor_pool_add_one(m);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to add executor to pool, not refilling until next spawn: %m");
+                        return sd_event_source_set_enabled(s, SD_EVENT_OFF);
+                }
+        }
+
+        if (m->n_executor_pool >= m->executor_pool_size)
+                return sd_event_source_set_enabled(s, SD_EVENT_OFF);
+
+        return 0;
+}
+
+int manager_setup_executor_pool(Manager *m) {
+        int r;
+
+        assert(m);
+
+        if (m->executor_pool_size == 0 || m->executor_fd < 0 || m->executor_pool_event_source)
+                return 0;
+
+        r = sd_event_add_defer(m->event, &m->executor_pool_event_source, on_executor_pool_refill, m);
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate executor pool event source: %m");
+
+        r = sd_event_source_set_priority(m->executor_pool_event_source, EVENT_PRIORITY_EXECUTOR_POOL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to set priority of executor pool event source: %m");
+
+        (void) sd_event_source_set_description(m->executor_pool_event_source, "manager-executor-pool");
+
+        log_debug("Keeping up to %u executors around.", m->executor_pool_size);
+        return 0;
+}
+
+void manager_free_executor_pool(Manager *m) {
+        assert(m);
+
+        m->executor_pool_event_source = sd_event_source_disable_unref(m->executor_pool_event_source);
+
+        FOREACH_ARRAY(e, m->executor_pool, m->n_executor_pool)
+                pooled_executor_done(e);
+
+        m->executor_pool = mfree(m->executor_pool);
+        m->n_executor_pool = 0;
+}
+
+int executor_pool_spawn(
+                Manager *m,
+                int serialization_fd,
+                FDSet *fds,
+                const char *log_levels,
+                const char *log_target,
+                const char *cgroup,
+                PidRef *ret) {
+
+        _cleanup_free_ char *payload = NULL;
+        _cleanup_free_ int *fd_array = NULL;
+        size_t n_fds;
+        int r;
+
+        assert(m);
+        assert(serialization_fd >= 0);
+        assert(log_levels);
+        assert(log_target);
+        assert(ret);
+
+        /* Returns > 0 if the work was handed to a pooled executor, 0 if the caller shall spawn a fresh one. */
+
+        if (!m->executor_pool_event_source)
+                return 0;
+
+        /* Whatever happens below, top up the pool again once we are idle */
+        r = sd_event_source_set_enabled(m->executor_pool_event_source, SD_EVENT_ON);
+        if (r < 0)
+                log_debug_errno(r, "Failed to enable executor pool event source, ignoring: %m");
+
+        if (m->n_executor_pool == 0)
+                return 0;
+
+        n_fds = fdset_size(fds);
+        if (n_fds >= EXECUTOR_POOL_FDS_MAX)
+                return 0;
+
+        if (!GREEDY_REALLOC(fd_array, n_fds + 1))
+                return -ENOMEM;
+
+        fd_array[0] = serialization_fd;
+
+        payload = strjoin(log_levels, " ", log_target);
+        if (!payload)
+                return -ENOMEM;
+
+        size_t i = 1;
+        int fd;
+        FDSET_FOREACH(fd, fds) {
+                fd_array[i++] = fd;
+
+                r = strextendf(&payload, " %i", fd);
+                if (r < 0)
+                        return r;
+        }
+        assert(i == n_fds + 1);
+
+        while (m->n_executor_pool > 0) {
+                _cleanup_(pooled_executor_done) PooledExecutor e = m->executor_pool[--m->n_executor_pool];
+                ssize_t k;
+
+                /* Move the executor to its final cgroup before it gets its work, so that it is covered when
+                 * the cgroup is killed */
+                if (cgroup) {
+                        r = cg_attach(cgroup, e.pidref.pid);
+                        if (r < 0) {
+                                /* Let the caller spawn a fresh executor, which handles the cgroup the
+                                 * regular way, including the cases where attaching is expected to fail. */
+                                log_debug_errno(r, "Failed to move pooled executor " PID_FMT " to cgroup '%s', spawning a new one instead: %m",
+                                                e.pidref.pid, cgroup);
+                                (void) pidref_kill(&e.pidref, SIGKILL);
+                                return 0;
+                        }
+                }
+
+                k = send_many_fds_iov(e.socket_fd, fd_array, n_fds + 1, &IOVEC_MAKE_STRING(payload), 1, MSG_NOSIGNAL);
+                if (k < 0) {
+                        /* The executor might have died in the meantime, try the next one */
+                        log_debug_errno(k, "Failed to hand work to pooled executor " PID_FMT ", trying next one: %m",
+                                        e.pidref.pid);
+                        (void) pidref_kill(&e.pidref, SIGKILL);
+                        continue;
+                }
+
+                *ret = TAKE_PIDREF(e.pidref);
+                return 1;
+        }
+
+        return 0;
+}
+
+int executor_pool_receive(
+                int socket_fd,
+                FILE **ret_serialization,
+                char **ret_log_levels,
+                char **ret_log_target) {
+
+        _cleanup_free_ char *log_levels = NULL, *log_target = NULL;
+        _cleanup_free_ int *targets = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        int *fds = NULL, max_target = STDERR_FILENO;
+        size_t n_fds = 0, n_targets = 0;
+        char buf[EXECUTOR_POOL_MESSAGE_MAX + 1];
+        const char *p;
+        ssize_t k;
+        int r;
+
+        CLEANUP_ARRAY(fds, n_fds, close_many_and_free);
+
+        assert(socket_fd >= 0);
+        assert(ret_serialization);
+        assert(ret_log_levels);
+        assert(ret_log_target);
+
+        /* Consumes socket_fd. Returns 0 if the manager closed the socket without handing us any work. */
+
+        /* Close everything but stdio and the socket before waiting for work. That way none of the fd
+         * numbers the serialization refers to can be taken by us once we get it, and taking over the work
+         * cannot fail anymore after the manager handed it to us. The log fd is reopened by the caller. */
+        log_close();
+        r = close_all_fds(&socket_fd, 1);
+        if (r < 0) {
+                safe_close(socket_fd);
+                return r;
+        }
+
+        k = receive_many_fds_iov(socket_fd, &IOVEC_MAKE(buf, sizeof(buf) - 1), 1, &fds, &n_fds, /* flags= */ 0);
+        safe_close(socket_fd);
+        if (k == -EIO)
+                return 0;
+        if (k < 0)
+                return (int) k;
+        if (n_fds == 0)
+                return -EBADMSG;
+
+        buf[k] = 0;
+        p = buf;
+
+        r = extract_many_words(&p, " ", /* flags= */ 0, &log_levels, &log_target);
+        if (r < 0)
+                return r;
+        if (r < 2)
+                return -EBADMSG;
+
+        for (;;) {
+                _cleanup_free_ char *word = NULL;
+                int fd;
+
+                r = extract_first_word(&p, &word, " ", /* flags= */ 0);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                fd = parse_fd(word);
+                if (fd < 0)
+                        return fd;
+                if (fd <= STDERR_FILENO)
+                        return -EBADMSG;
+
+                if (!GREEDY_REALLOC(targets, n_targets + 1))
+                        return -ENOMEM;
+
+                targets[n_targets++] = fd;
+                max_target = MAX(max_target, fd);
+        }
+
+        /* The first fd is the serialization itself, all others are referenced by it */
+        if (n_targets != n_fds - 1)
+                return -EBADMSG;
+
+        /* The serialization refers to the fds by the numbers they had in the manager. Hence, first move all
+         * received fds out of the way, above the highest of those numbers, then move them into place. */
+        for (size_t i = 0; i < n_fds; i++) {
+                r = fcntl(fds[i], F_DUPFD_CLOEXEC, max_target + 1);
+                if (r < 0)
+                        return -errno;
+
+                close_and_replace(fds[i], r);
+        }
+
+        for (size_t i = 0; i < n_targets; i++) {
+                /* dup2() leaves O_CLOEXEC unset, like for fds inherited from the manager directly */
+                if (dup2(fds[i + 1], targets[i]) < 0)
+                        return -errno;
+
+                fds[i + 1] = safe_close(fds[i + 1]);
+        }
+
+        f = take_fdopen(&fds[0], "r");
+        if (!f)
+                return -errno;
+
+        *ret_serialization = TAKE_PTR(f);
+        *ret_log_levels = TAKE_PTR(log_levels);
+        *ret_log_target = TAKE_PTR(log_target);
+        return 1;
+}
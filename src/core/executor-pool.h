@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include "core-forward.h"
+#include "pidref.h"
+
+/* How many sd-executor processes we keep around at most, waiting for work */
+#define EXECUTOR_POOL_SIZE_MAX 64U
+
+typedef struct PooledExecutor {
+        PidRef pidref;
+        int socket_fd;
+} PooledExecutor;
+
+void pooled_executor_done(PooledExecutor *e);
+
+int manager_setup_executor_pool(Manager *m);
+void manager_free_executor_pool(Manager *m);
+
+int executor_pool_spawn(
+                Manager *m,
+                int serialization_fd,
+                FDSet *fds,
+                const char *log_levels,
+                const char *log_target,
+                const char *cgroup,
+                PidRef *ret);
+
+int executor_pool_receive(
+                int socket_fd,
+                FILE **ret_serialization,
+                char **ret_log_levels,
+                char **ret_log_target);
@@ -14,6 +14,7 @@
 #include "exec-invoke.h"
 #include "execute.h"
 #include "execute-serialize.h"
+#include "executor-pool.h"
 #include "exit-status.h"
 #include "fd-util.h"
 #include "fdset.h"
@@ -27,8 +28,10 @@
 #include "static-destruct.h"
 
 static FILE *arg_serialization = NULL;
+static int arg_pool_socket = -EBADF;
 
 STATIC_DESTRUCTOR_REGISTER(arg_serialization, fclosep);
+STATIC_DESTRUCTOR_REGISTER(arg_pool_socket, closep);
 
 static int help(void) {
         _cleanup_free_ char *link = NULL;
@@ -52,6 +55,7 @@ static int help(void) {
                "     --log-location=BOOL   Include code location in messages\n"
                "     --log-time=BOOL       Prefix messages with current time\n"
                "     --deserialize=FD      Deserialize process config from FD\n"
+               "     --pool-socket=FD      Wait for process config to be passed via FD\n"
                "\nSee the %s for details.\n",
                program_invocation_short_name,
                ansi_highlight(),
@@ -66,6 +70,7 @@ static int parse_argv(int argc, char *argv[]) {
                 COMMON_GETOPT_ARGS,
                 ARG_VERSION,
                 ARG_DESERIALIZE,
+                ARG_POOL_SOCKET,
         };
 
         static const struct option options[] = {
@@ -77,6 +82,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "help",           no_argument,       NULL, 'h'                },
                 { "version",        no_argument,       NULL, ARG_VERSION        },
                 { "deserialize",    required_argument, NULL, ARG_DESERIALIZE    },
+                { "pool-socket",    required_argument, NULL, ARG_POOL_SOCKET    },
                 {}
         };
 
@@ -163,6 +169,21 @@ static int parse_argv(int argc, char *argv[]) {
                         break;
                 }
 
+                case ARG_POOL_SOCKET: {
+                        _cleanup_close_ int fd = -EBADF;
+
+                        fd = parse_fd(optarg);
+                        if (fd < 0)
+                                return log_error_errno(fd, "Failed to parse pool socket fd \"%s\": %m", optarg);
+
+                        r = fd_cloexec(fd, /* cloexec= */ true);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to set pool socket fd %d to close-on-exec: %m", fd);
+
+                        close_and_replace(arg_pool_socket, fd);
+                        break;
+                }
+
                 case '?':
                         return -EINVAL;
 
@@ -170,8 +191,8 @@ static int parse_argv(int argc, char *argv[]) {
                         assert_not_reached();
                 }
 
-        if (!arg_serialization)
-                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "No serialization fd specified.");
+        if (!arg_serialization == (arg_pool_socket < 0))
+                return log_error_errno(SYNTHETIC_ERRNO(EINVAL), "Exactly one of --deserialize= or --pool-socket= must be specified.");
 
         return 1 /* work to do */;
 }
@@ -207,6 +228,26 @@ static int run(int argc, char *argv[]) {
         if (r <= 0)
                 return r;
 
+        if (arg_pool_socket >= 0) {
+                _cleanup_free_ char *log_levels = NULL, *log_target = NULL;
+
+                /* We have been started ahead of time for the manager's executor pool, wait until we are
+                 * given something to do. */
+                r = executor_pool_receive(TAKE_FD(arg_pool_socket), &arg_serialization, &log_levels, &log_target);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to receive work from executor pool socket: %m");
+                if (r == 0) /* The manager doesn't need us anymore */
+                        return 0;
+
+                r = log_set_max_level_from_string(log_levels);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to parse log level \"%s\", ignoring: %m", log_levels);
+
+                r = log_set_target_from_string(log_target);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to parse log target \"%s\", ignoring: %m", log_target);
+        }
+
         /* Now that we know the intended log target, allow IPC and open the final log target. */
         log_set_prohibit_ipc(false);
         log_open();
@@ -50,7 +50,7 @@ static void exec_fuzz_one(FILE *f, FDSet *fdset) {
 
         (void) exec_deserialize_invocation(f, fdset, &exec_context, &command, &params, &runtime, &cgroup_context);
         exec_context.private_var_tmp = PRIVATE_TMP_DISCONNECTED; /* The deserialization in the above may set an invalid value. */
-        (void) exec_serialize_invocation(f, fdset, &exec_context, &command, &params, &runtime, &cgroup_context);
+        (void) exec_serialize_invocation(f, fdset, &exec_context, /* ctx_serialized= */ NULL, /* ctx_serialized_size= */ 0, &command, &params, &runtime, &cgroup_context);
         (void) exec_deserialize_invocation(f, fdset, &exec_context, &command, &params, &runtime, &cgroup_context);
 
         /* We definitely didn't provide valid FDs during deserialization, so
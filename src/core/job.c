@@ -14,6 +14,7 @@
 #include "job.h"
 #include "log.h"
 #include "manager.h"
+#include "mempool.h"
 #include "parse-util.h"
 #include "prioq.h"
 #include "serialize.h"
@@ -33,7 +34,9 @@ Job* job_new_raw(Unit *unit) {
 
         assert(unit);
 
-        j = new(Job, 1);
+        bool use_pool = mempool_enabled && mempool_enabled();  /* mempool_enabled is a weak symbol */
+
+        j = use_pool ? mempool_alloc_tile(&unit->manager->job_pool) : new(Job, 1);
         if (!j)
                 return NULL;
 
@@ -41,6 +44,7 @@ Job* job_new_raw(Unit *unit) {
                 .manager = unit->manager,
                 .unit = unit,
                 .type = _JOB_TYPE_INVALID,
+                .from_pool = use_pool,
         };
 
         return j;
@@ -126,6 +130,11 @@ Job* job_free(Job *j) {
 
         activation_details_unref(j->activation_details);
 
+        bus_job_invalidate_property_cache(j);
+
+        if (j->from_pool)
+                return mempool_free_tile(&j->manager->job_pool, j);
+
         return mfree(j);
 }
 
@@ -130,6 +130,7 @@ typedef struct Job {
 
         bool installed:1;
         bool in_run_queue:1;
+        bool from_pool:1;
 
         bool matters_to_anchor:1;
         bool refuse_late_merge:1;
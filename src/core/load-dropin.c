@@ -8,11 +8,14 @@
 #include "log.h"
 #include "manager.h"
 #include "path-util.h"
+#include "siphash24.h"
 #include "stat-util.h"
 #include "strv.h"
 #include "unit.h"
 #include "unit-name.h"
 
+#define DEPENDENCY_DROPIN_HASH_KEY SD_ID128_MAKE(5c,0f,a8,3e,71,d2,4b,96,8e,1a,27,c4,bd,60,93,f5)
+
 int unit_find_dropin_paths(Unit *u, bool use_unit_path_cache, char ***paths) {
         assert(u);
 
@@ -24,10 +27,24 @@ int unit_find_dropin_paths(Unit *u, bool use_unit_path_cache, char ***paths) {
                                            paths);
 }
 
-static int process_deps(Unit *u, UnitDependency dependency, const char *dir_suffix) {
+static const struct {
+        UnitDependency dependency;
+        const char *dir_suffix;
+} dependency_dirs[] = {
+        { UNIT_WANTS,    ".wants"    },
+        { UNIT_REQUIRES, ".requires" },
+        { UNIT_UPHOLDS,  ".upholds"  },
+};
+
+static int find_dependency_dropin_paths(Unit *u, const char *dir_suffix, struct siphash *state, char ***ret) {
         _cleanup_strv_free_ char **paths = NULL;
         int r;
 
+        assert(u);
+        assert(dir_suffix);
+        assert(state);
+        assert(ret);
+
         r = unit_file_find_dropin_paths(NULL,
                                         u->manager->lookup_paths.search_path,
                                         u->manager->unit_path_cache,
@@ -37,6 +54,48 @@ static int process_deps(Unit *u, UnitDependency dependency, const char *dir_suff
         if (r < 0)
                 return r;
 
+        /* Entries are only ever added or removed, hence hashing the paths is enough to notice changes */
+        STRV_FOREACH(p, paths)
+                siphash24_compress_string(*p, state);
+
+        r = (int) strv_length(paths);
+        *ret = TAKE_PTR(paths);
+        return r;
+}
+
+int unit_dependency_dropin_hash(Unit *u, uint64_t *ret) {
+        struct siphash state;
+        size_t n = 0;
+        int r;
+
+        assert(u);
+        assert(ret);
+
+        siphash24_init(&state, DEPENDENCY_DROPIN_HASH_KEY.bytes);
+
+        FOREACH_ELEMENT(i, dependency_dirs) {
+                _cleanup_strv_free_ char **paths = NULL;
+
+                r = find_dependency_dropin_paths(u, i->dir_suffix, &state, &paths);
+                if (r < 0)
+                        return r;
+
+                n += r;
+        }
+
+        /* Zero if there are none, so that this matches for units that never had their drop-ins loaded */
+        *ret = n > 0 ? siphash24_finalize(&state) : 0;
+        return 0;
+}
+
+static int process_deps(Unit *u, UnitDependency dependency, const char *dir_suffix, struct siphash *state) {
+        _cleanup_strv_free_ char **paths = NULL;
+        int r, n;
+
+        n = find_dependency_dropin_paths(u, dir_suffix, state, &paths);
+        if (n < 0)
+                return n;
+
         STRV_FOREACH(p, paths) {
                 _cleanup_free_ char *target = NULL, *target_file = NULL, *entry = NULL;
 
@@ -103,27 +162,29 @@ static int process_deps(Unit *u, UnitDependency dependency, const char *dir_suff
                                                unit_dependency_to_string(dependency), entry);
         }
 
-        return 0;
+        return n;
 }
 
 int unit_load_dropin(Unit *u) {
         _cleanup_strv_free_ char **l = NULL;
+        struct siphash state;
+        size_t n = 0;
         int r;
 
         assert(u);
 
         /* Load dependencies from .wants, .requires and .upholds directories */
-        r = process_deps(u, UNIT_WANTS, ".wants");
-        if (r < 0)
-                return r;
+        siphash24_init(&state, DEPENDENCY_DROPIN_HASH_KEY.bytes);
 
-        r = process_deps(u, UNIT_REQUIRES, ".requires");
-        if (r < 0)
-                return r;
+        FOREACH_ELEMENT(i, dependency_dirs) {
+                r = process_deps(u, i->dependency, i->dir_suffix, &state);
+                if (r < 0)
+                        return r;
 
-        r = process_deps(u, UNIT_UPHOLDS, ".upholds");
-        if (r < 0)
-                return r;
+                n += r;
+        }
+
+        u->dependency_dropin_hash = n > 0 ? siphash24_finalize(&state) : 0;
 
         /* Load .conf dropins */
         r = unit_find_dropin_paths(u, /* use_unit_path_cache= */ true, &l);
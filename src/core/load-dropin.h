@@ -8,3 +8,5 @@
 int unit_find_dropin_paths(Unit *u, bool use_unit_path_cache, char ***paths);
 
 int unit_load_dropin(Unit *u);
+
+int unit_dependency_dropin_hash(Unit *u, uint64_t *ret);
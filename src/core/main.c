@@ -36,6 +36,7 @@
 #include "coredump-util.h"
 #include "cpu-set-util.h"
 #include "crash-handler.h"
+#include "critical-path.h"
 #include "dbus.h"
 #include "dbus-manager.h"
 #include "dev-setup.h"
@@ -162,6 +163,10 @@ static void *arg_random_seed;
 static size_t arg_random_seed_size;
 static usec_t arg_reload_limit_interval_sec;
 static unsigned arg_reload_limit_burst;
+static usec_t arg_accounting_cache_usec;
+static bool arg_reuse_generator_output;
+static usec_t arg_properties_changed_interval_usec;
+static bool arg_critical_path_scheduling;
 
 /* A copy of the original environment block */
 static char **saved_env = NULL;
@@ -812,6 +817,10 @@ static int parse_config_file(void) {
                 { "Manager", "DefaultOOMScoreAdjust",        config_parse_oom_score_adjust,      0,                        NULL                              },
                 { "Manager", "ReloadLimitIntervalSec",       config_parse_sec,                   0,                        &arg_reload_limit_interval_sec    },
                 { "Manager", "ReloadLimitBurst",             config_parse_unsigned,              0,                        &arg_reload_limit_burst           },
+                { "Manager", "AccountingCacheSec",           config_parse_sec,                   0,                        &arg_accounting_cache_usec        },
+                { "Manager", "ReuseGeneratorOutput",         config_parse_bool,                  0,                        &arg_reuse_generator_output       },
+                { "Manager", "PropertiesChangedIntervalSec", config_parse_sec,                   0,                        &arg_properties_changed_interval_usec },
+                { "Manager", "CriticalPathScheduling",       config_parse_bool,                  0,                        &arg_critical_path_scheduling     },
 #if ENABLE_SMACK
                 { "Manager", "DefaultSmackProcessLabel",     config_parse_string,                0,                        &arg_defaults.smack_process_label },
 #else
@@ -897,6 +906,10 @@ static void set_manager_settings(Manager *m) {
          * counter on every daemon-reload. */
         m->reload_reexec_ratelimit.interval = arg_reload_limit_interval_sec;
         m->reload_reexec_ratelimit.burst = arg_reload_limit_burst;
+        m->accounting_cache_usec = arg_accounting_cache_usec;
+        m->reuse_generator_output = arg_reuse_generator_output;
+        m->properties_changed_interval_usec = arg_properties_changed_interval_usec;
+        m->critical_path_scheduling = arg_critical_path_scheduling;
 
         manager_set_watchdog(m, WATCHDOG_RUNTIME, arg_runtime_watchdog);
         manager_set_watchdog(m, WATCHDOG_REBOOT, arg_reboot_watchdog);
@@ -2788,6 +2801,10 @@ static void reset_arguments(void) {
 
         arg_reload_limit_interval_sec = 0;
         arg_reload_limit_burst = 0;
+        arg_accounting_cache_usec = 0;
+        arg_reuse_generator_output = false;
+        arg_properties_changed_interval_usec = 0;
+        arg_critical_path_scheduling = false;
 }
 
 static void determine_default_oom_score_adjust(void) {
@@ -3370,6 +3387,8 @@ int main(int argc, char *argv[]) {
                 r = do_queue_default_job(m, &error_message);
                 if (r < 0)
                         goto finish;
+
+                manager_predict_critical_path(m);
         }
 
         after_startup = now(CLOCK_MONOTONIC);
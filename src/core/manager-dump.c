@@ -5,11 +5,16 @@
 
 #include "sd-bus.h"
 
+#include "alloc-util.h"
 #include "build.h"
+#include "format-util.h"
 #include "hashmap.h"
+#include "list.h"
 #include "manager.h"
 #include "manager-dump.h"
+#include "mempool.h"
 #include "memstream-util.h"
+#include "set.h"
 #include "string-util.h"
 #include "strv.h"
 #include "unit-serialize.h"
@@ -64,6 +69,74 @@ void manager_dump_units(Manager *m, FILE *f, char **patterns, const char *prefix
         }
 }
 
+static size_t strv_allocated(char **l) {
+        size_t sz = MALLOC_SIZEOF_SAFE(l);
+
+        STRV_FOREACH(i, l)
+                sz += MALLOC_SIZEOF_SAFE(*i);
+
+        return sz;
+}
+
+static void manager_dump_memory(Manager *m, FILE *f, const char *prefix) {
+        size_t unit_pools_size, job_pool_size;
+
+        assert(m);
+        assert(f);
+
+        /* Approximate memory use by unit type, broken down by what it is used for. Strings shared between
+         * fields are counted for each of them. */
+
+        for (UnitType t = 0; t < _UNIT_TYPE_MAX; t++) {
+                size_t n = 0, names = 0, metadata = 0, environment = 0, dependencies = 0;
+
+                LIST_FOREACH(units_by_type, u, m->units_by_type[t]) {
+                        const char *alias;
+                        ExecContext *ec;
+
+                        n++;
+
+                        names += MALLOC_SIZEOF_SAFE(u->id) + MALLOC_SIZEOF_SAFE(u->instance);
+                        SET_FOREACH(alias, u->aliases)
+                                names += MALLOC_SIZEOF_SAFE(alias);
+
+                        metadata += MALLOC_SIZEOF_SAFE(u->description) +
+                                strv_allocated(u->documentation) +
+                                MALLOC_SIZEOF_SAFE(u->fragment_path) +
+                                MALLOC_SIZEOF_SAFE(u->source_path) +
+                                strv_allocated(u->dropin_paths);
+
+                        ec = unit_get_exec_context(u);
+                        if (ec)
+                                environment += strv_allocated(ec->environment) +
+                                        strv_allocated(ec->environment_files) +
+                                        strv_allocated(ec->pass_environment) +
+                                        strv_allocated(ec->unset_environment);
+
+                        dependencies += unit_dependencies_allocated(u, /* ret_n_entries= */ NULL);
+                }
+
+                if (n == 0)
+                        continue;
+
+                fprintf(f, "%sMemory %s: %zu units, objects %s, names %s, metadata %s, environment %s, dependencies %s\n",
+                        strempty(prefix), unit_type_to_string(t), n,
+                        FORMAT_BYTES(n * unit_vtable[t]->object_size),
+                        FORMAT_BYTES(names),
+                        FORMAT_BYTES(metadata),
+                        FORMAT_BYTES(environment),
+                        FORMAT_BYTES(dependencies));
+        }
+
+        unit_pools_size = manager_pools_allocated(m, &job_pool_size);
+
+        fprintf(f, "%sMemory Pools: %s for units, %s for %u jobs\n",
+                strempty(prefix),
+                FORMAT_BYTES(unit_pools_size),
+                FORMAT_BYTES(job_pool_size),
+                hashmap_size(m->jobs));
+}
+
 static void manager_dump_header(Manager *m, FILE *f, const char *prefix) {
 
         /* NB: this is a debug interface for developers. It's not supposed to be machine readable or be
@@ -86,6 +159,41 @@ static void manager_dump_header(Manager *m, FILE *f, const char *prefix) {
 
         for (const char *n = sd_bus_track_first(m->subscribed); n; n = sd_bus_track_next(m->subscribed))
                 fprintf(f, "%sSubscribed: %s\n", strempty(prefix), n);
+
+        size_t n_units = 0, n_dependencies = 0, dependencies_size = 0;
+        const char *t;
+        Unit *u;
+
+        HASHMAP_FOREACH_KEY(u, t, m->units) {
+                size_t n;
+
+                if (u->id != t)
+                        continue;
+
+                n_units++;
+                dependencies_size += unit_dependencies_allocated(u, &n);
+                n_dependencies += n;
+        }
+
+        fprintf(f, "%sDependencies: %zu entries for %zu units, %s (%s per unit)\n",
+                strempty(prefix), n_dependencies, n_units, FORMAT_BYTES(dependencies_size),
+                FORMAT_BYTES(n_units > 0 ? dependencies_size / n_units : 0));
+        fprintf(f, "%sDependency Walks: %" PRIu64 " (%" PRIu64 " dependencies covered, %" PRIu64 " per walk on average)\n",
+                strempty(prefix), m->n_dependency_walks, m->n_dependency_walk_entries,
+                m->n_dependency_walks > 0 ? m->n_dependency_walk_entries / m->n_dependency_walks : 0);
+        fprintf(f, "%sCGroup Attribute Writes: %" PRIu64 " (%" PRIu64 " skipped as unchanged)\n",
+                strempty(prefix), m->n_cgroup_attribute_writes, m->n_cgroup_attribute_writes_elided);
+        fprintf(f, "%sNotification Messages: %" PRIu64 " (%" PRIu64 " merged into later ones)\n",
+                strempty(prefix), m->n_notify_messages, m->n_notify_messages_coalesced);
+        fprintf(f, "%sGarbage Collection Runs: %" PRIu64 " (%" PRIu64 " units collected, longest pause %s)\n",
+                strempty(prefix), m->n_gc_runs, m->n_gc_collected_units,
+                FORMAT_TIMESPAN(m->gc_pause_max_usec, USEC_PER_MSEC / 10));
+        fprintf(f, "%sReaped Children: %" PRIu64 " (average latency %s, maximum %s)\n",
+                strempty(prefix), m->n_reaped_children,
+                FORMAT_TIMESPAN(m->n_reaped_children > 0 ? m->reap_latency_usec / m->n_reaped_children : 0, USEC_PER_MSEC / 10),
+                FORMAT_TIMESPAN(m->reap_latency_max_usec, USEC_PER_MSEC / 10));
+
+        manager_dump_memory(m, f, prefix);
 }
 
 void manager_dump(Manager *m, FILE *f, char **patterns, const char *prefix) {
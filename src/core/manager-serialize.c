@@ -92,6 +92,8 @@ int manager_serialize(
 
         _cleanup_(manager_reloading_stopp) _unused_ Manager *reloading = manager_reloading_start(m);
 
+        usec_t start = now(CLOCK_MONOTONIC);
+
         (void) serialize_item_format(f, "last-transaction-id", "%" PRIu64, m->last_transaction_id);
 
         (void) serialize_item_format(f, "current-job-id", "%" PRIu32, m->current_job_id);
@@ -190,6 +192,9 @@ int manager_serialize(
         if (r < 0)
                 return log_error_errno(r, "Failed to add bus sockets to serialization: %m");
 
+        log_debug("Serialized state with %u file descriptors in %s.",
+                  fdset_size(fds),
+                  FORMAT_TIMESPAN(usec_sub_unsigned(now(CLOCK_MONOTONIC), start), USEC_PER_MSEC));
         return 0;
 }
 
@@ -219,7 +224,7 @@ static int manager_deserialize_units(Manager *m, FILE *f, FDSet *fds) {
                 _cleanup_free_ char *line = NULL;
 
                 /* Start marker */
-                r = read_stripped_line(f, LONG_LINE_MAX, &line);
+                r = read_stripped_line_full(f, LONG_LINE_MAX, READ_LINE_NOT_A_TTY, &line);
                 if (r < 0)
                         return log_error_errno(r, "Failed to read serialization line: %m");
                 if (r == 0)
@@ -310,6 +315,8 @@ int manager_deserialize(Manager *m, FILE *f, FDSet *fds) {
 
         log_debug("Deserializing state...");
 
+        usec_t start = now(CLOCK_MONOTONIC);
+
         /* If we are not in reload mode yet, enter it now. Not that this is recursive, a caller might already have
          * increased it to non-zero, which is why we just increase it by one here and down again at the end of this
          * call. */
@@ -547,5 +554,11 @@ int manager_deserialize(Manager *m, FILE *f, FDSet *fds) {
                 }
         }
 
-        return manager_deserialize_units(m, f, fds);
+        r = manager_deserialize_units(m, f, fds);
+        if (r < 0)
+                return r;
+
+        log_debug("Deserialized state in %s.",
+                  FORMAT_TIMESPAN(usec_sub_unsigned(now(CLOCK_MONOTONIC), start), USEC_PER_MSEC));
+        return 0;
 }
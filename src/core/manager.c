@@ -2,6 +2,7 @@
 
 #include <fcntl.h>
 #include <linux/kd.h>
+#include <poll.h>
 #include <sys/inotify.h>
 #include <sys/ioctl.h>
 #include <sys/mount.h>
@@ -26,9 +27,11 @@
 #include "bus-error.h"
 #include "clean-ipc.h"
 #include "common-signal.h"
+#include "conf-files.h"
 #include "confidential-virt.h"
 #include "constants.h"
 #include "creds-util.h"
+#include "critical-path.h"
 #include "daemon-util.h"
 #include "dbus-job.h"
 #include "dbus-manager.h"
@@ -41,9 +44,12 @@
 #include "event-util.h"
 #include "exec-util.h"
 #include "execute.h"
+#include "executor-pool.h"
 #include "exit-status.h"
+#include "extract-word.h"
 #include "fd-util.h"
 #include "fdset.h"
+#include "fileio.h"
 #include "format-util.h"
 #include "fs-util.h"
 #include "generator-setup.h"
@@ -68,6 +74,7 @@
 #include "plymouth-util.h"
 #include "pretty-print.h"
 #include "prioq.h"
+#include "proc-cmdline.h"
 #include "process-util.h"
 #include "psi-util.h"
 #include "ratelimit.h"
@@ -77,6 +84,7 @@
 #include "serialize.h"
 #include "set.h"
 #include "signal-util.h"
+#include "siphash24.h"
 #include "socket-util.h"
 #include "special.h"
 #include "stat-util.h"
@@ -92,8 +100,10 @@
 #include "transaction.h"
 #include "umask-util.h"
 #include "unit-name.h"
+#include "unit-serialize.h"
 #include "user-util.h"
 #include "varlink.h"
+#include "varlink-unit.h"
 #include "virt.h"
 #include "watchdog.h"
 
@@ -115,6 +125,14 @@
 
 #define DEFAULT_TASKS_MAX ((const CGroupTasksMax) { 15U, 100U }) /* 15% */
 
+/* How many children to reap at most before returning to the event loop. */
+#define MANAGER_SIGCHLD_BUDGET 64U
+
+/* How many notification messages to receive at most before returning to the event loop. */
+#define MANAGER_NOTIFY_BUDGET 128U
+
+#define UNIT_DIRECTORY_CACHE_PATH "/var/cache/systemd/unit-directories"
+
 static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
 static int manager_dispatch_signal_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
 static int manager_dispatch_time_change_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
@@ -128,6 +146,8 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata);
 static int manager_dispatch_timezone_change(sd_event_source *source, const struct inotify_event *event, void *userdata);
 static int manager_run_environment_generators(Manager *m);
 static int manager_run_generators(Manager *m);
+static bool manager_generator_output_reusable(Manager *m);
+static void generator_timing_free_many(GeneratorTiming *timings, size_t n);
 static void manager_vacuum(Manager *m);
 
 static usec_t manager_watch_jobs_next_time(Manager *m) {
@@ -749,6 +769,41 @@ static void manager_free_unit_name_maps(Manager *m) {
         m->unit_cache_timestamp_hash = 0;
 }
 
+static bool manager_persist_unit_directory_cache(Manager *m) {
+        assert(m);
+
+        /* The directories of the initrd are gone after the switch, and for a different root the paths
+         * wouldn't match ours. */
+        return MANAGER_IS_SYSTEM(m) && !MANAGER_IS_TEST_RUN(m) && !m->lookup_paths.root_dir && !in_initrd();
+}
+
+static void manager_load_unit_directory_cache(Manager *m) {
+        int r;
+
+        assert(m);
+
+        if (!manager_persist_unit_directory_cache(m))
+                return;
+
+        /* /var/ might not be mounted yet when we boot, in which case we'll just read all directories */
+        r = unit_directory_cache_load(m->unit_directory_cache, UNIT_DIRECTORY_CACHE_PATH);
+        if (r < 0)
+                log_debug_errno(r, "Failed to load unit directory cache %s, ignoring: %m", UNIT_DIRECTORY_CACHE_PATH);
+}
+
+static void manager_save_unit_directory_cache(Manager *m) {
+        int r;
+
+        assert(m);
+
+        if (!manager_persist_unit_directory_cache(m))
+                return;
+
+        r = unit_directory_cache_save(m->unit_directory_cache, UNIT_DIRECTORY_CACHE_PATH);
+        if (r < 0)
+                log_debug_errno(r, "Failed to save unit directory cache %s, ignoring: %m", UNIT_DIRECTORY_CACHE_PATH);
+}
+
 static int manager_setup_run_queue(Manager *m) {
         int r;
 
@@ -795,6 +850,40 @@ static int manager_setup_sigchld_event_source(Manager *m) {
         return 0;
 }
 
+void manager_trim_pools(Manager *m) {
+        assert(m);
+
+        FOREACH_ELEMENT(pool, m->unit_pools)
+                if (pool->first_pool)
+                        mempool_trim(pool);
+
+        if (m->job_pool.first_pool)
+                mempool_trim(&m->job_pool);
+}
+
+size_t manager_pools_allocated(Manager *m, size_t *ret_jobs) {
+        size_t n = 0;
+
+        assert(m);
+
+        FOREACH_ELEMENT(pool, m->unit_pools)
+                n += mempool_allocated(pool);
+
+        if (ret_jobs)
+                *ret_jobs = mempool_allocated(&m->job_pool);
+
+        return n;
+}
+
+static int manager_dispatch_memory_pressure(sd_event_source *source, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        /* Release the pool memory of units and jobs that are gone, then do what the default handler does */
+        manager_trim_pools(m);
+
+        return sd_event_trim_memory();
+}
+
 int manager_setup_memory_pressure_event_source(Manager *m) {
         int r;
 
@@ -802,7 +891,7 @@ int manager_setup_memory_pressure_event_source(Manager *m) {
 
         m->memory_pressure_event_source = sd_event_source_disable_unref(m->memory_pressure_event_source);
 
-        r = sd_event_add_memory_pressure(m->event, &m->memory_pressure_event_source, NULL, NULL);
+        r = sd_event_add_memory_pressure(m->event, &m->memory_pressure_event_source, manager_dispatch_memory_pressure, m);
         if (r < 0)
                 log_full_errno(ERRNO_IS_NOT_SUPPORTED(r) || ERRNO_IS_PRIVILEGE(r) || (r == -EHOSTDOWN) ? LOG_DEBUG : LOG_NOTICE, r,
                                "Failed to establish memory pressure event source, ignoring: %m");
@@ -866,10 +955,24 @@ double manager_get_progress(Manager *m) {
 
 static int compare_job_priority(const void *a, const void *b) {
         const Job *x = a, *y = b;
+        int r;
+
+        /* During boot, jobs of units with the longest chain of jobs waiting for them go first, see
+         * critical-path.c. This is zero for all units otherwise. */
+        r = CMP(y->unit->critical_path_usec, x->unit->critical_path_usec);
+        if (r != 0)
+                return r;
 
         return unit_compare_priority(x->unit, y->unit);
 }
 
+static int compare_unit_change_signal_due(const void *a, const void *b) {
+        const Unit *x = a, *y = b;
+
+        /* The interval is the same for all units, hence the time of the last signal is enough */
+        return CMP(x->dbus_change_signal_timestamp, y->dbus_change_signal_timestamp);
+}
+
 usec_t manager_default_timeout(RuntimeScope scope) {
         return scope == RUNTIME_SCOPE_SYSTEM ? DEFAULT_TIMEOUT_USEC : DEFAULT_USER_TIMEOUT_USEC;
 }
@@ -892,6 +995,12 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
 
                 .status_unit_format = STATUS_UNIT_FORMAT_DEFAULT,
 
+                .job_pool = {
+                        .tile_size = sizeof(Job),
+                        .at_least = 64,
+                        .at_most = MANAGER_JOB_POOL_TILES_MAX,
+                },
+
                 .original_log_level = -1,
                 .original_log_target = _LOG_TARGET_INVALID,
 
@@ -909,6 +1018,7 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
                 .pidref_transport_fds = EBADF_PAIR,
                 .private_listen_fd = -EBADF,
                 .dev_autofs_fd = -EBADF,
+                .mount_fanotify_fd = -EBADF,
                 .cgroup_inotify_fd = -EBADF,
                 .pin_cgroupfs_fd = -EBADF,
                 .idle_pipe = { -EBADF, -EBADF, -EBADF, -EBADF},
@@ -949,6 +1059,10 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
         if (r < 0)
                 return r;
 
+        m->unit_directory_cache = unit_directory_cache_new();
+        if (!m->unit_directory_cache)
+                return -ENOMEM;
+
         r = hashmap_ensure_allocated(&m->watch_bus, &string_hash_ops);
         if (r < 0)
                 return r;
@@ -957,6 +1071,10 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
         if (r < 0)
                 return r;
 
+        r = prioq_ensure_allocated(&m->dbus_unit_deferred_queue, compare_unit_change_signal_due);
+        if (r < 0)
+                return r;
+
         r = manager_setup_prefix(m);
         if (r < 0)
                 return r;
@@ -1034,6 +1152,18 @@ int manager_new(RuntimeScope runtime_scope, ManagerTestRunFlags test_run_flags,
                         return log_debug_errno(m->executor_fd, "Failed to pin executor binary: %m");
 
                 log_debug("Using systemd-executor binary from '%s'.", m->executor_path);
+
+                const char *e = secure_getenv("SYSTEMD_EXECUTOR_POOL_SIZE");
+                if (e) {
+                        r = safe_atou(e, &m->executor_pool_size);
+                        if (r < 0)
+                                log_warning_errno(r, "Failed to parse $SYSTEMD_EXECUTOR_POOL_SIZE, ignoring: %s", e);
+                        else if (m->executor_pool_size > EXECUTOR_POOL_SIZE_MAX) {
+                                log_warning("$SYSTEMD_EXECUTOR_POOL_SIZE=%u is too large, using %u.",
+                                            m->executor_pool_size, EXECUTOR_POOL_SIZE_MAX);
+                                m->executor_pool_size = EXECUTOR_POOL_SIZE_MAX;
+                        }
+                }
         }
 
         /* Note that we do not set up the notify fd here. We do that after deserialization,
@@ -1318,6 +1448,18 @@ static void unit_gc_mark_good(Unit *u, unsigned gc_marker) {
                         unit_gc_mark_good(other, gc_marker);
 }
 
+static void unit_gc_collect(Unit *u, unsigned gc_marker) {
+        assert(u);
+
+        u->gc_marker = gc_marker + GC_OFFSET_BAD;
+
+        if (u->in_cleanup_queue)
+                return;
+
+        unit_add_to_cleanup_queue(u);
+        u->manager->n_gc_collected_units++;
+}
+
 static void unit_gc_sweep(Unit *u, unsigned gc_marker) {
         Unit *other;
         bool is_bad;
@@ -1370,19 +1512,58 @@ static void unit_gc_sweep(Unit *u, unsigned gc_marker) {
 bad:
         /* We definitely know that this one is not useful anymore, so
          * let's mark it for deletion */
-        u->gc_marker = gc_marker + GC_OFFSET_BAD;
-        unit_add_to_cleanup_queue(u);
+        unit_gc_collect(u, gc_marker);
         return;
 
 good:
         unit_gc_mark_good(u, gc_marker);
 }
 
-static unsigned manager_dispatch_gc_unit_queue(Manager *m) {
+usec_t manager_gc_pause_bucket_max(size_t i) {
+        usec_t max = 10;
+
+        assert(i < MANAGER_GC_PAUSE_BUCKETS);
+
+        /* The buckets cover pauses of up to 10µs, 100µs, 1ms, 10ms, 100ms, and the last one everything
+         * longer. */
+
+        if (i == MANAGER_GC_PAUSE_BUCKETS - 1)
+                return USEC_INFINITY;
+
+        for (; i > 0; i--)
+                max *= 10;
+
+        return max;
+}
+
+static void manager_record_gc_pause(Manager *m, usec_t t) {
+        size_t i = 0;
+
+        assert(m);
+
+        while (t > manager_gc_pause_bucket_max(i))
+                i++;
+
+        m->gc_pause_histogram[i]++;
+        m->gc_pause_max_usec = MAX(m->gc_pause_max_usec, t);
+        m->n_gc_runs++;
+}
+
+unsigned manager_dispatch_gc_unit_queue(Manager *m) {
         unsigned n = 0, gc_marker;
+        usec_t start, elapsed = 0;
 
         assert(m);
 
+        /* Sweeps the queued units until the queue is empty or MANAGER_GC_BUDGET_USEC of this event loop
+         * iteration are used up. Each sweep is independent of the others, as the markers are only valid
+         * during one call, hence we can stop between any two units. If we stop early we return 0, so that
+         * the other queues and the event loop get their turn, and continue in the next iteration, see
+         * manager_loop(). */
+
+        if (!m->gc_unit_queue || m->gc_budget_used_usec >= MANAGER_GC_BUDGET_USEC)
+                return 0;
+
         /* log_debug("Running GC..."); */
 
         m->gc_marker += _GC_OFFSET_MAX;
@@ -1390,6 +1571,7 @@ static unsigned manager_dispatch_gc_unit_queue(Manager *m) {
                 m->gc_marker = 1;
 
         gc_marker = m->gc_marker;
+        start = now(CLOCK_MONOTONIC);
 
         Unit *u;
         while ((u = m->gc_unit_queue)) {
@@ -1406,9 +1588,20 @@ static unsigned manager_dispatch_gc_unit_queue(Manager *m) {
                            GC_OFFSET_BAD, GC_OFFSET_UNSURE)) {
                         if (u->id)
                                 log_unit_debug(u, "Collecting.");
-                        u->gc_marker = gc_marker + GC_OFFSET_BAD;
-                        unit_add_to_cleanup_queue(u);
+                        unit_gc_collect(u, gc_marker);
                 }
+
+                elapsed = usec_sub_unsigned(now(CLOCK_MONOTONIC), start);
+                if (m->gc_budget_used_usec + elapsed >= MANAGER_GC_BUDGET_USEC)
+                        break;
+        }
+
+        m->gc_budget_used_usec += elapsed;
+        manager_record_gc_pause(m, elapsed);
+
+        if (m->gc_unit_queue) {
+                log_debug("Garbage collection used up its time budget after %u units, continuing later.", n);
+                return 0;
         }
 
         return n;
@@ -1639,7 +1832,9 @@ static void manager_clear_jobs_and_units(Manager *m) {
         assert(!m->load_queue);
         assert(prioq_isempty(m->run_queue));
         assert(!m->dbus_unit_queue);
+        assert(prioq_isempty(m->dbus_unit_deferred_queue));
         assert(!m->dbus_job_queue);
+        assert(!m->varlink_unit_state_queue);
         assert(!m->cleanup_queue);
         assert(!m->gc_unit_queue);
         assert(!m->gc_job_queue);
@@ -1661,6 +1856,10 @@ static void manager_clear_jobs_and_units(Manager *m) {
         m->n_installed_jobs = 0;
         m->n_failed_jobs = 0;
 
+        m->n_transactions = 0;
+        m->transactions_usec = 0;
+        m->transaction_max_usec = 0;
+
         m->transactions_with_cycle = set_free(m->transactions_with_cycle);
 }
 
@@ -1669,6 +1868,7 @@ Manager* manager_free(Manager *m) {
                 return NULL;
 
         manager_clear_jobs_and_units(m);
+        manager_trim_pools(m);
 
         for (UnitType c = 0; c < _UNIT_TYPE_MAX; c++)
                 if (unit_vtable[c]->shutdown)
@@ -1678,6 +1878,7 @@ Manager* manager_free(Manager *m) {
         manager_shutdown_cgroup(m, /* delete= */ IN_SET(m->objective, MANAGER_EXIT, MANAGER_REBOOT, MANAGER_POWEROFF, MANAGER_HALT, MANAGER_KEXEC));
 
         lookup_paths_flush_generator(&m->lookup_paths);
+        generator_timing_free_many(m->generator_timings, m->n_generator_timings);
 
         bus_done(m);
         manager_varlink_done(m);
@@ -1696,6 +1897,7 @@ Manager* manager_free(Manager *m) {
         hashmap_free(m->watch_bus);
 
         prioq_free(m->run_queue);
+        prioq_free(m->dbus_unit_deferred_queue);
 
         set_free(m->startup_units);
         set_free(m->failed_units);
@@ -1711,6 +1913,9 @@ Manager* manager_free(Manager *m) {
         sd_event_source_unref(m->handoff_timestamp_event_source);
         sd_event_source_unref(m->pidref_event_source);
         sd_event_source_unref(m->memory_pressure_event_source);
+        sd_event_source_disable_unref(m->dbus_queue_event_source);
+
+        set_free(m->dbus_units_freed_while_reloading);
 
         safe_close(m->signal_fd);
         safe_close(m->notify_fd);
@@ -1732,6 +1937,7 @@ Manager* manager_free(Manager *m) {
 
         hashmap_free(m->cgroup_unit);
         manager_free_unit_name_maps(m);
+        unit_directory_cache_free(m->unit_directory_cache);
 
         free(m->switch_root);
         free(m->switch_root_init);
@@ -1764,6 +1970,7 @@ Manager* manager_free(Manager *m) {
         bpf_restrict_fs_destroy(m->restrict_fs);
 #endif
 
+        manager_free_executor_pool(m);
         safe_close(m->executor_fd);
         free(m->executor_path);
 
@@ -2033,6 +2240,8 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds, const char *roo
 
         lookup_paths_log(&m->lookup_paths);
 
+        manager_load_unit_directory_cache(m);
+
         {
                 /* This block is (optionally) done with the reloading counter bumped */
                 _unused_ _cleanup_(manager_reloading_stopp) Manager *reloading = NULL;
@@ -2099,6 +2308,9 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds, const char *roo
                         /* This shouldn't fail, except if things are really broken. */
                         return r;
 
+                /* The pool is only an optimization, spawning works without it */
+                (void) manager_setup_executor_pool(m);
+
                 /* Connect to the bus if we are good for it */
                 manager_setup_bus(m);
 
@@ -2112,10 +2324,14 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds, const char *roo
                 /* Clean up runtime objects */
                 manager_vacuum(m);
 
-                if (serialization)
+                if (serialization) {
                         /* Let's wait for the UnitNew/JobNew messages being sent, before we notify that the
                          * reload is finished */
                         m->send_reloading_done = true;
+
+                        /* After reexecution all units are loaded again, and /var/ is usually around */
+                        manager_save_unit_directory_cache(m);
+                }
         }
 
         manager_ready(m);
@@ -2125,7 +2341,7 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds, const char *roo
         return 0;
 }
 
-int manager_add_job_full(
+static int manager_run_transaction(
                 Manager *m,
                 JobType type,
                 Unit *unit,
@@ -2136,25 +2352,13 @@ int manager_add_job_full(
                 Job **ret) {
 
         _cleanup_(transaction_abort_and_freep) Transaction *tr = NULL;
+        usec_t begin, duration;
         int r;
 
         assert(m);
-        assert(type >= 0 && type < _JOB_TYPE_MAX);
         assert(unit);
-        assert(mode >= 0 && mode < _JOB_MODE_MAX);
-        assert((extra_flags & ~_TRANSACTION_FLAGS_MASK_PUBLIC) == 0);
-
-        if (mode == JOB_ISOLATE && type != JOB_START)
-                return sd_bus_error_set(reterr_error, SD_BUS_ERROR_INVALID_ARGS, "Isolate is only valid for start.");
-
-        if (mode == JOB_ISOLATE && !unit->allow_isolate)
-                return sd_bus_error_set(reterr_error, BUS_ERROR_NO_ISOLATION, "Operation refused, unit may not be isolated.");
-
-        if (mode == JOB_TRIGGERING && type != JOB_STOP)
-                return sd_bus_error_set(reterr_error, SD_BUS_ERROR_INVALID_ARGS, "--job-mode=triggering is only valid for stop.");
 
-        if (mode == JOB_RESTART_DEPENDENCIES && type != JOB_START)
-                return sd_bus_error_set(reterr_error, SD_BUS_ERROR_INVALID_ARGS, "--job-mode=restart-dependencies is only valid for start.");
+        begin = now(CLOCK_MONOTONIC);
 
         tr = transaction_new(mode == JOB_REPLACE_IRREVERSIBLY, ++m->last_transaction_id);
         if (!tr)
@@ -2177,28 +2381,28 @@ int manager_add_job_full(
                         (mode == JOB_RESTART_DEPENDENCIES ? TRANSACTION_PROPAGATE_START_AS_RESTART : 0) |
                         extra_flags,
                         reterr_error);
-        if (r < 0)
-                return r;
-
-        if (mode == JOB_ISOLATE) {
+        if (r >= 0 && mode == JOB_ISOLATE)
                 r = transaction_add_isolate_jobs(tr, m);
-                if (r < 0)
-                        return r;
-        }
-
-        if (mode == JOB_TRIGGERING) {
+        if (r >= 0 && mode == JOB_TRIGGERING)
                 r = transaction_add_triggering_jobs(tr, unit);
-                if (r < 0)
-                        return r;
-        }
+        if (r >= 0)
+                r = transaction_activate(tr, m, mode, affected_jobs, reterr_error);
+
+        /* Keep track of how much time we spend in transactions, including failed ones (which might be the
+         * expensive ones, e.g. when an ordering cycle has to be broken), so that pathological dependency
+         * graphs can be spotted. */
+        duration = usec_sub_unsigned(now(CLOCK_MONOTONIC), begin);
+        m->n_transactions++;
+        m->transactions_usec = usec_add(m->transactions_usec, duration);
+        m->transaction_max_usec = MAX(m->transaction_max_usec, duration);
 
-        r = transaction_activate(tr, m, mode, affected_jobs, reterr_error);
         if (r < 0)
                 return r;
 
         log_unit_debug(unit,
-                       "Enqueued job %s/%s as %u", unit->id,
-                       job_type_to_string(type), (unsigned) tr->anchor_job->id);
+                       "Enqueued job %s/%s as %u, transaction took %s.", unit->id,
+                       job_type_to_string(type), (unsigned) tr->anchor_job->id,
+                       FORMAT_TIMESPAN(duration, 1));
 
         if (ret)
                 *ret = tr->anchor_job;
@@ -2207,6 +2411,37 @@ int manager_add_job_full(
         return 0;
 }
 
+int manager_add_job_full(
+                Manager *m,
+                JobType type,
+                Unit *unit,
+                JobMode mode,
+                TransactionAddFlags extra_flags,
+                Set *affected_jobs,
+                sd_bus_error *reterr_error,
+                Job **ret) {
+
+        assert(m);
+        assert(type >= 0 && type < _JOB_TYPE_MAX);
+        assert(unit);
+        assert(mode >= 0 && mode < _JOB_MODE_MAX);
+        assert((extra_flags & ~_TRANSACTION_FLAGS_MASK_PUBLIC) == 0);
+
+        if (mode == JOB_ISOLATE && type != JOB_START)
+                return sd_bus_error_set(reterr_error, SD_BUS_ERROR_INVALID_ARGS, "Isolate is only valid for start.");
+
+        if (mode == JOB_ISOLATE && !unit->allow_isolate)
+                return sd_bus_error_set(reterr_error, BUS_ERROR_NO_ISOLATION, "Operation refused, unit may not be isolated.");
+
+        if (mode == JOB_TRIGGERING && type != JOB_STOP)
+                return sd_bus_error_set(reterr_error, SD_BUS_ERROR_INVALID_ARGS, "--job-mode=triggering is only valid for stop.");
+
+        if (mode == JOB_RESTART_DEPENDENCIES && type != JOB_START)
+                return sd_bus_error_set(reterr_error, SD_BUS_ERROR_INVALID_ARGS, "--job-mode=restart-dependencies is only valid for start.");
+
+        return manager_run_transaction(m, type, unit, mode, extra_flags, affected_jobs, reterr_error, ret);
+}
+
 int manager_add_job(
         Manager *m,
         JobType type,
@@ -2573,9 +2808,100 @@ void manager_trigger_run_queue(Manager *m) {
                 log_warning_errno(r, "Failed to enable job run queue event source, ignoring: %m");
 }
 
+static int manager_dispatch_dbus_queue_timer(sd_event_source *source, usec_t usec, void *userdata);
+
+static void manager_arm_dbus_deferred_queue_timer(Manager *m) {
+        Unit *u;
+        int r;
+
+        assert(m);
+
+        u = prioq_peek(m->dbus_unit_deferred_queue);
+        if (!u)
+                return;
+
+        r = event_reset_time(
+                        m->event, &m->dbus_queue_event_source,
+                        CLOCK_MONOTONIC, bus_unit_change_signal_due(u), 0,
+                        manager_dispatch_dbus_queue_timer, m,
+                        SD_EVENT_PRIORITY_NORMAL, "manager-dbus-queue",
+                        /* force_reset= */ true);
+        if (r < 0)
+                log_warning_errno(r, "Failed to set up timer for deferred change signals, ignoring: %m");
+}
+
+static int manager_dispatch_dbus_queue_timer(sd_event_source *source, usec_t usec, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        unsigned budget = MANAGER_BUS_MESSAGE_BUDGET;
+        usec_t ts = now(CLOCK_MONOTONIC);
+        Unit *u;
+
+        /* Send the change signals that were deferred and are due now. Whatever doesn't fit into the
+         * budget is due already, and hence picked up in the next event loop iteration. */
+        while (budget > 0 && (u = prioq_peek(m->dbus_unit_deferred_queue))) {
+                assert(u->in_dbus_deferred_queue);
+
+                if (bus_unit_change_signal_due(u) > ts)
+                        break;
+
+                bus_unit_send_change_signal(u);
+                budget--;
+        }
+
+        manager_arm_dbus_deferred_queue_timer(m);
+        return 0;
+}
+
+static bool manager_defer_unit_change_signal(Manager *m, Unit *u) {
+        int r;
+
+        assert(m);
+        assert(u);
+        assert(u->in_dbus_queue);
+        assert(!u->in_dbus_deferred_queue);
+
+        /* Moves the unit from the D-Bus queue to the queue of deferred change signals, so that it isn't
+         * looked at again until its change signal is due. */
+
+        r = prioq_put(m->dbus_unit_deferred_queue, u, &u->dbus_deferred_queue_idx);
+        if (r < 0) {
+                log_unit_debug_errno(u, r, "Failed to defer change signal, sending it right away: %m");
+                return false;
+        }
+
+        LIST_REMOVE(dbus_queue, m->dbus_unit_queue, u);
+        u->in_dbus_deferred_queue = true;
+        return true;
+}
+
+static unsigned manager_flush_dbus_units_freed_while_reloading(Manager *m) {
+        unsigned n = 0;
+        char *id;
+
+        assert(m);
+
+        /* Tell the clients about the units we freed while reloading and which didn't come back. Those that
+         * did come back were announced before, so only send change signals for them. */
+
+        while ((id = set_steal_first(m->dbus_units_freed_while_reloading))) {
+                _cleanup_free_ char *p = id;
+                Unit *u;
+
+                u = manager_get_unit(m, id);
+                if (u && streq(u->id, id)) {
+                        u->sent_dbus_new_signal = true;
+                        continue;
+                }
+
+                bus_send_unit_removed_signal(m, id);
+                n++;
+        }
+
+        return n;
+}
+
 static unsigned manager_dispatch_dbus_queue(Manager *m) {
         unsigned n = 0, budget;
-        Unit *u;
         Job *j;
 
         assert(m);
@@ -2586,7 +2912,7 @@ static unsigned manager_dispatch_dbus_queue(Manager *m) {
                 budget = UINT_MAX; /* infinite budget in this case */
         else {
                 /* Anything to do at all? */
-                if (!m->dbus_unit_queue && !m->dbus_job_queue)
+                if (!m->dbus_unit_queue && !m->dbus_job_queue && set_isempty(m->dbus_units_freed_while_reloading))
                         return 0;
 
                 /* Do we have overly many messages queued at the moment? If so, let's not enqueue more on top, let's
@@ -2608,17 +2934,44 @@ static unsigned manager_dispatch_dbus_queue(Manager *m) {
                 budget = MANAGER_BUS_MESSAGE_BUDGET;
         }
 
-        while (budget != 0 && (u = m->dbus_unit_queue)) {
+        if (!MANAGER_IS_RELOADING(m))
+                n += manager_flush_dbus_units_freed_while_reloading(m);
 
-                assert(u->in_dbus_queue);
+        usec_t ts = now(CLOCK_MONOTONIC);
+        bool deferred = false;
+        Unit *u;
 
-                bus_unit_send_change_signal(u);
+        /* Don't defer anything while reloading, see above */
+        if (budget == UINT_MAX)
+                while ((u = prioq_peek(m->dbus_unit_deferred_queue))) {
+                        bus_unit_send_change_signal(u);
+                        n++;
+                }
+
+        LIST_FOREACH(dbus_queue, i, m->dbus_unit_queue) {
+                if (budget == 0)
+                        break;
+
+                assert(i->in_dbus_queue);
+
+                if (budget != UINT_MAX &&
+                    bus_unit_change_signal_due(i) > ts &&
+                    manager_defer_unit_change_signal(m, i)) {
+                        deferred = true;
+                        continue;
+                }
+
+                bus_unit_send_change_signal(i);
                 n++;
 
                 if (budget != UINT_MAX)
                         budget--;
         }
 
+        /* Some change signals were deferred, make sure we come back for them */
+        if (deferred)
+                manager_arm_dbus_deferred_queue_timer(m);
+
         while (budget != 0 && (j = m->dbus_job_queue)) {
                 assert(j->in_dbus_queue);
 
@@ -2748,62 +3101,181 @@ static int manager_get_units_for_pidref(Manager *m, const PidRef *pidref, Unit *
         return (int) n;
 }
 
-static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
-        Manager *m = ASSERT_PTR(userdata);
-        _cleanup_(pidref_done) PidRef pidref = PIDREF_NULL;
+typedef struct NotifyMessage {
+        PidRef pidref;
         struct ucred ucred;
-        _cleanup_(fdset_free_asyncp) FDSet *fds = NULL;
-        int r;
+        char **tags;
+        FDSet *fds;
+} NotifyMessage;
 
-        assert(m->notify_fd == fd);
+static void notify_message_done(NotifyMessage *msg) {
+        assert(msg);
 
-        if (revents != EPOLLIN) {
-                log_warning("Got unexpected poll event for notify fd.");
-                return 0;
-        }
+        pidref_done(&msg->pidref);
+        msg->tags = strv_free(msg->tags);
+        msg->fds = fdset_free_async(msg->fds);
+}
 
-        _cleanup_strv_free_ char **tags = NULL;
-        r = notify_recv_with_fds_strv(m->notify_fd, &tags, &ucred, &pidref, &fds);
-        if (r == -EAGAIN)
-                return 0;
-        if (r < 0)
-                /* If this is any other, real error, then stop processing this socket. This of course means
-                 * we won't take notification messages anymore, but that's still better than busy looping:
-                 * being woken up over and over again, but being unable to actually read the message from the
-                 * socket. */
-                return r;
+static void notify_message_done_many(NotifyMessage *msgs, size_t n_msgs) {
+        assert(msgs || n_msgs == 0);
 
-        /* Possibly a barrier fd, let's see. */
-        if (manager_process_barrier_fd(tags, fds)) {
-                log_debug("Received barrier notification message from PID " PID_FMT ".", pidref.pid);
-                return 0;
-        }
+        FOREACH_ARRAY(msg, msgs, n_msgs)
+                notify_message_done(msg);
 
-        /* Increase the generation counter used for filtering out duplicate unit invocations. */
-        m->notifygen++;
+        free(msgs);
+}
 
-        /* Notify every unit that might be interested, which might be multiple. */
-        _cleanup_free_ Unit **array = NULL;
+static bool notify_message_can_coalesce(const NotifyMessage *msg) {
+        assert(msg);
 
-        int n_array = manager_get_units_for_pidref(m, &pidref, &array);
-        if (n_array < 0) {
-                log_warning_errno(n_array, "Failed to determine units for PID " PID_FMT ", ignoring: %m", pidref.pid);
-                return 0;
-        }
-        if (n_array == 0)
-                log_debug("Cannot find unit for notify message of PID "PID_FMT", ignoring.", pidref.pid);
-        else
-                /* And now invoke the per-unit callbacks. Note that manager_invoke_notify_message() will handle
-                 * duplicate units – making sure we only invoke each unit's handler once. */
-                FOREACH_ARRAY(u, array, n_array)
-                        manager_invoke_notify_message(m, *u, &pidref, &ucred, tags, fds);
+        /* Status updates and watchdog keep-alives are by far the most frequent messages, and only their
+         * latest state matters: applying the last STATUS= and one WATCHDOG=1 has the same effect as
+         * applying all of them one by one. */
 
-        if (!fdset_isempty(fds))
-                log_warning("Got extra auxiliary fds with notification message, closing them.");
+        if (strv_isempty(msg->tags) || !fdset_isempty(msg->fds))
+                return false;
 
+        STRV_FOREACH(tag, msg->tags)
+                if (!startswith(*tag, "STATUS=") && !streq(*tag, "WATCHDOG=1"))
+                        return false;
+
+        return true;
+}
+
+static int notify_message_coalesce(NotifyMessage *prev, NotifyMessage *msg) {
+        _cleanup_strv_free_ char **tags = NULL;
+        const char *status = NULL;
+        bool watchdog = false;
+
+        assert(prev);
+        assert(msg);
+
+        /* Merges an earlier message from the same sender into this one */
+
+        FOREACH_ELEMENT(i, ((NotifyMessage*[]) { prev, msg }))
+                STRV_FOREACH(tag, (*i)->tags)
+                        if (streq(*tag, "WATCHDOG=1"))
+                                watchdog = true;
+                        else
+                                status = *tag;
+
+        if (watchdog && strv_extend(&tags, "WATCHDOG=1") < 0)
+                return -ENOMEM;
+        if (status && strv_extend(&tags, status) < 0)
+                return -ENOMEM;
+
+        strv_free_and_replace(msg->tags, tags);
+        notify_message_done(prev);
         return 0;
 }
 
+static void manager_process_notify_message(Manager *m, NotifyMessage *msg) {
+        assert(m);
+        assert(msg);
+
+        /* Possibly a barrier fd, let's see. */
+        if (manager_process_barrier_fd(msg->tags, msg->fds)) {
+                log_debug("Received barrier notification message from PID " PID_FMT ".", msg->pidref.pid);
+                return;
+        }
+
+        /* Increase the generation counter used for filtering out duplicate unit invocations. */
+        m->notifygen++;
+
+        /* Notify every unit that might be interested, which might be multiple. */
+        _cleanup_free_ Unit **array = NULL;
+
+        int n_array = manager_get_units_for_pidref(m, &msg->pidref, &array);
+        if (n_array < 0)
+                return (void) log_warning_errno(n_array, "Failed to determine units for PID " PID_FMT ", ignoring: %m", msg->pidref.pid);
+        if (n_array == 0)
+                log_debug("Cannot find unit for notify message of PID "PID_FMT", ignoring.", msg->pidref.pid);
+        else
+                /* And now invoke the per-unit callbacks. Note that manager_invoke_notify_message() will handle
+                 * duplicate units – making sure we only invoke each unit's handler once. */
+                FOREACH_ARRAY(u, array, n_array)
+                        manager_invoke_notify_message(m, *u, &msg->pidref, &msg->ucred, msg->tags, msg->fds);
+
+        if (!fdset_isempty(msg->fds))
+                log_warning("Got extra auxiliary fds with notification message, closing them.");
+}
+
+static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        NotifyMessage *msgs = NULL;
+        size_t n_msgs = 0, n_coalesced = 0;
+        int r = 0;
+
+        assert(m->notify_fd == fd);
+
+        CLEANUP_ARRAY(msgs, n_msgs, notify_message_done_many);
+
+        if (revents != EPOLLIN) {
+                log_warning("Got unexpected poll event for notify fd.");
+                return 0;
+        }
+
+        /* Services sending frequent status updates or watchdog keep-alives keep this socket busy. Let's
+         * receive whatever is queued in one go, and merge consecutive status/watchdog-only messages of
+         * the same sender, so that each is applied once per iteration rather than once per message. */
+
+        while (n_msgs < MANAGER_NOTIFY_BUDGET) {
+                if (!GREEDY_REALLOC(msgs, n_msgs + 1)) {
+                        r = log_oom();
+                        break;
+                }
+
+                NotifyMessage *msg = msgs + n_msgs;
+                *msg = (NotifyMessage) {
+                        .pidref = PIDREF_NULL,
+                };
+
+                r = notify_recv_with_fds_strv(m->notify_fd, &msg->tags, &msg->ucred, &msg->pidref, &msg->fds);
+                if (r == -EAGAIN) {
+                        /* Either the socket is drained, or this was an invalid message. In the latter case
+                         * we'll be called again, as the socket is still readable. */
+                        r = 0;
+                        break;
+                }
+                if (r < 0)
+                        /* If this is any other, real error, then stop processing this socket. This of course
+                         * means we won't take notification messages anymore, but that's still better than
+                         * busy looping: being woken up over and over again, but being unable to actually read
+                         * the message from the socket. Process what we already got first though. */
+                        break;
+
+                n_msgs++;
+
+                if (!notify_message_can_coalesce(msg))
+                        continue;
+
+                /* Find the previous message of the same sender, if it can be merged into this one. */
+                for (NotifyMessage *prev = msg; prev > msgs; ) {
+                        prev--;
+
+                        if (!pidref_is_set(&prev->pidref) || !pidref_equal(&prev->pidref, &msg->pidref))
+                                continue;
+
+                        if (notify_message_can_coalesce(prev) && notify_message_coalesce(prev, msg) >= 0)
+                                n_coalesced++;
+
+                        break;
+                }
+        }
+
+        m->n_notify_messages += n_msgs;
+        m->n_notify_messages_coalesced += n_coalesced;
+
+        if (n_coalesced > 0)
+                log_debug("Received %zu notification messages, %zu of them merged into later ones.", n_msgs, n_coalesced);
+
+        FOREACH_ARRAY(msg, msgs, n_msgs)
+                if (pidref_is_set(&msg->pidref))
+                        manager_process_notify_message(m, msg);
+
+        return r;
+}
+
 static void manager_invoke_sigchld_event(
                 Manager *m,
                 Unit *u,
@@ -2825,12 +3297,32 @@ static void manager_invoke_sigchld_event(
                 UNIT_VTABLE(u)->sigchld_event(u, si->si_pid, si->si_code, si->si_status);
 }
 
-static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
-        Manager *m = ASSERT_PTR(userdata);
+static bool manager_sigchld_should_yield(Manager *m) {
+        struct pollfd pollfd[3];
+        size_t n = 0;
+
+        assert(m);
+
+        /* Notification messages, handoff timestamps and pidrefs are supposed to be processed before the
+         * SIGCHLD of the process that sent them, which the event source priorities ensure. Hence, if any
+         * of them are waiting, stop reaping more children and go back to the event loop first. */
+
+        FOREACH_ELEMENT(fd, ((const int[]) { m->notify_fd, m->handoff_timestamp_fds[0], m->pidref_transport_fds[0] }))
+                if (*fd >= 0)
+                        pollfd[n++] = (struct pollfd) { .fd = *fd, .events = POLLIN };
+
+        if (n == 0)
+                return false;
+
+        return poll(pollfd, n, /* timeout= */ 0) != 0;
+}
+
+static int manager_reap_child(Manager *m) {
         siginfo_t si = {};
-        int r;
 
-        assert(source);
+        assert(m);
+
+        /* Returns 0 if there was no child to reap, > 0 if one was reaped */
 
         /* First we call waitid() for a PID and do not reap the zombie. That way we can still access
          * /proc/$PID for it while it is a zombie. */
@@ -2840,11 +3332,11 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
                 if (errno != ECHILD)
                         log_error_errno(errno, "Failed to peek for child with waitid(), ignoring: %m");
 
-                goto turn_off;
+                return 0;
         }
 
         if (si.si_pid <= 0)
-                goto turn_off;
+                return 0;
 
         if (SIGINFO_CODE_IS_DEAD(si.si_code)) {
                 _cleanup_free_ char *name = NULL;
@@ -2886,19 +3378,54 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
                         FOREACH_ARRAY(u, array, n_array)
                                 manager_invoke_sigchld_event(m, *u, &si);
                 }
+
+                /* Note that this is an upper bound for children that exited after the SIGCHLD we measure
+                 * from, as signals are coalesced. */
+                usec_t latency = usec_sub_unsigned(now(CLOCK_MONOTONIC), m->sigchld_timestamp);
+                m->n_reaped_children++;
+                m->reap_latency_usec = usec_add(m->reap_latency_usec, latency);
+                m->reap_latency_max_usec = MAX(m->reap_latency_max_usec, latency);
         }
 
         /* And now, we actually reap the zombie. */
-        if (waitid(P_PID, si.si_pid, &si, WEXITED) < 0) {
-                log_error_errno(errno, "Failed to dequeue child, ignoring: %m");
-                return 0;
+        if (waitid(P_PID, si.si_pid, &si, WEXITED) < 0)
+                return log_error_errno(errno, "Failed to dequeue child, ignoring: %m");
+
+        return 1;
+}
+
+static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+        unsigned n = 0;
+        int r;
+
+        assert(source);
+
+        /* When many processes exit at once, e.g. because lots of oneshot services finish together, going
+         * through a full event loop iteration for each of them is expensive. Hence reap a number of them in
+         * one go, unless there's something waiting that needs to be processed first. */
+
+        for (;;) {
+                r = manager_reap_child(m);
+                if (r < 0)
+                        return 0; /* Keep the event source on, and try again next iteration */
+                if (r == 0)
+                        break;
+
+                if (++n >= MANAGER_SIGCHLD_BUDGET || manager_sigchld_should_yield(m)) {
+                        if (n > 1)
+                                log_debug("Reaped %u children in one event loop iteration, more pending.", n);
+                        return 0;
+                }
         }
 
-        return 0;
+        if (n > 1)
+                log_debug("Reaped %u children in one event loop iteration.", n);
 
-turn_off:
         /* All children processed for now, turn off event source */
 
+        m->sigchld_timestamp = 0;
+
         r = sd_event_source_set_enabled(m->sigchld_event_source, SD_EVENT_OFF);
         if (r < 0)
                 return log_error_errno(r, "Failed to disable SIGCHLD event source: %m");
@@ -2974,6 +3501,9 @@ static int manager_dispatch_signal_fd(sd_event_source *source, int fd, uint32_t
         switch (sfsi.ssi_signo) {
 
         case SIGCHLD:
+                if (m->sigchld_timestamp == 0)
+                        m->sigchld_timestamp = now(CLOCK_MONOTONIC);
+
                 r = sd_event_source_set_enabled(m->sigchld_event_source, SD_EVENT_ON);
                 if (r < 0)
                         log_warning_errno(r, "Failed to enable SIGCHLD event source, ignoring: %m");
@@ -3278,6 +3808,7 @@ int manager_loop(Manager *m) {
         manager_check_finished(m);
 
         /* There might still be some zombies hanging around from before we were exec()'ed. Let's reap them. */
+        m->sigchld_timestamp = now(CLOCK_MONOTONIC);
         r = sd_event_source_set_enabled(m->sigchld_event_source, SD_EVENT_ON);
         if (r < 0)
                 return log_error_errno(r, "Failed to enable SIGCHLD event source: %m");
@@ -3325,8 +3856,14 @@ int manager_loop(Manager *m) {
                 if (manager_dispatch_dbus_queue(m) > 0)
                         continue;
 
-                /* Sleep for watchdog runtime wait time */
-                r = sd_event_run(m->event, watchdog_runtime_wait(/* divisor= */ 2));
+                if (manager_varlink_dispatch_unit_state_queue(m) > 0)
+                        continue;
+
+                /* Sleep for watchdog runtime wait time, unless garbage collection ran out of time and
+                 * there's more to do, in which case we only dispatch what's pending and return right
+                 * away. */
+                m->gc_budget_used_usec = 0;
+                r = sd_event_run(m->event, m->gc_unit_queue ? 0 : watchdog_runtime_wait(/* divisor= */ 2));
                 if (r < 0)
                         return log_error_errno(r, "Failed to run event loop: %m");
         }
@@ -3627,14 +4164,22 @@ int manager_reload(Manager *m) {
          * it. */
 
         manager_clear_jobs_and_units(m);
-        lookup_paths_flush_generator(&m->lookup_paths);
+        bus_invalidate_property_caches(m);
         exec_shared_runtime_vacuum(m);
         dynamic_user_vacuum(m, false);
         m->uid_refs = hashmap_free(m->uid_refs);
         m->gid_refs = hashmap_free(m->gid_refs);
 
         (void) manager_run_environment_generators(m);
-        (void) manager_run_generators(m);
+
+        /* The generators' output is derived from the environment generators' output, hence only check after
+         * having run those. */
+        if (manager_generator_output_reusable(m))
+                log_info("Generators and their inputs are unchanged, reusing output of the previous generator run.");
+        else {
+                lookup_paths_flush_generator(&m->lookup_paths);
+                (void) manager_run_generators(m);
+        }
 
         /* We flushed out generated files, for which we don't watch mtime, so we should flush the old map. */
         manager_free_unit_name_maps(m);
@@ -3675,10 +4220,239 @@ int manager_reload(Manager *m) {
 
         manager_ready(m);
 
+        /* Units were freed and loaded again, let the io.systemd.Unit.Subscribe() clients start over */
+        manager_varlink_unit_state_reset(m);
+
+        manager_save_unit_directory_cache(m);
+
         m->send_reloading_done = true;
         return 0;
 }
 
+typedef struct IncomingDependency {
+        Unit *unit;                 /* The unit that declared the dependency, and is not reloaded itself */
+        UnitDependency dependency;
+        UnitDependencyMask mask;
+        const char *target;         /* The id of the reloaded unit the dependency points to */
+} IncomingDependency;
+
+static bool unit_can_reload_in_place(Unit *u) {
+        _cleanup_set_free_ Set *names = NULL;
+        const char *fragment, *n;
+        int r;
+
+        assert(u);
+
+        /* Units that are also populated from the kernel, that have a job, that other units point to via
+         * UnitRef, or that have (or would get) further names, are too entangled with the rest of the
+         * manager to be replaced on their own. */
+        if (u->perpetual ||
+            UNIT_VTABLE(u)->enumerate ||
+            u->job ||
+            u->nop_job ||
+            u->refs_by_target ||
+            !set_isempty(u->aliases))
+                return false;
+
+        r = unit_file_find_fragment(u->manager->unit_id_map, u->manager->unit_name_map, u->id, &fragment, &names);
+        if (r < 0 && r != -ENOENT)
+                return false;
+
+        SET_FOREACH(n, names)
+                if (!streq(n, u->id))
+                        return false;
+
+        return true;
+}
+
+int manager_reload_unit_files(Manager *m) {
+        _unused_ _cleanup_(manager_reloading_stopp) Manager *reloading = NULL;
+        _cleanup_free_ IncomingDependency *incoming = NULL;
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        _cleanup_set_free_ Set *changed = NULL;
+        _cleanup_strv_free_ char **ids = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        size_t n_incoming = 0;
+        Unit *u;
+        char *k;
+        int r;
+
+        assert(m);
+
+        /* Reloads only the units whose unit files changed, and leaves all others alone. Unlike
+         * manager_reload() this neither reruns generators nor rereads the manager configuration. Each
+         * changed unit is serialized, freed, loaded again and deserialized, i.e. it goes through the same
+         * steps as during a full reload. Dependencies other units declared on it are lost when it is freed,
+         * hence we remember and restore them.
+         *
+         * Returns > 0 on success, 0 if some changed unit cannot be reloaded on its own, in which case the
+         * caller should do a full reload instead. */
+
+        r = unit_file_build_name_map(&m->lookup_paths, &m->unit_cache_timestamp_hash, m->unit_directory_cache,
+                                     &m->unit_id_map, &m->unit_name_map, &m->unit_path_cache);
+        if (r < 0)
+                return log_error_errno(r, "Failed to rebuild name map: %m");
+
+        HASHMAP_FOREACH_KEY(u, k, m->units) {
+                /* ignore aliases */
+                if (u->id != k)
+                        continue;
+
+                if (u->transient || IN_SET(u->load_state, UNIT_STUB, UNIT_MERGED))
+                        continue;
+
+                if (!unit_files_changed(u))
+                        continue;
+
+                if (!unit_can_reload_in_place(u)) {
+                        log_unit_debug(u, "Unit files changed, but unit cannot be reloaded on its own.");
+                        return 0;
+                }
+
+                r = set_ensure_put(&changed, NULL, u);
+                if (r < 0)
+                        return log_oom();
+        }
+
+        if (set_isempty(changed)) {
+                log_info("No unit files changed, nothing to reload.");
+                return 1;
+        }
+
+        r = manager_open_serialization(m, &f);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create serialization file: %m");
+
+        fds = fdset_new();
+        if (!fds)
+                return log_oom();
+
+        reloading = manager_reloading_start(m);
+
+        SET_FOREACH(u, changed) {
+                char *id;
+
+                id = strdup(u->id);
+                if (!id)
+                        return log_oom();
+
+                r = strv_consume(&ids, id);
+                if (r < 0)
+                        return log_oom();
+
+                for (UnitDependency d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
+                        UNIT_DEPENDENCY_SET_FOREACH(e, unit_get_dependencies(u, d)) {
+                                /* Dependencies between reloaded units are declared again when loading them */
+                                if (e->info.destination_mask == 0 || set_contains(changed, e->unit))
+                                        continue;
+
+                                if (!GREEDY_REALLOC(incoming, n_incoming + 1))
+                                        return log_oom();
+
+                                incoming[n_incoming++] = (IncomingDependency) {
+                                        .unit = e->unit,
+                                        .dependency = unit_dependency_inverse(d),
+                                        .mask = e->info.destination_mask,
+                                        .target = id,
+                                };
+                        }
+
+                r = unit_serialize_state(u, f, fds, /* switching_root= */ false);
+                if (r < 0)
+                        return r;
+        }
+
+        r = finish_serialization_file(f);
+        if (r < 0)
+                return log_error_errno(r, "Failed to finish serialization: %m");
+
+        /* 💀 This is the point of no return, from here on there is no way back. 💀 */
+        reloading = NULL;
+
+        log_info("Reloading %u changed units.", set_size(changed));
+
+        bus_manager_send_reloading(m, true);
+        bus_invalidate_property_caches(m);
+
+        SET_FOREACH(u, changed)
+                unit_free(u);
+        changed = set_free(changed);
+
+        STRV_FOREACH(id, ids) {
+                r = manager_load_unit_prepare(m, *id, /* path= */ NULL, /* e= */ NULL, &u);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to load unit %s, ignoring: %m", *id);
+        }
+
+        manager_dispatch_load_queue(m);
+
+        FOREACH_ARRAY(i, incoming, n_incoming) {
+                Unit *target;
+
+                target = manager_get_unit(m, i->target);
+                if (!target)
+                        continue;
+
+                r = unit_add_dependency(i->unit, i->dependency, target, /* add_reference= */ false, i->mask);
+                if (r < 0)
+                        log_unit_warning_errno(i->unit, r, "Failed to restore %s dependency on %s, ignoring: %m",
+                                               unit_dependency_to_string(i->dependency), target->id);
+        }
+
+        for (;;) {
+                _cleanup_free_ char *line = NULL;
+
+                r = read_stripped_line_full(f, LONG_LINE_MAX, READ_LINE_NOT_A_TTY, &line);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to read serialization line, proceeding anyway: %m");
+                        break;
+                }
+                if (r == 0)
+                        break;
+
+                u = manager_get_unit(m, line);
+                if (u) {
+                        r = unit_deserialize_state(u, f, fds);
+                        if (r >= 0)
+                                continue;
+
+                        log_unit_notice_errno(u, r, "Failed to deserialize unit, skipping: %m");
+                }
+
+                r = unit_deserialize_state_skip(f);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to skip unit serialization, proceeding anyway: %m");
+                        break;
+                }
+        }
+
+        f = safe_fclose(f);
+
+        STRV_FOREACH(id, ids) {
+                u = manager_get_unit(m, *id);
+                if (!u)
+                        continue;
+
+                r = unit_coldplug(u);
+                if (r < 0)
+                        log_unit_warning_errno(u, r, "We couldn't coldplug unit, proceeding anyway: %m");
+        }
+
+        manager_vacuum(m);
+
+        assert(m->n_reloading > 0);
+        m->n_reloading--;
+
+        STRV_FOREACH(id, ids) {
+                u = manager_get_unit(m, *id);
+                if (u)
+                        unit_catchup(u);
+        }
+
+        m->send_reloading_done = true;
+        return 1;
+}
+
 void manager_reset_failed(Manager *m) {
         Unit *u;
 
@@ -3922,7 +4696,12 @@ void manager_check_finished(Manager *m) {
 
         manager_notify_finished(m);
 
+        manager_finish_critical_path(m);
+
         manager_invalidate_startup_units(m);
+
+        /* /var/ is available by now, remember the unit directories for the next boot */
+        manager_save_unit_directory_cache(m);
 }
 
 void manager_send_reloading(Manager *m) {
@@ -4060,7 +4839,202 @@ static int build_generator_environment(Manager *m, char ***ret) {
         return 0;
 }
 
-static int manager_execute_generators(Manager *m, char * const *paths, bool remount_ro) {
+static void generator_fingerprint_stat(const struct stat *st, struct siphash *state) {
+        nsec_t mtime;
+
+        assert(st);
+        assert(state);
+
+        mtime = timespec_load_nsec(&st->st_mtim);
+
+        siphash24_compress_typesafe(st->st_dev, state);
+        siphash24_compress_typesafe(st->st_ino, state);
+        siphash24_compress_typesafe(st->st_size, state);
+        siphash24_compress_typesafe(mtime, state);
+}
+
+static int manager_generator_fingerprint(Manager *m, char * const *paths, uint64_t *ret) {
+        _cleanup_strv_free_ char **binaries = NULL, **ge = NULL;
+        _cleanup_free_ char *cmdline = NULL;
+        const char *creds = NULL, *encrypted_creds = NULL;
+        struct siphash state;
+        int r;
+
+        assert(m);
+        assert(ret);
+
+        /* Hashes everything we know the output of the generators depends on: the generators themselves, the
+         * environment we pass to them, the kernel command line, the credentials passed to us, and the
+         * configuration files read by the generators we ship. Generators may look at anything else too, hence
+         * this is only used if ReuseGeneratorOutput= is enabled. */
+
+        siphash24_init(&state, SD_ID128_MAKE(2b,a3,5e,61,0c,d4,4f,9b,8e,17,c6,72,d0,3f,a9,44).bytes);
+
+        r = conf_files_list_strv(
+                        &binaries,
+                        /* suffix= */ NULL,
+                        /* root= */ NULL,
+                        CONF_FILES_EXECUTABLE|CONF_FILES_REGULAR|CONF_FILES_FILTER_MASKED,
+                        (const char* const*) paths);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(b, binaries) {
+                struct stat st;
+
+                if (stat(*b, &st) < 0)
+                        return -errno;
+
+                string_hash_func(*b, &state);
+                generator_fingerprint_stat(&st, &state);
+        }
+
+        r = build_generator_environment(m, &ge);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(e, ge)
+                string_hash_func(*e, &state);
+
+        r = proc_cmdline(&cmdline);
+        if (r < 0)
+                return r;
+
+        string_hash_func(cmdline, &state);
+
+        if (MANAGER_IS_SYSTEM(m)) {
+                creds = SYSTEM_CREDENTIALS_DIRECTORY;
+                encrypted_creds = ENCRYPTED_SYSTEM_CREDENTIALS_DIRECTORY;
+        } else {
+                (void) get_credentials_dir(&creds);
+                (void) get_encrypted_credentials_dir(&encrypted_creds);
+        }
+
+        FOREACH_STRING(f, "/etc/fstab", "/etc/crypttab", "/etc/integritytab", "/etc/veritytab",
+                       strempty(creds), strempty(encrypted_creds)) {
+                struct stat st = {};
+
+                if (!isempty(f) && stat(f, &st) < 0 && errno != ENOENT)
+                        return -errno;
+
+                generator_fingerprint_stat(&st, &state);
+        }
+
+        /* Never return zero, we use that for "unknown" */
+        *ret = siphash24_finalize(&state) ?: 1;
+        return 0;
+}
+
+static bool manager_generator_output_reusable(Manager *m) {
+        _cleanup_strv_free_ char **paths = NULL;
+        uint64_t fingerprint;
+        int r;
+
+        assert(m);
+
+        if (!m->reuse_generator_output || m->generator_fingerprint == 0)
+                return false;
+
+        paths = generator_binary_paths(m->runtime_scope);
+        if (!paths) {
+                log_oom_debug();
+                return false;
+        }
+
+        r = manager_generator_fingerprint(m, paths, &fingerprint);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to determine whether generators or their inputs changed, rerunning them: %m");
+                return false;
+        }
+
+        return fingerprint == m->generator_fingerprint;
+}
+
+static void generator_timing_free_many(GeneratorTiming *timings, size_t n) {
+        assert(timings || n == 0);
+
+        FOREACH_ARRAY(t, timings, n)
+                free(t->path);
+
+        free(timings);
+}
+
+static bool generator_timings_have_failure(Manager *m) {
+        assert(m);
+
+        FOREACH_ARRAY(t, m->generator_timings, m->n_generator_timings)
+                if (t->status != 0)
+                        return true;
+
+        return false;
+}
+
+static int manager_read_generator_timings(Manager *m, int *fd) {
+        GeneratorTiming *timings = NULL;
+        size_t n_timings = 0;
+        int r;
+
+        assert(m);
+        assert(fd);
+        assert(*fd >= 0);
+
+        CLEANUP_ARRAY(timings, n_timings, generator_timing_free_many);
+
+        r = finish_serialization_fd(*fd);
+        if (r < 0)
+                return r;
+
+        _cleanup_fclose_ FILE *f = take_fdopen(fd, "r");
+        if (!f)
+                return -errno;
+
+        for (;;) {
+                _cleanup_free_ char *line = NULL, *start = NULL, *finish = NULL, *status = NULL;
+                GeneratorTiming t = {};
+                const char *p;
+
+                r = read_line(f, LONG_LINE_MAX, &line);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                /* The path goes last, as it may contain spaces */
+                p = line;
+                r = extract_many_words(&p, NULL, 0, &start, &finish, &status);
+                if (r < 0)
+                        return r;
+                if (r < 3 || isempty(p) ||
+                    safe_atou64(start, &t.start) < 0 ||
+                    safe_atou64(finish, &t.finish) < 0 ||
+                    safe_atoi(status, &t.status) < 0) {
+                        log_debug("Failed to parse generator timing '%s', ignoring.", line);
+                        continue;
+                }
+
+                t.path = strdup(p);
+                if (!t.path)
+                        return -ENOMEM;
+
+                if (!GREEDY_REALLOC(timings, n_timings + 1)) {
+                        free(t.path);
+                        return -ENOMEM;
+                }
+
+                timings[n_timings++] = t;
+
+                log_debug("Generator %s finished after %s with status %i.",
+                          t.path, FORMAT_TIMESPAN(usec_sub_unsigned(t.finish, t.start), USEC_PER_MSEC), t.status);
+        }
+
+        generator_timing_free_many(m->generator_timings, m->n_generator_timings);
+        m->generator_timings = TAKE_PTR(timings);
+        m->n_generator_timings = TAKE_GENERIC(n_timings, size_t, 0);
+
+        return 0;
+}
+
+static int manager_execute_generators(Manager *m, char * const *paths, int timings_fd, bool remount_ro) {
         _cleanup_strv_free_ char **ge = NULL;
         int r;
 
@@ -4091,11 +5065,12 @@ static int manager_execute_generators(Manager *m, char * const *paths, bool remo
         };
 
         BLOCK_WITH_UMASK(0022);
-        return execute_directories(
+        return execute_directories_full(
                         "generators",
                         (const char* const*) paths,
                         DEFAULT_TIMEOUT_USEC,
                         /* callbacks= */ NULL, /* callback_args= */ NULL,
+                        timings_fd,
                         (char**) argv,
                         ge,
                         EXEC_DIR_PARALLEL | EXEC_DIR_IGNORE_ERRORS | EXEC_DIR_SET_SYSTEMD_EXEC_PID | EXEC_DIR_WARN_WORLD_WRITABLE);
@@ -4104,6 +5079,8 @@ static int manager_execute_generators(Manager *m, char * const *paths, bool remo
 static int manager_run_generators(Manager *m) {
         ForkFlags flags = FORK_RESET_SIGNALS | FORK_WAIT | FORK_NEW_MOUNTNS | FORK_MOUNTNS_SLAVE;
         _cleanup_strv_free_ char **paths = NULL;
+        _cleanup_close_ int timings_fd = -EBADF;
+        uint64_t fingerprint = 0;
         int r;
 
         assert(m);
@@ -4118,6 +5095,21 @@ static int manager_run_generators(Manager *m) {
         if (!generator_path_any(paths))
                 return 0;
 
+        m->generator_fingerprint = 0;
+        generator_timing_free_many(m->generator_timings, m->n_generator_timings);
+        m->generator_timings = NULL;
+        m->n_generator_timings = 0;
+
+        if (m->reuse_generator_output) {
+                r = manager_generator_fingerprint(m, paths, &fingerprint);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to fingerprint generators and their inputs, ignoring: %m");
+        }
+
+        timings_fd = open_serialization_fd("generator-timings");
+        if (timings_fd < 0)
+                log_debug_errno(timings_fd, "Failed to open memfd for generator timings, ignoring: %m");
+
         r = lookup_paths_mkdir_generator(&m->lookup_paths);
         if (r < 0) {
                 log_error_errno(r, "Failed to create generator directories: %m");
@@ -4129,7 +5121,7 @@ static int manager_run_generators(Manager *m) {
          * necessary privileges, and the system manager has already mounted /tmp/ and everything else for us.
          */
         if (MANAGER_IS_USER(m)) {
-                r = manager_execute_generators(m, paths, /* remount_ro= */ false);
+                r = manager_execute_generators(m, paths, timings_fd, /* remount_ro= */ false);
                 goto finish;
         }
 
@@ -4140,7 +5132,7 @@ static int manager_run_generators(Manager *m) {
 
         r = pidref_safe_fork("(sd-gens)", flags, /* ret= */ NULL);
         if (r == 0) {
-                r = manager_execute_generators(m, paths, /* remount_ro= */ true);
+                r = manager_execute_generators(m, paths, timings_fd, /* remount_ro= */ true);
                 _exit(r >= 0 ? EXIT_SUCCESS : EXIT_FAILURE);
         }
         if (r < 0) {
@@ -4161,11 +5153,22 @@ static int manager_run_generators(Manager *m) {
                 log_debug_errno(r,
                                 "Failed to fork off sandboxing environment for executing generators. "
                                 "Falling back to execute generators without sandboxing: %m");
-                r = manager_execute_generators(m, paths, /* remount_ro= */ false);
+                r = manager_execute_generators(m, paths, timings_fd, /* remount_ro= */ false);
         }
 
 finish:
         lookup_paths_trim_generator(&m->lookup_paths);
+
+        if (timings_fd >= 0) {
+                int k = manager_read_generator_timings(m, &timings_fd);
+                if (k < 0)
+                        log_debug_errno(k, "Failed to read generator timings, ignoring: %m");
+        }
+
+        /* Only reuse the output if all generators succeeded, a failed one might do better next time */
+        if (r >= 0 && fingerprint != 0 && !generator_timings_have_failure(m))
+                m->generator_fingerprint = fingerprint;
+
         return r;
 }
 
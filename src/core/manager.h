@@ -8,6 +8,7 @@
 #include "execute.h"
 #include "core-forward.h"
 #include "log.h"
+#include "mempool.h"
 #include "path-lookup.h"
 #include "show-status.h"
 #include "unit.h"
@@ -17,6 +18,17 @@ struct libmnt_monitor;
 /* Enforce upper limit how many names we allow */
 #define MANAGER_MAX_NAMES 131072 /* 128K */
 
+/* How much time to spend at most on garbage collecting units per event loop iteration */
+#define MANAGER_GC_BUDGET_USEC (5*USEC_PER_MSEC)
+
+/* Number of buckets of the histogram of garbage collection pauses, see manager_gc_pause_bucket_max() */
+#define MANAGER_GC_PAUSE_BUCKETS 6
+
+/* Chunks of the unit and job pools stop growing at this many tiles, so that a single long-lived object
+ * doesn't keep a huge chunk around */
+#define MANAGER_UNIT_POOL_TILES_MAX 128U
+#define MANAGER_JOB_POOL_TILES_MAX 512U
+
 /* On sigrtmin+18, private commands */
 enum {
         MANAGER_SIGNAL_COMMAND_DUMP_JOBS = _COMMON_SIGNAL_COMMAND_PRIVATE_BASE + 0,
@@ -124,6 +136,20 @@ typedef enum ManagerTestRunFlags {
 
 assert_cc((MANAGER_TEST_FULL & UINT8_MAX) == MANAGER_TEST_FULL);
 
+/* How long one generator took during the last generator run */
+typedef struct GeneratorTiming {
+        char *path;
+        usec_t start;    /* CLOCK_MONOTONIC */
+        usec_t finish;   /* CLOCK_MONOTONIC */
+        int status;      /* exit status, or negative errno if it didn't exit normally */
+} GeneratorTiming;
+
+/* A unit that went away, kept for a while so that io.systemd.Unit.Subscribe() clients can resume */
+typedef struct UnitStateTombstone {
+        char *id;
+        uint64_t seqnum;
+} UnitStateTombstone;
+
 /* Various defaults for unit file settings. */
 typedef struct UnitDefaults {
         ExecOutput std_output, std_error;
@@ -182,6 +208,14 @@ typedef struct Manager {
         LIST_HEAD(Unit, dbus_unit_queue);
         LIST_HEAD(Job, dbus_job_queue);
 
+        /* Units whose change signal was deferred because of PropertiesChangedIntervalSec=, ordered by
+         * when it may be sent. They are still in_dbus_queue, but not in dbus_unit_queue. */
+        Prioq *dbus_unit_deferred_queue;
+
+        /* Units whose state changed since it was last sent to io.systemd.Unit.Subscribe() clients. Only
+         * populated while there are any. */
+        LIST_HEAD(Unit, varlink_unit_state_queue);
+
         /* Units to remove */
         LIST_HEAD(Unit, cleanup_queue);
 
@@ -251,6 +285,7 @@ typedef struct Manager {
         sd_event_source *signal_event_source;
 
         sd_event_source *sigchld_event_source;
+        usec_t sigchld_timestamp; /* When we learnt about the oldest children not reaped yet (CLOCK_MONOTONIC) */
 
         sd_event_source *time_change_event_source;
 
@@ -274,6 +309,8 @@ typedef struct Manager {
         Hashmap *unit_name_map;
         Set *unit_path_cache;
         uint64_t unit_cache_timestamp_hash;
+        /* Contents of the unit directories, survives reloads and is persisted across boots */
+        UnitDirectoryCache *unit_directory_cache;
 
         /* We don't have support for atomically enabling/disabling units, and unit_file_state might become
          * outdated if such operations failed half-way. Therefore, we set this flag if changes to unit files
@@ -291,6 +328,24 @@ typedef struct Manager {
 
         dual_timestamp timestamps[_MANAGER_TIMESTAMP_MAX];
 
+        GeneratorTiming *generator_timings;
+        size_t n_generator_timings;
+
+        /* Hash of the generators and the inputs we know of when they were last run, see
+         * ReuseGeneratorOutput= */
+        uint64_t generator_fingerprint;
+        bool reuse_generator_output;
+
+        /* See CriticalPathScheduling= and critical-path.c */
+        bool critical_path_scheduling;
+        usec_t critical_path_predicted_usec;
+        usec_t critical_path_start_usec;
+
+        /* Units and jobs are allocated from memory pools, one per object size, so that they are packed
+         * densely and the memory can be returned once they are gone again, see manager_trim_pools() */
+        struct mempool unit_pools[_UNIT_TYPE_MAX];
+        struct mempool job_pool;
+
         /* Data specific to the device subsystem */
         sd_device_monitor *device_monitor;
         Hashmap *devices_by_sysfs;
@@ -299,6 +354,16 @@ typedef struct Manager {
         struct libmnt_monitor *mount_monitor;
         sd_event_source *mount_event_source;
 
+        /* If the kernel supports fanotify mount notifications, mounts that appear or disappear are
+         * processed one by one, rather than by rescanning the whole mount table. mount_table maps unique
+         * mount IDs to MountTableEntry objects, mount_table_by_where counts the mounts on each path. */
+        int mount_fanotify_fd;
+        sd_event_source *mount_fanotify_event_source;
+        sd_event_source *mount_rescan_event_source;
+        Hashmap *mount_table;
+        Hashmap *mount_table_by_where;
+        bool mount_table_changes_seen;
+
         /* Data specific to the swap filesystem */
         FILE *proc_swaps;
         sd_event_source *swap_event_source;
@@ -316,6 +381,15 @@ typedef struct Manager {
         sd_bus_track *subscribed;
         char **subscribed_as_strv;
 
+        /* Names of units we announced and freed while reloading. If they come back after the reload, there's
+         * no need to tell the clients that they went away and reappeared. */
+        Set *dbus_units_freed_while_reloading;
+
+        /* Minimum time between two change signals for the same unit, see PropertiesChangedIntervalSec=, and
+         * the timer to wake us up for signals that were deferred because of it */
+        usec_t properties_changed_interval_usec;
+        sd_event_source *dbus_queue_event_source;
+
         /* The bus id of API bus acquired through org.freedesktop.DBus.GetId, which before deserializing
          * subscriptions we'd use to verify the bus is still the same instance as before. */
         sd_id128_t bus_id, deserialized_bus_id;
@@ -410,6 +484,35 @@ typedef struct Manager {
         unsigned n_installed_jobs;
         unsigned n_failed_jobs;
 
+        /* Number of transactions and time spent building and activating them */
+        unsigned n_transactions;
+        usec_t transactions_usec;
+        usec_t transaction_max_usec;
+
+        /* Number of dependency walks (see UNIT_FOREACH_DEPENDENCY()), and the dependencies covered by them */
+        uint64_t n_dependency_walks;
+        uint64_t n_dependency_walk_entries;
+
+        /* Number of cgroup attribute writes done, and skipped since the attribute had that value already */
+        uint64_t n_cgroup_attribute_writes;
+        uint64_t n_cgroup_attribute_writes_elided;
+
+        /* Number of notification messages received, and how many were merged into later ones */
+        uint64_t n_notify_messages;
+        uint64_t n_notify_messages_coalesced;
+
+        /* Number of garbage collection runs and how long they took, and the number of units collected */
+        uint64_t n_gc_runs;
+        uint64_t n_gc_collected_units;
+        usec_t gc_pause_max_usec;
+        uint64_t gc_pause_histogram[MANAGER_GC_PAUSE_BUCKETS];
+        usec_t gc_budget_used_usec; /* in this event loop iteration */
+
+        /* Number of children reaped, and the time from SIGCHLD until their units processed the exit */
+        uint64_t n_reaped_children;
+        usec_t reap_latency_usec;
+        usec_t reap_latency_max_usec;
+
         /* Jobs in progress watching */
         unsigned n_running_jobs;
         unsigned n_on_console;
@@ -469,6 +572,18 @@ typedef struct Manager {
          * systemd-oomd to report changes in ManagedOOM settings (systemd client - oomd server). */
         sd_varlink *managed_oom_varlink;
 
+        /* Clients of io.systemd.Unit.Subscribe(). Every change of a unit's state gets a new sequence number,
+         * which clients can pass back to resume the stream after reconnecting, as long as they resume the
+         * same stream, i.e. there was no reload or reexecution in between, and we still remember all units
+         * that went away since (i.e. the sequence number is not below the horizon). */
+        Set *unit_state_subscribers;
+        sd_id128_t unit_state_stream_id;
+        uint64_t unit_state_seqnum;
+        uint64_t unit_state_horizon;
+        UnitStateTombstone *unit_state_tombstones;
+        size_t n_unit_state_tombstones;
+        char **unit_state_removed; /* Units that went away since the last update was sent */
+
         /* Reference to RestrictFileSystems= BPF program */
         struct restrict_fs_bpf *restrict_fs;
 
@@ -477,6 +592,10 @@ typedef struct Manager {
         /* Dump*() are slow, so always rate limit them to 10 per 10 minutes */
         RateLimit dump_ratelimit;
 
+        /* For how long cgroup accounting data read for one client may be returned to the next one, see
+         * AccountingCacheSec= */
+        usec_t accounting_cache_usec;
+
         sd_event_source *memory_pressure_event_source;
 
         /* For NFTSet= */
@@ -487,6 +606,12 @@ typedef struct Manager {
         char *executor_path;
         int executor_fd;
 
+        /* Idle sd-executor processes waiting for work, see executor-pool.c */
+        PooledExecutor *executor_pool;
+        size_t n_executor_pool;
+        unsigned executor_pool_size;
+        sd_event_source *executor_pool_event_source;
+
         unsigned soft_reboots_count;
 
         /* Original ambient capabilities when we were initialized */
@@ -557,8 +682,11 @@ void manager_clear_jobs(Manager *m);
 void manager_unwatch_pidref(Manager *m, const PidRef *pid);
 
 unsigned manager_dispatch_load_queue(Manager *m);
+unsigned manager_dispatch_gc_unit_queue(Manager *m);
 
 int manager_setup_memory_pressure_event_source(Manager *m);
+void manager_trim_pools(Manager *m);
+size_t manager_pools_allocated(Manager *m, size_t *ret_jobs);
 
 int manager_default_environment(Manager *m);
 int manager_transient_environment_add(Manager *m, char **plus);
@@ -572,6 +700,7 @@ void manager_trigger_run_queue(Manager *m);
 int manager_loop(Manager *m);
 
 int manager_reload(Manager *m);
+int manager_reload_unit_files(Manager *m);
 Manager* manager_reloading_start(Manager *m);
 void manager_reloading_stopp(Manager **m);
 
@@ -632,6 +761,8 @@ DECLARE_STRING_TABLE_LOOKUP(manager_objective, ManagerObjective);
 DECLARE_STRING_TABLE_LOOKUP(manager_timestamp, ManagerTimestamp);
 ManagerTimestamp manager_timestamp_initrd_mangle(ManagerTimestamp s);
 
+usec_t manager_gc_pause_bucket_max(size_t i);
+
 usec_t manager_get_watchdog(Manager *m, WatchdogType t);
 void manager_set_watchdog(Manager *m, WatchdogType t, usec_t timeout);
 void manager_override_watchdog(Manager *m, WatchdogType t, usec_t timeout);
@@ -666,5 +797,6 @@ enum {
         EVENT_PRIORITY_IPC               = SD_EVENT_PRIORITY_NORMAL,
         EVENT_PRIORITY_SERVICE_WATCHDOG  = SD_EVENT_PRIORITY_IDLE,
         EVENT_PRIORITY_RUN_QUEUE         = SD_EVENT_PRIORITY_IDLE+1,
+        EVENT_PRIORITY_EXECUTOR_POOL     = SD_EVENT_PRIORITY_IDLE+2,
         /* … to least important */
 };
@@ -3,6 +3,8 @@
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/fanotify.h>
+#include <sys/mount.h>
 #include <sys/socket.h>
 
 #include "sd-messages.h"
@@ -13,6 +15,7 @@
 #include "dbus-unit.h"
 #include "device.h"
 #include "errno-util.h"
+#include "event-util.h"
 #include "exec-credential.h"
 #include "exit-status.h"
 #include "fd-util.h"
@@ -1736,9 +1739,14 @@ static int update_parameters_proc_self_mountinfo(
         if (r < 0)
                 return r;
 
-        q = free_and_strdup(&p->options, options);
+        /* The options are reported by libmount on a full scan and by statmount() for mount notifications,
+         * which might order them differently. Don't consider that a change. */
+        q = mount_options_equal(p->options, options);
         if (q < 0)
                 return q;
+        if (free_and_strdup(&p->options, options) < 0)
+                return -ENOMEM;
+        q = !q;
 
         w = free_and_strdup(&p->fstype, fstype);
         if (w < 0)
@@ -1872,7 +1880,8 @@ static int mount_setup_unit(
                 const char *where,
                 const char *options,
                 const char *fstype,
-                bool set_flags) {
+                bool set_flags,
+                Unit **ret_unit) {
 
         _cleanup_free_ char *e = NULL;
         MountProcFlags flags;
@@ -1885,6 +1894,9 @@ static int mount_setup_unit(
         assert(options);
         assert(fstype);
 
+        if (ret_unit)
+                *ret_unit = NULL;
+
         /* Ignore API and credential mount points. They should never be referenced in dependencies ever.
          * Furthermore, the lifetime of credential mounts is strictly bound to the owning services,
          * so mount units make little sense for them. */
@@ -1925,6 +1937,9 @@ static int mount_setup_unit(
         if (set_flags)
                 MOUNT(u)->proc_flags = flags;
 
+        if (ret_unit)
+                *ret_unit = u;
+
         return 0;
 }
 
@@ -1964,16 +1979,359 @@ static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
                 if (set_put_strdup_full(&devices, &path_hash_ops_free, device) != 0)
                         device_found_node(m, device, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
 
-                (void) mount_setup_unit(m, device, path, options, fstype, set_flags);
+                (void) mount_setup_unit(m, device, path, options, fstype, set_flags, /* ret_unit= */ NULL);
         }
 
         return 0;
 }
+
+typedef struct MountTableEntry {
+        uint64_t id;
+        char *what;
+        char *where;
+} MountTableEntry;
+
+static MountTableEntry* mount_table_entry_free(MountTableEntry *e) {
+        if (!e)
+                return NULL;
+
+        free(e->what);
+        free(e->where);
+        return mfree(e);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(MountTableEntry*, mount_table_entry_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                mount_table_entry_hash_ops,
+                uint64_t, uint64_hash_func, uint64_compare_func,
+                MountTableEntry, mount_table_entry_free);
+
+typedef struct MountTableChange {
+        uint64_t id;
+        bool attach;
+} MountTableChange;
+
+static int mount_table_ref_where(Manager *m, const char *where) {
+        unsigned n;
+        int r;
+
+        assert(m);
+        assert(where);
+
+        /* Returns > 0 if something else was already mounted on this path */
+
+        n = PTR_TO_UINT(hashmap_get(m->mount_table_by_where, where));
+        if (n > 0) {
+                r = hashmap_update(m->mount_table_by_where, where, UINT_TO_PTR(n + 1));
+                if (r < 0)
+                        return r;
+
+                return 1;
+        }
+
+        _cleanup_free_ char *k = strdup(where);
+        if (!k)
+                return -ENOMEM;
+
+        r = hashmap_ensure_put(&m->mount_table_by_where, &path_hash_ops_free, k, UINT_TO_PTR(1));
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(k);
+        return 0;
+}
+
+static unsigned mount_table_unref_where(Manager *m, const char *where) {
+        unsigned n;
+
+        assert(m);
+        assert(where);
+
+        /* Returns the number of mounts that remain on this path */
+
+        n = PTR_TO_UINT(hashmap_get(m->mount_table_by_where, where));
+        if (n <= 1) {
+                void *k = NULL;
+
+                (void) hashmap_remove2(m->mount_table_by_where, where, &k);
+                free(k);
+                return 0;
+        }
+
+        assert_se(hashmap_update(m->mount_table_by_where, where, UINT_TO_PTR(n - 1)) >= 0);
+        return n - 1;
+}
+
+static void mount_table_remove(Manager *m, uint64_t id) {
+        MountTableEntry *e;
+
+        assert(m);
+
+        e = hashmap_remove(m->mount_table, &id);
+        if (!e)
+                return;
+
+        (void) mount_table_unref_where(m, e->where);
+        mount_table_entry_free(e);
+}
+
+static int mount_table_attach(Manager *m, uint64_t id, bool setup_unit, Set **affected) {
+        _cleanup_(mount_table_entry_freep) MountTableEntry *e = NULL;
+        _cleanup_free_ struct statmount *sm = NULL;
+        _cleanup_free_ char *options = NULL, *fstype = NULL;
+        Unit *u;
+        int r, n;
+
+        assert(m);
+
+        /* Records a mount that just appeared in the mount table index, and if requested sets up its mount
+         * unit. Returns 0 if the mount table needs to be rescanned as a whole to process the change, > 0
+         * otherwise. */
+
+        r = statmount_alloc(id,
+                            STATMOUNT_SB_BASIC|STATMOUNT_MNT_BASIC|STATMOUNT_MNT_POINT|STATMOUNT_FS_TYPE|
+                            STATMOUNT_FS_SUBTYPE|STATMOUNT_SB_SOURCE|STATMOUNT_MNT_OPTS,
+                            &sm);
+        if (r == -ENOENT) /* Already gone again, a detach event will follow */
+                return 1;
+        if (r < 0)
+                return log_debug_errno(r, "Failed to query mount %" PRIu64 ": %m", id);
+
+        e = new0(MountTableEntry, 1);
+        if (!e)
+                return log_oom_debug();
+
+        e->id = id;
+
+        r = statmount_to_mountinfo(sm, &e->what, &e->where, &options, &fstype);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to convert statmount() data of mount %" PRIu64 ": %m", id);
+
+        /* We might already know it, if the notification raced against listmount() */
+        mount_table_remove(m, id);
+
+        n = mount_table_ref_where(m, e->where);
+        if (n < 0)
+                return log_oom_debug();
+
+        r = hashmap_ensure_put(&m->mount_table, &mount_table_entry_hash_ops, &e->id, e);
+        if (r < 0) {
+                (void) mount_table_unref_where(m, e->where);
+                return log_oom_debug();
+        }
+
+        MountTableEntry *added = TAKE_PTR(e);
+
+        if (!setup_unit)
+                return 1;
+
+        /* Something got mounted on top of an existing mount. Which of the two libmount would report for the
+         * mount point is not obvious, let the full scan sort it out. */
+        if (n > 0)
+                return 0;
+
+        device_found_node(m, added->what, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
+
+        r = mount_setup_unit(m, added->what, added->where, options, fstype, /* set_flags= */ true, &u);
+        if (r < 0 || !u)
+                return 1;
+
+        if (set_ensure_put(affected, NULL, u) < 0)
+                return log_oom_debug();
+
+        return 1;
+}
+
+static int mount_table_detach(Manager *m, uint64_t id, bool setup_unit, Set **affected) {
+        _cleanup_(mount_table_entry_freep) MountTableEntry *e = NULL;
+        _cleanup_free_ char *name = NULL;
+        Unit *u;
+
+        assert(m);
+
+        /* Drops a mount that just disappeared from the mount table index, and if requested marks its mount
+         * unit as unmounted. Returns 0 if the mount table needs to be rescanned as a whole to process the
+         * change, > 0 otherwise. */
+
+        e = hashmap_remove(m->mount_table, &id);
+        if (!e) /* Not a mount we know, hence nothing to do */
+                return 1;
+
+        if (mount_table_unref_where(m, e->where) > 0 && setup_unit)
+                /* There's still something else mounted on the path, let the full scan figure out what */
+                return 0;
+
+        if (!setup_unit)
+                return 1;
+
+        if (unit_name_from_path(e->where, ".mount", &name) < 0)
+                return 1;
+
+        u = manager_get_unit(m, name);
+        if (!u)
+                return 1;
+
+        MOUNT(u)->proc_flags = 0;
+
+        if (set_ensure_put(affected, NULL, u) < 0)
+                return log_oom_debug();
+
+        return 1;
+}
+
+static int mount_fanotify_read(Manager *m, MountTableChange **changes, size_t *n_changes) {
+        int r = 0;
+
+        assert(m);
+        assert(m->mount_fanotify_fd >= 0);
+        assert(changes);
+        assert(n_changes);
+
+        /* Reads all queued mount notifications and appends them to the array. Returns -ENOBUFS if the
+         * kernel's event queue overflowed, in which case notifications got lost. */
+
+        for (;;) {
+                _alignas_(struct fanotify_event_metadata) uint8_t buffer[4096];
+                ssize_t l;
+
+                l = read(m->mount_fanotify_fd, buffer, sizeof(buffer));
+                if (l < 0) {
+                        if (ERRNO_IS_TRANSIENT(errno))
+                                return r;
+
+                        return -errno;
+                }
+                if (l == 0)
+                        return r;
+
+                size_t left = l;
+                for (struct fanotify_event_metadata *meta = (struct fanotify_event_metadata*) buffer;
+                     FAN_EVENT_OK(meta, left);
+                     meta = FAN_EVENT_NEXT(meta, left)) {
+
+                        if (meta->vers != FANOTIFY_METADATA_VERSION)
+                                return -EPROTO;
+
+                        if (FLAGS_SET(meta->mask, FAN_Q_OVERFLOW))
+                                return -ENOBUFS;
+
+                        if (!(meta->mask & (FAN_MNT_ATTACH|FAN_MNT_DETACH)))
+                                continue;
+
+                        uint8_t *p = (uint8_t*) meta + meta->metadata_len, *end = (uint8_t*) meta + meta->event_len;
+                        while (p + sizeof(struct fanotify_event_info_header) <= end) {
+                                struct fanotify_event_info_header hdr;
+                                uint64_t id;
+
+                                memcpy(&hdr, p, sizeof(hdr));
+                                if (hdr.len < sizeof(hdr) || p + hdr.len > end)
+                                        return -EBADMSG;
+
+                                if (hdr.info_type == FAN_EVENT_INFO_TYPE_MNT && hdr.len >= sizeof(hdr) + sizeof(id)) {
+                                        memcpy(&id, p + sizeof(hdr), sizeof(id));
+
+                                        if (!GREEDY_REALLOC(*changes, *n_changes + 2))
+                                                return -ENOMEM;
+
+                                        /* A move reports both bits, handle it as detach followed by attach */
+                                        if (FLAGS_SET(meta->mask, FAN_MNT_DETACH))
+                                                (*changes)[(*n_changes)++] = (MountTableChange) { .id = id, .attach = false };
+                                        if (FLAGS_SET(meta->mask, FAN_MNT_ATTACH))
+                                                (*changes)[(*n_changes)++] = (MountTableChange) { .id = id, .attach = true };
+
+                                        r = 1;
+                                }
+
+                                p += hdr.len;
+                        }
+                }
+        }
+}
+
+static void mount_fanotify_shutdown(Manager *m) {
+        assert(m);
+
+        m->mount_fanotify_event_source = sd_event_source_disable_unref(m->mount_fanotify_event_source);
+        m->mount_fanotify_fd = safe_close(m->mount_fanotify_fd);
+        m->mount_rescan_event_source = sd_event_source_disable_unref(m->mount_rescan_event_source);
+        m->mount_table = hashmap_free(m->mount_table);
+        m->mount_table_by_where = hashmap_free(m->mount_table_by_where);
+        m->mount_table_changes_seen = false;
+}
+
+static int mount_dispatch_fanotify_io(sd_event_source *source, int fd, uint32_t revents, void *userdata);
+
+static int mount_setup_fanotify(Manager *m) {
+        _cleanup_close_ int fd = -EBADF, ns_fd = -EBADF;
+        _cleanup_free_ uint64_t *ids = NULL;
+        size_t n_ids = 0;
+        int r;
+
+        assert(m);
+        assert(m->mount_fanotify_fd < 0);
+
+        /* Mount notifications let us process mounts appearing and disappearing individually, instead of
+         * rereading the whole mount table each time anything changes. They need kernel v6.15 and
+         * CAP_SYS_ADMIN over our mount namespace, hence this is optional. */
+
+        fd = fanotify_init(FAN_REPORT_MNT|FAN_CLOEXEC|FAN_NONBLOCK, 0);
+        if (fd < 0)
+                return log_debug_errno(errno, "Mount notifications not available, will rescan the mount table on changes: %m");
+
+        ns_fd = open("/proc/self/ns/mnt", O_RDONLY|O_CLOEXEC);
+        if (ns_fd < 0)
+                return log_debug_errno(errno, "Failed to open our mount namespace: %m");
+
+        if (fanotify_mark(fd, FAN_MARK_ADD|FAN_MARK_MNTNS, FAN_MNT_ATTACH|FAN_MNT_DETACH, ns_fd, NULL) < 0)
+                return log_debug_errno(errno, "Failed to watch mount namespace for mount notifications, will rescan the mount table on changes: %m");
+
+        m->mount_fanotify_fd = TAKE_FD(fd);
+
+        /* Build the index only after the mark is in place, so that nothing that changes in between can be
+         * missed. Duplicates are handled gracefully by mount_table_attach(). */
+        r = listmount_all(&ids, &n_ids);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to enumerate mounts: %m");
+                goto fail;
+        }
+
+        FOREACH_ARRAY(id, ids, n_ids) {
+                r = mount_table_attach(m, *id, /* setup_unit= */ false, /* affected= */ NULL);
+                if (r < 0)
+                        goto fail;
+        }
+
+        r = sd_event_add_io(m->event, &m->mount_fanotify_event_source, m->mount_fanotify_fd, EPOLLIN, mount_dispatch_fanotify_io, m);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to watch mount notification file descriptor: %m");
+                goto fail;
+        }
+
+        r = sd_event_source_set_priority(m->mount_fanotify_event_source, EVENT_PRIORITY_MOUNT_TABLE);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to adjust mount notification priority: %m");
+                goto fail;
+        }
+
+        (void) sd_event_source_set_description(m->mount_fanotify_event_source, "mount-fanotify-dispatch");
+
+        log_debug("Tracking %zu mounts via mount notifications.", n_ids);
+        return 0;
+
+fail:
+        mount_fanotify_shutdown(m);
+        return r;
+}
 #endif
 
 static void mount_shutdown(Manager *m) {
         assert(m);
 
+#if HAVE_LIBMOUNT
+        mount_fanotify_shutdown(m);
+#endif
+
         m->mount_event_source = sd_event_source_disable_unref(m->mount_event_source);
 
         if (m->mount_monitor) {
@@ -2149,6 +2507,9 @@ static void mount_enumerate(Manager *m) {
                 (void) sd_event_source_set_description(m->mount_event_source, "mount-monitor-dispatch");
         }
 
+        if (m->mount_fanotify_fd < 0)
+                (void) mount_setup_fanotify(m);
+
         r = mount_load_proc_self_mountinfo(m, false);
         if (r < 0)
                 goto fail;
@@ -2160,8 +2521,11 @@ fail:
         mount_shutdown(m);
 }
 
-static int drain_libmount(Manager *m) {
+static int drain_libmount(Manager *m, bool *ret_userspace) {
         assert(m);
+        assert(ret_userspace);
+
+        *ret_userspace = false;
 
         if (!m->mount_monitor)
                 return false;
@@ -2177,11 +2541,18 @@ static int drain_libmount(Manager *m) {
          *
          * error: r < 0; valid: r == 0, false positive: r == 1 */
         do {
-                r = sym_mnt_monitor_next_change(m->mount_monitor, NULL, NULL);
+                int type = 0;
+
+                r = sym_mnt_monitor_next_change(m->mount_monitor, NULL, &type);
                 if (r < 0)
                         return log_error_errno(r, "Failed to drain libmount events: %m");
-                if (r == 0)
+                if (r == 0) {
                         rescan = true;
+
+                        /* utab carries the userspace mount options, which statmount() doesn't know */
+                        if (type == MNT_MONITOR_TYPE_USERSPACE)
+                                *ret_userspace = true;
+                }
         } while (r == 0);
 
         return rescan;
@@ -2191,16 +2562,112 @@ static int drain_libmount(Manager *m) {
 #endif
 }
 
-static int mount_process_proc_self_mountinfo(Manager *m) {
+#if HAVE_LIBMOUNT
+static void mount_process_proc_flags(Mount *mount, Set **gone, Set **around) {
+        assert(mount);
+        assert(gone);
+        assert(around);
+
+        if (!mount_is_mounted(mount)) {
+
+                /* A mount point is not around right now. It might be gone, or might never have
+                 * existed. */
+
+                if (mount->from_proc_self_mountinfo &&
+                    mount->parameters_proc_self_mountinfo.what)
+                        /* Remember that this device might just have disappeared */
+                        if (set_put_strdup_full(gone, &path_hash_ops_free, mount->parameters_proc_self_mountinfo.what) < 0)
+                                log_oom(); /* we don't care too much about OOM here... */
+
+                mount->from_proc_self_mountinfo = false;
+                assert_se(update_parameters_proc_self_mountinfo(mount, NULL, NULL, NULL) >= 0);
+
+                switch (mount->state) {
+
+                case MOUNT_MOUNTED:
+                        /* This has just been unmounted by somebody else, follow the state change.
+                         * Also explicitly override the result (see the comment in mount_sigchld_event()),
+                         * but more aggressively here since the state change is extrinsic. */
+                        mount_cycle_clear(mount);
+                        mount_enter_dead(mount, MOUNT_SUCCESS, /* flush_result= */ true);
+                        break;
+
+                case MOUNT_MOUNTING_DONE:
+                        /* The mount command may add the corresponding proc mountinfo entry and
+                         * then remove it because of an internal error. E.g., fuse.sshfs seems
+                         * to do that when the connection fails. See #17617. To handle such the
+                         * case, let's once set the state back to mounting. Then, the unit can
+                         * correctly enter the failed state later in mount_sigchld_event(). */
+                        mount_set_state(mount, MOUNT_MOUNTING);
+                        break;
+
+                default:
+                        ;
+                }
+
+        } else if (mount->proc_flags & (MOUNT_PROC_JUST_MOUNTED|MOUNT_PROC_JUST_CHANGED)) {
+
+                /* A mount point was added or changed */
+
+                switch (mount->state) {
+
+                case MOUNT_DEAD:
+                case MOUNT_FAILED:
+
+                        /* This has just been mounted by somebody else, follow the state change, but let's
+                         * generate a new invocation ID for this implicitly and automatically. */
+                        (void) unit_acquire_invocation_id(UNIT(mount));
+                        mount_cycle_clear(mount);
+                        mount_enter_mounted(mount, MOUNT_SUCCESS);
+                        break;
+
+                case MOUNT_MOUNTING:
+                        mount_set_state(mount, MOUNT_MOUNTING_DONE);
+                        break;
+
+                default:
+                        /* Nothing really changed, but let's issue an notification call nonetheless,
+                         * in case somebody is waiting for this. (e.g. file system ro/rw
+                         * remounts.) */
+                        mount_set_state(mount, mount->state);
+                }
+        }
+
+        if (mount_is_mounted(mount) &&
+            mount->from_proc_self_mountinfo &&
+            mount->parameters_proc_self_mountinfo.what)
+                /* Track devices currently used */
+                if (set_put_strdup_full(around, &path_hash_ops_free, mount->parameters_proc_self_mountinfo.what) < 0)
+                        log_oom();
+
+
+        /* Reset the flags for later calls */
+        mount->proc_flags = 0;
+}
+
+static void mount_forget_devices(Manager *m, Set *gone, Set *around) {
+        const char *what;
+
+        assert(m);
+
+        SET_FOREACH(what, gone) {
+                if (set_contains(around, what))
+                        continue;
+
+                /* Let the device units know that the device is no longer mounted */
+                device_found_node(m, what, DEVICE_NOT_FOUND, DEVICE_FOUND_MOUNT);
+        }
+}
+
+static int mount_rescan_proc_self_mountinfo(Manager *m) {
         int r;
 
         assert(m);
 
-        r = drain_libmount(m);
-        if (r <= 0)
-                return r;
+        /* We look at everything now, hence no need for a pending reconciliation anymore */
+        (void) sd_event_source_set_enabled(m->mount_rescan_event_source, SD_EVENT_OFF);
+        m->mount_table_changes_seen = false;
 
-#if HAVE_LIBMOUNT
         r = mount_load_proc_self_mountinfo(m, true);
         if (r < 0) {
                 /* Reset flags, just in case, for later calls */
@@ -2214,96 +2681,156 @@ static int mount_process_proc_self_mountinfo(Manager *m) {
 
         _cleanup_set_free_ Set *around = NULL, *gone = NULL;
 
-        LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT]) {
-                Mount *mount = MOUNT(u);
+        LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT])
+                mount_process_proc_flags(MOUNT(u), &gone, &around);
 
-                if (!mount_is_mounted(mount)) {
-
-                        /* A mount point is not around right now. It might be gone, or might never have
-                         * existed. */
+        mount_forget_devices(m, gone, around);
+        return 0;
+}
 
-                        if (mount->from_proc_self_mountinfo &&
-                            mount->parameters_proc_self_mountinfo.what)
-                                /* Remember that this device might just have disappeared */
-                                if (set_put_strdup_full(&gone, &path_hash_ops_free, mount->parameters_proc_self_mountinfo.what) < 0)
-                                        log_oom(); /* we don't care too much about OOM here... */
+static void mount_table_apply_changes(Manager *m, const MountTableChange *changes, size_t n_changes) {
+        assert(m);
+        assert(changes || n_changes == 0);
 
-                        mount->from_proc_self_mountinfo = false;
-                        assert_se(update_parameters_proc_self_mountinfo(mount, NULL, NULL, NULL) >= 0);
+        /* Only updates the index, for when the units are taken care of by a full scan */
 
-                        switch (mount->state) {
+        FOREACH_ARRAY(c, changes, n_changes)
+                if (c->attach)
+                        (void) mount_table_attach(m, c->id, /* setup_unit= */ false, /* affected= */ NULL);
+                else
+                        (void) mount_table_detach(m, c->id, /* setup_unit= */ false, /* affected= */ NULL);
+}
 
-                        case MOUNT_MOUNTED:
-                                /* This has just been unmounted by somebody else, follow the state change.
-                                 * Also explicitly override the result (see the comment in mount_sigchld_event()),
-                                 * but more aggressively here since the state change is extrinsic. */
-                                mount_cycle_clear(mount);
-                                mount_enter_dead(mount, MOUNT_SUCCESS, /* flush_result= */ true);
-                                break;
+static int mount_process_table_changes(Manager *m, const MountTableChange *changes, size_t n_changes) {
+        _cleanup_set_free_ Set *affected = NULL, *around = NULL, *gone = NULL;
+        bool complete = true;
+        Unit *u;
+        int r;
 
-                        case MOUNT_MOUNTING_DONE:
-                                /* The mount command may add the corresponding proc mountinfo entry and
-                                 * then remove it because of an internal error. E.g., fuse.sshfs seems
-                                 * to do that when the connection fails. See #17617. To handle such the
-                                 * case, let's once set the state back to mounting. Then, the unit can
-                                 * correctly enter the failed state later in mount_sigchld_event(). */
-                                mount_set_state(mount, MOUNT_MOUNTING);
-                                break;
+        assert(m);
+        assert(changes || n_changes == 0);
 
-                        default:
-                                ;
-                        }
+        /* Processes mounts that appeared or disappeared one by one. Returns 0 if that's not possible and
+         * the mount table needs to be rescanned as a whole instead, > 0 on success. */
 
-                } else if (mount->proc_flags & (MOUNT_PROC_JUST_MOUNTED|MOUNT_PROC_JUST_CHANGED)) {
+        for (size_t i = 0; i < n_changes; i++) {
+                if (changes[i].attach)
+                        r = mount_table_attach(m, changes[i].id, /* setup_unit= */ true, &affected);
+                else
+                        r = mount_table_detach(m, changes[i].id, /* setup_unit= */ true, &affected);
+                if (r > 0)
+                        continue;
 
-                        /* A mount point was added or changed */
+                /* Give up, but keep the index up-to-date. The units we set up so far are still processed
+                 * below: they are already updated from the mount table, hence the full scan would only find
+                 * them mounted, but not just mounted or changed, and they'd never change state. */
+                mount_table_apply_changes(m, changes + i + 1, n_changes - i - 1);
+                complete = false;
+                break;
+        }
 
-                        switch (mount->state) {
+        if (set_isempty(affected))
+                return complete;
 
-                        case MOUNT_DEAD:
-                        case MOUNT_FAILED:
+        manager_dispatch_load_queue(m);
 
-                                /* This has just been mounted by somebody else, follow the state change, but let's
-                                 * generate a new invocation ID for this implicitly and automatically. */
-                                (void) unit_acquire_invocation_id(u);
-                                mount_cycle_clear(mount);
-                                mount_enter_mounted(mount, MOUNT_SUCCESS);
-                                break;
+        SET_FOREACH(u, affected)
+                mount_process_proc_flags(MOUNT(u), &gone, &around);
 
-                        case MOUNT_MOUNTING:
-                                mount_set_state(mount, MOUNT_MOUNTING_DONE);
-                                break;
+        if (!set_isempty(gone))
+                /* The devices might still be mounted elsewhere, hence look at all other mounts too */
+                LIST_FOREACH(units_by_type, other, m->units_by_type[UNIT_MOUNT]) {
+                        Mount *mount = MOUNT(other);
 
-                        default:
-                                /* Nothing really changed, but let's issue an notification call nonetheless,
-                                 * in case somebody is waiting for this. (e.g. file system ro/rw
-                                 * remounts.) */
-                                mount_set_state(mount, mount->state);
-                        }
+                        if (mount_is_mounted(mount) &&
+                            mount->from_proc_self_mountinfo &&
+                            mount->parameters_proc_self_mountinfo.what &&
+                            set_put_strdup_full(&around, &path_hash_ops_free, mount->parameters_proc_self_mountinfo.what) < 0)
+                                log_oom();
                 }
 
-                if (mount_is_mounted(mount) &&
-                    mount->from_proc_self_mountinfo &&
-                    mount->parameters_proc_self_mountinfo.what)
-                        /* Track devices currently used */
-                        if (set_put_strdup_full(&around, &path_hash_ops_free, mount->parameters_proc_self_mountinfo.what) < 0)
-                                log_oom();
+        mount_forget_devices(m, gone, around);
 
-                /* Reset the flags for later calls */
-                mount->proc_flags = 0;
-        }
+        if (!complete)
+                return 0;
 
-        const char *what;
-        SET_FOREACH(what, gone) {
-                if (set_contains(around, what))
-                        continue;
+        log_debug("Processed %zu mount table changes without rescanning.", n_changes);
+        return 1;
+}
 
-                /* Let the device units know that the device is no longer mounted */
-                device_found_node(m, what, DEVICE_NOT_FOUND, DEVICE_FOUND_MOUNT);
+static int mount_dispatch_rescan(sd_event_source *source, usec_t usec, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        log_debug("Reconciling mount units with the mount table.");
+        return mount_rescan_proc_self_mountinfo(m);
+}
+#endif
+
+static int mount_process_proc_self_mountinfo(Manager *m) {
+        bool userspace;
+        int r;
+
+        assert(m);
+
+#if HAVE_LIBMOUNT
+        _cleanup_free_ MountTableChange *changes = NULL;
+        size_t n_changes = 0;
+        bool rescan = false;
+
+        if (m->mount_fanotify_fd >= 0) {
+                r = mount_fanotify_read(m, &changes, &n_changes);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to read mount notifications, falling back to rescanning the mount table on changes: %m");
+                        mount_fanotify_shutdown(m);
+                        changes = mfree(changes);
+                        n_changes = 0;
+                        rescan = true;
+                }
         }
+#endif
 
-        return 0;
+        r = drain_libmount(m, &userspace);
+        if (r < 0)
+                return r;
+
+#if HAVE_LIBMOUNT
+        if (m->mount_fanotify_fd < 0)
+                return r > 0 || rescan ? mount_rescan_proc_self_mountinfo(m) : 0;
+
+        if (userspace)
+                rescan = true;
+        else if (r > 0 && n_changes == 0 && !m->mount_table_changes_seen)
+                /* The mount table changed, but no mount appeared or disappeared, i.e. something got
+                 * remounted or changed propagation. There are no notifications for that. */
+                rescan = true;
+        else if (r > 0) {
+                /* Most likely the change was what the notifications told us about, but something might have
+                 * been remounted at the same time. Reconcile in a bit, but don't push that out further with
+                 * each change. */
+                m->mount_table_changes_seen = false;
+
+                if (event_reset_time_relative(
+                                m->event, &m->mount_rescan_event_source,
+                                CLOCK_MONOTONIC, 5 * USEC_PER_SEC, 0,
+                                mount_dispatch_rescan, m,
+                                EVENT_PRIORITY_MOUNT_TABLE, "mount-rescan",
+                                /* force_reset= */ false) < 0)
+                        rescan = true;
+        } else if (n_changes > 0)
+                /* The libmount monitor will fire for this too, remember that we already know what it's about */
+                m->mount_table_changes_seen = true;
+
+        if (!rescan && mount_process_table_changes(m, changes, n_changes) > 0)
+                return 0;
+
+        if (rescan)
+                mount_table_apply_changes(m, changes, n_changes);
+
+        return mount_rescan_proc_self_mountinfo(m);
 #else
+        if (r == 0)
+                return 0;
+
         assert_not_reached();
 #endif
 }
@@ -2316,6 +2843,14 @@ static int mount_dispatch_io(sd_event_source *source, int fd, uint32_t revents,
 
         return mount_process_proc_self_mountinfo(m);
 }
+
+static int mount_dispatch_fanotify_io(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+        Manager *m = ASSERT_PTR(userdata);
+
+        assert(revents & EPOLLIN);
+
+        return mount_process_proc_self_mountinfo(m);
+}
 #endif
 
 static void mount_reset_failed(Unit *u) {
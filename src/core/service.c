@@ -577,7 +577,7 @@ static int on_fd_store_io(sd_event_source *e, int fd, uint32_t revents, void *us
         return 0;
 }
 
-static int service_add_fd_store(Service *s, int fd_in, const char *name, bool do_poll) {
+static int service_add_fd_store(Service *s, int fd_in, const char *name, bool do_poll, bool check_duplicate) {
         _cleanup_(service_fd_store_unlinkp) ServiceFDStore *fs = NULL;
         _cleanup_(asynchronous_closep) int fd = ASSERT_FD(fd_in);
         struct stat st;
@@ -598,15 +598,18 @@ static int service_add_fd_store(Service *s, int fd_in, const char *name, bool do
                  * where systemd itself hits the file limit. */
                 return log_unit_debug_errno(UNIT(s), SYNTHETIC_ERRNO(EXFULL), "Hit fd store limit.");
 
-        LIST_FOREACH(fd_store, i, s->fd_store) {
-                r = same_fd(i->fd, fd);
-                if (r < 0)
-                        return r;
-                if (r > 0) {
-                        log_unit_debug(UNIT(s), "Suppressing duplicate fd %i in fd store.", fd);
-                        return 0; /* fd already included */
+        /* This is quadratic, and each comparison might need a syscall. Hence, skip it when restoring the
+         * store from our own serialization, which we know has no duplicates. */
+        if (check_duplicate)
+                LIST_FOREACH(fd_store, i, s->fd_store) {
+                        r = same_fd(i->fd, fd);
+                        if (r < 0)
+                                return r;
+                        if (r > 0) {
+                                log_unit_debug(UNIT(s), "Suppressing duplicate fd %i in fd store.", fd);
+                                return 0; /* fd already included */
+                        }
                 }
-        }
 
         fs = new(ServiceFDStore, 1);
         if (!fs)
@@ -650,7 +653,7 @@ static int service_add_fd_store_set(Service *s, FDSet *fds, const char *name, bo
                 if (fd < 0)
                         break;
 
-                r = service_add_fd_store(s, fd, name, do_poll);
+                r = service_add_fd_store(s, fd, name, do_poll, /* check_duplicate= */ true);
                 if (r == -EXFULL)
                         return log_unit_warning_errno(UNIT(s), r,
                                                       "Cannot store more fds than FileDescriptorStoreMax=%u, closing remaining.",
@@ -3611,7 +3614,7 @@ static int service_deserialize_item(Unit *u, const char *key, const char *value,
                         return 0;
                 }
 
-                r = service_add_fd_store(s, TAKE_FD(fd), fdn, do_poll);
+                r = service_add_fd_store(s, TAKE_FD(fd), fdn, do_poll, /* check_duplicate= */ false);
                 if (r < 0) {
                         log_unit_debug_errno(u, r,
                                              "Failed to store deserialized fd '%s', ignoring: %m", fdn);
@@ -52,28 +52,46 @@ static void transaction_abort(Transaction *tr) {
         assert(hashmap_isempty(tr->jobs));
 }
 
-static void transaction_find_jobs_that_matter_to_anchor(Job *j, unsigned generation) {
-        assert(j);
+static int transaction_find_jobs_that_matter_to_anchor(Job *anchor, unsigned generation) {
+        _cleanup_free_ Job **stack = NULL;
+        size_t n_stack = 0;
 
-        /* A recursive sweep through the graph that marks all units that matter to the anchor job, i.e. are
-         * directly or indirectly a dependency of the anchor job via paths that are fully marked as
-         * mattering. */
+        assert(anchor);
 
-        j->matters_to_anchor = true;
-        j->generation = generation;
+        /* A sweep through the graph that marks all units that matter to the anchor job, i.e. are directly or
+         * indirectly a dependency of the anchor job via paths that are fully marked as mattering. This
+         * uses an explicit stack rather than recursion, as the graph might be very deep. */
 
-        LIST_FOREACH(subject, l, j->subject_list) {
+        if (!GREEDY_REALLOC(stack, 1))
+                return -ENOMEM;
 
-                /* This link does not matter. */
-                if (!l->matters)
-                        continue;
+        anchor->matters_to_anchor = true;
+        anchor->generation = generation;
+        stack[n_stack++] = anchor;
 
-                /* This unit has already been marked. */
-                if (l->object->generation == generation)
-                        continue;
+        while (n_stack > 0) {
+                Job *j = stack[--n_stack];
+
+                LIST_FOREACH(subject, l, j->subject_list) {
+
+                        /* This link does not matter. */
+                        if (!l->matters)
+                                continue;
+
+                        /* This unit has already been marked. */
+                        if (l->object->generation == generation)
+                                continue;
 
-                transaction_find_jobs_that_matter_to_anchor(l->object, generation);
+                        if (!GREEDY_REALLOC(stack, n_stack + 1))
+                                return -ENOMEM;
+
+                        l->object->matters_to_anchor = true;
+                        l->object->generation = generation;
+                        stack[n_stack++] = l->object;
+                }
         }
+
+        return 0;
 }
 
 static void transaction_merge_and_delete_job(Transaction *tr, Job *j, Job *other, JobType t) {
@@ -290,38 +308,40 @@ static int transaction_merge_jobs(Transaction *tr, sd_bus_error *e) {
 }
 
 static void transaction_drop_redundant(Transaction *tr) {
-        bool again;
+        Job *j;
 
         /* Goes through the transaction and removes all jobs of the units whose jobs are all noops. If not
-         * all of a unit's jobs are redundant, they are kept. */
+         * all of a unit's jobs are redundant, they are kept.
+         *
+         * Whether a job is redundant only depends on the unit and its installed job, and we don't delete
+         * dependent jobs here, hence dropping one unit's jobs never changes the verdict for another unit,
+         * and a single pass is enough. */
 
         assert(tr);
 
-        do {
-                Job *j;
-
-                again = false;
-
-                HASHMAP_FOREACH(j, tr->jobs) {
-                        bool keep = false;
-
-                        LIST_FOREACH(transaction, k, j)
-                                if (tr->anchor_job == k ||
-                                    !job_type_is_redundant(k->type, unit_active_state(k->unit)) ||
-                                    (k->unit->job && job_type_is_conflicting(k->type, k->unit->job->type))) {
-                                        keep = true;
-                                        break;
-                                }
-
-                        if (!keep) {
-                                log_trace("Found redundant job %s/%s, dropping from transaction.",
-                                          j->unit->id, job_type_to_string(j->type));
-                                transaction_delete_job(tr, j, false);
-                                again = true;
+        HASHMAP_FOREACH(j, tr->jobs) {
+                bool keep = false;
+                Unit *u = j->unit;
+
+                LIST_FOREACH(transaction, k, j)
+                        if (tr->anchor_job == k ||
+                            !job_type_is_redundant(k->type, unit_active_state(k->unit)) ||
+                            (k->unit->job && job_type_is_conflicting(k->type, k->unit->job->type))) {
+                                keep = true;
                                 break;
                         }
+
+                if (keep)
+                        continue;
+
+                /* This only ever removes the current entry, which is safe while iterating. */
+                Job *d;
+                while ((d = hashmap_get(tr->jobs, u))) {
+                        log_trace("Found redundant job %s/%s, dropping from transaction.",
+                                  u->id, job_type_to_string(d->type));
+                        transaction_delete_job(tr, d, false);
                 }
-        } while (again);
+        }
 }
 
 static bool job_matters_to_anchor(Job *job) {
@@ -337,122 +357,114 @@ static bool job_matters_to_anchor(Job *job) {
         return false;
 }
 
-static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsigned generation, sd_bus_error *e) {
-
-        static const UnitDependencyAtom directions[] = {
-                UNIT_ATOM_BEFORE,
-                UNIT_ATOM_AFTER,
-        };
-
-        int r;
+static int transaction_break_cycle(Transaction *tr, Job *j, Job *from, unsigned generation, sd_bus_error *e) {
+        _cleanup_free_ char **array = NULL;
+        Job *delete = NULL;
 
         assert(tr);
         assert(j);
-        assert(!j->transaction_prev);
+        assert(from);
 
-        /* Does a recursive sweep through the ordering graph, looking for a cycle. If we find a cycle we try
-         * to break it. */
+        /* We reached j again while it is still on our path: we found a cycle. Let's try to break it. We go
+         * backwards in our path and try to find a suitable job to remove. We use the marker to find our
+         * way back, since smart how we are we stored our way back in there. */
+        for (Job *k = from; k; k = (k->generation == generation && k->marker != k) ? k->marker : NULL) {
 
-        /* Have we seen this before? */
-        if (j->generation == generation) {
-                _cleanup_free_ char **array = NULL;
-                Job *delete = NULL;
+                /* For logging below. */
+                if (strv_push_pair(&array, k->unit->id, (char*) job_type_to_string(k->type)) < 0)
+                        (void) log_oom_warning();
 
-                /* If the marker is NULL we have been here already and decided the job was loop-free from
-                 * here. Hence shortcut things and return right-away. */
-                if (!j->marker)
-                        return 0;
+                if (!delete && hashmap_contains(tr->jobs, k->unit) && !job_matters_to_anchor(k))
+                        /* Ok, we can drop this one, so let's do so. */
+                        delete = k;
 
-                /* So, the marker is not NULL and we already have been here. We have a cycle. Let's try to
-                 * break it. We go backwards in our path and try to find a suitable job to remove. We use the
-                 * marker to find our way back, since smart how we are we stored our way back in there. */
-                for (Job *k = from; k; k = (k->generation == generation && k->marker != k) ? k->marker : NULL) {
+                /* Check if this in fact was the beginning of the cycle. */
+                if (k == j)
+                        break;
+        }
 
-                        /* For logging below. */
-                        if (strv_push_pair(&array, k->unit->id, (char*) job_type_to_string(k->type)) < 0)
-                                (void) log_oom_warning();
+        _cleanup_free_ char *unit_ids = NULL;
+        STRV_FOREACH_PAIR(unit_id, job_type, array)
+                (void) strextendf_with_separator(&unit_ids, "\n", "%s%s", unit_log_field(j->unit), *unit_id);
 
-                        if (!delete && hashmap_contains(tr->jobs, k->unit) && !job_matters_to_anchor(k))
-                                /* Ok, we can drop this one, so let's do so. */
-                                delete = k;
+        _cleanup_free_ char *cycle_path_text = strdup("Found ordering cycle");
+        if (!strv_isempty(array)) {
+                (void) strextendf(&cycle_path_text, ": %s/%s", array[0], array[1]);
 
-                        /* Check if this in fact was the beginning of the cycle. */
-                        if (k == j)
-                                break;
-                }
-
-                _cleanup_free_ char *unit_ids = NULL;
-                STRV_FOREACH_PAIR(unit_id, job_type, array)
-                        (void) strextendf_with_separator(&unit_ids, "\n", "%s%s", unit_log_field(j->unit), *unit_id);
+                STRV_FOREACH_PAIR(unit_id, job_type, strv_skip(array, 2))
+                        (void) strextendf(&cycle_path_text, " after %s/%s", *unit_id, *job_type);
 
-                _cleanup_free_ char *cycle_path_text = strdup("Found ordering cycle");
-                if (!strv_isempty(array)) {
-                        (void) strextendf(&cycle_path_text, ": %s/%s", array[0], array[1]);
+                (void) strextendf(&cycle_path_text, " - after %s", array[0]);
+        }
 
-                        STRV_FOREACH_PAIR(unit_id, job_type, strv_skip(array, 2))
-                                (void) strextendf(&cycle_path_text, " after %s/%s", *unit_id, *job_type);
+        /* logging for j not k here to provide a consistent narrative */
+        if (cycle_path_text)
+                log_struct(LOG_ERR,
+                           LOG_UNIT_MESSAGE(j->unit, "%s", cycle_path_text),
+                           LOG_MESSAGE_ID(SD_MESSAGE_UNIT_ORDERING_CYCLE_STR),
+                           LOG_ITEM("%s", strempty(unit_ids)));
 
-                        (void) strextendf(&cycle_path_text, " - after %s", array[0]);
-                }
+        if (set_size(j->manager->transactions_with_cycle) >= CYCLIC_TRANSACTIONS_MAX)
+                log_warning("Too many transactions with ordering cycle, suppressing record.");
+        else {
+                uint64_t *id_buf = newdup(uint64_t, &tr->id, 1);
+                if (!id_buf)
+                        log_oom_warning();
+                else
+                        (void) set_ensure_consume(&j->manager->transactions_with_cycle, &uint64_hash_ops_value_free, id_buf);
+        }
 
+        if (delete) {
+                const char *status;
                 /* logging for j not k here to provide a consistent narrative */
-                if (cycle_path_text)
-                        log_struct(LOG_ERR,
-                                   LOG_UNIT_MESSAGE(j->unit, "%s", cycle_path_text),
-                                   LOG_MESSAGE_ID(SD_MESSAGE_UNIT_ORDERING_CYCLE_STR),
-                                   LOG_ITEM("%s", strempty(unit_ids)));
-
-                if (set_size(j->manager->transactions_with_cycle) >= CYCLIC_TRANSACTIONS_MAX)
-                        log_warning("Too many transactions with ordering cycle, suppressing record.");
-                else {
-                        uint64_t *id_buf = newdup(uint64_t, &tr->id, 1);
-                        if (!id_buf)
-                                log_oom_warning();
-                        else
-                                (void) set_ensure_consume(&j->manager->transactions_with_cycle, &uint64_hash_ops_value_free, id_buf);
-                }
-
-                if (delete) {
-                        const char *status;
-                        /* logging for j not k here to provide a consistent narrative */
-                        log_struct(LOG_WARNING,
-                                   LOG_UNIT_MESSAGE(j->unit,
-                                                    "Job %s/%s deleted to break ordering cycle starting with %s/%s",
-                                                    delete->unit->id, job_type_to_string(delete->type),
-                                                    j->unit->id, job_type_to_string(j->type)),
-                                   LOG_MESSAGE_ID(SD_MESSAGE_DELETING_JOB_BECAUSE_ORDERING_CYCLE_STR),
-                                   LOG_ITEM("DELETED_UNIT=%s", delete->unit->id),
-                                   LOG_ITEM("DELETED_TYPE=%s", job_type_to_string(delete->type)),
-                                   LOG_ITEM("%s", strempty(unit_ids)));
-
-                        if (log_get_show_color())
-                                status = ANSI_HIGHLIGHT_RED " SKIP " ANSI_NORMAL;
-                        else
-                                status = " SKIP ";
-
-                        unit_status_printf(delete->unit,
-                                           STATUS_TYPE_NOTICE,
-                                           status,
-                                           "Ordering cycle found, skipping %s",
-                                           unit_status_string(delete->unit, NULL));
-                        transaction_delete_unit(tr, delete->unit);
-                        return -EAGAIN;
-                }
-
-                log_struct(LOG_ERR,
-                           LOG_UNIT_MESSAGE(j->unit, "Unable to break cycle starting with %s/%s",
+                log_struct(LOG_WARNING,
+                           LOG_UNIT_MESSAGE(j->unit,
+                                            "Job %s/%s deleted to break ordering cycle starting with %s/%s",
+                                            delete->unit->id, job_type_to_string(delete->type),
                                             j->unit->id, job_type_to_string(j->type)),
-                           LOG_MESSAGE_ID(SD_MESSAGE_CANT_BREAK_ORDERING_CYCLE_STR),
+                           LOG_MESSAGE_ID(SD_MESSAGE_DELETING_JOB_BECAUSE_ORDERING_CYCLE_STR),
+                           LOG_ITEM("DELETED_UNIT=%s", delete->unit->id),
+                           LOG_ITEM("DELETED_TYPE=%s", job_type_to_string(delete->type)),
                            LOG_ITEM("%s", strempty(unit_ids)));
 
-                return sd_bus_error_setf(e, BUS_ERROR_TRANSACTION_ORDER_IS_CYCLIC,
-                                         "Transaction order is cyclic. See system logs for details.");
+                if (log_get_show_color())
+                        status = ANSI_HIGHLIGHT_RED " SKIP " ANSI_NORMAL;
+                else
+                        status = " SKIP ";
+
+                unit_status_printf(delete->unit,
+                                   STATUS_TYPE_NOTICE,
+                                   status,
+                                   "Ordering cycle found, skipping %s",
+                                   unit_status_string(delete->unit, NULL));
+                transaction_delete_unit(tr, delete->unit);
+                return -EAGAIN;
         }
 
-        /* Make the marker point to where we come from, so that we can find our way backwards if we want to
-         * break a cycle. We use a special marker for the beginning: we point to ourselves. */
-        j->marker = from ?: j;
-        j->generation = generation;
+        log_struct(LOG_ERR,
+                   LOG_UNIT_MESSAGE(j->unit, "Unable to break cycle starting with %s/%s",
+                                    j->unit->id, job_type_to_string(j->type)),
+                   LOG_MESSAGE_ID(SD_MESSAGE_CANT_BREAK_ORDERING_CYCLE_STR),
+                   LOG_ITEM("%s", strempty(unit_ids)));
+
+        return sd_bus_error_setf(e, BUS_ERROR_TRANSACTION_ORDER_IS_CYCLIC,
+                                 "Transaction order is cyclic. See system logs for details.");
+}
+
+static int job_get_order_successors(Transaction *tr, Job *j, Job ***ret, size_t *ret_n) {
+
+        static const UnitDependencyAtom directions[] = {
+                UNIT_ATOM_BEFORE,
+                UNIT_ATOM_AFTER,
+        };
+
+        _cleanup_free_ Job **successors = NULL;
+        size_t n = 0;
+
+        assert(tr);
+        assert(j);
+        assert(ret);
+        assert(ret_n);
 
         /* Actual ordering of jobs depends on the unit ordering dependency and job types. We need to traverse
          * the graph over 'before' edges in the actual job execution order. We traverse over both unit
@@ -478,14 +490,113 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
                         if (job_compare(j, o, *d) >= 0)
                                 continue;
 
-                        r = transaction_verify_order_one(tr, o, j, generation, e);
-                        if (r < 0)
-                                return r;
+                        if (!GREEDY_REALLOC(successors, n + 1))
+                                return -ENOMEM;
+
+                        successors[n++] = o;
                 }
         }
 
-        /* Ok, let's backtrack, and remember that this entry is not on our path anymore. */
-        j->marker = NULL;
+        *ret = TAKE_PTR(successors);
+        *ret_n = n;
+        return 0;
+}
+
+typedef struct OrderFrame {
+        Job *job;
+        Job **successors;
+        size_t n_successors;
+        size_t next;
+} OrderFrame;
+
+static void order_frame_array_free(OrderFrame *frames, size_t n) {
+        FOREACH_ARRAY(f, frames, n)
+                free(f->successors);
+
+        free(frames);
+}
+
+static int transaction_verify_order_push(Transaction *tr, OrderFrame **frames, size_t *n_frames, Job *j, Job *from, unsigned generation) {
+        OrderFrame *f;
+        int r;
+
+        assert(tr);
+        assert(frames);
+        assert(n_frames);
+        assert(j);
+
+        if (!GREEDY_REALLOC(*frames, *n_frames + 1))
+                return -ENOMEM;
+
+        /* Make the marker point to where we come from, so that we can find our way backwards if we want to
+         * break a cycle. We use a special marker for the beginning: we point to ourselves. */
+        j->marker = from ?: j;
+        j->generation = generation;
+
+        f = *frames + *n_frames;
+        *f = (OrderFrame) {
+                .job = j,
+        };
+
+        r = job_get_order_successors(tr, j, &f->successors, &f->n_successors);
+        if (r < 0)
+                return r;
+
+        (*n_frames)++;
+        return 0;
+}
+
+static int transaction_verify_order_one(Transaction *tr, Job *j, unsigned generation, sd_bus_error *e) {
+        OrderFrame *frames = NULL;
+        size_t n_frames = 0;
+        int r;
+
+        CLEANUP_ARRAY(frames, n_frames, order_frame_array_free);
+
+        assert(tr);
+        assert(j);
+        assert(!j->transaction_prev);
+
+        /* Does a depth-first sweep through the ordering graph, looking for a cycle. If we find a cycle we
+         * try to break it. The path is kept on an explicit stack rather than in recursion, as with large
+         * transactions it might get very long. Jobs whose marker is reset to NULL are known to be loop-free
+         * from there on, and are not visited again in this generation. */
+
+        if (j->generation == generation)
+                return 0;
+
+        r = transaction_verify_order_push(tr, &frames, &n_frames, j, /* from= */ NULL, generation);
+        if (r < 0)
+                return r;
+
+        while (n_frames > 0) {
+                OrderFrame *f = frames + n_frames - 1;
+                Job *o;
+
+                if (f->next >= f->n_successors) {
+                        /* Ok, let's backtrack, and remember that this entry is not on our path anymore. */
+                        f->job->marker = NULL;
+                        f->successors = mfree(f->successors);
+                        n_frames--;
+                        continue;
+                }
+
+                o = f->successors[f->next++];
+
+                /* Have we seen this before? */
+                if (o->generation == generation) {
+                        /* If the marker is NULL we have been here already and decided the job was
+                         * loop-free from here. */
+                        if (!o->marker)
+                                continue;
+
+                        return transaction_break_cycle(tr, o, f->job, generation, e);
+                }
+
+                r = transaction_verify_order_push(tr, &frames, &n_frames, o, f->job, generation);
+                if (r < 0)
+                        return r;
+        }
 
         return 0;
 }
@@ -503,7 +614,7 @@ static int transaction_verify_order(Transaction *tr, unsigned *generation, sd_bu
         g = (*generation)++;
 
         HASHMAP_FOREACH(j, tr->jobs) {
-                r = transaction_verify_order_one(tr, j, NULL, g, e);
+                r = transaction_verify_order_one(tr, j, g, e);
                 if (r < 0)
                         return r;
         }
@@ -511,36 +622,59 @@ static int transaction_verify_order(Transaction *tr, unsigned *generation, sd_bu
         return 0;
 }
 
-static void transaction_collect_garbage(Transaction *tr) {
-        bool again;
+static int transaction_collect_garbage(Transaction *tr) {
+        _cleanup_free_ Unit **queue = NULL;
+        size_t n_queue = 0;
+        Job *j;
 
         assert(tr);
 
-        /* Drop jobs that are not required by any other job. */
+        /* Drop jobs that are not required by any other job.
+         *
+         * Deleting such a job only removes links where it is the subject, hence the only jobs that might
+         * become garbage are the ones it pulled in, and the next job of its own unit. Instead of rescanning
+         * the whole transaction after each deletion, track these candidates in a queue. */
 
-        do {
-                Job *j;
+        HASHMAP_FOREACH(j, tr->jobs) {
+                if (!GREEDY_REALLOC(queue, n_queue + 1))
+                        return -ENOMEM;
 
-                again = false;
+                queue[n_queue++] = j->unit;
+        }
 
-                HASHMAP_FOREACH(j, tr->jobs) {
-                        if (tr->anchor_job == j)
-                                continue;
+        while (n_queue > 0) {
+                Unit *u = queue[--n_queue];
 
-                        if (!j->object_list) {
-                                log_trace("Garbage collecting job %s/%s", j->unit->id, job_type_to_string(j->type));
-                                transaction_delete_job(tr, j, true);
-                                again = true;
-                                break;
-                        }
+                j = hashmap_get(tr->jobs, u);
+                if (!j || tr->anchor_job == j)
+                        continue;
 
+                if (j->object_list) {
                         log_trace("Keeping job %s/%s because of %s/%s",
                                   j->unit->id, job_type_to_string(j->type),
                                   j->object_list->subject ? j->object_list->subject->unit->id : "root",
                                   j->object_list->subject ? job_type_to_string(j->object_list->subject->type) : "root");
+                        continue;
+                }
+
+                /* The job itself might be followed by another one for the same unit, and everything it
+                 * pulled in might have lost its last reference. */
+                if (!GREEDY_REALLOC(queue, n_queue + 1))
+                        return -ENOMEM;
+
+                queue[n_queue++] = u;
+                LIST_FOREACH(subject, l, j->subject_list) {
+                        if (!GREEDY_REALLOC(queue, n_queue + 1))
+                                return -ENOMEM;
+
+                        queue[n_queue++] = l->object->unit;
                 }
 
-        } while (again);
+                log_trace("Garbage collecting job %s/%s", j->unit->id, job_type_to_string(j->type));
+                transaction_delete_job(tr, j, true);
+        }
+
+        return 0;
 }
 
 static int transaction_is_destructive(Transaction *tr, JobMode mode, sd_bus_error *e) {
@@ -731,7 +865,9 @@ int transaction_activate(
                 j->generation = 0;
 
         /* First step: figure out which jobs matter. */
-        transaction_find_jobs_that_matter_to_anchor(tr->anchor_job, generation++);
+        r = transaction_find_jobs_that_matter_to_anchor(tr->anchor_job, generation++);
+        if (r < 0)
+                return log_oom();
 
         /* Second step: Try not to stop any running services if we don't have to. Don't try to reverse
          * running jobs if we don't have to. */
@@ -746,8 +882,11 @@ int transaction_activate(
 
         for (;;) {
                 /* Fourth step: Let's remove unneeded jobs that might be lurking. */
-                if (mode != JOB_ISOLATE)
-                        transaction_collect_garbage(tr);
+                if (mode != JOB_ISOLATE) {
+                        r = transaction_collect_garbage(tr);
+                        if (r < 0)
+                                return log_oom();
+                }
 
                 /* Fifth step: verify order makes sense and correct cycles if necessary and possible. */
                 r = transaction_verify_order(tr, &generation, e);
@@ -771,8 +910,11 @@ int transaction_activate(
                                                  bus_error_message(e, r));
 
                 /* Seventh step: an entry got dropped, let's garbage collect its dependencies. */
-                if (mode != JOB_ISOLATE)
-                        transaction_collect_garbage(tr);
+                if (mode != JOB_ISOLATE) {
+                        r = transaction_collect_garbage(tr);
+                        if (r < 0)
+                                return log_oom();
+                }
 
                 /* Let's see if the resulting transaction still has unmergeable entries... */
         }
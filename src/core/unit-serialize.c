@@ -393,7 +393,7 @@ int unit_deserialize_state_skip(FILE *f) {
         for (;;) {
                 _cleanup_free_ char *line = NULL;
 
-                r = read_stripped_line(f, LONG_LINE_MAX, &line);
+                r = read_stripped_line_full(f, LONG_LINE_MAX, READ_LINE_NOT_A_TTY, &line);
                 if (r < 0)
                         return log_error_errno(r, "Failed to read serialization line: %m");
                 if (r == 0)
@@ -614,20 +614,24 @@ void unit_dump(Unit *u, FILE *f, const char *prefix) {
                         prefix, strna(FORMAT_TIMESTAMP(u->assert_timestamp.realtime)),
                         prefix, yes_no(u->assert_result));
 
-        for (UnitDependency d = 0; d < _UNIT_DEPENDENCY_MAX; d++) {
-                UnitDependencyInfo di;
-                Unit *other;
-
-                HASHMAP_FOREACH_KEY(di.data, other, unit_get_dependencies(u, d)) {
+        for (UnitDependency d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
+                UNIT_DEPENDENCY_SET_FOREACH(e, unit_get_dependencies(u, d)) {
                         bool space = false;
 
-                        fprintf(f, "%s\t%s: %s (", prefix, unit_dependency_to_string(d), other->id);
+                        fprintf(f, "%s\t%s: %s (", prefix, unit_dependency_to_string(d), e->unit->id);
 
-                        print_unit_dependency_mask(f, "origin", di.origin_mask, &space);
-                        print_unit_dependency_mask(f, "destination", di.destination_mask, &space);
+                        print_unit_dependency_mask(f, "origin", e->info.origin_mask, &space);
+                        print_unit_dependency_mask(f, "destination", e->info.destination_mask, &space);
 
                         fputs(")\n", f);
                 }
+
+        if (!hashmap_isempty(u->dependencies)) {
+                size_t n_entries, sz;
+
+                sz = unit_dependencies_allocated(u, &n_entries);
+                fprintf(f, "%s\tDependency Memory: %zu entries in %u types, %s\n",
+                        prefix, n_entries, hashmap_size(u->dependencies), FORMAT_BYTES(sz));
         }
 
         for (UnitMountDependencyType type = 0; type < _UNIT_MOUNT_DEPENDENCY_TYPE_MAX; type++)
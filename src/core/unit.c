@@ -40,10 +40,12 @@
 #include "logarithm.h"
 #include "mkdir-label.h"
 #include "manager.h"
+#include "mempool.h"
 #include "mount-util.h"
 #include "mountpoint-util.h"
 #include "netlink-internal.h"
 #include "path-util.h"
+#include "prioq.h"
 #include "process-util.h"
 #include "quota-util.h"
 #include "rm-rf.h"
@@ -64,6 +66,7 @@
 #include "unit-name.h"
 #include "user-util.h"
 #include "varlink.h"
+#include "varlink-unit.h"
 
 /* Thresholds for logging at INFO level about resource consumption */
 #define MENTIONWORTHY_CPU_NSEC     (1 * NSEC_PER_SEC)
@@ -91,17 +94,44 @@ const UnitVTable * const unit_vtable[_UNIT_TYPE_MAX] = {
         [UNIT_SCOPE]     = &scope_vtable,
 };
 
+static struct mempool* manager_get_unit_pool(Manager *m, size_t size) {
+        assert(m);
+
+        if (!(mempool_enabled && mempool_enabled())) /* mempool_enabled is a weak symbol */
+                return NULL;
+
+        /* There's one pool per object size, i.e. usually per unit type */
+        FOREACH_ELEMENT(pool, m->unit_pools) {
+                if (pool->tile_size == size)
+                        return pool;
+
+                if (pool->tile_size == 0) {
+                        *pool = (struct mempool) {
+                                .tile_size = size,
+                                .at_least = 16,
+                                .at_most = MANAGER_UNIT_POOL_TILES_MAX,
+                        };
+                        return pool;
+                }
+        }
+
+        return NULL;
+}
+
 Unit* unit_new(Manager *m, size_t size) {
+        struct mempool *pool;
         Unit *u;
 
         assert(m);
         assert(size >= sizeof(Unit));
 
-        u = malloc0(size);
+        pool = manager_get_unit_pool(m, size);
+        u = pool ? mempool_alloc0_tile(pool) : malloc0(size);
         if (!u)
                 return NULL;
 
         u->manager = m;
+        u->mempool = pool;
         u->type = _UNIT_TYPE_INVALID;
         u->default_dependencies = true;
         u->unit_file_state = _UNIT_FILE_STATE_INVALID;
@@ -440,8 +470,9 @@ bool unit_may_gc(Unit *u) {
         if (u->in_cgroup_empty_queue || u->in_cgroup_oom_queue)
                 return false;
 
-        /* Make sure to send out D-Bus events before we unload the unit */
-        if (u->in_dbus_queue)
+        /* Make sure to send out D-Bus events before we unload the unit. Units that were never announced can
+         * go away silently, see bus_unit_send_removed_signal(). */
+        if (u->in_dbus_queue && u->sent_dbus_new_signal)
                 return false;
 
         if (sd_bus_track_count(u->bus_track) > 0)
@@ -523,9 +554,20 @@ void unit_add_to_dbus_queue(Unit *u) {
         assert(u);
         assert(u->type != _UNIT_TYPE_INVALID);
 
-        if (u->load_state == UNIT_STUB || u->in_dbus_queue)
+        if (u->load_state == UNIT_STUB)
+                return;
+
+        /* Varlink subscribers resume based on the sequence number, hence bump it for every change */
+        manager_varlink_unit_state_changed(u);
+
+        if (u->in_dbus_queue)
                 return;
 
+        /* Something about the unit changed, possibly even one of the properties we declare constant (such
+         * as dependencies), hence don't serve them from the cache anymore. Changes while the unit is
+         * queued are covered by invalidating again when the change signal is sent. */
+        bus_unit_invalidate_property_cache(u);
+
         /* Shortcut things if nobody cares */
         if (sd_bus_track_count(u->manager->subscribed) <= 0 &&
             sd_bus_track_count(u->bus_track) <= 0 &&
@@ -642,24 +684,144 @@ void unit_remove_from_stop_notify_queue(Unit *u) {
         u->in_stop_notify_queue = false;
 }
 
+static UnitDependencySet* unit_dependency_set_free(UnitDependencySet *s) {
+        if (!s)
+                return NULL;
+
+        free(s->entries);
+        return mfree(s);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(UnitDependencySet*, unit_dependency_set_free);
+
+static bool unit_dependency_set_find(const UnitDependencySet *s, const Unit *other, size_t *ret_index) {
+        size_t left = 0, right = unit_dependency_set_size(s);
+
+        assert(other);
+        assert(ret_index);
+
+        /* Returns true and the index of the entry for 'other' if there is one. Otherwise returns false and
+         * the index at which an entry for 'other' has to be inserted. */
+
+        while (left < right) {
+                size_t middle = left + (right - left) / 2;
+                int c;
+
+                c = CMP((uintptr_t) s->entries[middle].unit, (uintptr_t) other);
+                if (c == 0) {
+                        *ret_index = middle;
+                        return true;
+                }
+                if (c < 0)
+                        left = middle + 1;
+                else
+                        right = middle;
+        }
+
+        *ret_index = left;
+        return false;
+}
+
+UnitDependencyEntry* unit_dependency_set_get(const UnitDependencySet *s, const Unit *other) {
+        size_t i;
+
+        if (!unit_dependency_set_find(s, other, &i))
+                return NULL;
+
+        return s->entries + i;
+}
+
+static int unit_dependency_set_reserve(UnitDependencySet *s, size_t n_add) {
+        assert(s);
+
+        if (!GREEDY_REALLOC(s->entries, s->n_entries + n_add))
+                return -ENOMEM;
+
+        return 0;
+}
+
+static int unit_dependency_set_put(UnitDependencySet *s, Unit *other, UnitDependencyInfo info) {
+        size_t i;
+
+        assert(s);
+        assert(other);
+
+        /* Inserts an entry for 'other', or replaces the info of the existing one. This never fails if there
+         * is an entry for 'other' already, or if space was reserved with unit_dependency_set_reserve(). */
+
+        if (unit_dependency_set_find(s, other, &i)) {
+                s->entries[i].info = info;
+                return 0;
+        }
+
+        if (!GREEDY_REALLOC(s->entries, s->n_entries + 1))
+                return -ENOMEM;
+
+        memmove(s->entries + i + 1, s->entries + i, (s->n_entries - i) * sizeof(UnitDependencyEntry));
+        s->entries[i] = (UnitDependencyEntry) {
+                .unit = other,
+                .info = info,
+        };
+        s->n_entries++;
+
+        return 1;
+}
+
+static bool unit_dependency_set_remove(UnitDependencySet *s, const Unit *other, UnitDependencyInfo *ret) {
+        size_t i;
+
+        assert(other);
+
+        if (!unit_dependency_set_find(s, other, &i))
+                return false;
+
+        if (ret)
+                *ret = s->entries[i].info;
+
+        memmove(s->entries + i, s->entries + i + 1, (s->n_entries - i - 1) * sizeof(UnitDependencyEntry));
+        s->n_entries--;
+
+        return true;
+}
+
+size_t unit_dependencies_allocated(const Unit *u, size_t *ret_n_entries) {
+        UnitDependencySet *deps;
+        size_t n = 0, sz = 0;
+
+        assert(u);
+
+        /* Returns the memory used for the per dependency type arrays of the unit, for debugging purposes */
+
+        HASHMAP_FOREACH(deps, u->dependencies) {
+                n += deps->n_entries;
+                sz += MALLOC_SIZEOF_SAFE(deps) + MALLOC_SIZEOF_SAFE(deps->entries);
+        }
+
+        if (ret_n_entries)
+                *ret_n_entries = n;
+
+        return sz;
+}
+
 static void unit_clear_dependencies(Unit *u) {
         assert(u);
 
         /* Removes all dependencies configured on u and their reverse dependencies. */
 
-        for (Hashmap *deps; (deps = hashmap_steal_first(u->dependencies));) {
+        for (UnitDependencySet *deps; (deps = hashmap_steal_first(u->dependencies));) {
 
-                for (Unit *other; (other = hashmap_steal_first_key(deps));) {
-                        Hashmap *other_deps;
+                UNIT_DEPENDENCY_SET_FOREACH(e, deps) {
+                        Unit *other = e->unit;
+                        UnitDependencySet *other_deps;
 
                         HASHMAP_FOREACH(other_deps, other->dependencies)
-                                hashmap_remove(other_deps, u);
+                                unit_dependency_set_remove(other_deps, u, /* ret= */ NULL);
 
                         unit_add_to_gc_queue(other);
                         other->dependency_generation++;
                 }
 
-                hashmap_free(deps);
+                unit_dependency_set_free(deps);
         }
 
         u->dependencies = hashmap_free(u->dependencies);
@@ -695,6 +857,7 @@ static void unit_remove_transient(Unit *u) {
                 (void) unit_file_remove_from_name_map(
                                 &u->manager->lookup_paths,
                                 &u->manager->unit_cache_timestamp_hash,
+                                u->manager->unit_directory_cache,
                                 &u->manager->unit_id_map,
                                 &u->manager->unit_name_map,
                                 &u->manager->unit_path_cache,
@@ -773,6 +936,8 @@ Unit* unit_free(Unit *u) {
                 unit_remove_transient(u);
 
         bus_unit_send_removed_signal(u);
+        bus_unit_invalidate_property_cache(u);
+        manager_varlink_unit_state_removed(u);
 
         unit_done(u);
 
@@ -780,6 +945,7 @@ Unit* unit_free(Unit *u) {
         u->bus_track = sd_bus_track_unref(u->bus_track);
         u->deserialized_refs = strv_free(u->deserialized_refs);
         u->pending_freezer_invocation = sd_bus_message_unref(u->pending_freezer_invocation);
+        free(u->exec_context_serialized);
 
         unit_free_mounts_for(u);
 
@@ -834,7 +1000,9 @@ Unit* unit_free(Unit *u) {
         if (u->in_load_queue)
                 LIST_REMOVE(load_queue, u->manager->load_queue, u);
 
-        if (u->in_dbus_queue)
+        if (u->in_dbus_deferred_queue)
+                prioq_remove(u->manager->dbus_unit_deferred_queue, u, &u->dbus_deferred_queue_idx);
+        else if (u->in_dbus_queue)
                 LIST_REMOVE(dbus_queue, u->manager->dbus_unit_queue, u);
 
         if (u->in_cleanup_queue)
@@ -889,6 +1057,9 @@ Unit* unit_free(Unit *u) {
 
         activation_details_unref(u->activation_details);
 
+        if (u->mempool)
+                return mempool_free_tile(u->mempool, u);
+
         return mfree(u);
 }
 
@@ -939,17 +1110,17 @@ static int unit_merge_names(Unit *u, Unit *other) {
 
 static int unit_reserve_dependencies(Unit *u, Unit *other) {
         size_t n_reserve;
-        Hashmap* deps;
+        UnitDependencySet *deps;
         void *d;
         int r;
 
         assert(u);
         assert(other);
 
-        /* Let's reserve some space in the dependency hashmaps so that later on merging the units cannot
-         * fail.
+        /* Let's reserve some space in the dependency hashmap and arrays so that later on merging the units
+         * cannot fail.
          *
-         * First make some room in the per dependency type hashmaps. Using the summed size of both units'
+         * First make some room in the hashmap of dependency types. Using the summed size of both units'
          * hashmaps is an estimate that is likely too high since they probably use some of the same
          * types. But it's never too low, and that's all we need. */
 
@@ -964,7 +1135,7 @@ static int unit_reserve_dependencies(Unit *u, Unit *other) {
                         return r;
         }
 
-        /* Now, enlarge our per dependency type hashmaps by the number of entries in the same hashmap of the
+        /* Now, enlarge our per dependency type arrays by the number of entries in the same array of the
          * other unit's dependencies.
          *
          * NB: If u does not have a dependency set allocated for some dependency type, there is no need to
@@ -972,11 +1143,7 @@ static int unit_reserve_dependencies(Unit *u, Unit *other) {
          * complete_move(). */
 
         HASHMAP_FOREACH_KEY(deps, d, u->dependencies) {
-                Hashmap *other_deps;
-
-                other_deps = hashmap_get(other->dependencies, d);
-
-                r = hashmap_reserve(deps, hashmap_size(other_deps));
+                r = unit_dependency_set_reserve(deps, unit_dependency_set_size(hashmap_get(other->dependencies, d)));
                 if (r < 0)
                         return r;
         }
@@ -997,41 +1164,41 @@ static bool unit_should_warn_about_dependency(UnitDependency dependency) {
                       UNIT_TRIGGERED_BY);
 }
 
-static int unit_per_dependency_type_hashmap_update(
-                Hashmap *per_type,
+static int unit_dependency_set_update(
+                UnitDependencySet *s,
                 Unit *other,
                 UnitDependencyMask origin_mask,
                 UnitDependencyMask destination_mask) {
 
+        UnitDependencyEntry *e;
         UnitDependencyInfo info;
         int r;
 
+        assert(s);
         assert(other);
-        assert_cc(sizeof(void*) == sizeof(info));
 
         /* Acquire the UnitDependencyInfo entry for the Unit* we are interested in, and update it if it
          * exists, or insert it anew if not. */
 
-        info.data = hashmap_get(per_type, other);
-        if (info.data) {
+        e = unit_dependency_set_get(s, other);
+        if (e) {
                 /* Entry already exists. Add in our mask. */
 
-                if (FLAGS_SET(origin_mask, info.origin_mask) &&
-                    FLAGS_SET(destination_mask, info.destination_mask))
+                if (FLAGS_SET(e->info.origin_mask, origin_mask) &&
+                    FLAGS_SET(e->info.destination_mask, destination_mask))
                         return 0; /* NOP */
 
-                info.origin_mask |= origin_mask;
-                info.destination_mask |= destination_mask;
+                e->info.origin_mask |= origin_mask;
+                e->info.destination_mask |= destination_mask;
+                return 1;
+        }
 
-                r = hashmap_update(per_type, other, info.data);
-        } else {
-                info = (UnitDependencyInfo) {
-                        .origin_mask = origin_mask,
-                        .destination_mask = destination_mask,
-                };
+        info = (UnitDependencyInfo) {
+                .origin_mask = origin_mask,
+                .destination_mask = destination_mask,
+        };
 
-                r = hashmap_put(per_type, other, info.data);
-        }
+        r = unit_dependency_set_put(s, other, info);
         if (r < 0)
                 return r;
 
@@ -1039,7 +1206,7 @@ static int unit_per_dependency_type_hashmap_update(
 }
 
 static void unit_merge_dependencies(Unit *u, Unit *other) {
-        Hashmap *deps;
+        UnitDependencySet *deps;
         void *dt; /* Actually of type UnitDependency, except that we don't bother casting it here,
                    * since the hashmaps all want it as void pointer. */
 
@@ -1051,19 +1218,18 @@ static void unit_merge_dependencies(Unit *u, Unit *other) {
 
         /* First, remove dependency to other. */
         HASHMAP_FOREACH_KEY(deps, dt, u->dependencies) {
-                if (hashmap_remove(deps, other) && unit_should_warn_about_dependency(UNIT_DEPENDENCY_FROM_PTR(dt)))
+                if (unit_dependency_set_remove(deps, other, /* ret= */ NULL) &&
+                    unit_should_warn_about_dependency(UNIT_DEPENDENCY_FROM_PTR(dt)))
                         log_unit_warning(u, "Dependency %s=%s is dropped, as %s is merged into %s.",
                                          unit_dependency_to_string(UNIT_DEPENDENCY_FROM_PTR(dt)),
                                          other->id, other->id, u->id);
 
-                if (hashmap_isempty(deps))
-                        hashmap_free(hashmap_remove(u->dependencies, dt));
+                if (deps->n_entries == 0)
+                        unit_dependency_set_free(hashmap_remove(u->dependencies, dt));
         }
 
         for (;;) {
-                _cleanup_hashmap_free_ Hashmap *other_deps = NULL;
-                UnitDependencyInfo di_back;
-                Unit *back;
+                _cleanup_(unit_dependency_set_freep) UnitDependencySet *other_deps = NULL;
 
                 /* Let's focus on one dependency type at a time, that 'other' has defined. */
                 other_deps = hashmap_steal_first_key_and_value(other->dependencies, &dt);
@@ -1074,8 +1240,10 @@ static void unit_merge_dependencies(Unit *u, Unit *other) {
 
                 /* Now iterate through all dependencies of this dependency type, of 'other'. We refer to the
                  * referenced units as 'back'. */
-                HASHMAP_FOREACH_KEY(di_back.data, back, other_deps) {
-                        Hashmap *back_deps;
+                for (size_t i = 0; i < other_deps->n_entries;) {
+                        UnitDependencyInfo di_back = other_deps->entries[i].info;
+                        Unit *back = other_deps->entries[i].unit;
+                        UnitDependencySet *back_deps;
                         void *back_dt;
 
                         if (back == u) {
@@ -1086,20 +1254,21 @@ static void unit_merge_dependencies(Unit *u, Unit *other) {
                                                          unit_dependency_to_string(UNIT_DEPENDENCY_FROM_PTR(dt)),
                                                          u->id, other->id, other->id, u->id);
 
-                                hashmap_remove(other_deps, back);
+                                /* This drops entry i, hence the next one moves into its place */
+                                assert_se(unit_dependency_set_remove(other_deps, back, /* ret= */ NULL));
                                 continue;
                         }
 
                         /* Now iterate through all deps of 'back', and fix the ones pointing to 'other' to
-                         * point to 'u' instead. */
+                         * point to 'u' instead. As we just removed an entry from the array, adding one
+                         * cannot fail. */
                         HASHMAP_FOREACH_KEY(back_deps, back_dt, back->dependencies) {
                                 UnitDependencyInfo di_move;
 
-                                di_move.data = hashmap_remove(back_deps, other);
-                                if (!di_move.data)
+                                if (!unit_dependency_set_remove(back_deps, other, &di_move))
                                         continue;
 
-                                assert_se(unit_per_dependency_type_hashmap_update(
+                                assert_se(unit_dependency_set_update(
                                                           back_deps,
                                                           u,
                                                           di_move.origin_mask,
@@ -1108,11 +1277,13 @@ static void unit_merge_dependencies(Unit *u, Unit *other) {
 
                         /* The target unit already has dependencies of this type, let's then merge this individually. */
                         if (deps)
-                                assert_se(unit_per_dependency_type_hashmap_update(
+                                assert_se(unit_dependency_set_update(
                                                           deps,
                                                           back,
                                                           di_back.origin_mask,
                                                           di_back.destination_mask) >= 0);
+
+                        i++;
                 }
 
                 /* Now all references towards 'other' of the current type 'dt' are corrected to point to 'u'.
@@ -3029,24 +3200,24 @@ bool unit_job_is_applicable(Unit *u, JobType j) {
         }
 }
 
-static Hashmap *unit_get_dependency_hashmap_per_type(Unit *u, UnitDependency d) {
-        Hashmap *deps;
+static UnitDependencySet* unit_get_dependency_set_per_type(Unit *u, UnitDependency d) {
+        UnitDependencySet *deps;
 
         assert(u);
         assert(d >= 0 && d < _UNIT_DEPENDENCY_MAX);
 
         deps = hashmap_get(u->dependencies, UNIT_DEPENDENCY_TO_PTR(d));
         if (!deps) {
-                _cleanup_hashmap_free_ Hashmap *h = NULL;
+                _cleanup_(unit_dependency_set_freep) UnitDependencySet *s = NULL;
 
-                h = hashmap_new(NULL);
-                if (!h)
+                s = new0(UnitDependencySet, 1);
+                if (!s)
                         return NULL;
 
-                if (hashmap_ensure_put(&u->dependencies, NULL, UNIT_DEPENDENCY_TO_PTR(d), h) < 0)
+                if (hashmap_ensure_put(&u->dependencies, NULL, UNIT_DEPENDENCY_TO_PTR(d), s) < 0)
                         return NULL;
 
-                deps = TAKE_PTR(h);
+                deps = TAKE_PTR(s);
         }
 
         return deps;
@@ -3057,71 +3228,80 @@ typedef enum NotifyDependencyFlags {
         NOTIFY_DEPENDENCY_UPDATE_TO   = 1 << 1,
 } NotifyDependencyFlags;
 
+static const UnitDependency unit_dependency_inverse_table[_UNIT_DEPENDENCY_MAX] = {
+        [UNIT_REQUIRES]               = UNIT_REQUIRED_BY,
+        [UNIT_REQUISITE]              = UNIT_REQUISITE_OF,
+        [UNIT_WANTS]                  = UNIT_WANTED_BY,
+        [UNIT_BINDS_TO]               = UNIT_BOUND_BY,
+        [UNIT_PART_OF]                = UNIT_CONSISTS_OF,
+        [UNIT_UPHOLDS]                = UNIT_UPHELD_BY,
+        [UNIT_REQUIRED_BY]            = UNIT_REQUIRES,
+        [UNIT_REQUISITE_OF]           = UNIT_REQUISITE,
+        [UNIT_WANTED_BY]              = UNIT_WANTS,
+        [UNIT_BOUND_BY]               = UNIT_BINDS_TO,
+        [UNIT_CONSISTS_OF]            = UNIT_PART_OF,
+        [UNIT_UPHELD_BY]              = UNIT_UPHOLDS,
+        [UNIT_CONFLICTS]              = UNIT_CONFLICTED_BY,
+        [UNIT_CONFLICTED_BY]          = UNIT_CONFLICTS,
+        [UNIT_BEFORE]                 = UNIT_AFTER,
+        [UNIT_AFTER]                  = UNIT_BEFORE,
+        [UNIT_ON_SUCCESS]             = UNIT_ON_SUCCESS_OF,
+        [UNIT_ON_SUCCESS_OF]          = UNIT_ON_SUCCESS,
+        [UNIT_ON_FAILURE]             = UNIT_ON_FAILURE_OF,
+        [UNIT_ON_FAILURE_OF]          = UNIT_ON_FAILURE,
+        [UNIT_TRIGGERS]               = UNIT_TRIGGERED_BY,
+        [UNIT_TRIGGERED_BY]           = UNIT_TRIGGERS,
+        [UNIT_PROPAGATES_RELOAD_TO]   = UNIT_RELOAD_PROPAGATED_FROM,
+        [UNIT_RELOAD_PROPAGATED_FROM] = UNIT_PROPAGATES_RELOAD_TO,
+        [UNIT_PROPAGATES_STOP_TO]     = UNIT_STOP_PROPAGATED_FROM,
+        [UNIT_STOP_PROPAGATED_FROM]   = UNIT_PROPAGATES_STOP_TO,
+        [UNIT_JOINS_NAMESPACE_OF]     = UNIT_JOINS_NAMESPACE_OF, /* symmetric! 👓 */
+        [UNIT_REFERENCES]             = UNIT_REFERENCED_BY,
+        [UNIT_REFERENCED_BY]          = UNIT_REFERENCES,
+        [UNIT_IN_SLICE]               = UNIT_SLICE_OF,
+        [UNIT_SLICE_OF]               = UNIT_IN_SLICE,
+};
+
+UnitDependency unit_dependency_inverse(UnitDependency d) {
+        assert(d >= 0 && d < _UNIT_DEPENDENCY_MAX);
+
+        return unit_dependency_inverse_table[d];
+}
+
 static int unit_add_dependency_impl(
                 Unit *u,
                 UnitDependency d,
                 Unit *other,
                 UnitDependencyMask mask) {
 
-        static const UnitDependency inverse_table[_UNIT_DEPENDENCY_MAX] = {
-                [UNIT_REQUIRES]               = UNIT_REQUIRED_BY,
-                [UNIT_REQUISITE]              = UNIT_REQUISITE_OF,
-                [UNIT_WANTS]                  = UNIT_WANTED_BY,
-                [UNIT_BINDS_TO]               = UNIT_BOUND_BY,
-                [UNIT_PART_OF]                = UNIT_CONSISTS_OF,
-                [UNIT_UPHOLDS]                = UNIT_UPHELD_BY,
-                [UNIT_REQUIRED_BY]            = UNIT_REQUIRES,
-                [UNIT_REQUISITE_OF]           = UNIT_REQUISITE,
-                [UNIT_WANTED_BY]              = UNIT_WANTS,
-                [UNIT_BOUND_BY]               = UNIT_BINDS_TO,
-                [UNIT_CONSISTS_OF]            = UNIT_PART_OF,
-                [UNIT_UPHELD_BY]              = UNIT_UPHOLDS,
-                [UNIT_CONFLICTS]              = UNIT_CONFLICTED_BY,
-                [UNIT_CONFLICTED_BY]          = UNIT_CONFLICTS,
-                [UNIT_BEFORE]                 = UNIT_AFTER,
-                [UNIT_AFTER]                  = UNIT_BEFORE,
-                [UNIT_ON_SUCCESS]             = UNIT_ON_SUCCESS_OF,
-                [UNIT_ON_SUCCESS_OF]          = UNIT_ON_SUCCESS,
-                [UNIT_ON_FAILURE]             = UNIT_ON_FAILURE_OF,
-                [UNIT_ON_FAILURE_OF]          = UNIT_ON_FAILURE,
-                [UNIT_TRIGGERS]               = UNIT_TRIGGERED_BY,
-                [UNIT_TRIGGERED_BY]           = UNIT_TRIGGERS,
-                [UNIT_PROPAGATES_RELOAD_TO]   = UNIT_RELOAD_PROPAGATED_FROM,
-                [UNIT_RELOAD_PROPAGATED_FROM] = UNIT_PROPAGATES_RELOAD_TO,
-                [UNIT_PROPAGATES_STOP_TO]     = UNIT_STOP_PROPAGATED_FROM,
-                [UNIT_STOP_PROPAGATED_FROM]   = UNIT_PROPAGATES_STOP_TO,
-                [UNIT_JOINS_NAMESPACE_OF]     = UNIT_JOINS_NAMESPACE_OF, /* symmetric! 👓 */
-                [UNIT_REFERENCES]             = UNIT_REFERENCED_BY,
-                [UNIT_REFERENCED_BY]          = UNIT_REFERENCES,
-                [UNIT_IN_SLICE]               = UNIT_SLICE_OF,
-                [UNIT_SLICE_OF]               = UNIT_IN_SLICE,
-        };
-
-        Hashmap *u_deps, *other_deps;
+        UnitDependencySet *u_deps, *other_deps;
         UnitDependencyInfo u_info, u_info_old, other_info, other_info_old;
         NotifyDependencyFlags flags = 0;
+        UnitDependencyEntry *e;
         int r;
 
         assert(u);
         assert(other);
         assert(d >= 0 && d < _UNIT_DEPENDENCY_MAX);
-        assert(inverse_table[d] >= 0 && inverse_table[d] < _UNIT_DEPENDENCY_MAX);
+        assert(unit_dependency_inverse_table[d] >= 0 && unit_dependency_inverse_table[d] < _UNIT_DEPENDENCY_MAX);
         assert(mask > 0 && mask < _UNIT_DEPENDENCY_MASK_FULL);
 
-        /* Ensure the following two hashmaps for each unit exist:
-         * - the top-level dependency hashmap that maps UnitDependency → Hashmap(Unit* → UnitDependencyInfo),
-         * - the inner hashmap, that maps Unit* → UnitDependencyInfo, for the specified dependency type. */
-        u_deps = unit_get_dependency_hashmap_per_type(u, d);
+        /* Ensure the following for each unit exist:
+         * - the top-level dependency hashmap that maps UnitDependency → UnitDependencySet,
+         * - the array, that maps Unit* → UnitDependencyInfo, for the specified dependency type. */
+        u_deps = unit_get_dependency_set_per_type(u, d);
         if (!u_deps)
                 return -ENOMEM;
 
-        other_deps = unit_get_dependency_hashmap_per_type(other, inverse_table[d]);
+        other_deps = unit_get_dependency_set_per_type(other, unit_dependency_inverse_table[d]);
         if (!other_deps)
                 return -ENOMEM;
 
         /* Save the original dependency info. */
-        u_info.data = u_info_old.data = hashmap_get(u_deps, other);
-        other_info.data = other_info_old.data = hashmap_get(other_deps, u);
+        e = unit_dependency_set_get(u_deps, other);
+        u_info.data = u_info_old.data = e ? e->info.data : NULL;
+        e = unit_dependency_set_get(other_deps, u);
+        other_info.data = other_info_old.data = e ? e->info.data : NULL;
 
         /* Update dependency info. */
         u_info.origin_mask |= mask;
@@ -3129,7 +3309,7 @@ static int unit_add_dependency_impl(
 
         /* Save updated dependency info. */
         if (u_info.data != u_info_old.data) {
-                r = hashmap_replace(u_deps, other, u_info.data);
+                r = unit_dependency_set_put(u_deps, other, u_info);
                 if (r < 0)
                         return r;
 
@@ -3138,14 +3318,14 @@ static int unit_add_dependency_impl(
         }
 
         if (other_info.data != other_info_old.data) {
-                r = hashmap_replace(other_deps, u, other_info.data);
+                r = unit_dependency_set_put(other_deps, u, other_info);
                 if (r < 0) {
                         if (u_info.data != u_info_old.data) {
                                 /* Restore the old dependency. */
                                 if (u_info_old.data)
-                                        (void) hashmap_update(u_deps, other, u_info_old.data);
+                                        (void) unit_dependency_set_put(u_deps, other, u_info_old);
                                 else
-                                        hashmap_remove(u_deps, other);
+                                        unit_dependency_set_remove(u_deps, other, /* ret= */ NULL);
                         }
                         return r;
                 }
@@ -3838,12 +4018,8 @@ static bool fragment_mtime_newer(const char *path, usec_t mtime, bool path_maske
         return false;
 }
 
-bool unit_need_daemon_reload(Unit *u) {
+static bool unit_files_newer(Unit *u) {
         assert(u);
-        assert(u->manager);
-
-        if (u->manager->unit_file_state_outdated)
-                return true;
 
         /* For unit files, we allow masking… */
         if (fragment_mtime_newer(u->fragment_path, u->fragment_mtime,
@@ -3871,6 +4047,46 @@ bool unit_need_daemon_reload(Unit *u) {
         return false;
 }
 
+bool unit_need_daemon_reload(Unit *u) {
+        assert(u);
+        assert(u->manager);
+
+        if (u->manager->unit_file_state_outdated)
+                return true;
+
+        return unit_files_newer(u);
+}
+
+bool unit_files_changed(Unit *u) {
+        const char *fragment = NULL;
+        uint64_t h;
+        int r;
+
+        assert(u);
+        assert(u->manager);
+
+        /* Like unit_need_daemon_reload(), but also notices if the unit would be loaded from a different
+         * fragment now, or if entries were added to or removed from its .wants/.requires/.upholds
+         * directories. Expects the unit name map to be up-to-date. */
+
+        r = unit_file_find_fragment(u->manager->unit_id_map, u->manager->unit_name_map, u->id, &fragment, /* ret_names= */ NULL);
+        if (r < 0 && r != -ENOENT)
+                return true;
+        if (!streq_ptr(fragment, u->fragment_path))
+                return true;
+
+        if (unit_files_newer(u))
+                return true;
+
+        if (u->load_state == UNIT_LOADED) {
+                r = unit_dependency_dropin_hash(u, &h);
+                if (r < 0 || h != u->dependency_dropin_hash)
+                        return true;
+        }
+
+        return false;
+}
+
 void unit_reset_failed(Unit *u) {
         assert(u);
 
@@ -5617,20 +5833,20 @@ int unit_fork_and_watch_rm_rf(Unit *u, char **paths, PidRef *ret_pid) {
         return 0;
 }
 
-static void unit_update_dependency_mask(Hashmap *deps, Unit *other, UnitDependencyInfo di) {
+static void unit_update_dependency_mask(UnitDependencySet *deps, Unit *other, UnitDependencyInfo di) {
         assert(deps);
         assert(other);
 
         if (di.origin_mask == 0 && di.destination_mask == 0)
                 /* No bit set anymore, let's drop the whole entry */
-                assert_se(hashmap_remove(deps, other));
+                assert_se(unit_dependency_set_remove(deps, other, /* ret= */ NULL));
         else
                 /* Mask was reduced, let's update the entry */
-                assert_se(hashmap_update(deps, other, di.data) == 0);
+                assert_se(unit_dependency_set_put(deps, other, di) == 0);
 }
 
 void unit_remove_dependencies(Unit *u, UnitDependencyMask mask) {
-        Hashmap *deps;
+        UnitDependencySet *deps;
         assert(u);
 
         /* Removes all dependencies u has on other units marked for ownership by 'mask'. */
@@ -5638,54 +5854,51 @@ void unit_remove_dependencies(Unit *u, UnitDependencyMask mask) {
         if (mask == 0)
                 return;
 
-        HASHMAP_FOREACH(deps, u->dependencies) {
-                bool done;
-
-                do {
-                        UnitDependencyInfo di;
-                        Unit *other;
+        HASHMAP_FOREACH(deps, u->dependencies)
+                for (size_t i = 0; i < deps->n_entries;) {
+                        UnitDependencyInfo di = deps->entries[i].info;
+                        Unit *other = deps->entries[i].unit;
+                        UnitDependencySet *other_deps;
 
-                        done = true;
-
-                        HASHMAP_FOREACH_KEY(di.data, other, deps) {
-                                Hashmap *other_deps;
-
-                                if (FLAGS_SET(~mask, di.origin_mask))
-                                        continue;
-
-                                di.origin_mask &= ~mask;
-                                unit_update_dependency_mask(deps, other, di);
+                        if (FLAGS_SET(~mask, di.origin_mask)) {
+                                i++;
+                                continue;
+                        }
 
-                                /* We updated the dependency from our unit to the other unit now. But most
-                                 * dependencies imply a reverse dependency. Hence, let's delete that one
-                                 * too. For that we go through all dependency types on the other unit and
-                                 * delete all those which point to us and have the right mask set. */
+                        di.origin_mask &= ~mask;
+                        unit_update_dependency_mask(deps, other, di);
 
-                                HASHMAP_FOREACH(other_deps, other->dependencies) {
-                                        UnitDependencyInfo dj;
+                        /* We updated the dependency from our unit to the other unit now. But most
+                         * dependencies imply a reverse dependency. Hence, let's delete that one too. For
+                         * that we go through all dependency types on the other unit and delete all those
+                         * which point to us and have the right mask set. */
 
-                                        dj.data = hashmap_get(other_deps, u);
-                                        if (FLAGS_SET(~mask, dj.destination_mask))
-                                                continue;
+                        HASHMAP_FOREACH(other_deps, other->dependencies) {
+                                UnitDependencyEntry *e;
+                                UnitDependencyInfo dj;
 
-                                        dj.destination_mask &= ~mask;
-                                        unit_update_dependency_mask(other_deps, u, dj);
-                                }
+                                e = unit_dependency_set_get(other_deps, u);
+                                if (!e || FLAGS_SET(~mask, e->info.destination_mask))
+                                        continue;
 
-                                unit_add_to_gc_queue(other);
+                                dj = e->info;
+                                dj.destination_mask &= ~mask;
+                                unit_update_dependency_mask(other_deps, u, dj);
+                        }
 
-                                /* The unit 'other' may not be wanted by the unit 'u'. */
-                                unit_submit_to_stop_when_unneeded_queue(other);
+                        unit_add_to_gc_queue(other);
 
-                                u->dependency_generation++;
-                                other->dependency_generation++;
+                        /* The unit 'other' may not be wanted by the unit 'u'. */
+                        unit_submit_to_stop_when_unneeded_queue(other);
 
-                                done = false;
-                                break;
-                        }
+                        u->dependency_generation++;
+                        other->dependency_generation++;
 
-                } while (!done);
-        }
+                        /* Only the entry we just looked at might have changed: if it was dropped the next
+                         * one moved into its place, otherwise let's move on. */
+                        if (i < deps->n_entries && deps->entries[i].unit == other)
+                                i++;
+                }
 }
 
 static int unit_get_invocation_path(Unit *u, char **ret) {
@@ -6608,6 +6821,8 @@ static const char* const collect_mode_table[_COLLECT_MODE_MAX] = {
 DEFINE_STRING_TABLE_LOOKUP(collect_mode, CollectMode);
 
 Unit* unit_has_dependency(const Unit *u, UnitDependencyAtom atom, Unit *other) {
+        UnitDependencySet *deps;
+        void *dt;
         Unit *i;
 
         assert(u);
@@ -6616,10 +6831,19 @@ Unit* unit_has_dependency(const Unit *u, UnitDependencyAtom atom, Unit *other) {
          * NULL checks if the unit has *any* dependency of that atom. Returns 'other' if found (or if 'other'
          * is NULL the first entry found), or NULL if not found. */
 
-        UNIT_FOREACH_DEPENDENCY(i, u, atom)
-                if (!other || other == i)
+        if (!other) {
+                UNIT_FOREACH_DEPENDENCY(i, u, atom)
                         return i;
 
+                return NULL;
+        }
+
+        /* Look up 'other' in each dependency type with a matching atom, instead of walking them all */
+        HASHMAP_FOREACH_KEY(deps, dt, u->dependencies)
+                if ((unit_dependency_to_atom(UNIT_DEPENDENCY_FROM_PTR(dt)) & atom) != 0 &&
+                    unit_dependency_set_get(deps, other))
+                        return other;
+
         return NULL;
 }
 
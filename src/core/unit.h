@@ -124,7 +124,7 @@ typedef enum UnitDependencyMask {
         _UNIT_DEPENDENCY_MASK_FULL         = (1 << 9) - 1,
 } UnitDependencyMask;
 
-/* The Unit's dependencies[] hashmaps use this structure as value. It has the same size as a void pointer, and thus can
+/* The Unit's dependency arrays and mounts_for[] hashmaps use this structure. It has the same size as a void pointer, and thus can
  * be stored directly as hashmap value, without any indirection. Note that this stores two masks, as both the origin
  * and the destination of a dependency might have created it. */
 typedef union UnitDependencyInfo {
@@ -135,6 +135,26 @@ typedef union UnitDependencyInfo {
         } _packed_;
 } UnitDependencyInfo;
 
+typedef struct UnitDependencyEntry {
+        Unit *unit;
+        UnitDependencyInfo info;
+} UnitDependencyEntry;
+
+/* The dependencies of one type of a Unit: an array sorted by the Unit* pointer, so that a lookup is a binary
+ * search, and walking the dependencies walks one contiguous block of memory. Units have many dependency
+ * types in use with only a handful of entries each, which makes this a lot more compact than a Hashmap. */
+typedef struct UnitDependencySet {
+        UnitDependencyEntry *entries;
+        size_t n_entries;
+} UnitDependencySet;
+
+static inline size_t unit_dependency_set_size(const UnitDependencySet *s) {
+        return s ? s->n_entries : 0;
+}
+
+#define UNIT_DEPENDENCY_SET_FOREACH(e, s)                               \
+        FOREACH_ARRAY(e, ((s) ? (s)->entries : NULL), unit_dependency_set_size(s))
+
 /* Store information about why a unit was activated.
  * We start with trigger units (.path/.timer), eventually it will be expanded to include more metadata. */
 typedef struct ActivationDetails {
@@ -226,6 +246,7 @@ typedef struct UnitRef {
 /* The generic, dynamic definition of the unit */
 typedef struct Unit {
         Manager *manager;
+        struct mempool *mempool; /* The pool the unit was allocated from, if any */
 
         UnitType type;
         UnitLoadState load_state;
@@ -236,9 +257,9 @@ typedef struct Unit {
 
         Set *aliases; /* All the other names. */
 
-        /* For each dependency type we can look up another Hashmap with this, whose key is a Unit* object,
-         * and whose value encodes why the dependency exists, using the UnitDependencyInfo type. i.e. a
-         * Hashmap(UnitDependency → Hashmap(Unit* → UnitDependencyInfo)) */
+        /* For each dependency type we can look up a UnitDependencySet with this, whose entries are Unit*
+         * objects together with the reason the dependency exists, using the UnitDependencyInfo type. i.e. a
+         * Hashmap(UnitDependency → UnitDependencySet(Unit* → UnitDependencyInfo)) */
         Hashmap *dependencies;
         uint64_t dependency_generation;
 
@@ -262,6 +283,7 @@ typedef struct Unit {
         usec_t fragment_mtime;
         usec_t source_mtime;
         usec_t dropin_mtime;
+        uint64_t dependency_dropin_hash; /* of the entries in .wants/, .requires/ and .upholds/ */
 
         /* If this is a transient unit we are currently writing, this is where we are writing it to */
         FILE *transient_file;
@@ -317,6 +339,18 @@ typedef struct Unit {
 
         /* D-Bus queue */
         LIST_FIELDS(Unit, dbus_queue);
+        usec_t dbus_change_signal_timestamp; /* When we last sent UnitNew or PropertiesChanged (CLOCK_MONOTONIC) */
+        unsigned dbus_deferred_queue_idx;
+
+        /* How long the unit took to activate during the previous boot, and how long it takes until the last
+         * job ordered after it is done, based on that. See critical-path.c. */
+        usec_t predicted_activation_usec;
+        usec_t critical_path_usec;
+
+        /* io.systemd.Unit.Subscribe() queue, and the state last sent to subscribers */
+        LIST_FIELDS(Unit, varlink_unit_state_queue);
+        uint64_t varlink_state_seqnum;
+        sd_json_variant *varlink_state;
 
         /* Cleanup queue */
         LIST_FIELDS(Unit, cleanup_queue);
@@ -397,6 +431,10 @@ typedef struct Unit {
         /* If the job had a specific trigger that needs to be advertised (eg: a path unit), store it. */
         ActivationDetails *activation_details;
 
+        /* The execution context serialized for sd-executor, reused until the context changes */
+        char *exec_context_serialized;
+        size_t exec_context_serialized_size;
+
         /* Tweaking the GC logic */
         CollectMode collect_mode;
 
@@ -441,6 +479,8 @@ typedef struct Unit {
         /* Booleans indicating membership of this unit in the various queues */
         bool in_load_queue:1;
         bool in_dbus_queue:1;
+        bool in_dbus_deferred_queue:1;
+        bool in_varlink_unit_state_queue:1;
         bool in_cleanup_queue:1;
         bool in_gc_queue:1;
         bool in_cgroup_realize_queue:1;
@@ -457,6 +497,10 @@ typedef struct Unit {
 
         bool job_running_timeout_set:1;
 
+        /* Boot-time scheduling, see critical-path.c */
+        bool critical_path_computed:1;
+        bool on_critical_path:1;
+
         bool in_audit:1;
         bool on_console:1;
 
@@ -802,10 +846,13 @@ Unit* unit_has_dependency(const Unit *u, UnitDependencyAtom atom, Unit *other);
 int unit_get_dependency_array(const Unit *u, UnitDependencyAtom atom, Unit ***ret_array);
 int unit_get_transitive_dependency_set(Unit *u, UnitDependencyAtom atom, Set **ret);
 
-static inline Hashmap* unit_get_dependencies(Unit *u, UnitDependency d) {
+static inline UnitDependencySet* unit_get_dependencies(Unit *u, UnitDependency d) {
         return hashmap_get(u->dependencies, UNIT_DEPENDENCY_TO_PTR(d));
 }
 
+UnitDependencyEntry* unit_dependency_set_get(const UnitDependencySet *s, const Unit *other);
+size_t unit_dependencies_allocated(const Unit *u, size_t *ret_n_entries);
+
 static inline Unit* UNIT_TRIGGER(Unit *u) {
         return unit_has_dependency(u, UNIT_ATOM_TRIGGERS, NULL);
 }
@@ -821,6 +868,8 @@ DEFINE_TRIVIAL_CLEANUP_FUNC(Unit *, unit_free);
 int unit_new_for_name(Manager *m, size_t size, const char *name, Unit **ret);
 int unit_add_name(Unit *u, const char *text);
 
+UnitDependency unit_dependency_inverse(UnitDependency d);
+
 int unit_add_dependency(Unit *u, UnitDependency d, Unit *other, bool add_reference, UnitDependencyMask mask);
 int unit_add_two_dependencies(Unit *u, UnitDependency d, UnitDependency e, Unit *other, bool add_reference, UnitDependencyMask mask);
 
@@ -921,6 +970,7 @@ void unit_catchup(Unit *u);
 void unit_status_printf(Unit *u, StatusType status_type, const char *status, const char *format, const char *ident) _printf_(4, 0);
 
 bool unit_need_daemon_reload(Unit *u);
+bool unit_files_changed(Unit *u);
 
 void unit_reset_failed(Unit *u);
 
@@ -1175,9 +1225,11 @@ typedef struct UnitForEachDependencyData {
          * specified dependency atom bits set */
         const Unit *unit;
         UnitDependencyAtom match_atom;
-        Hashmap *by_type, *by_unit;
+        Hashmap *by_type;
+        UnitDependencySet *by_unit;
         void *current_type;
-        Iterator by_type_iterator, by_unit_iterator;
+        Iterator by_type_iterator;
+        size_t by_unit_index;
         Unit **current_unit;
         uint64_t generation;
         unsigned n_restart;
@@ -1189,7 +1241,10 @@ typedef struct UnitForEachDependencyData {
 
 /* Iterates through all dependencies that have a specific atom in the dependency type set. This tries to be
  * smart: if the atom is unique, we'll directly go to right entry. Otherwise we'll iterate through the
- * per-dependency type hashmap and match all dep that have the right atom set. */
+ * per-dependency type hashmap and match all dep that have the right atom set. The dependencies of each
+ * matching type are then walked in array order. The walks and the size of the arrays they cover are counted
+ * in the Manager object once per walk and array, not per dependency, to show the cost of a walk in the
+ * dump. */
 #define _UNIT_FOREACH_DEPENDENCY(other, u, ma, restart, data)           \
         for (UnitForEachDependencyData data = {                         \
                         .unit = (u),                                    \
@@ -1207,6 +1262,7 @@ typedef struct UnitForEachDependencyData {
                              data.generation = data.unit->dependency_generation; \
                              data.by_type = data.unit->dependencies;    \
                              data.by_type_iterator = ITERATOR_FIRST;    \
+                             data.unit->manager->n_dependency_walks += data.n_restart == 0; \
                              assert_se(data.n_restart++ < MAX_FOREACH_DEPENDENCY_RESTART); \
                      } else                                             \
                              assert(data.generation == data.unit->dependency_generation); \
@@ -1227,13 +1283,14 @@ typedef struct UnitForEachDependencyData {
                                                       (const void**) &(data.current_type)); \
                      _found;                                            \
              }); )                                                      \
-                if ((unit_dependency_to_atom(UNIT_DEPENDENCY_FROM_PTR(data.current_type)) & data.match_atom) != 0) \
-                        for (data.by_unit_iterator = ITERATOR_FIRST;    \
+                if ((unit_dependency_to_atom(UNIT_DEPENDENCY_FROM_PTR(data.current_type)) & data.match_atom) != 0 && \
+                    (data.unit->manager->n_dependency_walk_entries += data.by_unit ? data.by_unit->n_entries : 0, true)) \
+                        for (data.by_unit_index = 0;                    \
                              data.generation == data.unit->dependency_generation && \
-                                hashmap_iterate(data.by_unit,           \
-                                                &data.by_unit_iterator, \
-                                                NULL,                   \
-                                                (const void**) data.current_unit); )
+                                data.by_unit &&                         \
+                                data.by_unit_index < data.by_unit->n_entries && \
+                                (*data.current_unit = data.by_unit->entries[data.by_unit_index].unit, true); \
+                             data.by_unit_index++)
 
 /* Note: this matches deps that have *any* of the atoms specified in match_atom set */
 #define UNIT_FOREACH_DEPENDENCY(other, u, match_atom) \
@@ -509,36 +509,26 @@ empty:
         return 0;
 }
 
-static int get_io_counter_build_json(sd_json_variant **ret, const char *name, void *userdata) {
-        Unit *u = ASSERT_PTR(userdata);
-        CGroupIOAccountingMetric metric;
-        uint64_t value;
+static void unit_get_io_counters(Unit *u, uint64_t ret[static _CGROUP_IO_ACCOUNTING_METRIC_MAX]) {
         int r;
 
+        assert(u);
         assert(ret);
-        assert(name);
-
-        metric = cgroup_io_accounting_metric_from_string(name);
-        assert(metric >= 0);
-
-        r = unit_get_io_accounting(u, metric, &value);
-        if (r == -ENODATA)
-                goto empty;
-        if (r < 0)
-                return log_debug_errno(r, "Failed to get value for '%s': %m", name);
-
-        if (value == UINT64_MAX)
-                goto empty;
 
-        return sd_json_variant_new_unsigned(ret, value);
+        /* All IO counters come from io.stat, hence read it once rather than once per counter */
+        r = unit_get_io_accounting_all(u, ret);
+        if (r < 0) {
+                if (r != -ENODATA)
+                        log_unit_debug_errno(u, r, "Failed to get IO accounting data: %m");
 
-empty:
-        *ret = NULL;
-        return 0;
+                for (CGroupIOAccountingMetric i = 0; i < _CGROUP_IO_ACCOUNTING_METRIC_MAX; i++)
+                        ret[i] = UINT64_MAX;
+        }
 }
 
 int unit_cgroup_runtime_build_json(sd_json_variant **ret, const char *name, void *userdata) {
         Unit *u = ASSERT_PTR(userdata);
+        uint64_t io[_CGROUP_IO_ACCOUNTING_METRIC_MAX];
 
         assert(ret);
         assert(name);
@@ -549,6 +539,8 @@ int unit_cgroup_runtime_build_json(sd_json_variant **ret, const char *name, void
                 return 0;
         }
 
+        unit_get_io_counters(u, io);
+
         return sd_json_buildo(
                         ret,
 
@@ -580,10 +572,63 @@ int unit_cgroup_runtime_build_json(sd_json_variant **ret, const char *name, void
                         JSON_BUILD_PAIR_CALLBACK_NON_NULL("IPEgressPackets", get_ip_counter_build_json, u),
 
                         /* IO */
-                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("IOReadBytes", get_io_counter_build_json, u),
-                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("IOReadOperations", get_io_counter_build_json, u),
-                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("IOWriteBytes", get_io_counter_build_json, u),
-                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("IOWriteOperations", get_io_counter_build_json, u),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("IOReadBytes", io[CGROUP_IO_READ_BYTES], UINT64_MAX),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("IOReadOperations", io[CGROUP_IO_READ_OPERATIONS], UINT64_MAX),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("IOWriteBytes", io[CGROUP_IO_WRITE_BYTES], UINT64_MAX),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("IOWriteOperations", io[CGROUP_IO_WRITE_OPERATIONS], UINT64_MAX),
+
+                        /* OOM */
+                        SD_JSON_BUILD_PAIR_UNSIGNED("OOMKills", crt->oom_kill_last),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("ManagedOOMKills", crt->managed_oom_kill_last));
+}
+
+int unit_cgroup_accounting_build_json(sd_json_variant **ret, const char *name, void *userdata) {
+        Unit *u = ASSERT_PTR(userdata);
+        uint64_t io[_CGROUP_IO_ACCOUNTING_METRIC_MAX];
+
+        assert(ret);
+        assert(name);
+
+        /* Like unit_cgroup_runtime_build_json(), but only the resource usage counters, i.e. nothing that
+         * requires walking up the slice tree or reading the cpuset configuration. */
+
+        CGroupRuntime *crt = unit_get_cgroup_runtime(u);
+        if (!crt) {
+                *ret = NULL;
+                return 0;
+        }
+
+        unit_get_io_counters(u, io);
+
+        return sd_json_buildo(
+                        ret,
+
+                        /* ID */
+                        JSON_BUILD_PAIR_UNSIGNED_NON_ZERO("ID", crt->cgroup_id),
+                        JSON_BUILD_PAIR_STRING_NON_EMPTY("Path", crt->cgroup_path ? empty_to_root(crt->cgroup_path) : NULL),
+
+                        /* Memory */
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("MemoryCurrent", memory_accounting_metric_build_json, u),
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("MemoryPeak", memory_accounting_metric_build_json, u),
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("MemorySwapCurrent", memory_accounting_metric_build_json, u),
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("MemorySwapPeak", memory_accounting_metric_build_json, u),
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("MemoryZSwapCurrent", memory_accounting_metric_build_json, u),
+
+                        /* CPU */
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("CPUUsageNSec", cpu_usage_build_json, u),
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("TasksCurrent", tasks_current_build_json, u),
+
+                        /* IP */
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("IPIngressBytes", get_ip_counter_build_json, u),
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("IPIngressPackets", get_ip_counter_build_json, u),
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("IPEgressBytes", get_ip_counter_build_json, u),
+                        JSON_BUILD_PAIR_CALLBACK_NON_NULL("IPEgressPackets", get_ip_counter_build_json, u),
+
+                        /* IO */
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("IOReadBytes", io[CGROUP_IO_READ_BYTES], UINT64_MAX),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("IOReadOperations", io[CGROUP_IO_READ_OPERATIONS], UINT64_MAX),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("IOWriteBytes", io[CGROUP_IO_WRITE_BYTES], UINT64_MAX),
+                        JSON_BUILD_PAIR_UNSIGNED_NOT_EQUAL("IOWriteOperations", io[CGROUP_IO_WRITE_OPERATIONS], UINT64_MAX),
 
                         /* OOM */
                         SD_JSON_BUILD_PAIR_UNSIGNED("OOMKills", crt->oom_kill_last),
@@ -5,3 +5,4 @@
 
 int unit_cgroup_context_build_json(sd_json_variant **ret, const char *name, void *userdata);
 int unit_cgroup_runtime_build_json(sd_json_variant **ret, const char *name, void *userdata);
+int unit_cgroup_accounting_build_json(sd_json_variant **ret, const char *name, void *userdata);
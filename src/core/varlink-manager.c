@@ -139,6 +139,28 @@ static int transactions_with_cycle_build_json(sd_json_variant **ret, const char
         return 0;
 }
 
+static int gc_pauses_build_json(sd_json_variant **ret, const char *name, void *userdata) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        Manager *m = ASSERT_PTR(userdata);
+        int r;
+
+        assert(ret);
+
+        for (size_t i = 0; i < MANAGER_GC_PAUSE_BUCKETS; i++) {
+                usec_t max = manager_gc_pause_bucket_max(i);
+
+                r = sd_json_variant_append_arraybo(
+                                &v,
+                                SD_JSON_BUILD_PAIR_CONDITION(max != USEC_INFINITY, "MaxUSec", SD_JSON_BUILD_UNSIGNED(max)),
+                                SD_JSON_BUILD_PAIR_UNSIGNED("Count", m->gc_pause_histogram[i]));
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(v);
+        return 0;
+}
+
 static int manager_runtime_build_json(sd_json_variant **ret, const char *name, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
         dual_timestamp watchdog_last_ping;
@@ -181,6 +203,16 @@ static int manager_runtime_build_json(sd_json_variant **ret, const char *name, v
                 SD_JSON_BUILD_PAIR_UNSIGNED("NJobs", hashmap_size(m->jobs)),
                 SD_JSON_BUILD_PAIR_UNSIGNED("NInstalledJobs", m->n_installed_jobs),
                 SD_JSON_BUILD_PAIR_UNSIGNED("NFailedJobs", m->n_failed_jobs),
+                SD_JSON_BUILD_PAIR_UNSIGNED("NTransactions", m->n_transactions),
+                SD_JSON_BUILD_PAIR_UNSIGNED("TransactionsUSec", m->transactions_usec),
+                SD_JSON_BUILD_PAIR_UNSIGNED("TransactionMaxUSec", m->transaction_max_usec),
+                SD_JSON_BUILD_PAIR_UNSIGNED("NGarbageCollectionRuns", m->n_gc_runs),
+                SD_JSON_BUILD_PAIR_UNSIGNED("NGarbageCollectedUnits", m->n_gc_collected_units),
+                SD_JSON_BUILD_PAIR_UNSIGNED("GarbageCollectionPauseMaxUSec", m->gc_pause_max_usec),
+                SD_JSON_BUILD_PAIR_CALLBACK("GarbageCollectionPauses", gc_pauses_build_json, m),
+                SD_JSON_BUILD_PAIR_UNSIGNED("NReapedChildren", m->n_reaped_children),
+                SD_JSON_BUILD_PAIR_UNSIGNED("ReapLatencyUSec", m->reap_latency_usec),
+                SD_JSON_BUILD_PAIR_UNSIGNED("ReapLatencyMaxUSec", m->reap_latency_max_usec),
                 JSON_BUILD_PAIR_CALLBACK_NON_NULL("TransactionsWithOrderingCycle", transactions_with_cycle_build_json, m->transactions_with_cycle),
                 SD_JSON_BUILD_PAIR_REAL("Progress", manager_get_progress(m)),
                 JSON_BUILD_PAIR_DUAL_TIMESTAMP_NON_NULL("WatchdogLastPingTimestamp", watchdog_get_last_ping_as_dual_timestamp(&watchdog_last_ping)),
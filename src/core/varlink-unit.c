@@ -1,7 +1,10 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include "sd-id128.h"
 #include "sd-json.h"
+#include "sd-varlink.h"
 
+#include "alloc-util.h"
 #include "bitfield.h"
 #include "cgroup.h"
 #include "condition.h"
@@ -37,10 +40,8 @@ static int unit_dependencies_build_json(sd_json_variant **ret, const char *name,
         if (d < 0)
                 return log_debug_errno(d, "Failed to get unit dependency for '%s': %m", name);
 
-        void *value;
-        Unit *other;
-        HASHMAP_FOREACH_KEY(value, other, unit_get_dependencies(u, d)) {
-                r = sd_json_variant_append_arrayb(&v, SD_JSON_BUILD_STRING(other->id));
+        UNIT_DEPENDENCY_SET_FOREACH(e, unit_get_dependencies(u, d)) {
+                r = sd_json_variant_append_arrayb(&v, SD_JSON_BUILD_STRING(e->unit->id));
                 if (r < 0)
                         return r;
         }
@@ -511,3 +512,498 @@ int vl_method_list_units(sd_varlink *link, sd_json_variant *parameters, sd_varli
 
         return sd_varlink_error(link, "io.systemd.Manager.NoSuchUnit", NULL);
 }
+
+static int list_unit_accounting_one(sd_varlink *link, Unit *unit, bool more) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(link);
+        assert(unit);
+
+        r = sd_json_buildo(
+                &v,
+                SD_JSON_BUILD_PAIR_STRING("name", unit->id),
+                SD_JSON_BUILD_PAIR_CALLBACK("CGroup", unit_cgroup_accounting_build_json, unit));
+        if (r < 0)
+                return r;
+
+        if (more)
+                return sd_varlink_notify(link, v);
+
+        return sd_varlink_reply(link, v);
+}
+
+int vl_method_list_unit_accounting(sd_varlink *link, sd_json_variant *parameters, sd_varlink_method_flags_t flags, void *userdata) {
+        Manager *manager = ASSERT_PTR(userdata);
+        Unit *unit, *previous = NULL;
+        const char *k;
+        int r;
+
+        assert(link);
+        assert(parameters);
+
+        /* Returns the resource usage counters of all units with a cgroup, for monitoring software that
+         * would otherwise have to query the full properties of each unit individually. */
+
+        r = sd_varlink_dispatch(link, parameters, /* dispatch_table= */ NULL, /* userdata= */ NULL);
+        if (r != 0)
+                return r;
+
+        if (!FLAGS_SET(flags, SD_VARLINK_METHOD_MORE))
+                return sd_varlink_error(link, SD_VARLINK_ERROR_EXPECTED_MORE, NULL);
+
+        HASHMAP_FOREACH_KEY(unit, k, manager->units) {
+                /* ignore aliases */
+                if (k != unit->id)
+                        continue;
+
+                if (!unit_get_cgroup_runtime(unit))
+                        continue;
+
+                if (previous) {
+                        r = list_unit_accounting_one(link, previous, /* more= */ true);
+                        if (r < 0)
+                                return r;
+                }
+
+                previous = unit;
+        }
+
+        if (previous)
+                return list_unit_accounting_one(link, previous, /* more= */ false);
+
+        return sd_varlink_error(link, "io.systemd.Manager.NoSuchUnit", NULL);
+}
+
+/* io.systemd.Unit.Subscribe(): a compact summary of each unit's state is streamed to subscribers. They first
+ * get a snapshot of all units, and from then on only the fields that changed, batched up once per event loop
+ * iteration. */
+
+#define UNIT_STATE_TOMBSTONES_MAX 4096U
+
+static int unit_state_build_json(Unit *u, sd_json_variant **ret) {
+        assert(u);
+        assert(ret);
+
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_STRING("LoadState", unit_load_state_to_string(u->load_state)),
+                        SD_JSON_BUILD_PAIR_STRING("ActiveState", unit_active_state_to_string(unit_active_state(u))),
+                        SD_JSON_BUILD_PAIR_STRING("FreezerState", freezer_state_to_string(u->freezer_state)),
+                        SD_JSON_BUILD_PAIR_STRING("SubState", unit_sub_state_to_string(u)),
+                        JSON_BUILD_PAIR_UNSIGNED_NON_ZERO("JobId", u->job ? u->job->id : 0),
+                        SD_JSON_BUILD_PAIR_CONDITION(!sd_id128_is_null(u->invocation_id), "InvocationID", SD_JSON_BUILD_UUID(u->invocation_id)),
+                        JSON_BUILD_PAIR_DUAL_TIMESTAMP_NON_NULL("StateChangeTimestamp", &u->state_change_timestamp));
+}
+
+static int unit_state_change_build_json(Unit *u, sd_json_variant *old, sd_json_variant *new, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *changed = NULL;
+        _cleanup_strv_free_ char **cleared = NULL;
+        sd_json_variant *e;
+        const char *k;
+        int r;
+
+        assert(u);
+        assert(new);
+        assert(ret);
+
+        /* Builds an entry with the fields of 'new' that differ from 'old', and the names of the fields that
+         * are gone. If 'old' is NULL that's all fields. Returns 0 and NULL if nothing changed. */
+
+        JSON_VARIANT_OBJECT_FOREACH(k, e, new) {
+                if (old && sd_json_variant_equal(sd_json_variant_by_key(old, k), e))
+                        continue;
+
+                r = sd_json_variant_set_field(&changed, k, e);
+                if (r < 0)
+                        return r;
+        }
+
+        if (old)
+                JSON_VARIANT_OBJECT_FOREACH(k, e, old) {
+                        if (sd_json_variant_by_key(new, k))
+                                continue;
+
+                        r = strv_extend(&cleared, k);
+                        if (r < 0)
+                                return r;
+                }
+
+        if (!changed && strv_isempty(cleared)) {
+                *ret = NULL;
+                return 0;
+        }
+
+        r = sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_STRING("name", u->id),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("seqnum", u->varlink_state_seqnum),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!changed, "state", SD_JSON_BUILD_VARIANT(changed)),
+                        SD_JSON_BUILD_PAIR_CONDITION(!strv_isempty(cleared), "cleared", SD_JSON_BUILD_STRV(cleared)));
+        if (r < 0)
+                return r;
+
+        return 1;
+}
+
+static void unit_state_queue_remove(Unit *u) {
+        assert(u);
+
+        if (!u->in_varlink_unit_state_queue)
+                return;
+
+        LIST_REMOVE(varlink_unit_state_queue, u->manager->varlink_unit_state_queue, u);
+        u->in_varlink_unit_state_queue = false;
+}
+
+static void unit_state_forget(Manager *m) {
+        Unit *u;
+
+        assert(m);
+
+        /* Nobody follows along anymore, the recorded state will be outdated soon */
+
+        while ((u = m->varlink_unit_state_queue))
+                unit_state_queue_remove(u);
+
+        HASHMAP_FOREACH(u, m->units)
+                u->varlink_state = sd_json_variant_unref(u->varlink_state);
+
+        m->unit_state_removed = strv_free(m->unit_state_removed);
+}
+
+static void unit_state_subscribers_close(Manager *m) {
+        sd_varlink *link;
+
+        assert(m);
+
+        while ((link = set_steal_first(m->unit_state_subscribers)))
+                sd_varlink_close_unref(link);
+
+        m->unit_state_subscribers = set_free(m->unit_state_subscribers);
+
+        unit_state_forget(m);
+}
+
+static void unit_state_tombstones_free(Manager *m) {
+        assert(m);
+
+        FOREACH_ARRAY(t, m->unit_state_tombstones, m->n_unit_state_tombstones)
+                free(t->id);
+
+        m->unit_state_tombstones = mfree(m->unit_state_tombstones);
+        m->n_unit_state_tombstones = 0;
+}
+
+void manager_varlink_unit_state_changed(Unit *u) {
+        Manager *m;
+
+        assert(u);
+
+        m = u->manager;
+
+        u->varlink_state_seqnum = ++m->unit_state_seqnum;
+
+        /* Shortcut things if nobody cares, the sequence number is enough for resuming */
+        if (u->in_varlink_unit_state_queue || set_isempty(m->unit_state_subscribers))
+                return;
+
+        LIST_PREPEND(varlink_unit_state_queue, m->varlink_unit_state_queue, u);
+        u->in_varlink_unit_state_queue = true;
+}
+
+static void unit_state_tombstones_trim(Manager *m) {
+        size_t n;
+
+        assert(m);
+
+        if (m->n_unit_state_tombstones < UNIT_STATE_TOMBSTONES_MAX)
+                return;
+
+        /* Forget the older half at once, so that we don't have to move the array around for every removed
+         * unit. Clients that want to resume from before that get a full snapshot. */
+        n = m->n_unit_state_tombstones / 2;
+        m->unit_state_horizon = m->unit_state_tombstones[n - 1].seqnum;
+
+        FOREACH_ARRAY(t, m->unit_state_tombstones, n)
+                free(t->id);
+
+        memmove(m->unit_state_tombstones, m->unit_state_tombstones + n, (m->n_unit_state_tombstones - n) * sizeof(UnitStateTombstone));
+        m->n_unit_state_tombstones -= n;
+}
+
+void manager_varlink_unit_state_removed(Unit *u) {
+        _cleanup_free_ char *id = NULL;
+        Manager *m;
+
+        assert(u);
+
+        m = u->manager;
+
+        unit_state_queue_remove(u);
+        u->varlink_state = sd_json_variant_unref(u->varlink_state);
+
+        /* During reload all units go away and most come back, subscribers get a new snapshot afterwards */
+        if (!u->id || u->load_state == UNIT_STUB || MANAGER_IS_RELOADING(m))
+                return;
+
+        id = strdup(u->id);
+        if (!id || !GREEDY_REALLOC(m->unit_state_tombstones, m->n_unit_state_tombstones + 1)) {
+                /* We can't tell about this unit when resuming, hence make sure nobody resumes from before */
+                log_oom_debug();
+                m->unit_state_horizon = ++m->unit_state_seqnum;
+                return;
+        }
+
+        m->unit_state_tombstones[m->n_unit_state_tombstones++] = (UnitStateTombstone) {
+                .id = TAKE_PTR(id),
+                .seqnum = ++m->unit_state_seqnum,
+        };
+
+        unit_state_tombstones_trim(m);
+
+        if (!set_isempty(m->unit_state_subscribers) && strv_extend(&m->unit_state_removed, u->id) < 0) {
+                /* The subscribers would never hear about this unit going away, let them resume instead */
+                log_oom_debug();
+                unit_state_subscribers_close(m);
+        }
+}
+
+static int unit_state_snapshot_build_json(Manager *m, bool reset, uint64_t since, sd_json_variant **ret) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *units = NULL, *removed = NULL;
+        const char *k;
+        Unit *u;
+        int r;
+
+        assert(m);
+        assert(ret);
+
+        /* Builds the initial message for a subscriber: the state of all units if 'reset' is true, otherwise
+         * the state of all units that changed and the names of all units that went away after 'since'. The
+         * state sent is recorded, so that later updates only need to carry the changes. */
+
+        HASHMAP_FOREACH_KEY(u, k, m->units) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *state = NULL, *e = NULL;
+
+                /* ignore aliases */
+                if (k != u->id)
+                        continue;
+
+                if (u->load_state == UNIT_STUB)
+                        continue;
+
+                if (!reset && u->varlink_state_seqnum <= since)
+                        continue;
+
+                r = unit_state_build_json(u, &state);
+                if (r < 0)
+                        return r;
+
+                r = unit_state_change_build_json(u, /* old= */ NULL, state, &e);
+                if (r < 0)
+                        return r;
+
+                r = sd_json_variant_append_array(&units, e);
+                if (r < 0)
+                        return r;
+
+                sd_json_variant_unref(u->varlink_state);
+                u->varlink_state = TAKE_PTR(state);
+        }
+
+        if (!reset)
+                FOREACH_ARRAY(t, m->unit_state_tombstones, m->n_unit_state_tombstones) {
+                        if (t->seqnum <= since)
+                                continue;
+
+                        r = sd_json_variant_append_arrayb(&removed, SD_JSON_BUILD_STRING(t->id));
+                        if (r < 0)
+                                return r;
+                }
+
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_ID128("streamID", m->unit_state_stream_id),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("seqnum", m->unit_state_seqnum),
+                        SD_JSON_BUILD_PAIR_BOOLEAN("reset", reset),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!units, "units", SD_JSON_BUILD_VARIANT(units)),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!removed, "removed", SD_JSON_BUILD_VARIANT(removed)));
+}
+
+static void unit_state_subscribers_notify(Manager *m, sd_json_variant *v) {
+        sd_varlink *link;
+        int r;
+
+        assert(m);
+        assert(v);
+
+        SET_FOREACH(link, m->unit_state_subscribers) {
+                r = sd_varlink_notify(link, v);
+                if (r < 0) {
+                        /* Most likely the client doesn't keep up. Kick it out rather than letting it miss
+                         * updates, it can resume after reconnecting. This removes the link from the set via
+                         * the disconnect handler, which is fine while iterating. */
+                        log_debug_errno(r, "Failed to send unit state changes to subscriber, disconnecting: %m");
+                        (void) sd_varlink_close(link);
+                }
+        }
+}
+
+unsigned manager_varlink_dispatch_unit_state_queue(Manager *m) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *units = NULL, *v = NULL;
+        _cleanup_strv_free_ char **removed = NULL;
+        unsigned n = 0;
+        Unit *u;
+        int r;
+
+        assert(m);
+
+        if (!m->varlink_unit_state_queue && strv_isempty(m->unit_state_removed))
+                return 0;
+
+        removed = TAKE_PTR(m->unit_state_removed);
+
+        while ((u = m->varlink_unit_state_queue)) {
+                _cleanup_(sd_json_variant_unrefp) sd_json_variant *state = NULL, *e = NULL;
+
+                unit_state_queue_remove(u);
+
+                r = unit_state_build_json(u, &state);
+                if (r >= 0)
+                        r = unit_state_change_build_json(u, u->varlink_state, state, &e);
+                if (r >= 0 && e)
+                        r = sd_json_variant_append_array(&units, e);
+                if (r < 0) {
+                        log_unit_debug_errno(u, r, "Failed to build unit state change, ignoring: %m");
+                        continue;
+                }
+
+                sd_json_variant_unref(u->varlink_state);
+                u->varlink_state = TAKE_PTR(state);
+
+                if (e)
+                        n++;
+        }
+
+        n += strv_length(removed);
+        if (n == 0)
+                return 0;
+
+        r = sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_ID128("streamID", m->unit_state_stream_id),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("seqnum", m->unit_state_seqnum),
+                        SD_JSON_BUILD_PAIR_CONDITION(!!units, "units", SD_JSON_BUILD_VARIANT(units)),
+                        SD_JSON_BUILD_PAIR_CONDITION(!strv_isempty(removed), "removed", SD_JSON_BUILD_STRV(removed)));
+        if (r < 0) {
+                log_debug_errno(r, "Failed to build unit state changes, sending full snapshot instead: %m");
+                manager_varlink_unit_state_reset(m);
+                return n;
+        }
+
+        unit_state_subscribers_notify(m, v);
+        return n;
+}
+
+void manager_varlink_unit_state_reset(Manager *m) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        int r;
+
+        assert(m);
+
+        /* Starts a new stream, i.e. after reloading, when units might have come and gone without us keeping
+         * track. Subscribers get a full snapshot, and nobody can resume from before. */
+
+        unit_state_tombstones_free(m);
+        m->unit_state_stream_id = SD_ID128_NULL;
+
+        unit_state_forget(m);
+
+        if (set_isempty(m->unit_state_subscribers))
+                return;
+
+        r = sd_id128_randomize(&m->unit_state_stream_id);
+        if (r >= 0)
+                r = unit_state_snapshot_build_json(m, /* reset= */ true, /* since= */ 0, &v);
+        if (r < 0) {
+                log_warning_errno(r, "Failed to build unit state snapshot, disconnecting subscribers: %m");
+                unit_state_subscribers_close(m);
+                return;
+        }
+
+        unit_state_subscribers_notify(m, v);
+}
+
+void manager_varlink_unit_state_subscriber_gone(Manager *m, sd_varlink *link) {
+        assert(m);
+        assert(link);
+
+        if (!set_remove(m->unit_state_subscribers, link))
+                return;
+
+        sd_varlink_unref(link);
+
+        if (set_isempty(m->unit_state_subscribers))
+                unit_state_forget(m);
+}
+
+void manager_varlink_unit_state_done(Manager *m) {
+        assert(m);
+
+        unit_state_subscribers_close(m);
+        unit_state_tombstones_free(m);
+}
+
+typedef struct SubscribeParameters {
+        sd_id128_t stream_id;
+        uint64_t since;
+} SubscribeParameters;
+
+int vl_method_subscribe_units(sd_varlink *link, sd_json_variant *parameters, sd_varlink_method_flags_t flags, void *userdata) {
+        static const sd_json_dispatch_field dispatch_table[] = {
+                { "streamID", SD_JSON_VARIANT_STRING,        sd_json_dispatch_id128,  offsetof(SubscribeParameters, stream_id), 0 },
+                { "since",    _SD_JSON_VARIANT_TYPE_INVALID, sd_json_dispatch_uint64, offsetof(SubscribeParameters, since),     0 },
+                {}
+        };
+
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+        Manager *m = ASSERT_PTR(userdata);
+        SubscribeParameters p = {};
+        bool reset;
+        int r;
+
+        assert(link);
+        assert(parameters);
+
+        r = sd_varlink_dispatch(link, parameters, dispatch_table, &p);
+        if (r != 0)
+                return r;
+
+        if (!FLAGS_SET(flags, SD_VARLINK_METHOD_MORE))
+                return sd_varlink_error(link, SD_VARLINK_ERROR_EXPECTED_MORE, NULL);
+
+        if (sd_id128_is_null(m->unit_state_stream_id)) {
+                r = sd_id128_randomize(&m->unit_state_stream_id);
+                if (r < 0)
+                        return r;
+        }
+
+        /* Bring the existing subscribers up to date first, so that the recorded state is current */
+        (void) manager_varlink_dispatch_unit_state_queue(m);
+
+        reset = !sd_id128_equal(p.stream_id, m->unit_state_stream_id) ||
+                p.since < m->unit_state_horizon ||
+                p.since > m->unit_state_seqnum;
+
+        r = unit_state_snapshot_build_json(m, reset, p.since, &v);
+        if (r < 0)
+                return r;
+
+        r = set_ensure_put(&m->unit_state_subscribers, /* hash_ops= */ NULL, link);
+        if (r < 0)
+                return r;
+
+        sd_varlink_ref(link);
+
+        return sd_varlink_notify(link, v);
+}
@@ -7,3 +7,12 @@
 
 int varlink_error_no_such_unit(sd_varlink *v, const char *name);
 int vl_method_list_units(sd_varlink *link, sd_json_variant *parameters, sd_varlink_method_flags_t flags, void *userdata);
+int vl_method_list_unit_accounting(sd_varlink *link, sd_json_variant *parameters, sd_varlink_method_flags_t flags, void *userdata);
+int vl_method_subscribe_units(sd_varlink *link, sd_json_variant *parameters, sd_varlink_method_flags_t flags, void *userdata);
+
+void manager_varlink_unit_state_changed(Unit *u);
+void manager_varlink_unit_state_removed(Unit *u);
+unsigned manager_varlink_dispatch_unit_state_queue(Manager *m);
+void manager_varlink_unit_state_reset(Manager *m);
+void manager_varlink_unit_state_subscriber_gone(Manager *m, sd_varlink *link);
+void manager_varlink_unit_state_done(Manager *m);
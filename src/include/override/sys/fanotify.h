@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include_next <sys/fanotify.h>  /* IWYU pragma: export */
+
+#include <assert.h>
+
+/* Mount notifications, since kernel v6.15 */
+
+#ifndef FAN_MNT_ATTACH
+#  define FAN_MNT_ATTACH 0x01000000
+#else
+static_assert(FAN_MNT_ATTACH == 0x01000000, "");
+#endif
+
+#ifndef FAN_MNT_DETACH
+#  define FAN_MNT_DETACH 0x02000000
+#else
+static_assert(FAN_MNT_DETACH == 0x02000000, "");
+#endif
+
+#ifndef FAN_REPORT_MNT
+#  define FAN_REPORT_MNT 0x00004000
+#else
+static_assert(FAN_REPORT_MNT == 0x00004000, "");
+#endif
+
+#ifndef FAN_MARK_MNTNS
+#  define FAN_MARK_MNTNS 0x00000110
+#else
+static_assert(FAN_MARK_MNTNS == 0x00000110, "");
+#endif
+
+/* The info record carrying the mount ID is a struct fanotify_event_info_header followed by the 64-bit
+ * unique mount ID (struct fanotify_event_info_mnt in the kernel headers). */
+#ifndef FAN_EVENT_INFO_TYPE_MNT
+#  define FAN_EVENT_INFO_TYPE_MNT 6
+#else
+static_assert(FAN_EVENT_INFO_TYPE_MNT == 6, "");
+#endif
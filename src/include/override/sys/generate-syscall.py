@@ -8,12 +8,14 @@ import functools
 SYSCALLS = [
     'close_range',   # defined in glibc header since glibc-2.33
     'fchmodat2',     # defined in glibc header since glibc-2.39
+    'listmount',
     'mount_setattr', # defined in glibc header since glibc-2.34
     'open_tree_attr',
     'openat2',       # defined in glibc header since glibc-2.32
     'quotactl_fd',   # defined in glibc header since glibc-2.35
     'removexattrat',
     'setxattrat',
+    'statmount',
 ]
 
 def dictify(f):
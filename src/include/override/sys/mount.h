@@ -7,6 +7,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <sys/ioctl.h>
+#include <sys/types.h>
 
 /* Since glibc-2.37 (774058d72942249f71d74e7f2b639f77184160a6), sys/mount.h includes linux/mount.h, and
  * we can safely include both headers in the same source file. However, we cannot do that with older glibc.
@@ -112,3 +113,22 @@ extern int open_tree_attr(int __dfd, const char *__filename, unsigned int __flag
 int missing_open_tree_attr(int dfd, const char *filename, unsigned int flags, struct mount_attr *attr, size_t size);
 #  define open_tree_attr missing_open_tree_attr
 #endif
+
+/* Not defined in glibc yet as of glibc-2.41.
+ * Supported since kernel v6.8. */
+#if HAVE_STATMOUNT
+extern int statmount(const struct mnt_id_req *__req, struct statmount *__buf, size_t __bufsize, unsigned int __flags);
+#else
+int missing_statmount(const struct mnt_id_req *req, struct statmount *buf, size_t bufsize, unsigned int flags);
+/* Function-like, since 'struct statmount' must not be renamed */
+#  define statmount(req, buf, bufsize, flags) missing_statmount(req, buf, bufsize, flags)
+#endif
+
+/* Not defined in glibc yet as of glibc-2.41.
+ * Supported since kernel v6.8. */
+#if HAVE_LISTMOUNT
+extern ssize_t listmount(const struct mnt_id_req *__req, uint64_t *__mnt_ids, size_t __nr_mnt_ids, unsigned int __flags);
+#else
+ssize_t missing_listmount(const struct mnt_id_req *req, uint64_t *mnt_ids, size_t nr_mnt_ids, unsigned int flags);
+#  define listmount missing_listmount
+#endif
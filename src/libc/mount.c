@@ -45,3 +45,15 @@ int missing_open_tree_attr(int dfd, const char *filename, unsigned int flags, st
         return syscall(__NR_open_tree_attr, dfd, filename, flags, attr, size);
 }
 #endif
+
+#if !HAVE_STATMOUNT
+int missing_statmount(const struct mnt_id_req *req, struct statmount *buf, size_t bufsize, unsigned int flags) {
+        return syscall(__NR_statmount, req, buf, bufsize, flags);
+}
+#endif
+
+#if !HAVE_LISTMOUNT
+ssize_t missing_listmount(const struct mnt_id_req *req, uint64_t *mnt_ids, size_t nr_mnt_ids, unsigned int flags) {
+        return syscall(__NR_listmount, req, mnt_ids, nr_mnt_ids, flags);
+}
+#endif
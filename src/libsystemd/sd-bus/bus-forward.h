@@ -22,6 +22,7 @@ typedef struct BusNodeCallback BusNodeCallback;
 typedef struct BusNodeEnumerator BusNodeEnumerator;
 typedef struct BusNodeObjectManager BusNodeObjectManager;
 typedef struct BusNodeVTable BusNodeVTable;
+typedef struct BusPropertyCache BusPropertyCache;
 typedef struct BusVTableMember BusVTableMember;
 
 typedef struct BusReplyCallback BusReplyCallback;
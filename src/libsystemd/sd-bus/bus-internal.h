@@ -84,6 +84,19 @@ typedef struct BusNodeVTable {
         LIST_FIELDS(BusNodeVTable, vtables);
 } BusNodeVTable;
 
+typedef struct BusPropertyCache {
+        /* Identifies the object and interface the cached properties belong to */
+        BusNodeVTable *vtable;
+        void *userdata;
+
+        LIST_FIELDS(BusPropertyCache, entries);
+
+        /* The marshalled "{sv}" dictionary entries of all constant properties, starting at an 8-byte
+         * aligned offset */
+        size_t size;
+        uint8_t data[];
+} BusPropertyCache;
+
 typedef struct BusVTableMember {
         const char *path;
         const char *interface;
@@ -210,6 +223,16 @@ typedef struct sd_bus {
         uint64_t cookie;
         uint64_t read_counter; /* A counter for each incoming msg */
 
+        /* Counters for message objects and body parts, split by whether they had to be allocated from the
+         * heap or could be recycled from the message memory pools */
+        uint64_t n_message_allocs;
+        uint64_t n_message_allocs_pooled;
+
+        /* Counters for write syscalls and for messages written completely, the ratio tells us how well
+         * queued messages are coalesced into gathered writes */
+        uint64_t n_write_calls;
+        uint64_t n_written_messages;
+
         char *unique_name;
         uint64_t unique_id;
 
@@ -222,6 +245,12 @@ typedef struct sd_bus {
         Set *vtable_methods;
         Set *vtable_properties;
 
+        /* Object path → list of BusPropertyCache, see bus_set_property_cache() */
+        bool property_cache;
+        Hashmap *property_cache_entries;
+        size_t n_property_cache_entries;
+        char **property_cache_exclude;
+
         union sockaddr_union sockaddr;
         socklen_t sockaddr_size;
 
@@ -316,6 +345,10 @@ typedef struct sd_bus {
 #define BUS_AUTH_TIMEOUT ((usec_t) DEFAULT_TIMEOUT_USEC)
 
 #define BUS_WQUEUE_MAX (384*1024)
+
+/* Upper bounds for the number of queued messages and iovecs we gather into a single write */
+#define BUS_WRITE_MESSAGES_MAX 64U
+#define BUS_WRITE_IOVEC_MAX 256U
 #define BUS_RQUEUE_MAX (384*1024)
 
 #define BUS_MESSAGE_SIZE_MAX (128*1024*1024)
@@ -334,6 +367,9 @@ typedef struct sd_bus {
 
 #define BUS_EXEC_ARGV_MAX 256
 
+/* Upper bound for the number of objects we cache constant property values for */
+#define BUS_PROPERTY_CACHE_MAX 16384U
+
 bool interface_name_is_valid(const char *p) _pure_;
 bool service_name_is_valid(const char *p) _pure_;
 bool member_name_is_valid(const char *p) _pure_;
@@ -12,6 +12,8 @@
 #include "log.h"
 #include "memfd-util.h"
 #include "memory-util.h"
+#include "mempool.h"
+#include "process-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "utf8.h"
@@ -19,6 +21,72 @@
 static int message_append_basic(sd_bus_message *m, char type, const void *p, const void **stored);
 static int message_parse_fields(sd_bus_message *m);
 
+/* A message object with its inline header as well as any additional body part are fixed size. When running
+ * in the main thread of a process that enabled mempools (i.e. PID 1 and friends) we hence recycle both
+ * through tile pools, so that the common call/reply/signal paths don't hit malloc()/free() each time. */
+typedef struct BusMessageTile {
+        sd_bus_message message;
+        BusMessageHeader header;
+} BusMessageTile;
+
+assert_cc(offsetof(BusMessageTile, header) == CONST_ALIGN_TO(sizeof(sd_bus_message), sizeof(void*)));
+
+DEFINE_MEMPOOL(message_pool, BusMessageTile, 64);
+DEFINE_MEMPOOL(body_part_pool, BusMessageBodyPart, 64);
+
+static bool message_use_pool(void) {
+        /* The pools are process-wide and unsynchronized, hence only use them from the main thread, like
+         * the hashmap implementation does. Bus connections might be used from other threads too. */
+        return mempool_enabled && mempool_enabled() &&  /* mempool_enabled is a weak symbol */
+                is_main_thread();
+}
+
+static void message_count_alloc(sd_bus *bus, bool pooled) {
+        if (!bus)
+                return;
+
+        if (pooled)
+                bus->n_message_allocs_pooled++;
+        else
+                bus->n_message_allocs++;
+}
+
+static sd_bus_message* message_alloc0(sd_bus *bus, size_t size) {
+        sd_bus_message *m;
+
+        assert(size >= ALIGN(sizeof(sd_bus_message)));
+
+        if (size <= sizeof(BusMessageTile) && message_use_pool()) {
+                m = mempool_alloc0_tile(&message_pool);
+                if (!m)
+                        return NULL;
+
+                m->from_pool = true;
+        } else {
+                m = malloc0(size);
+                if (!m)
+                        return NULL;
+        }
+
+        message_count_alloc(bus, m->from_pool);
+        return m;
+}
+
+static sd_bus_message* message_release(sd_bus_message *m) {
+        if (!m)
+                return NULL;
+
+        if (m->from_pool) {
+                /* Ensure that the object didn't get migrated between threads. */
+                assert_se(is_main_thread());
+                return mempool_free_tile(&message_pool, m);
+        }
+
+        return mfree(m);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(sd_bus_message*, message_release);
+
 static void* adjust_pointer(const void *p, void *old_base, size_t sz, void *new_base) {
 
         if (!p)
@@ -59,7 +127,14 @@ static void message_free_part(sd_bus_message *m, BusMessageBodyPart *part) {
                         free(part->data);
         }
 
-        if (part != &m->body)
+        if (part == &m->body)
+                return;
+
+        if (part->from_pool) {
+                /* Ensure that the object didn't get migrated between threads. */
+                assert_se(is_main_thread());
+                mempool_free_tile(&body_part_pool, part);
+        } else
                 free(part);
 }
 
@@ -139,7 +214,7 @@ static sd_bus_message* message_free(sd_bus_message *m) {
         message_free_last_container(m);
 
         bus_creds_done(&m->creds);
-        return mfree(m);
+        return message_release(m);
 }
 
 static void* message_extend_fields(sd_bus_message *m, size_t sz, bool add_offset) {
@@ -334,7 +409,7 @@ static int message_from_header(
                 const char *label,
                 sd_bus_message **ret) {
 
-        _cleanup_free_ sd_bus_message *m = NULL;
+        _cleanup_(message_releasep) sd_bus_message *m = NULL;
         BusMessageHeader *h;
         size_t a, label_sz = 0; /* avoid false maybe-uninitialized warning */
 
@@ -365,7 +440,7 @@ static int message_from_header(
                 a += label_sz + 1;
         }
 
-        m = malloc0(a);
+        m = message_alloc0(bus, a);
         if (!m)
                 return -ENOMEM;
 
@@ -461,7 +536,7 @@ _public_ int sd_bus_message_new(
         /* Creation of messages with _SD_BUS_MESSAGE_TYPE_INVALID is allowed. */
         assert_return(type < _SD_BUS_MESSAGE_TYPE_MAX, -EINVAL);
 
-        sd_bus_message *t = malloc0(ALIGN(sizeof(sd_bus_message)) + sizeof(BusMessageHeader));
+        sd_bus_message *t = message_alloc0(bus, ALIGN(sizeof(sd_bus_message)) + sizeof(BusMessageHeader));
         if (!t)
                 return -ENOMEM;
 
@@ -1097,12 +1172,17 @@ static BusMessageBodyPart* message_append_part(sd_bus_message *m) {
         } else {
                 assert(m->body_end);
 
-                part = new0(BusMessageBodyPart, 1);
+                bool pooled = message_use_pool();
+
+                part = pooled ? mempool_alloc0_tile(&body_part_pool) : new0(BusMessageBodyPart, 1);
                 if (!part) {
                         m->poisoned = true;
                         return NULL;
                 }
 
+                part->from_pool = pooled;
+                message_count_alloc(m->bus, pooled);
+
                 m->body_end->next = part;
         }
 
@@ -2083,6 +2163,58 @@ _public_ int sd_bus_message_append(sd_bus_message *m, const char *types, ...) {
         return r;
 }
 
+int bus_message_append_raw(sd_bus_message *m, size_t align, const void *p, size_t sz) {
+        void *a;
+
+        assert(m);
+        assert(p || sz == 0);
+
+        /* Appends already marshalled data to the body of the message, at the current position and aligned
+         * as specified. The caller is responsible for the data matching the signature of the enclosing
+         * container and having been marshalled at an offset with the same alignment. */
+
+        if (m->sealed)
+                return -EPERM;
+        if (m->poisoned)
+                return -ESTALE;
+
+        if (sz == 0)
+                return 0;
+
+        a = message_extend_body(m, align, sz);
+        if (!a)
+                return -ENOMEM;
+
+        memcpy(a, p, sz);
+        return 0;
+}
+
+int bus_message_get_body_range(sd_bus_message *m, size_t begin, size_t end, const void **ret) {
+        BusMessageBodyPart *part;
+        size_t offset = 0;
+        unsigned i;
+
+        assert(m);
+        assert(begin <= end);
+        assert(ret);
+
+        /* Returns a pointer to the specified range of the body, if it is stored contiguously in memory */
+
+        MESSAGE_FOREACH_PART(part, i, m) {
+                if (begin >= offset && end <= offset + part->size) {
+                        if (!part->data || part->is_zero || part->memfd >= 0)
+                                return -EOPNOTSUPP;
+
+                        *ret = (const uint8_t*) part->data + begin - offset;
+                        return 0;
+                }
+
+                offset += part->size;
+        }
+
+        return -EOPNOTSUPP;
+}
+
 _public_ int sd_bus_message_append_array_space(
                 sd_bus_message *m,
                 char type,
@@ -2685,11 +2817,12 @@ static bool validate_nul(const char *s, size_t l) {
 
 static bool validate_string(const char *s, size_t l) {
 
-        if (!validate_nul(s, l))
+        /* Check for NUL termination */
+        if (s[l] != 0)
                 return false;
 
-        /* Check if valid UTF8 */
-        if (!utf8_is_valid(s))
+        /* Check if valid UTF8, this also refuses embedded NUL chars */
+        if (!utf8_is_valid_n(s, l))
                 return false;
 
         return true;
@@ -2700,6 +2833,10 @@ static bool validate_signature(const char *s, size_t l) {
         if (!validate_nul(s, l))
                 return false;
 
+        /* Variants mostly carry a single basic type, which is trivially valid */
+        if (l == 1 && bus_type_is_basic(s[0]))
+                return true;
+
         /* Check if valid signature */
         if (!signature_is_valid(s, true))
                 return false;
@@ -2707,6 +2844,25 @@ static bool validate_signature(const char *s, size_t l) {
         return true;
 }
 
+static bool message_rindex_validated(sd_bus_message *m, size_t rindex) {
+        assert(m);
+
+        /* Returns true if the data up to the specified read index has already been validated by an
+         * earlier walk through the message, for example before the message was rewound. */
+        return rindex <= m->validated_rindex;
+}
+
+static void message_set_rindex(sd_bus_message *m, size_t rindex) {
+        assert(m);
+
+        /* Extend the validated range only if the data we skip over is adjacent to it, so that it always
+         * covers one contiguous walk from the beginning of the body. */
+        if (m->rindex <= m->validated_rindex && rindex > m->validated_rindex)
+                m->validated_rindex = rindex;
+
+        m->rindex = rindex;
+}
+
 static bool validate_object_path(const char *s, size_t l) {
 
         if (!validate_nul(s, l))
@@ -2757,7 +2913,9 @@ _public_ int sd_bus_message_read_basic(sd_bus_message *m, char type, void *ret)
                 if (r < 0)
                         return r;
 
-                if (type == SD_BUS_TYPE_OBJECT_PATH)
+                if (message_rindex_validated(m, rindex))
+                        ok = true;
+                else if (type == SD_BUS_TYPE_OBJECT_PATH)
                         ok = validate_object_path(q, l);
                 else
                         ok = validate_string(q, l);
@@ -2783,7 +2941,7 @@ _public_ int sd_bus_message_read_basic(sd_bus_message *m, char type, void *ret)
                 if (r < 0)
                         return r;
 
-                if (!validate_signature(q, l))
+                if (!message_rindex_validated(m, rindex) && !validate_signature(q, l))
                         return -EBADMSG;
 
                 if (ret)
@@ -2850,7 +3008,7 @@ _public_ int sd_bus_message_read_basic(sd_bus_message *m, char type, void *ret)
                 }
         }
 
-        m->rindex = rindex;
+        message_set_rindex(m, rindex);
 
         if (c->enclosing != SD_BUS_TYPE_ARRAY)
                 c->index++;
@@ -2904,7 +3062,7 @@ static int bus_message_enter_array(
 
         *ret_array_size = (uint32_t*) q;
 
-        m->rindex = rindex;
+        message_set_rindex(m, rindex);
 
         if (c->enclosing != SD_BUS_TYPE_ARRAY)
                 c->index += 1 + strlen(contents);
@@ -2953,13 +3111,13 @@ static int bus_message_enter_variant(
         if (r < 0)
                 return r;
 
-        if (!validate_signature(q, l))
+        if (!message_rindex_validated(m, rindex) && !validate_signature(q, l))
                 return -EBADMSG;
 
         if (!streq(q, contents))
                 return -ENXIO;
 
-        m->rindex = rindex;
+        message_set_rindex(m, rindex);
 
         if (c->enclosing != SD_BUS_TYPE_ARRAY)
                 c->index++;
@@ -2972,7 +3130,7 @@ static int bus_message_enter_struct(
                 BusMessageContainer *c,
                 const char *contents) {
 
-        size_t l;
+        size_t l, rindex;
         int r;
 
         assert(m);
@@ -2992,10 +3150,13 @@ static int bus_message_enter_struct(
             c->signature[c->index + 1 + l] != SD_BUS_TYPE_STRUCT_END)
                 return -ENXIO;
 
-        r = message_peek_body(m, &m->rindex, 8, 0, NULL);
+        rindex = m->rindex;
+        r = message_peek_body(m, &rindex, 8, 0, NULL);
         if (r < 0)
                 return r;
 
+        message_set_rindex(m, rindex);
+
         if (c->enclosing != SD_BUS_TYPE_ARRAY)
                 c->index += 1 + l + 1;
 
@@ -3007,7 +3168,7 @@ static int bus_message_enter_dict_entry(
                 BusMessageContainer *c,
                 const char *contents) {
 
-        size_t l;
+        size_t l, rindex;
         int r;
 
         assert(m);
@@ -3030,10 +3191,13 @@ static int bus_message_enter_dict_entry(
             c->signature[c->index + 1 + l] != SD_BUS_TYPE_DICT_ENTRY_END)
                 return -ENXIO;
 
-        r = message_peek_body(m, &m->rindex, 8, 0, NULL);
+        rindex = m->rindex;
+        r = message_peek_body(m, &rindex, 8, 0, NULL);
         if (r < 0)
                 return r;
 
+        message_set_rindex(m, rindex);
+
         if (c->enclosing != SD_BUS_TYPE_ARRAY)
                 c->index += 1 + l + 1;
 
@@ -3736,9 +3900,13 @@ _public_ int sd_bus_message_read_array(
                  * pointer that is not NULL */
                 p = (uint8_t*) align;
         else {
-                r = message_peek_body(m, &m->rindex, align, sz, &p);
+                size_t rindex = m->rindex;
+
+                r = message_peek_body(m, &rindex, align, sz, &p);
                 if (r < 0)
                         goto fail;
+
+                message_set_rindex(m, rindex);
         }
 
         r = sd_bus_message_exit_container(m);
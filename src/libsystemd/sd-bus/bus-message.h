@@ -51,6 +51,7 @@ typedef struct BusMessageBodyPart {
         bool munmap_this:1;
         bool sealed:1;
         bool is_zero:1;
+        bool from_pool:1;
 } BusMessageBodyPart;
 
 typedef struct sd_bus_message {
@@ -91,6 +92,7 @@ typedef struct sd_bus_message {
         bool free_fds:1;
         bool poisoned:1;
         bool sensitive:1;
+        bool from_pool:1;
 
         /* The first bytes of the message */
         BusMessageHeader *header;
@@ -104,6 +106,7 @@ typedef struct sd_bus_message {
         unsigned n_body_parts;
 
         size_t rindex;
+        size_t validated_rindex; /* body data before this index has already been validated */
         BusMessageBodyPart *cached_rindex_part;
         size_t cached_rindex_part_begin;
 
@@ -180,6 +183,9 @@ int bus_message_from_malloc(
                 const char *label,
                 sd_bus_message **ret);
 
+int bus_message_append_raw(sd_bus_message *m, size_t align, const void *p, size_t sz);
+int bus_message_get_body_range(sd_bus_message *m, size_t begin, size_t end, const void **ret);
+
 int bus_message_get_arg(sd_bus_message *m, unsigned i, const char **str);
 int bus_message_get_arg_strv(sd_bus_message *m, unsigned i, char ***strv);
 
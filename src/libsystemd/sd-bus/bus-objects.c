@@ -12,6 +12,9 @@
 #include "bus-signature.h"
 #include "bus-slot.h"
 #include "bus-type.h"
+#include "hashmap.h"
+#include "list.h"
+#include "log.h"
 #include "ordered-set.h"
 #include "set.h"
 #include "string-util.h"
@@ -748,7 +751,169 @@ static int vtable_append_one_property(
         return 0;
 }
 
-static int vtable_append_all_properties(
+static bool vtable_property_is_dumped(sd_bus_message *reply, const sd_bus_vtable *v) {
+        assert(reply);
+        assert(v);
+
+        if (!IN_SET(v->type, _SD_BUS_VTABLE_PROPERTY, _SD_BUS_VTABLE_WRITABLE_PROPERTY))
+                return false;
+
+        if (v->flags & SD_BUS_VTABLE_HIDDEN)
+                return false;
+
+        /* Let's not include properties marked as "explicit" in any message that contains a generic
+         * dump of properties, but only in those generated as a response to an explicit request. */
+        if (v->flags & SD_BUS_VTABLE_PROPERTY_EXPLICIT)
+                return false;
+
+        /* Let's not include properties marked only for invalidation on change (i.e. in contrast to
+         * those whose new values are included in PropertiesChanges message) in any signals. This is
+         * useful to ensure they aren't included in InterfacesAdded messages. */
+        if (reply->header->type != SD_BUS_MESSAGE_METHOD_RETURN &&
+            FLAGS_SET(v->flags, SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION))
+                return false;
+
+        return true;
+}
+
+static bool vtable_property_is_cacheable(const sd_bus_vtable *v) {
+        assert(v);
+
+        /* Values of constant properties can be cached in marshalled form, unless they contain fds, which
+         * are stored out of band and are referenced by index. */
+        return FLAGS_SET(v->flags, SD_BUS_VTABLE_PROPERTY_CONST) &&
+                !strchr(v->x.property.signature, SD_BUS_TYPE_UNIX_FD);
+}
+
+static void property_cache_free_list(BusPropertyCache *head) {
+        LIST_CLEAR(entries, head, free);
+}
+
+DEFINE_PRIVATE_HASH_OPS_FULL(property_cache_hash_ops,
+                             char, string_hash_func, string_compare_func, free,
+                             BusPropertyCache, property_cache_free_list);
+
+static BusPropertyCache* property_cache_find(sd_bus *bus, const char *path, BusNodeVTable *c, void *userdata) {
+        assert(bus);
+        assert(path);
+        assert(c);
+
+        BusPropertyCache *head = hashmap_get(bus->property_cache_entries, path);
+        LIST_FOREACH(entries, i, head)
+                if (i->vtable == c && i->userdata == userdata)
+                        return i;
+
+        return NULL;
+}
+
+static int property_cache_add(
+                sd_bus *bus,
+                const char *path,
+                BusNodeVTable *c,
+                void *userdata,
+                const void *data,
+                size_t size) {
+
+        _cleanup_free_ BusPropertyCache *e = NULL;
+        BusPropertyCache *head;
+        int r;
+
+        assert(bus);
+        assert(path);
+        assert(c);
+        assert(data || size == 0);
+
+        /* Put a bound on the memory we use for this, by starting over if there are too many entries */
+        if (bus->n_property_cache_entries >= BUS_PROPERTY_CACHE_MAX)
+                bus_property_cache_invalidate(bus, NULL);
+
+        e = malloc(offsetof(BusPropertyCache, data) + size);
+        if (!e)
+                return -ENOMEM;
+
+        *e = (BusPropertyCache) {
+                .vtable = c,
+                .userdata = userdata,
+                .size = size,
+        };
+        memcpy_safe(e->data, data, size);
+
+        head = hashmap_get(bus->property_cache_entries, path);
+        if (head)
+                LIST_APPEND(entries, head, e);
+        else {
+                _cleanup_free_ char *p = strdup(path);
+                if (!p)
+                        return -ENOMEM;
+
+                r = hashmap_ensure_put(&bus->property_cache_entries, &property_cache_hash_ops, p, e);
+                if (r < 0)
+                        return r;
+
+                TAKE_PTR(p);
+        }
+
+        TAKE_PTR(e);
+        bus->n_property_cache_entries++;
+        return 0;
+}
+
+int bus_set_property_cache(sd_bus *bus, bool b) {
+        assert(bus);
+
+        /* Enables caching of the marshalled values of all constant properties of an object in replies to
+         * GetAll(), so that their getters don't have to be invoked each time. Entries are invalidated
+         * whenever PropertiesChanged, InterfacesRemoved or ObjectRemoved are emitted for an object path.
+         * Callers that remove objects without emitting either of those, and might register a new object
+         * under the same path and with the same userdata pointer later, need to call
+         * bus_property_cache_invalidate() themselves. */
+
+        if (!b)
+                bus_property_cache_invalidate(bus, NULL);
+
+        bus->property_cache = b;
+        return 0;
+}
+
+void bus_property_cache_invalidate(sd_bus *bus, const char *path) {
+        BusPropertyCache *head;
+
+        assert(bus);
+
+        if (!path) {
+                bus->property_cache_entries = hashmap_free(bus->property_cache_entries);
+                bus->n_property_cache_entries = 0;
+                return;
+        }
+
+        head = hashmap_remove(bus->property_cache_entries, path);
+        LIST_FOREACH(entries, i, head) {
+                assert(bus->n_property_cache_entries > 0);
+                bus->n_property_cache_entries--;
+        }
+
+        property_cache_free_list(head);
+}
+
+bool bus_property_cache_isempty(sd_bus *bus) {
+        assert(bus);
+
+        return bus->n_property_cache_entries == 0;
+}
+
+int bus_property_cache_exclude(sd_bus *bus, const char *path) {
+        assert(bus);
+        assert(path);
+
+        /* Never caches properties for the specified object path. Use this for paths that resolve to
+         * different objects depending on the caller, and hence cannot be invalidated reliably. */
+
+        bus_property_cache_invalidate(bus, path);
+
+        return strv_extend(&bus->property_cache_exclude, path);
+}
+
+static int vtable_append_cached_properties(
                 sd_bus *bus,
                 sd_bus_message *reply,
                 const char *path,
@@ -757,6 +922,9 @@ static int vtable_append_all_properties(
                 sd_bus_error *reterr_error) {
 
         const sd_bus_vtable *v;
+        BusPropertyCache *e;
+        const void *data = NULL;
+        size_t begin, end;
         int r;
 
         assert(bus);
@@ -764,27 +932,83 @@ static int vtable_append_all_properties(
         assert(path);
         assert(c);
 
-        if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
-                return 1;
+        e = property_cache_find(bus, path, c, userdata);
+        if (e)
+                /* Dictionary entries are 8-byte aligned, hence the cached data can be copied verbatim */
+                return bus_message_append_raw(reply, 8, e->data, e->size);
+
+        begin = reply->body_size;
 
         v = c->vtable;
         for (v = bus_vtable_next(c->vtable, v); v->type != _SD_BUS_VTABLE_END; v = bus_vtable_next(c->vtable, v)) {
-                if (!IN_SET(v->type, _SD_BUS_VTABLE_PROPERTY, _SD_BUS_VTABLE_WRITABLE_PROPERTY))
+                if (!vtable_property_is_dumped(reply, v))
                         continue;
 
-                if (v->flags & SD_BUS_VTABLE_HIDDEN)
+                if (!vtable_property_is_cacheable(v))
                         continue;
 
-                /* Let's not include properties marked as "explicit" in any message that contains a generic
-                 * dump of properties, but only in those generated as a response to an explicit request. */
-                if (v->flags & SD_BUS_VTABLE_PROPERTY_EXPLICIT)
+                r = vtable_append_one_property(bus, reply, path, c, v, userdata, reterr_error);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        return 0;
+        }
+
+        end = reply->body_size;
+        begin = end > begin ? ALIGN8(begin) : end;
+
+        if (end > begin) {
+                r = bus_message_get_body_range(reply, begin, end, &data);
+                if (r < 0)
+                        return 0; /* Not stored contiguously, don't cache */
+        }
+
+        r = property_cache_add(bus, path, c, userdata, data, end - begin);
+        if (r < 0)
+                log_debug_errno(r, "Failed to cache constant properties of %s, ignoring: %m", path);
+
+        return 0;
+}
+
+static int vtable_append_all_properties(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *path,
+                BusNodeVTable *c,
+                void *userdata,
+                sd_bus_error *reterr_error) {
+
+        const sd_bus_vtable *v;
+        bool use_cache;
+        int r;
+
+        assert(bus);
+        assert(reply);
+        assert(path);
+        assert(c);
+
+        if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
+                return 1;
+
+        /* Only replies to GetAll() are served from the cache, signals are always generated from scratch */
+        use_cache = bus->property_cache &&
+                reply->header->type == SD_BUS_MESSAGE_METHOD_RETURN &&
+                !FLAGS_SET(c->vtable->flags, SD_BUS_VTABLE_SENSITIVE) &&
+                !strv_contains(bus->property_cache_exclude, path);
+        if (use_cache) {
+                r = vtable_append_cached_properties(bus, reply, path, c, userdata, reterr_error);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        return 0;
+        }
+
+        v = c->vtable;
+        for (v = bus_vtable_next(c->vtable, v); v->type != _SD_BUS_VTABLE_END; v = bus_vtable_next(c->vtable, v)) {
+                if (!vtable_property_is_dumped(reply, v))
                         continue;
 
-                /* Let's not include properties marked only for invalidation on change (i.e. in contrast to
-                 * those whose new values are included in PropertiesChanges message) in any signals. This is
-                 * useful to ensure they aren't included in InterfacesAdded messages. */
-                if (reply->header->type != SD_BUS_MESSAGE_METHOD_RETURN &&
-                    FLAGS_SET(v->flags, SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION))
+                if (use_cache && vtable_property_is_cacheable(v))
                         continue;
 
                 r = vtable_append_one_property(bus, reply, path, c, v, userdata, reterr_error);
@@ -2287,6 +2511,8 @@ _public_ int sd_bus_emit_properties_changed_strv(
         assert_return(interface_name_is_valid(interface), -EINVAL);
         assert_return(!bus_origin_changed(bus), -ECHILD);
 
+        bus_property_cache_invalidate(bus, path);
+
         if (!BUS_IS_OPEN(bus->state))
                 return -ENOTCONN;
 
@@ -2717,6 +2943,8 @@ _public_ int sd_bus_emit_object_removed(sd_bus *bus, const char *path) {
         assert_return(object_path_is_valid(path), -EINVAL);
         assert_return(!bus_origin_changed(bus), -ECHILD);
 
+        bus_property_cache_invalidate(bus, path);
+
         if (!BUS_IS_OPEN(bus->state))
                 return -ENOTCONN;
 
@@ -2971,6 +3199,8 @@ _public_ int sd_bus_emit_interfaces_removed_strv(sd_bus *bus, const char *path,
         assert_return(object_path_is_valid(path), -EINVAL);
         assert_return(!bus_origin_changed(bus), -ECHILD);
 
+        bus_property_cache_invalidate(bus, path);
+
         if (!BUS_IS_OPEN(bus->state))
                 return -ENOTCONN;
 
@@ -8,6 +8,11 @@ bool bus_vtable_has_names(const sd_bus_vtable *vtable);
 int bus_process_object(sd_bus *bus, sd_bus_message *m);
 void bus_node_gc(sd_bus *b, BusNode *n);
 
+int bus_set_property_cache(sd_bus *bus, bool b);
+void bus_property_cache_invalidate(sd_bus *bus, const char *path);
+bool bus_property_cache_isempty(sd_bus *bus);
+int bus_property_cache_exclude(sd_bus *bus, const char *path);
+
 int introspect_path(
                 sd_bus *bus,
                 const char *path,
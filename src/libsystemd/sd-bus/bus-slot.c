@@ -152,6 +152,9 @@ void bus_slot_disconnect(sd_bus_slot *slot, bool unref) {
                         }
                 }
 
+                /* Cache entries are keyed by the vtable object, which is about to go away */
+                bus_property_cache_invalidate(slot->bus, NULL);
+
                 slot->node_vtable.interface = mfree(slot->node_vtable.interface);
 
                 if (slot->node_vtable.node) {
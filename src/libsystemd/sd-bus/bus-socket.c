@@ -1221,38 +1221,63 @@ int bus_socket_take_fd(sd_bus *b) {
         return bus_socket_start_auth(b);
 }
 
-int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
+int bus_socket_write_messages(sd_bus *bus, sd_bus_message * const *messages, size_t n_messages, size_t *idx) {
         struct iovec *iov;
+        sd_bus_message *m;
+        size_t n_iovec = 0, n_batch = 0;
         ssize_t k;
-        size_t n;
         unsigned j;
         int r;
 
         assert(bus);
-        assert(m);
+        assert(messages);
+        assert(n_messages > 0);
         assert(idx);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
+        m = messages[0];
+
         if (*idx >= BUS_MESSAGE_SIZE(m))
                 return 0;
 
-        r = bus_message_setup_iovec(m);
-        if (r < 0)
-                return r;
+        /* Gather as many of the queued messages as we can into a single write. Messages that carry fds
+         * end the batch (unless they come first), since the fds are attached to the first byte written. */
+        for (size_t i = 0; i < MIN(n_messages, (size_t) BUS_WRITE_MESSAGES_MAX); i++) {
+                sd_bus_message *q = messages[i];
+
+                if (i > 0 && q->n_fds > 0)
+                        break;
+
+                r = bus_message_setup_iovec(q);
+                if (r < 0) {
+                        if (i == 0)
+                                return r;
+                        break;
+                }
+
+                if (i > 0 && n_iovec + q->n_iovec > BUS_WRITE_IOVEC_MAX)
+                        break;
 
-        n = m->n_iovec * sizeof(struct iovec);
-        iov = newa(struct iovec, n);
-        memcpy_safe(iov, m->iovec, n);
+                n_iovec += q->n_iovec;
+                n_batch++;
+        }
+
+        iov = newa(struct iovec, n_iovec);
+        n_iovec = 0;
+        for (size_t i = 0; i < n_batch; i++) {
+                memcpy_safe(iov + n_iovec, messages[i]->iovec, messages[i]->n_iovec * sizeof(struct iovec));
+                n_iovec += messages[i]->n_iovec;
+        }
 
         j = 0;
         iovec_advance(iov, &j, *idx);
 
         if (bus->prefer_writev)
-                k = writev(bus->output_fd, iov, m->n_iovec);
+                k = writev(bus->output_fd, iov + j, n_iovec - j);
         else {
                 struct msghdr mh = {
-                        .msg_iov = iov,
-                        .msg_iovlen = m->n_iovec,
+                        .msg_iov = iov + j,
+                        .msg_iovlen = n_iovec - j,
                 };
 
                 if (m->n_fds > 0 && *idx == 0) {
@@ -1270,10 +1295,12 @@ int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
                 k = sendmsg(bus->output_fd, &mh, MSG_DONTWAIT|MSG_NOSIGNAL);
                 if (k < 0 && errno == ENOTSOCK) {
                         bus->prefer_writev = true;
-                        k = writev(bus->output_fd, iov, m->n_iovec);
+                        k = writev(bus->output_fd, iov + j, n_iovec - j);
                 }
         }
 
+        bus->n_write_calls++;
+
         if (k < 0)
                 return ERRNO_IS_TRANSIENT(errno) ? 0 : -errno;
 
@@ -1281,6 +1308,10 @@ int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         return 1;
 }
 
+int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
+        return bus_socket_write_messages(bus, &m, 1, idx);
+}
+
 static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
         uint32_t a, b;
         uint8_t e;
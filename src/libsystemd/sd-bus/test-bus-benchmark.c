@@ -73,6 +73,18 @@ static void transaction(sd_bus *b, size_t sz, const char *server_name) {
         assert_se(sd_bus_call(b, m, 0, NULL, &reply) >= 0);
 }
 
+static void print_allocs(sd_bus *b, uint64_t allocs, uint64_t allocs_pooled, unsigned n) {
+        assert(b);
+
+        /* Report how many message objects and body parts one round-trip needed on the client side, and how
+         * many of them were served from the message memory pools instead of the heap. Run with
+         * $SYSTEMD_MEMPOOL=0 to compare against the non-pooled allocation path. */
+        n = MAX(n, 1u);
+        printf("%.2f\t%.2f",
+               (double) (b->n_message_allocs - allocs) / n,
+               (double) (b->n_message_allocs_pooled - allocs_pooled) / n);
+}
+
 static void client_bisect(const char *address, const char *server_name) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *x = NULL;
         size_t lsize, rsize, csize;
@@ -94,11 +106,12 @@ static void client_bisect(const char *address, const char *server_name) {
         lsize = 1;
         rsize = MAX_SIZE;
 
-        printf("SIZE\tCOPY\tMEMFD\n");
+        printf("SIZE\tCOPY\tMEMFD\tMALLOC/RT\tPOOL/RT\n");
 
         for (;;) {
                 usec_t t;
                 unsigned n_copying, n_memfd;
+                uint64_t allocs, allocs_pooled;
 
                 csize = (lsize + rsize) / 2;
 
@@ -112,6 +125,9 @@ static void client_bisect(const char *address, const char *server_name) {
 
                 b->use_memfd = 0;
 
+                allocs = b->n_message_allocs;
+                allocs_pooled = b->n_message_allocs_pooled;
+
                 t = now(CLOCK_MONOTONIC);
                 for (n_copying = 0;; n_copying++) {
                         transaction(b, csize, server_name);
@@ -128,7 +144,10 @@ static void client_bisect(const char *address, const char *server_name) {
                         if (now(CLOCK_MONOTONIC) >= t + arg_loop_usec)
                                 break;
                 }
-                printf("%u\n", (unsigned) ((n_memfd * USEC_PER_SEC) / arg_loop_usec));
+                printf("%u\t", (unsigned) ((n_memfd * USEC_PER_SEC) / arg_loop_usec));
+
+                print_allocs(b, allocs, allocs_pooled, n_copying + n_memfd + 2);
+                putchar('\n');
 
                 if (n_copying == n_memfd)
                         break;
@@ -175,16 +194,17 @@ static void client_chart(Type type, const char *address, const char *server_name
 
         switch (type) {
         case TYPE_LEGACY:
-                printf("SIZE\tLEGACY\n");
+                printf("SIZE\tLEGACY\tMALLOC/RT\tPOOL/RT\n");
                 break;
         case TYPE_DIRECT:
-                printf("SIZE\tDIRECT\n");
+                printf("SIZE\tDIRECT\tMALLOC/RT\tPOOL/RT\n");
                 break;
         }
 
         for (csize = 1; csize <= MAX_SIZE; csize *= 2) {
                 usec_t t;
                 unsigned n_memfd;
+                uint64_t allocs = b->n_message_allocs, allocs_pooled = b->n_message_allocs_pooled;
 
                 printf("%zu\t", csize);
 
@@ -195,7 +215,10 @@ static void client_chart(Type type, const char *address, const char *server_name
                                 break;
                 }
 
-                printf("%u\n", (unsigned) ((n_memfd * USEC_PER_SEC) / arg_loop_usec));
+                printf("%u\t", (unsigned) ((n_memfd * USEC_PER_SEC) / arg_loop_usec));
+
+                print_allocs(b, allocs, allocs_pooled, n_memfd + 1);
+                putchar('\n');
         }
 
         b->use_memfd = 1;
@@ -7,10 +7,17 @@
 #include "alloc-util.h"
 #include "bus-internal.h"
 #include "bus-message.h"
+#include "bus-objects.h"
 #include "log.h"
 #include "strv.h"
 #include "tests.h"
 
+/* Counts invocations of the getter of the constant Value3 property, to check the property cache */
+static unsigned n_value3_get = 0;
+/* Part of the constant Value3 property, but changed behind the cache's back, like e.g. PID 1's
+ * FinishTimestamp */
+static uint64_t value3_timestamp = 0;
+
 struct context {
         int fds[2];
         bool quit;
@@ -84,7 +91,11 @@ static int value_handler(sd_bus *bus, const char *path, const char *interface, c
         _cleanup_free_ char *s = NULL;
         const char *x;
 
-        ASSERT_OK(asprintf(&s, "object %p, path %s", userdata, path));
+        if (streq(property, "Value3")) {
+                n_value3_get++;
+                ASSERT_OK(asprintf(&s, "object %p, path %s, timestamp %" PRIu64, userdata, path, value3_timestamp));
+        } else
+                ASSERT_OK(asprintf(&s, "object %p, path %s", userdata, path));
         ASSERT_OK(sd_bus_message_append(reply, "s", s));
 
         ASSERT_NOT_NULL(x = startswith(path, "/value/"));
@@ -220,6 +231,8 @@ static void* server(void *p) {
         ASSERT_OK(sd_bus_new(&bus));
         ASSERT_OK(sd_bus_set_fd(bus, c->fds[0], c->fds[0]));
         ASSERT_OK(sd_bus_set_server(bus, 1, id));
+        ASSERT_OK(bus_set_property_cache(bus, true));
+        ASSERT_OK(bus_property_cache_exclude(bus, "/value/b"));
 
         ASSERT_OK(sd_bus_add_object_vtable(bus, NULL, "/foo", "org.freedesktop.systemd.test", vtable, c));
         ASSERT_OK(sd_bus_add_object_vtable(bus, NULL, "/foo", "org.freedesktop.systemd.test2", vtable, c));
@@ -265,6 +278,36 @@ fail:
         return INT_TO_PTR(r);
 }
 
+static void get_all_value3(sd_bus *bus, const char *path, char **ret) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_free_ char *value3 = NULL;
+        unsigned n = 0;
+
+        ASSERT_OK(sd_bus_call_method(bus, "org.freedesktop.systemd.test", path, "org.freedesktop.DBus.Properties", "GetAll", NULL, &reply, "s", "org.freedesktop.systemd.ValueTest"));
+
+        ASSERT_OK_POSITIVE(sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "{sv}"));
+        while (ASSERT_OK(sd_bus_message_enter_container(reply, SD_BUS_TYPE_DICT_ENTRY, "sv")) > 0) {
+                const char *name, *value;
+
+                ASSERT_OK_POSITIVE(sd_bus_message_read(reply, "s", &name));
+                ASSERT_OK_POSITIVE(sd_bus_message_read(reply, "v", "s", &value));
+                ASSERT_TRUE(STR_IN_SET(name, "Value", "Value2", "Value3", "Value4"));
+                ASSERT_NOT_NULL(startswith(value, "object "));
+
+                if (streq(name, "Value3"))
+                        ASSERT_NOT_NULL(value3 = strdup(value));
+
+                ASSERT_OK(sd_bus_message_exit_container(reply));
+                n++;
+        }
+        ASSERT_OK(sd_bus_message_exit_container(reply));
+
+        ASSERT_EQ(n, 4U);
+        ASSERT_NOT_NULL(value3);
+
+        *ret = TAKE_PTR(value3);
+}
+
 static int client(struct context *c) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_(sd_bus_unrefp) sd_bus *bus = NULL;
@@ -456,6 +499,32 @@ static int client(struct context *c) {
 
         reply = sd_bus_message_unref(reply);
 
+        /* The constant Value3 property is served from the property cache on the second GetAll() */
+        _cleanup_free_ char *value3_a = NULL, *value3_b = NULL, *value3_c = NULL;
+        unsigned n_value3_get_saved;
+
+        get_all_value3(bus, "/value/a", &value3_a);
+        n_value3_get_saved = n_value3_get;
+        get_all_value3(bus, "/value/a", &value3_b);
+        ASSERT_STREQ(value3_a, value3_b);
+        ASSERT_EQ(n_value3_get, n_value3_get_saved);
+
+        /* Excluded paths are never served from the cache, hence changes of constant properties there are
+         * seen right away, while the cached path still returns the old value */
+        _cleanup_free_ char *value3_excluded = NULL, *value3_excluded_changed = NULL, *value3_d = NULL;
+
+        get_all_value3(bus, "/value/b", &value3_excluded);
+        value3_timestamp = 4711;
+        get_all_value3(bus, "/value/b", &value3_excluded_changed);
+        ASSERT_EQ(n_value3_get, n_value3_get_saved + 2);
+        ASSERT_NOT_NULL(endswith(value3_excluded, "timestamp 0"));
+        ASSERT_NOT_NULL(endswith(value3_excluded_changed, "timestamp 4711"));
+
+        get_all_value3(bus, "/value/a", &value3_d);
+        ASSERT_STREQ(value3_a, value3_d);
+        ASSERT_EQ(n_value3_get, n_value3_get_saved + 2);
+        n_value3_get_saved = n_value3_get;
+
         ASSERT_OK(sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/value/a", "org.freedesktop.systemd.ValueTest", "NotifyTest", &error, NULL, NULL));
 
         ASSERT_OK_POSITIVE(r = sd_bus_process(bus, &reply));
@@ -465,6 +534,11 @@ static int client(struct context *c) {
 
         reply = sd_bus_message_unref(reply);
 
+        /* Emitting PropertiesChanged invalidated the cache */
+        get_all_value3(bus, "/value/a", &value3_c);
+        ASSERT_NOT_NULL(endswith(value3_c, "timestamp 4711"));
+        ASSERT_EQ(n_value3_get, n_value3_get_saved + 1);
+
         ASSERT_OK(sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/value/a", "org.freedesktop.systemd.ValueTest", "NotifyTest2", &error, NULL, NULL));
 
         ASSERT_OK_POSITIVE(r = sd_bus_process(bus, &reply));
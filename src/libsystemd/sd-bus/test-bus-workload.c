@@ -0,0 +1,529 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+/* Benchmarks sd-bus with the kind of load PID 1 sees on its API bus: GetAll() on many unit objects, signal
+ * dispatch with many installed matches and ListUnitsByPatterns() over a large number of units. Latency
+ * percentiles and per-call message allocation counts are written as JSON to stdout, so that results can
+ * be compared across builds.
+ *
+ * Usage: test-bus-workload [N_OBJECTS [N_MATCHES [N_UNITS]]]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/socket.h>
+
+#include "sd-bus.h"
+#include "sd-json.h"
+
+#include "alloc-util.h"
+#include "bus-internal.h"
+#include "bus-objects.h"
+#include "fd-util.h"
+#include "hash-funcs.h"
+#include "log.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "sort-util.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "time-util.h"
+
+#define UNIT_PREFIX "/org/freedesktop/systemd1/unit"
+#define UNIT_INTERFACE "org.freedesktop.systemd1.Unit"
+#define MANAGER_PATH "/org/freedesktop/systemd1"
+#define MANAGER_INTERFACE "org.freedesktop.systemd1.Manager"
+
+#define N_LIST_CALLS 50U
+
+static unsigned arg_n_objects = 1000;
+static unsigned arg_n_matches = 1000;
+static unsigned arg_n_units = 10000;
+
+typedef struct Server {
+        unsigned n_units;
+        bool quit;
+} Server;
+
+typedef struct Stats {
+        nsec_t *nsec;
+        size_t n;
+        uint64_t n_message_allocs;
+        uint64_t n_message_allocs_pooled;
+} Stats;
+
+static void stats_done(Stats *s) {
+        assert(s);
+
+        s->nsec = mfree(s->nsec);
+}
+
+static void stats_begin(Stats *s, sd_bus *bus, size_t n) {
+        assert(s);
+        assert(bus);
+
+        *s = (Stats) {
+                .nsec = new(nsec_t, n),
+                .n_message_allocs = bus->n_message_allocs,
+                .n_message_allocs_pooled = bus->n_message_allocs_pooled,
+        };
+        assert_se(s->nsec);
+}
+
+static void stats_end(Stats *s, sd_bus *bus) {
+        assert(s);
+        assert(bus);
+
+        s->n_message_allocs = bus->n_message_allocs - s->n_message_allocs;
+        s->n_message_allocs_pooled = bus->n_message_allocs_pooled - s->n_message_allocs_pooled;
+}
+
+static nsec_t stats_percentile(const Stats *s, unsigned p) {
+        assert(s);
+        assert(s->n > 0);
+        assert(p <= 100);
+
+        /* Expects the samples to be sorted already */
+        return s->nsec[(s->n - 1) * p / 100];
+}
+
+static int stats_to_json(Stats *s, sd_json_variant **ret) {
+        nsec_t sum = 0;
+
+        assert(s);
+        assert(s->n > 0);
+        assert(ret);
+
+        typesafe_qsort(s->nsec, s->n, uint64_compare_func);
+
+        FOREACH_ARRAY(i, s->nsec, s->n)
+                sum += *i;
+
+        return sd_json_buildo(
+                        ret,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("calls", s->n),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("minNSec", s->nsec[0]),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("meanNSec", sum / s->n),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("p50NSec", stats_percentile(s, 50)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("p90NSec", stats_percentile(s, 90)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("p99NSec", stats_percentile(s, 99)),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("maxNSec", s->nsec[s->n - 1]),
+                        SD_JSON_BUILD_PAIR_REAL("messageAllocsPerCall", (double) s->n_message_allocs / s->n),
+                        SD_JSON_BUILD_PAIR_REAL("messageAllocsPooledPerCall", (double) s->n_message_allocs_pooled / s->n));
+}
+
+static void unit_fields(
+                unsigned i,
+                char *id, size_t id_size,
+                char *path, size_t path_size,
+                const char **active_state,
+                const char **sub_state) {
+
+        assert(id);
+        assert(path);
+
+        assert_se(snprintf_ok(id, id_size, "bench-%u.service", i));
+        assert_se(snprintf_ok(path, path_size, UNIT_PREFIX "/unit_%u", i));
+
+        if (active_state)
+                *active_state = i % 7 == 0 ? "failed" : i % 3 == 0 ? "inactive" : "active";
+        if (sub_state)
+                *sub_state = i % 7 == 0 ? "failed" : i % 3 == 0 ? "dead" : "running";
+}
+
+#define UNIT_ID_MAX (STRLEN("bench-.service") + DECIMAL_STR_MAX(unsigned))
+#define UNIT_PATH_MAX (STRLEN(UNIT_PREFIX "/unit_") + DECIMAL_STR_MAX(unsigned))
+
+static int unit_find(sd_bus *bus, const char *path, const char *interface, void *userdata, void **ret, sd_bus_error *error) {
+        Server *s = ASSERT_PTR(userdata);
+        const char *e;
+        unsigned i;
+
+        e = startswith(path, UNIT_PREFIX "/unit_");
+        if (!e || safe_atou(e, &i) < 0 || i >= s->n_units)
+                return 0;
+
+        *ret = UINT_TO_PTR(i + 1);
+        return 1;
+}
+
+static int property_get_id(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        char id[UNIT_ID_MAX], p[UNIT_PATH_MAX];
+
+        unit_fields(PTR_TO_UINT(userdata) - 1, id, sizeof(id), p, sizeof(p), NULL, NULL);
+
+        if (streq(property, "Names"))
+                return sd_bus_message_append(reply, "as", 1, id);
+
+        return sd_bus_message_append_basic(reply, 's', id);
+}
+
+static int property_get_state(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        char id[UNIT_ID_MAX], p[UNIT_PATH_MAX];
+        const char *active_state, *sub_state;
+
+        unit_fields(PTR_TO_UINT(userdata) - 1, id, sizeof(id), p, sizeof(p), &active_state, &sub_state);
+
+        return sd_bus_message_append_basic(reply, 's', streq(property, "ActiveState") ? active_state : sub_state);
+}
+
+static int property_get_timestamp(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        return sd_bus_message_append(reply, "t", (uint64_t) PTR_TO_UINT(userdata) * USEC_PER_SEC);
+}
+
+static const sd_bus_vtable unit_vtable[] = {
+        SD_BUS_VTABLE_START(0),
+        SD_BUS_PROPERTY("Id", "s", property_get_id, 0, SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("Names", "as", property_get_id, 0, SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("Description", "s", property_get_id, 0, SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("ActiveState", "s", property_get_state, 0, SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_PROPERTY("SubState", "s", property_get_state, 0, SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_PROPERTY("StateChangeTimestamp", "t", property_get_timestamp, 0, SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_PROPERTY("InactiveExitTimestamp", "t", property_get_timestamp, 0, SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_PROPERTY("ActiveEnterTimestamp", "t", property_get_timestamp, 0, SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_VTABLE_END
+};
+
+static int method_list_units_by_patterns(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_strv_free_ char **states = NULL, **patterns = NULL;
+        Server *s = ASSERT_PTR(userdata);
+        int r;
+
+        r = sd_bus_message_read_strv(message, &states);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &patterns);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(ssssssouso)");
+        if (r < 0)
+                return r;
+
+        for (unsigned i = 0; i < s->n_units; i++) {
+                char id[UNIT_ID_MAX], path[UNIT_PATH_MAX];
+                const char *active_state, *sub_state;
+
+                unit_fields(i, id, sizeof(id), path, sizeof(path), &active_state, &sub_state);
+
+                if (!strv_isempty(states) &&
+                    !strv_contains(states, "loaded") &&
+                    !strv_contains(states, active_state) &&
+                    !strv_contains(states, sub_state))
+                        continue;
+
+                if (!strv_fnmatch_or_empty(patterns, id, 0))
+                        continue;
+
+                r = sd_bus_message_append(
+                                reply, "(ssssssouso)",
+                                id,
+                                id,
+                                "loaded",
+                                active_state,
+                                sub_state,
+                                "",
+                                path,
+                                (uint32_t) 0,
+                                "",
+                                "/");
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_message_send(reply);
+}
+
+static int method_set_property_cache(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        int b, r;
+
+        r = sd_bus_message_read(message, "b", &b);
+        if (r < 0)
+                return r;
+
+        r = bus_set_property_cache(sd_bus_message_get_bus(message), b);
+        if (r < 0)
+                return r;
+
+        return sd_bus_reply_method_return(message, NULL);
+}
+
+static int method_emit(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        char id[UNIT_ID_MAX], path[UNIT_PATH_MAX];
+        uint32_t i;
+        int r;
+
+        r = sd_bus_message_read(message, "u", &i);
+        if (r < 0)
+                return r;
+
+        unit_fields(i, id, sizeof(id), path, sizeof(path), NULL, NULL);
+
+        r = sd_bus_emit_properties_changed(sd_bus_message_get_bus(message), path, UNIT_INTERFACE, "ActiveState", "SubState", NULL);
+        if (r < 0)
+                return r;
+
+        return sd_bus_reply_method_return(message, NULL);
+}
+
+static int method_exit(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        Server *s = ASSERT_PTR(userdata);
+
+        s->quit = true;
+        return sd_bus_reply_method_return(message, NULL);
+}
+
+static const sd_bus_vtable manager_vtable[] = {
+        SD_BUS_VTABLE_START(0),
+        SD_BUS_METHOD("ListUnitsByPatterns", "asas", "a(ssssssouso)", method_list_units_by_patterns, 0),
+        SD_BUS_METHOD("SetPropertyCache", "b", NULL, method_set_property_cache, 0),
+        SD_BUS_METHOD("Emit", "u", NULL, method_emit, 0),
+        SD_BUS_METHOD("Exit", NULL, NULL, method_exit, 0),
+        SD_BUS_VTABLE_END
+};
+
+static int _server(int fd) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        Server s = {
+                .n_units = MAX(arg_n_units, arg_n_objects),
+        };
+        sd_id128_t id;
+        int r;
+
+        ASSERT_OK(sd_id128_randomize(&id));
+
+        ASSERT_OK(sd_bus_new(&bus));
+        ASSERT_OK(sd_bus_set_fd(bus, fd, fd));
+        ASSERT_OK(sd_bus_set_server(bus, 1, id));
+
+        ASSERT_OK(sd_bus_add_object_vtable(bus, NULL, MANAGER_PATH, MANAGER_INTERFACE, manager_vtable, &s));
+        ASSERT_OK(sd_bus_add_fallback_vtable(bus, NULL, UNIT_PREFIX, UNIT_INTERFACE, unit_vtable, unit_find, &s));
+
+        ASSERT_OK(sd_bus_start(bus));
+
+        while (!s.quit) {
+                r = sd_bus_process(bus, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to process requests: %m");
+                if (r == 0)
+                        ASSERT_OK(sd_bus_wait(bus, UINT64_MAX));
+        }
+
+        return 0;
+}
+
+static void* server(void *p) {
+        return INT_TO_PTR(_server(PTR_TO_FD(p)));
+}
+
+static void bench_get_all(sd_bus *bus, Stats *s) {
+        stats_begin(s, bus, arg_n_objects);
+
+        for (unsigned i = 0; i < arg_n_objects; i++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+                char id[UNIT_ID_MAX], path[UNIT_PATH_MAX];
+                nsec_t t;
+
+                unit_fields(i, id, sizeof(id), path, sizeof(path), NULL, NULL);
+
+                t = now_nsec(CLOCK_MONOTONIC);
+                ASSERT_OK(sd_bus_call_method(bus, NULL, path, "org.freedesktop.DBus.Properties", "GetAll", NULL, &reply, "s", UNIT_INTERFACE));
+                ASSERT_OK(sd_bus_message_skip(reply, "a{sv}"));
+                s->nsec[s->n++] = now_nsec(CLOCK_MONOTONIC) - t;
+        }
+
+        stats_end(s, bus);
+}
+
+static int on_properties_changed(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        unsigned *n_dispatched = ASSERT_PTR(userdata);
+
+        (*n_dispatched)++;
+        return 0;
+}
+
+static void bench_match_dispatch(sd_bus *bus, Stats *s) {
+        unsigned n_dispatched = 0, n_expected = 0;
+
+        /* Install one PropertiesChanged match per unit, like clients that watch individual units do */
+        for (unsigned i = 0; i < arg_n_matches; i++) {
+                char id[UNIT_ID_MAX], path[UNIT_PATH_MAX];
+                _cleanup_free_ char *match = NULL;
+
+                unit_fields(i, id, sizeof(id), path, sizeof(path), NULL, NULL);
+
+                match = strjoin("type='signal',path='", path, "',"
+                                "interface='org.freedesktop.DBus.Properties',member='PropertiesChanged',"
+                                "arg0='" UNIT_INTERFACE "'");
+                assert_se(match);
+
+                ASSERT_OK(sd_bus_add_match(bus, NULL, match, on_properties_changed, &n_dispatched));
+        }
+
+        stats_begin(s, bus, arg_n_objects);
+
+        for (unsigned i = 0; i < arg_n_objects; i++) {
+                unsigned u = (i * 7919U) % arg_n_objects;
+                nsec_t t;
+
+                /* The signal is queued before the method reply, hence once the call returns it sits in the
+                 * read queue and we only measure the local match dispatching. */
+                ASSERT_OK(sd_bus_call_method(bus, NULL, MANAGER_PATH, MANAGER_INTERFACE, "Emit", NULL, NULL, "u", (uint32_t) u));
+
+                t = now_nsec(CLOCK_MONOTONIC);
+                while (bus->rqueue_size > 0)
+                        ASSERT_OK(sd_bus_process(bus, NULL));
+                s->nsec[s->n++] = now_nsec(CLOCK_MONOTONIC) - t;
+
+                if (u < arg_n_matches)
+                        n_expected++;
+        }
+
+        stats_end(s, bus);
+
+        ASSERT_EQ(n_dispatched, n_expected);
+}
+
+static void bench_list_units(sd_bus *bus, Stats *s) {
+        stats_begin(s, bus, N_LIST_CALLS);
+
+        for (unsigned i = 0; i < N_LIST_CALLS; i++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+                unsigned n = 0;
+                nsec_t t;
+                int r;
+
+                t = now_nsec(CLOCK_MONOTONIC);
+                ASSERT_OK(sd_bus_call_method(bus, NULL, MANAGER_PATH, MANAGER_INTERFACE, "ListUnitsByPatterns", NULL, &reply, "asas", 0, 0));
+
+                /* Parse the reply like systemctl does */
+                ASSERT_OK(sd_bus_message_enter_container(reply, 'a', "(ssssssouso)"));
+                for (;;) {
+                        const char *id, *description, *load_state, *active_state, *sub_state, *following, *unit_path, *job_type, *job_path;
+                        uint32_t job_id;
+
+                        r = sd_bus_message_read(reply, "(ssssssouso)",
+                                                &id, &description, &load_state, &active_state, &sub_state,
+                                                &following, &unit_path, &job_id, &job_type, &job_path);
+                        ASSERT_OK(r);
+                        if (r == 0)
+                                break;
+
+                        n++;
+                }
+                ASSERT_OK(sd_bus_message_exit_container(reply));
+                s->nsec[s->n++] = now_nsec(CLOCK_MONOTONIC) - t;
+
+                ASSERT_EQ(n, MAX(arg_n_units, arg_n_objects));
+        }
+
+        stats_end(s, bus);
+}
+
+static void add_result(sd_json_variant **results, const char *name, Stats *s) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *v = NULL;
+
+        ASSERT_OK(stats_to_json(s, &v));
+        ASSERT_OK(sd_json_variant_set_field(results, name, v));
+
+        stats_done(s);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(sd_json_variant_unrefp) sd_json_variant *results = NULL, *v = NULL;
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        int fds[2];
+        pthread_t t;
+        Stats s;
+        void *p;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc > 1)
+                ASSERT_OK(safe_atou(argv[1], &arg_n_objects));
+        if (argc > 2)
+                ASSERT_OK(safe_atou(argv[2], &arg_n_matches));
+        if (argc > 3)
+                ASSERT_OK(safe_atou(argv[3], &arg_n_units));
+
+        assert_se(arg_n_objects > 0);
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+        ASSERT_OK(-pthread_create(&t, NULL, server, FD_TO_PTR(fds[0])));
+
+        ASSERT_OK(sd_bus_new(&bus));
+        ASSERT_OK(sd_bus_set_fd(bus, fds[1], fds[1]));
+        ASSERT_OK(sd_bus_start(bus));
+
+        log_info("Running GetAll() on %u objects.", arg_n_objects);
+        bench_get_all(bus, &s);
+        add_result(&results, "getAll", &s);
+
+        ASSERT_OK(sd_bus_call_method(bus, NULL, MANAGER_PATH, MANAGER_INTERFACE, "SetPropertyCache", NULL, NULL, "b", true));
+
+        log_info("Running GetAll() on %u objects with the property cache enabled.", arg_n_objects);
+        bench_get_all(bus, &s); /* Populate the cache */
+        stats_done(&s);
+        bench_get_all(bus, &s);
+        add_result(&results, "getAllCached", &s);
+
+        log_info("Dispatching %u signals with %u matches installed.", arg_n_objects, arg_n_matches);
+        bench_match_dispatch(bus, &s);
+        add_result(&results, "matchDispatch", &s);
+
+        log_info("Calling ListUnitsByPatterns() on %u units.", MAX(arg_n_units, arg_n_objects));
+        bench_list_units(bus, &s);
+        add_result(&results, "listUnitsByPatterns", &s);
+
+        ASSERT_OK(sd_bus_call_method(bus, NULL, MANAGER_PATH, MANAGER_INTERFACE, "Exit", NULL, NULL, NULL));
+
+        ASSERT_OK(-pthread_join(t, &p));
+        ASSERT_OK(PTR_TO_INT(p));
+
+        ASSERT_OK(sd_json_buildo(
+                        &v,
+                        SD_JSON_BUILD_PAIR_UNSIGNED("objects", arg_n_objects),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("matches", arg_n_matches),
+                        SD_JSON_BUILD_PAIR_UNSIGNED("units", MAX(arg_n_units, arg_n_objects)),
+                        SD_JSON_BUILD_PAIR_VARIANT("results", results)));
+
+        ASSERT_OK(sd_json_variant_dump(v, SD_JSON_FORMAT_NEWLINE, stdout, NULL));
+
+        return 0;
+}
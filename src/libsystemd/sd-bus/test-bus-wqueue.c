@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "sd-bus.h"
+
+#include "bus-internal.h"
+#include "fd-util.h"
+#include "log.h"
+#include "tests.h"
+
+#define N_SIGNALS 1000U
+
+static int _server(int fd) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        unsigned n_signals = 0;
+        sd_id128_t id;
+        bool quit = false;
+        int r;
+
+        ASSERT_OK(sd_id128_randomize(&id));
+
+        ASSERT_OK(sd_bus_new(&bus));
+        ASSERT_OK(sd_bus_set_fd(bus, fd, fd));
+        ASSERT_OK(sd_bus_set_server(bus, 1, id));
+        ASSERT_OK(sd_bus_start(bus));
+
+        while (!quit) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+                r = sd_bus_process(bus, &m);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to process requests: %m");
+
+                if (r == 0) {
+                        ASSERT_OK(sd_bus_wait(bus, UINT64_MAX));
+                        continue;
+                }
+
+                if (!m)
+                        continue;
+
+                if (sd_bus_message_is_signal(m, "org.freedesktop.systemd.test", "Ping")) {
+                        uint32_t i;
+
+                        /* Messages coalesced into one write must arrive complete and in order */
+                        ASSERT_OK_POSITIVE(sd_bus_message_read(m, "u", &i));
+                        ASSERT_EQ(i, n_signals);
+                        n_signals++;
+
+                } else if (sd_bus_message_is_method_call(m, "org.freedesktop.systemd.test", "Exit")) {
+                        ASSERT_EQ(n_signals, N_SIGNALS);
+                        ASSERT_OK(sd_bus_reply_method_return(m, NULL));
+                        quit = true;
+                }
+        }
+
+        return 0;
+}
+
+static void* server(void *p) {
+        return INT_TO_PTR(_server(PTR_TO_FD(p)));
+}
+
+TEST(wqueue_coalesce) {
+        _cleanup_(sd_bus_unrefp) sd_bus *bus = NULL;
+        int fds[2];
+        pthread_t s;
+        void *p;
+
+        ASSERT_OK_ERRNO(socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+        ASSERT_OK(-pthread_create(&s, NULL, server, FD_TO_PTR(fds[0])));
+
+        ASSERT_OK(sd_bus_new(&bus));
+        ASSERT_OK(sd_bus_set_fd(bus, fds[1], fds[1]));
+        ASSERT_OK(sd_bus_start(bus));
+
+        /* We are still authenticating at this point, hence all of these end up in the write queue first */
+        for (unsigned i = 0; i < N_SIGNALS; i++)
+                ASSERT_OK(sd_bus_emit_signal(bus, "/", "org.freedesktop.systemd.test", "Ping", "u", (uint32_t) i));
+
+        ASSERT_OK(sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/", "org.freedesktop.systemd.test", "Exit", NULL, NULL, NULL));
+
+        ASSERT_OK(-pthread_join(s, &p));
+        ASSERT_OK(PTR_TO_INT(p));
+
+        log_info("Wrote %" PRIu64 " messages with %" PRIu64 " write calls.",
+                 bus->n_written_messages, bus->n_write_calls);
+
+        ASSERT_EQ(bus->n_written_messages, (uint64_t) N_SIGNALS + 1);
+        ASSERT_LT(bus->n_write_calls, bus->n_written_messages);
+}
+
+DEFINE_TEST_MAIN(LOG_INFO);
@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "alloc-util.h"
@@ -29,9 +30,24 @@
 
 #define EXIT_SKIP_REMAINING 77
 
-DEFINE_PRIVATE_HASH_OPS_FULL(pidref_hash_ops_free_free,
+typedef struct ExecChild {
+        char *path;
+        usec_t start;
+} ExecChild;
+
+static ExecChild* exec_child_free(ExecChild *c) {
+        if (!c)
+                return NULL;
+
+        free(c->path);
+        return mfree(c);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(ExecChild*, exec_child_free);
+
+DEFINE_PRIVATE_HASH_OPS_FULL(pidref_hash_ops_free_exec_child_free,
                              PidRef, pidref_hash_func, pidref_compare_func,
-                             pidref_free, char*, free);
+                             pidref_free, ExecChild, exec_child_free);
 
 /* Put this test here for a lack of better place */
 assert_cc(EAGAIN == EWOULDBLOCK);
@@ -87,6 +103,19 @@ static int do_spawn(
         return 1;
 }
 
+static void record_timing(int timings_fd, const char *path, usec_t start, int status) {
+        assert(path);
+
+        /* One line per executable: start and finish timestamps (CLOCK_MONOTONIC), the exit status (or a
+         * negative errno if it didn't exit normally) and the path, which goes last as it may contain spaces. */
+
+        if (timings_fd < 0)
+                return;
+
+        if (dprintf(timings_fd, USEC_FMT " " USEC_FMT " %i %s\n", start, now(CLOCK_MONOTONIC), status, path) < 0)
+                log_debug_errno(errno, "Failed to record timing of %s, ignoring: %m", path);
+}
+
 static int do_execute(
                 char * const *paths,
                 const char *root,
@@ -94,6 +123,7 @@ static int do_execute(
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void * const callback_args[_STDOUT_CONSUME_MAX],
                 int output_fd,
+                int timings_fd,
                 char *argv[],
                 char *envp[],
                 ExecDirFlags flags) {
@@ -165,27 +195,41 @@ static int do_execute(
                                             "permission bits. Proceeding anyway.", t);
                 }
 
+                usec_t start = now(CLOCK_MONOTONIC);
+
                 _cleanup_(pidref_done) PidRef pidref = PIDREF_NULL;
                 r = do_spawn(t, argv, fd, FLAGS_SET(flags, EXEC_DIR_SET_SYSTEMD_EXEC_PID), &pidref);
                 if (r <= 0)
                         continue;
 
                 if (parallel_execution) {
+                        _cleanup_(exec_child_freep) ExecChild *c = NULL;
                         _cleanup_(pidref_freep) PidRef *dup = NULL;
+
                         r = pidref_dup(&pidref, &dup);
                         if (r < 0)
                                 return log_error_errno(r, "Failed to duplicate pid reference: %m");
 
-                        r = hashmap_ensure_put(&pids, &pidref_hash_ops_free_free, dup, t);
+                        c = new(ExecChild, 1);
+                        if (!c)
+                                return log_oom();
+
+                        *c = (ExecChild) {
+                                .path = TAKE_PTR(t),
+                                .start = start,
+                        };
+
+                        r = hashmap_ensure_put(&pids, &pidref_hash_ops_free_exec_child_free, dup, c);
                         if (r < 0)
                                 return log_oom();
 
                         TAKE_PTR(dup);
-                        TAKE_PTR(t);
+                        TAKE_PTR(c);
                 } else {
                         bool skip_remaining = false;
 
                         r = pidref_wait_for_terminate_and_check(t, &pidref, WAIT_LOG_ABNORMAL);
+                        record_timing(timings_fd, t, start, r);
                         if (r < 0)
                                 return r;
                         if (r > 0) {
@@ -222,12 +266,30 @@ static int do_execute(
         }
 
         while (!hashmap_isempty(pids)) {
+                _cleanup_(exec_child_freep) ExecChild *c = NULL;
                 _cleanup_(pidref_freep) PidRef *pidref = NULL;
-                _cleanup_free_ char *t = NULL;
+                siginfo_t si = {};
 
-                t = ASSERT_PTR(hashmap_steal_first_key_and_value(pids, (void**) &pidref));
+                /* Collect the children in the order they finish rather than in the order we started them, so
+                 * that the recorded timings are accurate. We are a dedicated executor process, hence all
+                 * children are ours. Peek only, so that the reaping is done via the pidfd below. */
+                if (waitid(P_ALL, 0, &si, WEXITED|WNOWAIT) < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        return log_error_errno(errno, "Failed to wait for children: %m");
+                }
+
+                c = hashmap_remove2(pids, &PIDREF_MAKE_FROM_PID(si.si_pid), (void**) &pidref);
+                if (!c) {
+                        /* Not one of ours? Should not happen, but let's not spin on it. */
+                        log_debug("Unexpected child " PID_FMT " exited, reaping.", si.si_pid);
+                        (void) waitid(P_PID, si.si_pid, &si, WEXITED);
+                        continue;
+                }
 
-                r = pidref_wait_for_terminate_and_check(t, pidref, WAIT_LOG);
+                r = pidref_wait_for_terminate_and_check(c->path, pidref, WAIT_LOG);
+                record_timing(timings_fd, c->path, c->start, r);
                 if (r < 0)
                         return r;
                 if (!FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS) && r > 0)
@@ -237,13 +299,14 @@ static int do_execute(
         return 0;
 }
 
-int execute_strv(
+int execute_strv_full(
                 const char *name,
                 char * const *paths,
                 const char *root,
                 usec_t timeout,
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void * const callback_args[_STDOUT_CONSUME_MAX],
+                int timings_fd,
                 char *argv[],
                 char *envp[],
                 ExecDirFlags flags) {
@@ -279,7 +342,7 @@ int execute_strv(
         if (r < 0)
                 return r;
         if (r == 0) {
-                r = do_execute(paths, root, timeout, callbacks, callback_args, fd, argv, envp, flags);
+                r = do_execute(paths, root, timeout, callbacks, callback_args, fd, timings_fd, argv, envp, flags);
                 _exit(r < 0 ? EXIT_FAILURE : r);
         }
 
@@ -303,12 +366,13 @@ int execute_strv(
         return 0;
 }
 
-int execute_directories(
+int execute_directories_full(
                 const char *name,
                 const char * const *directories,
                 usec_t timeout,
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void * const callback_args[_STDOUT_CONSUME_MAX],
+                int timings_fd,
                 char *argv[],
                 char *envp[],
                 ExecDirFlags flags) {
@@ -333,7 +397,7 @@ int execute_directories(
                 return 0;
         }
 
-        return execute_strv(name, paths, /* root= */ NULL, timeout, callbacks, callback_args, argv, envp, flags);
+        return execute_strv_full(name, paths, /* root= */ NULL, timeout, callbacks, callback_args, timings_fd, argv, envp, flags);
 }
 
 static int gather_environment_generate(int fd, void *arg) {
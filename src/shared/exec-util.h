@@ -20,26 +20,52 @@ typedef enum ExecDirFlags {
         EXEC_DIR_WARN_WORLD_WRITABLE  = 1 << 4, /* Warn if world writable files are found */
 } ExecDirFlags;
 
-int execute_strv(
+/* If timings_fd is valid, a line "START FINISH STATUS PATH" is written to it for each executable run. */
+int execute_strv_full(
                 const char *name,
                 char * const *paths,
                 const char *root,
                 usec_t timeout,
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void * const callback_args[_STDOUT_CONSUME_MAX],
+                int timings_fd,
                 char *argv[],
                 char *envp[],
                 ExecDirFlags flags);
+static inline int execute_strv(
+                const char *name,
+                char * const *paths,
+                const char *root,
+                usec_t timeout,
+                gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
+                void * const callback_args[_STDOUT_CONSUME_MAX],
+                char *argv[],
+                char *envp[],
+                ExecDirFlags flags) {
+        return execute_strv_full(name, paths, root, timeout, callbacks, callback_args, -EBADF, argv, envp, flags);
+}
 
-int execute_directories(
+int execute_directories_full(
                 const char *name,
                 const char * const *directories,
                 usec_t timeout,
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void * const callback_args[_STDOUT_CONSUME_MAX],
+                int timings_fd,
                 char *argv[],
                 char *envp[],
                 ExecDirFlags flags);
+static inline int execute_directories(
+                const char *name,
+                const char * const *directories,
+                usec_t timeout,
+                gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
+                void * const callback_args[_STDOUT_CONSUME_MAX],
+                char *argv[],
+                char *envp[],
+                ExecDirFlags flags) {
+        return execute_directories_full(name, directories, timeout, callbacks, callback_args, -EBADF, argv, envp, flags);
+}
 
 extern const gather_stdout_callback_t gather_environment[_STDOUT_CONSUME_MAX];
 
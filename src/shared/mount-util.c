@@ -2232,3 +2232,225 @@ int path_is_network_fs_harder_at(int dir_fd, const char *path) {
 
         return false;
 }
+
+int statmount_alloc(uint64_t mnt_id, uint64_t mask, struct statmount **ret) {
+        struct mnt_id_req req = {
+                .size = MNT_ID_REQ_SIZE_VER0,
+                .mnt_id = mnt_id,
+                .param = mask,
+        };
+        size_t size = sizeof(struct statmount) + 1024;
+
+        assert(ret);
+
+        /* Queries the specified mount by its unique ID, growing the buffer until all requested strings fit */
+
+        for (;;) {
+                _cleanup_free_ struct statmount *sm = NULL;
+
+                sm = malloc0(size);
+                if (!sm)
+                        return -ENOMEM;
+
+                if (statmount(&req, sm, size, /* flags= */ 0) >= 0) {
+                        *ret = TAKE_PTR(sm);
+                        return 0;
+                }
+                if (errno != EOVERFLOW)
+                        return -errno;
+
+                if (size >= 16U * 1024U * 1024U)
+                        return -E2BIG;
+
+                size *= 2;
+        }
+}
+
+int statmount_to_mountinfo(
+                const struct statmount *sm,
+                char **ret_what,
+                char **ret_where,
+                char **ret_options,
+                char **ret_fstype) {
+
+        static const struct {
+                uint64_t attr;
+                const char *name;
+        } vfs_options[] = {
+                { MOUNT_ATTR_NOSUID,      "nosuid"      },
+                { MOUNT_ATTR_NODEV,       "nodev"       },
+                { MOUNT_ATTR_NOEXEC,      "noexec"      },
+        }, vfs_options_late[] = {
+                { MOUNT_ATTR_NODIRATIME,  "nodiratime"  },
+        }, vfs_options_last[] = {
+                { MOUNT_ATTR_NOSYMFOLLOW, "nosymfollow" },
+                { MOUNT_ATTR_IDMAP,       "idmapped"    },
+        };
+        static const struct {
+                uint32_t flag;
+                const char *name;
+        } sb_options[] = {
+                { MS_SYNCHRONOUS, "sync"     },
+                { MS_DIRSYNC,     "dirsync"  },
+                { MS_MANDLOCK,    "mand"     },
+                { MS_LAZYTIME,    "lazytime" },
+        };
+
+        _cleanup_free_ char *what = NULL, *where = NULL, *options = NULL, *fstype = NULL;
+
+        assert(sm);
+
+        /* Converts the result of statmount() into the strings libmount reports for the mount's line in
+         * /proc/self/mountinfo. Needs at least STATMOUNT_MNT_BASIC, STATMOUNT_SB_BASIC, STATMOUNT_MNT_POINT
+         * and STATMOUNT_FS_TYPE. */
+
+        if ((sm->mask & (STATMOUNT_MNT_BASIC|STATMOUNT_SB_BASIC|STATMOUNT_MNT_POINT|STATMOUNT_FS_TYPE)) !=
+            (STATMOUNT_MNT_BASIC|STATMOUNT_SB_BASIC|STATMOUNT_MNT_POINT|STATMOUNT_FS_TYPE))
+                return -ENODATA;
+
+        if (ret_what) {
+                what = strdup(FLAGS_SET(sm->mask, STATMOUNT_SB_SOURCE) ? sm->str + sm->sb_source : "none");
+                if (!what)
+                        return -ENOMEM;
+        }
+
+        if (ret_where) {
+                where = strdup(sm->str + sm->mnt_point);
+                if (!where)
+                        return -ENOMEM;
+        }
+
+        if (ret_options) {
+                /* Same order as the kernel uses in /proc/self/mountinfo, and with a single "ro"/"rw" first,
+                 * like libmount merges the per-mount and superblock options */
+                if (!strextend(&options,
+                               FLAGS_SET(sm->mnt_attr, MOUNT_ATTR_RDONLY) || FLAGS_SET(sm->sb_flags, MS_RDONLY) ? "ro" : "rw"))
+                        return -ENOMEM;
+
+                FOREACH_ELEMENT(i, vfs_options)
+                        if (FLAGS_SET(sm->mnt_attr, i->attr) &&
+                            !strextend_with_separator(&options, ",", i->name))
+                                return -ENOMEM;
+
+                if ((sm->mnt_attr & MOUNT_ATTR__ATIME) == MOUNT_ATTR_NOATIME &&
+                    !strextend(&options, ",noatime"))
+                        return -ENOMEM;
+
+                FOREACH_ELEMENT(i, vfs_options_late)
+                        if (FLAGS_SET(sm->mnt_attr, i->attr) &&
+                            !strextend_with_separator(&options, ",", i->name))
+                                return -ENOMEM;
+
+                if ((sm->mnt_attr & MOUNT_ATTR__ATIME) == MOUNT_ATTR_RELATIME &&
+                    !strextend(&options, ",relatime"))
+                        return -ENOMEM;
+
+                FOREACH_ELEMENT(i, vfs_options_last)
+                        if (FLAGS_SET(sm->mnt_attr, i->attr) &&
+                            !strextend_with_separator(&options, ",", i->name))
+                                return -ENOMEM;
+
+                FOREACH_ELEMENT(i, sb_options)
+                        if (FLAGS_SET(sm->sb_flags, i->flag) &&
+                            !strextend_with_separator(&options, ",", i->name))
+                                return -ENOMEM;
+
+                if (FLAGS_SET(sm->mask, STATMOUNT_MNT_OPTS) &&
+                    !isempty(sm->str + sm->mnt_opts) &&
+                    !strextend_with_separator(&options, ",", sm->str + sm->mnt_opts))
+                        return -ENOMEM;
+        }
+
+        if (ret_fstype) {
+                if (FLAGS_SET(sm->mask, STATMOUNT_FS_SUBTYPE) && !isempty(sm->str + sm->fs_subtype))
+                        fstype = strjoin(sm->str + sm->fs_type, ".", sm->str + sm->fs_subtype);
+                else
+                        fstype = strdup(sm->str + sm->fs_type);
+                if (!fstype)
+                        return -ENOMEM;
+        }
+
+        if (ret_what)
+                *ret_what = TAKE_PTR(what);
+        if (ret_where)
+                *ret_where = TAKE_PTR(where);
+        if (ret_options)
+                *ret_options = TAKE_PTR(options);
+        if (ret_fstype)
+                *ret_fstype = TAKE_PTR(fstype);
+
+        return 0;
+}
+
+int listmount_all(uint64_t **ret_ids, size_t *ret_n_ids) {
+        struct mnt_id_req req = {
+                .size = MNT_ID_REQ_SIZE_VER0,
+                .mnt_id = LSMT_ROOT,
+        };
+        _cleanup_free_ uint64_t *ids = NULL;
+        size_t n = 0;
+
+        assert(ret_ids);
+        assert(ret_n_ids);
+
+        /* Returns the unique IDs of all mounts visible below our root directory */
+
+        for (;;) {
+                ssize_t k;
+
+                if (!GREEDY_REALLOC(ids, n + 512))
+                        return -ENOMEM;
+
+                k = listmount(&req, ids + n, 512, /* flags= */ 0);
+                if (k < 0)
+                        return -errno;
+
+                n += k;
+                if (k < 512)
+                        break;
+
+                /* Continue after the last ID we got */
+                req.param = ids[n - 1];
+        }
+
+        *ret_ids = TAKE_PTR(ids);
+        *ret_n_ids = n;
+        return 0;
+}
+
+static int mount_options_normalize(const char *options, char ***ret) {
+        _cleanup_strv_free_ char **l = NULL;
+        int r;
+
+        assert(ret);
+
+        r = strv_split_full(&l, strempty(options), ",", EXTRACT_KEEP_QUOTE|EXTRACT_RETAIN_ESCAPE);
+        if (r < 0)
+                return r;
+
+        *ret = strv_sort_uniq(TAKE_PTR(l));
+        return 0;
+}
+
+int mount_options_equal(const char *a, const char *b) {
+        _cleanup_strv_free_ char **x = NULL, **y = NULL;
+        int r;
+
+        /* Compares two mount option strings as reported in /proc/self/mountinfo, by libmount or by
+         * statmount_to_mountinfo(), ignoring the order and duplicates of the individual options. The
+         * order differs between these sources, for example for options that are both per-mount and per
+         * superblock, or for the options libmount merges in from utab. */
+
+        if (streq_ptr(a, b))
+                return true;
+
+        r = mount_options_normalize(a, &x);
+        if (r < 0)
+                return r;
+
+        r = mount_options_normalize(b, &y);
+        if (r < 0)
+                return r;
+
+        return strv_equal(x, y);
+}
@@ -181,3 +181,11 @@ int path_is_network_fs_harder_at(int dir_fd, const char *path);
 static inline int path_is_network_fs_harder(const char *path) {
         return path_is_network_fs_harder_at(AT_FDCWD, path);
 }
+
+struct statmount;
+
+int statmount_alloc(uint64_t mnt_id, uint64_t mask, struct statmount **ret);
+int statmount_to_mountinfo(const struct statmount *sm, char **ret_what, char **ret_where, char **ret_options, char **ret_fstype);
+int listmount_all(uint64_t **ret_ids, size_t *ret_n_ids);
+
+int mount_options_equal(const char *a, const char *b);
@@ -77,6 +77,7 @@ typedef struct Table Table;
 typedef struct Tpm2Context Tpm2Context;
 typedef struct Tpm2Handle Tpm2Handle;
 typedef struct Tpm2PCRValue Tpm2PCRValue;
+typedef struct UnitDirectoryCache UnitDirectoryCache;
 typedef struct UnitInfo UnitInfo;
 typedef struct UserRecord UserRecord;
 typedef struct VeritySettings VeritySettings;
@@ -1,16 +1,25 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <fcntl.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
 #include "sd-id128.h"
 
 #include "alloc-util.h"
 #include "chase.h"
 #include "dirent-util.h"
+#include "extract-word.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "fs-util.h"
 #include "glyph-util.h"
 #include "initrd-util.h"
 #include "log.h"
+#include "memstream-util.h"
+#include "parse-util.h"
 #include "path-lookup.h"
+#include "path-util.h"
 #include "set.h"
 #include "siphash24.h"
 #include "special.h"
@@ -363,9 +372,566 @@ int unit_file_resolve_symlink(
         return !tail;  /* true if linked unit file */
 }
 
+#define UNIT_DIRECTORY_CACHE_MAGIC "systemd-unit-directory-cache-v2"
+
+typedef enum UnitDirectoryEntryType {
+        UNIT_DIRECTORY_ENTRY_FILE,      /* A regular file with a valid unit name */
+        UNIT_DIRECTORY_ENTRY_SYMLINK,   /* A symlink with a valid unit name */
+        UNIT_DIRECTORY_ENTRY_DIRECTORY, /* A .wants/, .requires/, .upholds/ or .d/ directory, or a symlink to one */
+} UnitDirectoryEntryType;
+
+typedef struct UnitDirectoryEntry {
+        UnitDirectoryEntryType type;
+        char *name;
+
+        /* For symlinks, filled in the first time we need it */
+        bool resolved;
+        char *destination;
+} UnitDirectoryEntry;
+
+typedef struct UnitDirectory {
+        dev_t dev;
+        ino_t ino;
+        uint64_t fsid; /* device numbers may be reused by a different file system, e.g. after reboot */
+        nsec_t mtime;
+
+        UnitDirectoryEntry *entries;
+        size_t n_entries;
+} UnitDirectory;
+
+struct UnitDirectoryCache {
+        /* The contents of the unit directories, so that we only need to read the directories again that
+         * changed since. Symlinks are resolved relative to the search path, hence this is only valid as long
+         * as the search path stays the same. */
+        uint64_t search_path_hash;
+        Hashmap *directories; /* path → UnitDirectory */
+        bool dirty;
+};
+
+static UnitDirectory* unit_directory_free(UnitDirectory *d) {
+        if (!d)
+                return NULL;
+
+        FOREACH_ARRAY(e, d->entries, d->n_entries) {
+                free(e->name);
+                free(e->destination);
+        }
+
+        free(d->entries);
+        return mfree(d);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(UnitDirectory*, unit_directory_free);
+
+DEFINE_PRIVATE_HASH_OPS_FULL(unit_directory_hash_ops,
+                             char, path_hash_func, path_compare, free,
+                             UnitDirectory, unit_directory_free);
+
+static int unit_directory_add_entry(
+                UnitDirectory *d,
+                UnitDirectoryEntryType type,
+                const char *name,
+                bool resolved,
+                const char *destination) {
+
+        _cleanup_free_ char *n = NULL, *dst = NULL;
+
+        assert(d);
+        assert(name);
+
+        n = strdup(name);
+        if (!n)
+                return -ENOMEM;
+
+        if (destination) {
+                dst = strdup(destination);
+                if (!dst)
+                        return -ENOMEM;
+        }
+
+        if (!GREEDY_REALLOC(d->entries, d->n_entries + 1))
+                return -ENOMEM;
+
+        d->entries[d->n_entries++] = (UnitDirectoryEntry) {
+                .type = type,
+                .name = TAKE_PTR(n),
+                .resolved = resolved,
+                .destination = TAKE_PTR(dst),
+        };
+
+        return 0;
+}
+
+static int fd_get_fsid(int fd, uint64_t *ret) {
+        struct statfs sfs;
+
+        assert(fd >= 0);
+        assert(ret);
+
+        if (fstatfs(fd, &sfs) < 0)
+                return -errno;
+
+        assert_cc(sizeof(sfs.f_fsid) == sizeof(uint64_t));
+        memcpy(ret, &sfs.f_fsid, sizeof(uint64_t));
+        return 0;
+}
+
+static bool unit_directory_is_current(const UnitDirectory *d, const char *path) {
+        _cleanup_close_ int fd = -EBADF;
+        struct stat st;
+        uint64_t fsid;
+
+        assert(d);
+        assert(path);
+
+        fd = open(path, O_PATH|O_DIRECTORY|O_CLOEXEC);
+        if (fd < 0)
+                return false;
+
+        if (fstat(fd, &st) < 0 || fd_get_fsid(fd, &fsid) < 0)
+                return false;
+
+        return st.st_dev == d->dev &&
+                st.st_ino == d->ino &&
+                fsid == d->fsid &&
+                timespec_load_nsec(&st.st_mtim) == d->mtime;
+}
+
+static int unit_directory_read(const char *path, bool with_directories, UnitDirectory **ret) {
+        _cleanup_(unit_directory_freep) UnitDirectory *d = NULL;
+        _cleanup_closedir_ DIR *dir = NULL;
+        struct stat st;
+        uint64_t fsid;
+        int r;
+
+        assert(path);
+        assert(ret);
+
+        dir = opendir(path);
+        if (!dir)
+                return -errno;
+
+        /* Take the timestamp before reading, so that concurrent modifications are noticed next time */
+        if (fstat(dirfd(dir), &st) < 0)
+                return -errno;
+
+        r = fd_get_fsid(dirfd(dir), &fsid);
+        if (r < 0)
+                return r;
+
+        d = new(UnitDirectory, 1);
+        if (!d)
+                return -ENOMEM;
+
+        *d = (UnitDirectory) {
+                .dev = st.st_dev,
+                .ino = st.st_ino,
+                .fsid = fsid,
+                .mtime = timespec_load_nsec(&st.st_mtim),
+        };
+
+        FOREACH_DIRENT_ALL(de, dir, log_warning_errno(errno, "Failed to read \"%s\", ignoring: %m", path)) {
+                UnitDirectoryEntryType type;
+
+                /* We only care about valid units and dirs with certain suffixes, let's ignore the rest. */
+
+                if (de->d_type == DT_REG) {
+
+                        /* Accept a regular file whose name is a valid unit file name. */
+                        if (!unit_name_is_valid(de->d_name, UNIT_NAME_ANY))
+                                continue;
+
+                        type = UNIT_DIRECTORY_ENTRY_FILE;
+
+                } else if (de->d_type == DT_DIR) {
+
+                        if (!with_directories) /* Skip directories early unless requested */
+                                continue;
+
+                        r = directory_name_is_valid(de->d_name);
+                        if (r < 0)
+                                return r;
+                        if (r == 0)
+                                continue;
+
+                        type = UNIT_DIRECTORY_ENTRY_DIRECTORY;
+
+                } else if (de->d_type == DT_LNK) {
+
+                        /* Accept a symlink file whose name is a valid unit file name or
+                         * ending in .wants/, .requires/ or .d/. */
+
+                        if (!unit_name_is_valid(de->d_name, UNIT_NAME_ANY)) {
+                                _cleanup_free_ char *target = NULL;
+
+                                if (!with_directories) /* Skip symlink to a directory early unless requested */
+                                        continue;
+
+                                r = directory_name_is_valid(de->d_name);
+                                if (r < 0)
+                                        return r;
+                                if (r == 0)
+                                        continue;
+
+                                r = readlinkat_malloc(dirfd(dir), de->d_name, &target);
+                                if (r < 0) {
+                                        log_warning_errno(r, "Failed to read symlink %s/%s, ignoring: %m",
+                                                          path, de->d_name);
+                                        continue;
+                                }
+
+                                r = is_dir(target, /* follow= */ true);
+                                if (r <= 0)
+                                        continue;
+
+                                type = UNIT_DIRECTORY_ENTRY_DIRECTORY;
+                        } else
+                                type = UNIT_DIRECTORY_ENTRY_SYMLINK;
+
+                } else
+                        continue;
+
+                r = unit_directory_add_entry(d, type, de->d_name, /* resolved= */ false, /* destination= */ NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(d);
+        return 0;
+}
+
+static int unit_directory_get(
+                UnitDirectoryCache *c,
+                const LookupPaths *lp,
+                const char *path,
+                bool with_directories,
+                UnitDirectory **uncached,
+                UnitDirectory **ret) {
+
+        _cleanup_(unit_directory_freep) UnitDirectory *d = NULL;
+        _cleanup_free_ char *key = NULL;
+        UnitDirectory *cached;
+        int r;
+
+        assert(lp);
+        assert(path);
+        assert(uncached);
+        assert(ret);
+
+        /* Returns the contents of the directory, either from the cache, or freshly read. In the latter case
+         * it might be returned in 'uncached' instead of being added to the cache, and must be freed by the
+         * caller. */
+
+        /* Directories under our exclusive control change all the time, don't bother caching them */
+        if (!c || lookup_paths_mtime_exclude(lp, path)) {
+                r = unit_directory_read(path, with_directories, uncached);
+                if (r < 0)
+                        return r;
+
+                *ret = *uncached;
+                return 0;
+        }
+
+        cached = hashmap_get(c->directories, path);
+        if (cached) {
+                if (unit_directory_is_current(cached, path)) {
+                        *ret = cached;
+                        return 0;
+                }
+
+                unit_directory_free(hashmap_remove2(c->directories, path, (void**) &key));
+                key = mfree(key);
+                c->dirty = true;
+        }
+
+        r = unit_directory_read(path, /* with_directories= */ true, &d);
+        if (r < 0)
+                return r;
+
+        /* Modifications within the granularity of the file system timestamps would go unnoticed, hence
+         * don't cache directories that were modified only just now. */
+        if (usec_sub_unsigned(now(CLOCK_REALTIME), d->mtime / NSEC_PER_USEC) < USEC_PER_SEC) {
+                *ret = *uncached = TAKE_PTR(d);
+                return 0;
+        }
+
+        key = strdup(path);
+        if (!key)
+                return -ENOMEM;
+
+        r = hashmap_ensure_put(&c->directories, &unit_directory_hash_ops, key, d);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(key);
+        c->dirty = true;
+
+        *ret = TAKE_PTR(d);
+        return 0;
+}
+
+static uint64_t search_path_hash(const LookupPaths *lp, char **expanded_search_path) {
+        struct siphash state;
+
+        assert(lp);
+
+        siphash24_init(&state, HASH_KEY.bytes);
+        siphash24_compress_string(lp->root_dir, &state);
+
+        /* A different file system mounted at the same root (e.g. another image) invalidates the whole
+         * cache, even if all its directories happen to have the same inode numbers and timestamps. */
+        _cleanup_close_ int fd = open(empty_to_root(lp->root_dir), O_PATH|O_DIRECTORY|O_CLOEXEC);
+        uint64_t fsid;
+        if (fd >= 0 && fd_get_fsid(fd, &fsid) >= 0)
+                siphash24_compress_typesafe(fsid, &state);
+
+        STRV_FOREACH(dir, expanded_search_path)
+                siphash24_compress_string(*dir, &state);
+
+        return siphash24_finalize(&state);
+}
+
+UnitDirectoryCache* unit_directory_cache_new(void) {
+        return new0(UnitDirectoryCache, 1);
+}
+
+UnitDirectoryCache* unit_directory_cache_free(UnitDirectoryCache *c) {
+        if (!c)
+                return NULL;
+
+        hashmap_free(c->directories);
+        return mfree(c);
+}
+
+int unit_directory_cache_load(UnitDirectoryCache *c, const char *path) {
+        _cleanup_hashmap_free_ Hashmap *directories = NULL;
+        _cleanup_free_ char *magic = NULL, *hash = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        UnitDirectory *current = NULL;
+        uint64_t search_path_hash;
+        struct stat st;
+        int r;
+
+        assert(c);
+        assert(path);
+
+        /* The format is line based: a magic line, the search path hash, then for each directory a line
+         * "D DEV INODE FSID MTIME PATH" followed by one line "TYPE NAME [DESTINATION]" per entry. */
+
+        f = fopen(path, "re");
+        if (!f)
+                return errno == ENOENT ? 0 : -errno;
+
+        if (fstat(fileno(f), &st) < 0)
+                return -errno;
+
+        /* The cache decides which unit files are loaded, hence only trust it if nobody else could have
+         * written to it. */
+        if (st.st_uid != getuid() || (st.st_mode & 0022) != 0)
+                return log_debug_errno(SYNTHETIC_ERRNO(EPERM), "Unit directory cache %s has unsafe ownership or access mode, ignoring.", path);
+
+        r = read_line(f, LONG_LINE_MAX, &magic);
+        if (r < 0)
+                return r;
+        if (!streq(magic, UNIT_DIRECTORY_CACHE_MAGIC))
+                return log_debug_errno(SYNTHETIC_ERRNO(EBADMSG), "Unit directory cache %s has unknown format, ignoring.", path);
+
+        r = read_line(f, LONG_LINE_MAX, &hash);
+        if (r < 0)
+                return r;
+        r = safe_atoux64(hash, &search_path_hash);
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                _cleanup_free_ char *line = NULL;
+                UnitDirectoryEntryType type;
+                const char *p, *name, *destination = NULL;
+                bool resolved = false;
+
+                r = read_line(f, LONG_LINE_MAX, &line);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                if (strlen(line) < 3 || line[1] != ' ')
+                        return -EBADMSG;
+
+                p = line + 2;
+
+                if (line[0] == 'D') {
+                        _cleanup_(unit_directory_freep) UnitDirectory *d = NULL;
+                        _cleanup_free_ char *dev = NULL, *ino = NULL, *fsid = NULL, *mtime = NULL, *key = NULL;
+                        uint64_t dev_u, ino_u, fsid_u, mtime_u;
+
+                        r = extract_many_words(&p, " ", /* flags= */ 0, &dev, &ino, &fsid, &mtime);
+                        if (r < 0)
+                                return r;
+                        if (r < 4 || !p || !path_is_absolute(p))
+                                return -EBADMSG;
+
+                        if (safe_atou64(dev, &dev_u) < 0 ||
+                            safe_atou64(ino, &ino_u) < 0 ||
+                            safe_atoux64(fsid, &fsid_u) < 0 ||
+                            safe_atou64(mtime, &mtime_u) < 0)
+                                return -EBADMSG;
+
+                        d = new(UnitDirectory, 1);
+                        if (!d)
+                                return -ENOMEM;
+
+                        *d = (UnitDirectory) {
+                                .dev = (dev_t) dev_u,
+                                .ino = (ino_t) ino_u,
+                                .fsid = fsid_u,
+                                .mtime = mtime_u,
+                        };
+
+                        key = strdup(p);
+                        if (!key)
+                                return -ENOMEM;
+
+                        r = hashmap_ensure_put(&directories, &unit_directory_hash_ops, key, d);
+                        if (r < 0)
+                                return r;
+
+                        TAKE_PTR(key);
+                        current = TAKE_PTR(d);
+                        continue;
+                }
+
+                if (!current)
+                        return -EBADMSG;
+
+                switch (line[0]) {
+
+                case 'f':
+                        type = UNIT_DIRECTORY_ENTRY_FILE;
+                        break;
+
+                case 'd':
+                        type = UNIT_DIRECTORY_ENTRY_DIRECTORY;
+                        break;
+
+                case 'l': /* not resolved yet */
+                        type = UNIT_DIRECTORY_ENTRY_SYMLINK;
+                        break;
+
+                case 'r': /* resolved */
+                        type = UNIT_DIRECTORY_ENTRY_SYMLINK;
+                        resolved = true;
+                        break;
+
+                default:
+                        return -EBADMSG;
+                }
+
+                name = p;
+                if (line[0] == 'r') {
+                        char *space = strchr(p, ' ');
+                        if (!space)
+                                return -EBADMSG;
+
+                        *space = 0;
+                        destination = space + 1;
+                        if (isempty(destination))
+                                return -EBADMSG;
+                }
+
+                if (!filename_is_valid(name))
+                        return -EBADMSG;
+
+                r = unit_directory_add_entry(current, type, name, resolved, destination);
+                if (r < 0)
+                        return r;
+        }
+
+        hashmap_free_and_replace(c->directories, directories);
+        c->search_path_hash = search_path_hash;
+        c->dirty = false;
+
+        log_debug("Loaded unit directory cache %s with %u directories.", path, hashmap_size(c->directories));
+        return 1;
+}
+
+static bool string_is_serializable(const char *s) {
+        return !s || !strchr(s, '\n');
+}
+
+int unit_directory_cache_save(UnitDirectoryCache *c, const char *path) {
+        _cleanup_(memstream_done) MemStream m = {};
+        _cleanup_free_ char *buf = NULL;
+        UnitDirectory *d;
+        const char *dir;
+        FILE *f;
+        int r;
+
+        assert(path);
+
+        if (!c || !c->dirty)
+                return 0;
+
+        f = memstream_init(&m);
+        if (!f)
+                return -ENOMEM;
+
+        fprintf(f, "%s\n%" PRIx64 "\n", UNIT_DIRECTORY_CACHE_MAGIC, c->search_path_hash);
+
+        HASHMAP_FOREACH_KEY(d, dir, c->directories) {
+                bool good = string_is_serializable(dir);
+
+                FOREACH_ARRAY(e, d->entries, d->n_entries)
+                        good = good && string_is_serializable(e->destination);
+                if (!good)
+                        continue;
+
+                fprintf(f, "D %" PRIu64 " %" PRIu64 " %" PRIx64 " %" PRIu64 " %s\n",
+                        (uint64_t) d->dev, (uint64_t) d->ino, d->fsid, (uint64_t) d->mtime, dir);
+
+                FOREACH_ARRAY(e, d->entries, d->n_entries)
+                        switch (e->type) {
+
+                        case UNIT_DIRECTORY_ENTRY_FILE:
+                                fprintf(f, "f %s\n", e->name);
+                                break;
+
+                        case UNIT_DIRECTORY_ENTRY_DIRECTORY:
+                                fprintf(f, "d %s\n", e->name);
+                                break;
+
+                        case UNIT_DIRECTORY_ENTRY_SYMLINK:
+                                if (e->resolved)
+                                        fprintf(f, "r %s %s\n", e->name, e->destination);
+                                else
+                                        fprintf(f, "l %s\n", e->name);
+                                break;
+
+                        default:
+                                assert_not_reached();
+                        }
+        }
+
+        r = memstream_finalize(&m, &buf, /* ret_size= */ NULL);
+        if (r < 0)
+                return r;
+
+        r = write_string_file(path, buf,
+                              WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC|
+                              WRITE_STRING_FILE_AVOID_NEWLINE|WRITE_STRING_FILE_MKDIR_0755);
+        if (r < 0)
+                return r;
+
+        c->dirty = false;
+
+        log_debug("Saved unit directory cache %s with %u directories.", path, hashmap_size(c->directories));
+        return 1;
+}
+
 int unit_file_build_name_map(
                 const LookupPaths *lp,
                 uint64_t *cache_timestamp_hash,
+                UnitDirectoryCache *dir_cache,
                 Hashmap **unit_ids_map,
                 Hashmap **unit_names_map,
                 Set **path_cache) {
@@ -378,6 +944,9 @@ int unit_file_build_name_map(
          *
          * At the same, build a cache of paths where to find units. The non-const parameters are for input
          * and output. Existing contents will be freed before the new contents are stored.
+         *
+         * If dir_cache is specified, the contents of directories that did not change since they were last
+         * read are taken from there, and it is updated with the directories that had to be read.
          */
 
         _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
@@ -439,77 +1008,39 @@ int unit_file_build_name_map(
                         return log_oom();
         }
 
+        if (dir_cache) {
+                uint64_t h = search_path_hash(lp, expanded_search_path);
+
+                /* Resolved symlinks depend on the search path, start from scratch if it changed */
+                if (h != dir_cache->search_path_hash) {
+                        dir_cache->directories = hashmap_free(dir_cache->directories);
+                        dir_cache->search_path_hash = h;
+                        dir_cache->dirty = true;
+                }
+        }
+
         STRV_FOREACH(dir, lp->search_path) {
-                _cleanup_closedir_ DIR *d = NULL;
+                _cleanup_(unit_directory_freep) UnitDirectory *uncached = NULL;
+                UnitDirectory *d;
 
-                d = opendir(*dir);
-                if (!d) {
-                        if (errno != ENOENT)
-                                log_warning_errno(errno, "Failed to open \"%s\", ignoring: %m", *dir);
+                r = unit_directory_get(dir_cache, lp, *dir, /* with_directories= */ paths, &uncached, &d);
+                if (r == -ENOMEM)
+                        return log_oom();
+                if (r < 0) {
+                        if (r != -ENOENT)
+                                log_warning_errno(r, "Failed to read \"%s\", ignoring: %m", *dir);
                         continue;
                 }
 
-                FOREACH_DIRENT_ALL(de, d, log_warning_errno(errno, "Failed to read \"%s\", ignoring: %m", *dir)) {
+                FOREACH_ARRAY(e, d->entries, d->n_entries) {
                         _unused_ _cleanup_free_ char *_filename_free = NULL;
                         char *filename;
                         _cleanup_free_ char *dst = NULL;
-                        bool symlink_to_dir = false;
-
-                        /* We only care about valid units and dirs with certain suffixes, let's ignore the
-                         * rest. */
-
-                        if (de->d_type == DT_REG) {
-
-                                /* Accept a regular file whose name is a valid unit file name. */
-                                if (!unit_name_is_valid(de->d_name, UNIT_NAME_ANY))
-                                        continue;
 
-                        } else if (de->d_type == DT_DIR) {
-
-                                if (!paths) /* Skip directories early unless path_cache is requested */
-                                        continue;
-
-                                r = directory_name_is_valid(de->d_name);
-                                if (r < 0)
-                                        return r;
-                                if (r == 0)
-                                        continue;
-
-                        } else if (de->d_type == DT_LNK) {
-
-                                /* Accept a symlink file whose name is a valid unit file name or
-                                 * ending in .wants/, .requires/ or .d/. */
-
-                                if (!unit_name_is_valid(de->d_name, UNIT_NAME_ANY)) {
-                                        _cleanup_free_ char *target = NULL;
-
-                                        if (!paths) /* Skip symlink to a directory early unless path_cache is requested */
-                                                continue;
-
-                                        r = directory_name_is_valid(de->d_name);
-                                        if (r < 0)
-                                                return r;
-                                        if (r == 0)
-                                                continue;
-
-                                        r = readlinkat_malloc(dirfd(d), de->d_name, &target);
-                                        if (r < 0) {
-                                                log_warning_errno(r, "Failed to read symlink %s/%s, ignoring: %m",
-                                                                  *dir, de->d_name);
-                                                continue;
-                                        }
-
-                                        r = is_dir(target, /* follow= */ true);
-                                        if (r <= 0)
-                                                continue;
-
-                                        symlink_to_dir = true;
-                                }
-
-                        } else
+                        if (e->type == UNIT_DIRECTORY_ENTRY_DIRECTORY && !paths)
                                 continue;
 
-                        filename = path_join(*dir, de->d_name);
+                        filename = path_join(*dir, e->name);
                         if (!filename)
                                 return log_oom();
 
@@ -522,29 +1053,39 @@ int unit_file_build_name_map(
                         } else
                                 _filename_free = filename; /* Make sure we free the filename. */
 
-                        if (de->d_type == DT_DIR || (de->d_type == DT_LNK && symlink_to_dir))
+                        if (e->type == UNIT_DIRECTORY_ENTRY_DIRECTORY)
                                 continue;
 
-                        assert(IN_SET(de->d_type, DT_REG, DT_LNK));
-
                         /* search_path is ordered by priority (highest first). If the name is already mapped
                          * to something (incl. itself), it means that we have already seen it, and we should
                          * ignore it here. */
-                        if (hashmap_contains(ids, de->d_name))
+                        if (hashmap_contains(ids, e->name))
                                 continue;
 
-                        if (de->d_type == DT_LNK) {
+                        if (e->type == UNIT_DIRECTORY_ENTRY_SYMLINK) {
                                 /* We don't explicitly check for alias loops here. unit_ids_map_get() which
                                  * limits the number of hops should be used to access the map. */
 
-                                r = unit_file_resolve_symlink(lp->root_dir, expanded_search_path,
-                                                              *dir, dirfd(d), de->d_name,
-                                                              /* resolve_destination_target= */ false,
-                                                              &dst);
-                                if (r == -ENOMEM)
-                                        return r;
-                                if (r < 0)  /* we ignore other errors here */
-                                        continue;
+                                if (!e->resolved) {
+                                        r = unit_file_resolve_symlink(lp->root_dir, expanded_search_path,
+                                                                      /* dir= */ NULL, AT_FDCWD, filename,
+                                                                      /* resolve_destination_target= */ false,
+                                                                      &e->destination);
+                                        if (r == -ENOMEM)
+                                                return r;
+                                        if (r < 0)  /* we ignore other errors here */
+                                                continue;
+
+                                        /* Only remember successful resolutions, so that errors are logged
+                                         * again next time */
+                                        e->resolved = true;
+                                        if (dir_cache && d != uncached)
+                                                dir_cache->dirty = true;
+                                }
+
+                                dst = strdup(e->destination);
+                                if (!dst)
+                                        return log_oom();
 
                         } else {
                                 dst = TAKE_PTR(_filename_free); /* Grab the copy we made previously, if available. */
@@ -557,14 +1098,14 @@ int unit_file_build_name_map(
                                 log_debug("%s: normal unit file: %s", __func__, dst);
                         }
 
-                        _cleanup_free_ char *key = strdup(de->d_name);
+                        _cleanup_free_ char *key = strdup(e->name);
                         if (!key)
                                 return log_oom();
 
                         r = hashmap_ensure_put(&ids, &string_hash_ops_free_free, key, dst);
                         if (r < 0)
                                 return log_warning_errno(r, "Failed to add entry to hashmap (%s%s%s): %m",
-                                                         de->d_name, glyph(GLYPH_ARROW_RIGHT), dst);
+                                                         e->name, glyph(GLYPH_ARROW_RIGHT), dst);
                         key = dst = NULL;
                 }
         }
@@ -630,6 +1171,7 @@ int unit_file_build_name_map(
 int unit_file_remove_from_name_map(
                 const LookupPaths *lp,
                 uint64_t *cache_timestamp_hash,
+                UnitDirectoryCache *dir_cache,
                 Hashmap **unit_ids_map,
                 Hashmap **unit_names_map,
                 Set **path_cache,
@@ -643,7 +1185,7 @@ int unit_file_remove_from_name_map(
 
         /* If one of the lookup paths we are monitoring is already changed, let's rebuild the map. Then, the
          * new map should not contain entries relevant to the specified path. */
-        r = unit_file_build_name_map(lp, cache_timestamp_hash, unit_ids_map, unit_names_map, path_cache);
+        r = unit_file_build_name_map(lp, cache_timestamp_hash, dir_cache, unit_ids_map, unit_names_map, path_cache);
         if (r != 0)
                 return r;
 
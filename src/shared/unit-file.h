@@ -55,9 +55,17 @@ int unit_file_resolve_symlink(
                 bool resolve_destination_target,
                 char **ret_destination);
 
+UnitDirectoryCache* unit_directory_cache_new(void);
+UnitDirectoryCache* unit_directory_cache_free(UnitDirectoryCache *c);
+DEFINE_TRIVIAL_CLEANUP_FUNC(UnitDirectoryCache*, unit_directory_cache_free);
+
+int unit_directory_cache_load(UnitDirectoryCache *c, const char *path);
+int unit_directory_cache_save(UnitDirectoryCache *c, const char *path);
+
 int unit_file_build_name_map(
                 const LookupPaths *lp,
                 uint64_t *cache_timestamp_hash,
+                UnitDirectoryCache *dir_cache,
                 Hashmap **unit_ids_map,
                 Hashmap **unit_names_map,
                 Set **path_cache);
@@ -65,6 +73,7 @@ int unit_file_build_name_map(
 int unit_file_remove_from_name_map(
                 const LookupPaths *lp,
                 uint64_t *cache_timestamp_hash,
+                UnitDirectoryCache *dir_cache,
                 Hashmap **unit_ids_map,
                 Hashmap **unit_names_map,
                 Set **path_cache,
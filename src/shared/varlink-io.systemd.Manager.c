@@ -14,6 +14,13 @@ static SD_VARLINK_DEFINE_STRUCT_TYPE(
                 SD_VARLINK_FIELD_COMMENT("'journal' target log level"),
                 SD_VARLINK_DEFINE_FIELD(journal, SD_VARLINK_STRING, 0));
 
+static SD_VARLINK_DEFINE_STRUCT_TYPE(
+                GarbageCollectionPauseBucket,
+                SD_VARLINK_FIELD_COMMENT("Upper bound of the pauses counted in this bucket, in microseconds, unset for the last bucket"),
+                SD_VARLINK_DEFINE_FIELD(MaxUSec, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("Number of garbage collection runs that took longer than the previous bucket's upper bound, but not longer than this one's"),
+                SD_VARLINK_DEFINE_FIELD(Count, SD_VARLINK_INT, 0));
+
 /* The split between ManagerContext and ManagerRuntime follows the rule:
  * - Context is what cannot change once configuration is loaded. You can think about context settings as constants.
  * - Runtime is changeable settings at runtime, in other words - variables. */
@@ -155,6 +162,26 @@ static SD_VARLINK_DEFINE_STRUCT_TYPE(
                 SD_VARLINK_DEFINE_FIELD(NInstalledJobs, SD_VARLINK_INT, 0),
                 SD_VARLINK_FIELD_COMMENT("The total amount of failed jobs"),
                 SD_VARLINK_DEFINE_FIELD(NFailedJobs, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("The total amount of transactions processed"),
+                SD_VARLINK_DEFINE_FIELD(NTransactions, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("The total time spent processing transactions, in microseconds"),
+                SD_VARLINK_DEFINE_FIELD(TransactionsUSec, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("The time spent processing the most expensive transaction, in microseconds"),
+                SD_VARLINK_DEFINE_FIELD(TransactionMaxUSec, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("The number of garbage collection runs"),
+                SD_VARLINK_DEFINE_FIELD(NGarbageCollectionRuns, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("The number of units unloaded by garbage collection"),
+                SD_VARLINK_DEFINE_FIELD(NGarbageCollectedUnits, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("The time taken by the longest garbage collection run, in microseconds"),
+                SD_VARLINK_DEFINE_FIELD(GarbageCollectionPauseMaxUSec, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("Histogram of the time taken by garbage collection runs"),
+                SD_VARLINK_DEFINE_FIELD_BY_TYPE(GarbageCollectionPauses, GarbageCollectionPauseBucket, SD_VARLINK_ARRAY),
+                SD_VARLINK_FIELD_COMMENT("The total amount of child processes reaped"),
+                SD_VARLINK_DEFINE_FIELD(NReapedChildren, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("The total time from SIGCHLD until the units of the reaped children processed their exit, in microseconds"),
+                SD_VARLINK_DEFINE_FIELD(ReapLatencyUSec, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("The longest time from SIGCHLD until the units of a reaped child processed its exit, in microseconds"),
+                SD_VARLINK_DEFINE_FIELD(ReapLatencyMaxUSec, SD_VARLINK_INT, 0),
                 SD_VARLINK_FIELD_COMMENT("IDs of transactions that encountered ordering cycle"),
                 SD_VARLINK_DEFINE_FIELD(TransactionsWithOrderingCycle, SD_VARLINK_INT, SD_VARLINK_ARRAY|SD_VARLINK_NULLABLE),
                 SD_VARLINK_FIELD_COMMENT("Boot progress as a floating point value between 0.0 and 1.0"),
@@ -213,4 +240,5 @@ SD_VARLINK_DEFINE_INTERFACE(
                 &vl_type_ResourceLimit,
                 &vl_type_ResourceLimitTable,
                 &vl_type_RateLimit,
-                &vl_type_LogLevelStruct);
+                &vl_type_LogLevelStruct,
+                &vl_type_GarbageCollectionPauseBucket);
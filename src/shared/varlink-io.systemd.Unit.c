@@ -1023,11 +1023,73 @@ static SD_VARLINK_DEFINE_METHOD_FULL(
                 SD_VARLINK_FIELD_COMMENT("Runtime information of the unit"),
                 SD_VARLINK_DEFINE_OUTPUT_BY_TYPE(runtime, UnitRuntime, 0));
 
+static SD_VARLINK_DEFINE_METHOD_FULL(
+                ListAccounting,
+                SD_VARLINK_REQUIRES_MORE,
+                SD_VARLINK_FIELD_COMMENT("Name of the unit"),
+                SD_VARLINK_DEFINE_OUTPUT(name, SD_VARLINK_STRING, 0),
+                SD_VARLINK_FIELD_COMMENT("Resource usage counters of the unit's cgroup. Only the accounting fields are set, limits and other cgroup properties are not."),
+                SD_VARLINK_DEFINE_OUTPUT_BY_TYPE(CGroup, CGroupRuntime, SD_VARLINK_NULLABLE));
+
+static SD_VARLINK_DEFINE_STRUCT_TYPE(
+                UnitState,
+                SD_VARLINK_FIELD_COMMENT("The load state of the unit"),
+                SD_VARLINK_DEFINE_FIELD(LoadState, SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("The active state of the unit"),
+                SD_VARLINK_DEFINE_FIELD(ActiveState, SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("The freezer state of the unit"),
+                SD_VARLINK_DEFINE_FIELD(FreezerState, SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("The sub state of the unit"),
+                SD_VARLINK_DEFINE_FIELD(SubState, SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("The ID of the job currently queued for the unit"),
+                SD_VARLINK_DEFINE_FIELD(JobId, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("Current invocation ID"),
+                SD_VARLINK_DEFINE_FIELD(InvocationID, SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("The last time the unit changed its state"),
+                SD_VARLINK_DEFINE_FIELD_BY_TYPE(StateChangeTimestamp, Timestamp, SD_VARLINK_NULLABLE));
+
+static SD_VARLINK_DEFINE_STRUCT_TYPE(
+                UnitStateChange,
+                SD_VARLINK_FIELD_COMMENT("Name of the unit"),
+                SD_VARLINK_DEFINE_FIELD(name, SD_VARLINK_STRING, 0),
+                SD_VARLINK_FIELD_COMMENT("Sequence number of the last change of the unit"),
+                SD_VARLINK_DEFINE_FIELD(seqnum, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("The fields that changed, with their new values. Fields not set did not change."),
+                SD_VARLINK_DEFINE_FIELD_BY_TYPE(state, UnitState, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("Names of the fields that are not set anymore"),
+                SD_VARLINK_DEFINE_FIELD(cleared, SD_VARLINK_STRING, SD_VARLINK_ARRAY|SD_VARLINK_NULLABLE));
+
+static SD_VARLINK_DEFINE_METHOD_FULL(
+                Subscribe,
+                SD_VARLINK_REQUIRES_MORE,
+                SD_VARLINK_FIELD_COMMENT("The stream to resume, as returned by a previous call"),
+                SD_VARLINK_DEFINE_INPUT(streamID, SD_VARLINK_STRING, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("The sequence number of the last message received from the stream to resume"),
+                SD_VARLINK_DEFINE_INPUT(since, SD_VARLINK_INT, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("The stream the message belongs to. If this changes, the client has to discard what it knows about the units."),
+                SD_VARLINK_DEFINE_OUTPUT(streamID, SD_VARLINK_STRING, 0),
+                SD_VARLINK_FIELD_COMMENT("Sequence number of the message, to pass to a later call in order to resume the stream from here"),
+                SD_VARLINK_DEFINE_OUTPUT(seqnum, SD_VARLINK_INT, 0),
+                SD_VARLINK_FIELD_COMMENT("If true, the message contains the complete state of all units, and the client has to discard what it knows about units not listed"),
+                SD_VARLINK_DEFINE_OUTPUT(reset, SD_VARLINK_BOOL, SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("Units that went away. These are to be processed before the units that changed, a unit that went away might have come back since."),
+                SD_VARLINK_DEFINE_OUTPUT(removed, SD_VARLINK_STRING, SD_VARLINK_ARRAY|SD_VARLINK_NULLABLE),
+                SD_VARLINK_FIELD_COMMENT("Units that appeared or changed"),
+                SD_VARLINK_DEFINE_OUTPUT_BY_TYPE(units, UnitStateChange, SD_VARLINK_ARRAY|SD_VARLINK_NULLABLE));
+
 SD_VARLINK_DEFINE_INTERFACE(
                 io_systemd_Unit,
                 "io.systemd.Unit",
                 SD_VARLINK_SYMBOL_COMMENT("List units"),
                 &vl_method_List,
+                SD_VARLINK_SYMBOL_COMMENT("List resource accounting data of all units with a cgroup, reading each cgroup attribute at most once per unit"),
+                &vl_method_ListAccounting,
+                SD_VARLINK_SYMBOL_COMMENT("Subscribe to the state of all units. The first message is a snapshot of all units, or of the changes since the given sequence number if the stream can be resumed, later messages carry only the fields that changed."),
+                &vl_method_Subscribe,
+                SD_VARLINK_SYMBOL_COMMENT("A compact summary of a unit's state"),
+                &vl_type_UnitState,
+                SD_VARLINK_SYMBOL_COMMENT("A change of a unit's state"),
+                &vl_type_UnitStateChange,
                 &vl_type_RateLimit,
                 SD_VARLINK_SYMBOL_COMMENT("An object to represent a unit's conditions"),
                 &vl_type_Condition,
@@ -578,7 +578,7 @@ int unit_find_paths(
                 }
         } else {
                 if (!*cached_name_map) {
-                        r = unit_file_build_name_map(lp, NULL, cached_id_map, cached_name_map, NULL);
+                        r = unit_file_build_name_map(lp, NULL, NULL, cached_id_map, cached_name_map, NULL);
                         if (r < 0)
                                 return r;
                 }
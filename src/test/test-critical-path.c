@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "sd-bus.h"
+
+#include "critical-path.h"
+#include "fileio.h"
+#include "job.h"
+#include "manager.h"
+#include "path-util.h"
+#include "prioq.h"
+#include "rm-rf.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+
+static char *runtime_dir = NULL;
+
+STATIC_DESTRUCTOR_REGISTER(runtime_dir, rm_rf_physical_and_freep);
+
+static Manager* setup_manager(void) {
+        _cleanup_(manager_freep) Manager *m = NULL;
+        int r;
+
+        r = manager_new(RUNTIME_SCOPE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (manager_errno_skip_test(r)) {
+                log_tests_skipped_errno(r, "manager_new");
+                return NULL;
+        }
+        ASSERT_OK(r);
+        ASSERT_OK(manager_startup(m, NULL, NULL, NULL));
+
+        return TAKE_PTR(m);
+}
+
+static void set_activation_time(Unit *u, usec_t start, usec_t end) {
+        u->inactive_exit_timestamp = (dual_timestamp) { .realtime = start, .monotonic = start };
+        u->active_enter_timestamp = (dual_timestamp) { .realtime = end, .monotonic = end };
+}
+
+TEST(critical_path) {
+        _cleanup_(sd_bus_error_free) sd_bus_error err = SD_BUS_ERROR_NULL;
+        _cleanup_(rm_rf_physical_and_freep) char *d = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        _cleanup_free_ char *p = NULL;
+        Unit *a, *b, *c, *f;
+        Job *j;
+
+        m = setup_manager();
+        if (!m)
+                return;
+
+        /* c requires a, a requires b and is ordered before it, b wants f. Only a → b is an ordering chain. */
+        ASSERT_OK(manager_load_startable_unit_or_warn(m, "c.service", NULL, &c));
+        ASSERT_OK(manager_add_job(m, JOB_START, c, JOB_REPLACE, &err, &j));
+        ASSERT_NOT_NULL(a = manager_get_unit(m, "a.service"));
+        ASSERT_NOT_NULL(b = manager_get_unit(m, "b.service"));
+        ASSERT_NOT_NULL(f = manager_get_unit(m, "f.service"));
+        ASSERT_NOT_NULL(a->job);
+        ASSERT_NOT_NULL(b->job);
+        ASSERT_NOT_NULL(f->job);
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-critical-path.XXXXXX", &d));
+        ASSERT_NOT_NULL(p = path_join(d, "activation-times"));
+
+        /* Invalid lines and unknown units are skipped */
+        ASSERT_OK(write_string_file(p,
+                                    "systemd-activation-times-v1\n"
+                                    "5000000 a.service\n"
+                                    "3000000 b.service\n"
+                                    "100000 c.service\n"
+                                    "1000000 f.service\n"
+                                    "foo a.service\n"
+                                    "2000000\n"
+                                    "7000000 nonexistent.service\n",
+                                    WRITE_STRING_FILE_CREATE));
+        ASSERT_EQ(manager_load_activation_times(m, p), 4);
+        ASSERT_EQ(a->predicted_activation_usec, 5 * USEC_PER_SEC);
+        ASSERT_EQ(b->predicted_activation_usec, 3 * USEC_PER_SEC);
+        ASSERT_EQ(c->predicted_activation_usec, 100 * USEC_PER_MSEC);
+        ASSERT_EQ(f->predicted_activation_usec, 1 * USEC_PER_SEC);
+
+        /* Each unit waits for the longest chain of units ordered after it */
+        ASSERT_EQ(unit_critical_path_length(a), 8 * USEC_PER_SEC);
+        ASSERT_EQ(unit_critical_path_length(b), 3 * USEC_PER_SEC);
+        ASSERT_EQ(unit_critical_path_length(c), 100 * USEC_PER_MSEC);
+        ASSERT_EQ(unit_critical_path_length(f), 1 * USEC_PER_SEC);
+
+        /* The longest chain is a → b, and a's job is dispatched first */
+        ASSERT_EQ(manager_select_critical_path(m), 2);
+        ASSERT_EQ(m->critical_path_predicted_usec, 8 * USEC_PER_SEC);
+        ASSERT_TRUE(a->on_critical_path);
+        ASSERT_TRUE(b->on_critical_path);
+        ASSERT_FALSE(c->on_critical_path);
+        ASSERT_FALSE(f->on_critical_path);
+        ASSERT_NOT_NULL(j = prioq_peek(m->run_queue));
+        ASSERT_PTR_EQ(j->unit, a);
+
+        /* Unknown formats are refused */
+        ASSERT_OK(write_string_file(p, "systemd-activation-times-v0\n5000000 a.service\n", WRITE_STRING_FILE_TRUNCATE));
+        ASSERT_ERROR(manager_load_activation_times(m, p), EBADMSG);
+
+        ASSERT_OK_ZERO(manager_load_activation_times(m, "/tmp/test-critical-path-nonexistent"));
+}
+
+TEST(activation_times_round_trip) {
+        _cleanup_(rm_rf_physical_and_freep) char *d = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        _cleanup_free_ char *p = NULL;
+        Unit *a, *b, *c;
+
+        m = setup_manager();
+        if (!m)
+                return;
+
+        ASSERT_OK(manager_load_startable_unit_or_warn(m, "a.service", NULL, &a));
+        ASSERT_OK(manager_load_startable_unit_or_warn(m, "b.service", NULL, &b));
+        ASSERT_OK(manager_load_startable_unit_or_warn(m, "c.service", NULL, &c));
+
+        set_activation_time(a, 1 * USEC_PER_SEC, 6 * USEC_PER_SEC);
+        set_activation_time(b, 2 * USEC_PER_SEC, 2 * USEC_PER_SEC + 250 * USEC_PER_MSEC);
+        /* c never became active, and is not recorded */
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-critical-path.XXXXXX", &d));
+        ASSERT_NOT_NULL(p = path_join(d, "some/dir/activation-times"));
+        ASSERT_OK(manager_save_activation_times(m, p));
+
+        ASSERT_EQ(manager_load_activation_times(m, p), 2);
+        ASSERT_EQ(a->predicted_activation_usec, 5 * USEC_PER_SEC);
+        ASSERT_EQ(b->predicted_activation_usec, 250 * USEC_PER_MSEC);
+        ASSERT_EQ(c->predicted_activation_usec, 0U);
+}
+
+static int intro(void) {
+        _cleanup_free_ char *unit_dir = NULL;
+
+        if (enter_cgroup_subroot(NULL) == -ENOMEDIUM)
+                return log_tests_skipped("cgroupfs not available");
+
+        ASSERT_OK(get_testdata_dir("test-engine", &unit_dir));
+        ASSERT_OK(setenv_unit_path(unit_dir));
+        ASSERT_NOT_NULL(runtime_dir = setup_fake_runtime_dir());
+        return EXIT_SUCCESS;
+}
+
+DEFINE_TEST_MAIN_WITH_INTRO(LOG_DEBUG, intro);
@@ -416,6 +416,51 @@ TEST(error_catching) {
         assert_se(r == 42);
 }
 
+TEST(timings) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmpdir = NULL;
+        _cleanup_free_ char *contents = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        const char *name, *name2;
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-exec-util.XXXXXXX", &tmpdir));
+
+        const char *dirs[] = { tmpdir, NULL };
+
+        name = strjoina(tmpdir, "/10-slow");
+        name2 = strjoina(tmpdir, "/20-fast");
+
+        ASSERT_OK(write_string_file(name, "#!/bin/sh\nsleep 0.2\n", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK(write_string_file(name2, "#!/bin/sh\nexit 7\n", WRITE_STRING_FILE_CREATE));
+
+        ASSERT_OK_ERRNO(chmod(name, 0755));
+        ASSERT_OK_ERRNO(chmod(name2, 0755));
+
+        if (access(name, X_OK) < 0 && ERRNO_IS_PRIVILEGE(errno))
+                return (void) log_tests_skipped("cannot execute scripts");
+
+        fd = ASSERT_OK(open_tmpfile_unlinkable(NULL, O_RDWR|O_CLOEXEC));
+
+        ASSERT_OK(execute_directories_full(__func__,
+                                           dirs, DEFAULT_TIMEOUT_USEC,
+                                           /* callbacks= */ NULL, /* callback_args= */ NULL,
+                                           fd,
+                                           /* argv= */ NULL, /* envp= */ NULL,
+                                           EXEC_DIR_PARALLEL|EXEC_DIR_IGNORE_ERRORS));
+
+        ASSERT_OK_ERRNO(lseek(fd, 0, SEEK_SET));
+        _cleanup_fclose_ FILE *f = ASSERT_NOT_NULL(take_fdopen(&fd, "r"));
+        ASSERT_OK(read_full_stream(f, &contents, NULL));
+        log_debug("Timings:\n%s", contents);
+
+        /* Children are collected in the order they finish, hence the fast one comes first */
+        _cleanup_strv_free_ char **lines = ASSERT_NOT_NULL(strv_split_newlines(contents));
+        ASSERT_EQ(strv_length(lines), 2u);
+        ASSERT_TRUE(endswith(lines[0], "/20-fast"));
+        ASSERT_NOT_NULL(strstr(lines[0], " 7 "));
+        ASSERT_TRUE(endswith(lines[1], "/10-slow"));
+        ASSERT_NOT_NULL(strstr(lines[1], " 0 "));
+}
+
 TEST(exec_command_flags_from_strv) {
         ExecCommandFlags flags = 0;
         char **valid_strv = STRV_MAKE("no-env-expand", "no-setuid", "ignore-failure");
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+/* Measures how many processes the manager can spawn per second, and the latency from exec_spawn() until
+ * sd-executor hands off to the payload, once without and once with the executor pool.
+ *
+ * Usage: test-executor-pool [N_SPAWNS [POOL_SIZE]]
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sd-event.h"
+
+#include "capability-util.h"
+#include "executor-pool.h"
+#include "fileio.h"
+#include "hash-funcs.h"
+#include "manager.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "service.h"
+#include "sort-util.h"
+#include "tests.h"
+#include "time-util.h"
+#include "tmpfile-util.h"
+#include "unit.h"
+
+static unsigned arg_n_spawns = 500;
+static unsigned arg_pool_size = 8;
+
+static void start_parent_slices(Unit *unit) {
+        Unit *slice;
+
+        slice = UNIT_GET_SLICE(unit);
+        if (slice) {
+                start_parent_slices(slice);
+                ASSERT_OK_OR(unit_start(slice, NULL), -EALREADY);
+        }
+}
+
+static void run_benchmark(unsigned pool_size) {
+        _cleanup_(manager_freep) Manager *m = NULL;
+        _cleanup_free_ usec_t *latency = NULL;
+        usec_t begin, end;
+        Service *s;
+        Unit *u;
+        int r;
+
+        r = manager_new(RUNTIME_SCOPE_SYSTEM, MANAGER_TEST_RUN_BASIC, &m);
+        if (manager_errno_skip_test(r))
+                return (void) log_tests_skipped_errno(r, "manager_new");
+        ASSERT_OK(r);
+
+        m->executor_pool_size = pool_size;
+        ASSERT_OK(manager_startup(m, NULL, NULL, NULL));
+
+        ASSERT_OK(manager_load_startable_unit_or_warn(m, "executor-pool-benchmark.service", NULL, &u));
+        s = ASSERT_PTR(SERVICE(u));
+
+        /* We need to start the slices as well otherwise the slice cgroups might be pruned */
+        start_parent_slices(u);
+
+        /* Let the pool fill up before we start measuring */
+        for (unsigned i = 0; i < 100 && m->n_executor_pool < pool_size; i++)
+                ASSERT_OK(sd_event_run(m->event, 100 * USEC_PER_MSEC));
+        ASSERT_EQ(m->n_executor_pool, (size_t) pool_size);
+
+        latency = new(usec_t, arg_n_spawns);
+        ASSERT_NOT_NULL(latency);
+
+        begin = now(CLOCK_MONOTONIC);
+
+        for (unsigned i = 0; i < arg_n_spawns; i++) {
+                ExecStatus *es = &s->exec_command[SERVICE_EXEC_START]->exec_status;
+
+                ASSERT_OK(unit_start(u, NULL));
+
+                while (!IN_SET(s->state, SERVICE_DEAD, SERVICE_FAILED))
+                        ASSERT_OK(sd_event_run(m->event, 100 * USEC_PER_MSEC));
+
+                ASSERT_EQ(s->result, SERVICE_SUCCESS);
+
+                latency[i] = usec_sub_unsigned(es->handoff_timestamp.monotonic, es->start_timestamp.monotonic);
+        }
+
+        end = now(CLOCK_MONOTONIC);
+
+        typesafe_qsort(latency, arg_n_spawns, uint64_compare_func);
+
+        log_info("Pool size %u: %u spawns in %s, %.1f spawns/s, latency p50 %s, p99 %s, max %s",
+                 pool_size,
+                 arg_n_spawns,
+                 FORMAT_TIMESPAN(end - begin, USEC_PER_MSEC),
+                 (double) arg_n_spawns * USEC_PER_SEC / MAX(end - begin, 1u),
+                 FORMAT_TIMESPAN(latency[(arg_n_spawns - 1) * 50 / 100], 1),
+                 FORMAT_TIMESPAN(latency[(arg_n_spawns - 1) * 99 / 100], 1),
+                 FORMAT_TIMESPAN(latency[arg_n_spawns - 1], 1));
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *unit_dir = NULL;
+        _cleanup_free_ char *unit_path = NULL;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc > 1)
+                ASSERT_OK(safe_atou(argv[1], &arg_n_spawns));
+        if (argc > 2)
+                ASSERT_OK(safe_atou(argv[2], &arg_pool_size));
+
+        ASSERT_GT(arg_n_spawns, 0u);
+        ASSERT_LE(arg_pool_size, EXECUTOR_POOL_SIZE_MAX);
+
+        /* It is needed otherwise cgroup creation fails */
+        if (geteuid() != 0 || have_effective_cap(CAP_SYS_ADMIN) <= 0)
+                return log_tests_skipped("not privileged");
+
+        r = enter_cgroup_subroot(NULL);
+        if (r == -ENOMEDIUM)
+                return log_tests_skipped("cgroupfs not available");
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-executor-pool-XXXXXX", &unit_dir));
+        ASSERT_NOT_NULL((unit_path = path_join(unit_dir, "executor-pool-benchmark.service")));
+        ASSERT_OK(write_string_file(
+                        unit_path,
+                        "[Unit]\n"
+                        "StartLimitIntervalSec=0\n"
+                        "[Service]\n"
+                        "Type=oneshot\n"
+                        "ExecStart=/bin/true\n"
+                        "StandardOutput=null\n",
+                        WRITE_STRING_FILE_CREATE));
+        ASSERT_OK(setenv_unit_path(unit_dir));
+
+        run_benchmark(/* pool_size= */ 0);
+        if (arg_pool_size > 0)
+                run_benchmark(arg_pool_size);
+
+        return EXIT_SUCCESS;
+}
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include <stdio.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "sd-daemon.h"
@@ -12,6 +13,7 @@
 #include "conf-parser.h"
 #include "fileio.h"
 #include "format-util.h"
+#include "fs-util.h"
 #include "hashmap.h"
 #include "hostname-setup.h"
 #include "install.h"
@@ -19,6 +21,7 @@
 #include "load-fragment.h"
 #include "manager.h"
 #include "open-file.h"
+#include "path-util.h"
 #include "pcre2-util.h"
 #include "rm-rf.h"
 #include "set.h"
@@ -26,6 +29,7 @@
 #include "string-util.h"
 #include "strv.h"
 #include "tests.h"
+#include "tmpfile-util.h"
 #include "user-util.h"
 
 /* Nontrivial value serves as a placeholder to check that parsing function (didn't) change it */
@@ -1033,6 +1037,72 @@ TEST(config_parse_open_file) {
         ASSERT_NULL(of);
 }
 
+TEST(reload_unit_files) {
+        _cleanup_(rm_rf_physical_and_freep) char *unit_dir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        _cleanup_free_ char *wants_dir = NULL;
+        Unit *a, *b, *c;
+        const char *p;
+        int r;
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-reload-unit-files-XXXXXX", &unit_dir));
+
+        p = strjoina(unit_dir, "/a.service");
+        ASSERT_OK(write_string_file(p, "[Unit]\nWants=b.service\n[Service]\nExecStart=/bin/true\n", WRITE_STRING_FILE_CREATE));
+        p = strjoina(unit_dir, "/b.service");
+        ASSERT_OK(write_string_file(p, "[Unit]\nDescription=old\n[Service]\nExecStart=/bin/true\n", WRITE_STRING_FILE_CREATE));
+        p = strjoina(unit_dir, "/c.service");
+        ASSERT_OK(write_string_file(p, "[Service]\nExecStart=/bin/true\n", WRITE_STRING_FILE_CREATE));
+
+        ASSERT_OK(setenv_unit_path(unit_dir));
+
+        r = manager_new(RUNTIME_SCOPE_USER, MANAGER_TEST_RUN_MINIMAL, &m);
+        if (manager_errno_skip_test(r)) {
+                log_notice_errno(r, "Skipping test: manager_new: %m");
+                return;
+        }
+
+        ASSERT_OK(r);
+        ASSERT_OK(manager_startup(m, NULL, NULL, NULL));
+
+        ASSERT_OK(manager_load_unit(m, "a.service", NULL, NULL, &a));
+        ASSERT_OK(manager_load_unit(m, "c.service", NULL, NULL, &c));
+        ASSERT_NOT_NULL(b = manager_get_unit(m, "b.service"));
+        ASSERT_STREQ(b->description, "old");
+
+        /* Nothing changed, nothing is replaced */
+        ASSERT_OK_POSITIVE(manager_reload_unit_files(m));
+        ASSERT_PTR_EQ(manager_get_unit(m, "a.service"), a);
+        ASSERT_PTR_EQ(manager_get_unit(m, "b.service"), b);
+
+        /* Only b.service is reloaded, and a.service still wants it afterwards */
+        p = strjoina(unit_dir, "/b.service");
+        ASSERT_OK(write_string_file(p, "[Unit]\nDescription=new\n[Service]\nExecStart=/bin/true\n", WRITE_STRING_FILE_TRUNCATE));
+        ASSERT_OK(touch_file(p, /* parents= */ false, b->fragment_mtime + USEC_PER_SEC, UID_INVALID, GID_INVALID, MODE_INVALID));
+
+        ASSERT_OK_POSITIVE(manager_reload_unit_files(m));
+        ASSERT_PTR_EQ(manager_get_unit(m, "a.service"), a);
+        ASSERT_NOT_NULL(b = manager_get_unit(m, "b.service"));
+        ASSERT_STREQ(b->description, "new");
+        ASSERT_TRUE(unit_dependency_set_get(unit_get_dependencies(a, UNIT_WANTS), b));
+        ASSERT_TRUE(unit_dependency_set_get(unit_get_dependencies(b, UNIT_WANTED_BY), a));
+
+        /* New entries in .wants/ are picked up too */
+        ASSERT_NOT_NULL(wants_dir = path_join(unit_dir, "a.service.wants"));
+        ASSERT_OK_ERRNO(mkdir(wants_dir, 0755));
+        p = strjoina(wants_dir, "/c.service");
+        ASSERT_OK_ERRNO(symlink("../c.service", p));
+
+        ASSERT_OK_POSITIVE(manager_reload_unit_files(m));
+        ASSERT_NOT_NULL(a = manager_get_unit(m, "a.service"));
+        ASSERT_PTR_EQ(manager_get_unit(m, "b.service"), b);
+        ASSERT_PTR_EQ(manager_get_unit(m, "c.service"), c);
+        ASSERT_TRUE(unit_dependency_set_get(unit_get_dependencies(a, UNIT_WANTS), b));
+        ASSERT_TRUE(unit_dependency_set_get(unit_get_dependencies(a, UNIT_WANTS), c));
+
+        ASSERT_OK_ERRNO(unsetenv("SYSTEMD_UNIT_PATH"));
+}
+
 static int intro(void) {
         if (enter_cgroup_subroot(NULL) == -ENOMEDIUM)
                 return log_tests_skipped("cgroupfs not available");
@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+/* Measures how long the manager takes to serialize and deserialize its state with many units and a large
+ * fd store, i.e. the pause a daemon-reexec causes.
+ *
+ * Usage: test-manager-serialize [N_UNITS [N_FDS]]
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fd-util.h"
+#include "fdset.h"
+#include "fileio.h"
+#include "manager.h"
+#include "manager-serialize.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "rlimit-util.h"
+#include "rm-rf.h"
+#include "serialize.h"
+#include "service.h"
+#include "tests.h"
+#include "time-util.h"
+#include "tmpfile-util.h"
+#include "unit.h"
+
+static unsigned arg_n_units = 10000;
+static unsigned arg_n_fds = 4096;
+
+static int new_manager(Manager **ret) {
+        _cleanup_(manager_freep) Manager *m = NULL;
+        int r;
+
+        r = manager_new(RUNTIME_SCOPE_USER, MANAGER_TEST_RUN_MINIMAL, &m);
+        if (r < 0)
+                return r;
+
+        ASSERT_OK(manager_startup(m, NULL, NULL, NULL));
+
+        *ret = TAKE_PTR(m);
+        return 0;
+}
+
+static void fill_fd_store(Manager *m) {
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        usec_t begin;
+        Unit *u;
+
+        /* There is no API to add to the fd store from here, hence go through the deserialization path,
+         * which also is what restores the fd store on reexec. */
+
+        ASSERT_NOT_NULL(fds = fdset_new());
+        ASSERT_OK(open_serialization_file("test-manager-serialize", &f));
+
+        fputs("\nserialize-benchmark-store.service\n", f);
+        for (unsigned i = 0; i < arg_n_fds; i++) {
+                int fd;
+
+                ASSERT_OK_ERRNO(fd = open("/dev/null", O_RDONLY|O_CLOEXEC));
+                ASSERT_OK(fdset_consume(fds, fd));
+                ASSERT_OK(serialize_item_format(f, "fd-store-fd", "%i \"fd%u\" 0", fd, i));
+        }
+        fputc('\n', f);
+
+        ASSERT_OK(finish_serialization_file(f));
+
+        begin = now(CLOCK_MONOTONIC);
+        ASSERT_OK(manager_deserialize(m, f, fds));
+
+        log_info("Restored fd store with %u fds in %s",
+                 arg_n_fds, FORMAT_TIMESPAN(usec_sub_unsigned(now(CLOCK_MONOTONIC), begin), 1));
+
+        u = ASSERT_PTR(manager_get_unit(m, "serialize-benchmark-store.service"));
+        ASSERT_EQ(SERVICE(u)->n_fd_store, arg_n_fds);
+}
+
+static void run_benchmark(void) {
+        _cleanup_(manager_freep) Manager *m = NULL, *m2 = NULL;
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        usec_t begin, serialized, deserialized;
+        Unit *u;
+        int r;
+
+        r = new_manager(&m);
+        if (manager_errno_skip_test(r))
+                return (void) log_tests_skipped_errno(r, "manager_new");
+        ASSERT_OK(r);
+
+        for (unsigned i = 0; i < arg_n_units; i++) {
+                char name[STRLEN("serialize-benchmark@.service") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(name, "serialize-benchmark@%u.service", i);
+                ASSERT_OK(manager_load_unit(m, name, NULL, NULL, &u));
+        }
+
+        ASSERT_OK(manager_load_unit(m, "serialize-benchmark-store.service", NULL, NULL, &u));
+        fill_fd_store(m);
+
+        ASSERT_NOT_NULL(fds = fdset_new());
+        ASSERT_OK(open_serialization_file("test-manager-serialize", &f));
+
+        begin = now(CLOCK_MONOTONIC);
+        ASSERT_OK(manager_serialize(m, f, fds, /* switching_root= */ false));
+        ASSERT_OK(finish_serialization_file(f));
+        serialized = usec_sub_unsigned(now(CLOCK_MONOTONIC), begin);
+
+        /* Free the old manager first, like a reexec does */
+        m = manager_free(m);
+        ASSERT_OK(new_manager(&m2));
+
+        begin = now(CLOCK_MONOTONIC);
+        ASSERT_OK(manager_deserialize(m2, f, fds));
+        deserialized = usec_sub_unsigned(now(CLOCK_MONOTONIC), begin);
+
+        u = ASSERT_PTR(manager_get_unit(m2, "serialize-benchmark-store.service"));
+        ASSERT_EQ(SERVICE(u)->n_fd_store, arg_n_fds);
+
+        log_info("%u units, %u fds: serialized in %s, deserialized in %s",
+                 arg_n_units,
+                 arg_n_fds,
+                 FORMAT_TIMESPAN(serialized, 1),
+                 FORMAT_TIMESPAN(deserialized, 1));
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *unit_dir = NULL;
+        _cleanup_free_ char *template_path = NULL, *store_path = NULL, *store_contents = NULL;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc > 1)
+                ASSERT_OK(safe_atou(argv[1], &arg_n_units));
+        if (argc > 2)
+                ASSERT_OK(safe_atou(argv[2], &arg_n_fds));
+
+        /* Each fd exists up to three times: in the fd store, in the serialization set, and in the new
+         * manager's fd store */
+        r = rlimit_nofile_bump(3 * arg_n_fds + 1024);
+        if (r < 0)
+                return log_tests_skipped_errno(r, "Failed to bump RLIMIT_NOFILE");
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-manager-serialize-XXXXXX", &unit_dir));
+
+        ASSERT_NOT_NULL((template_path = path_join(unit_dir, "serialize-benchmark@.service")));
+        ASSERT_OK(write_string_file(
+                        template_path,
+                        "[Service]\n"
+                        "ExecStart=/bin/true\n",
+                        WRITE_STRING_FILE_CREATE));
+
+        ASSERT_NOT_NULL((store_path = path_join(unit_dir, "serialize-benchmark-store.service")));
+        ASSERT_OK(asprintf(&store_contents,
+                           "[Service]\n"
+                           "ExecStart=/bin/true\n"
+                           "FileDescriptorStoreMax=%u\n",
+                           arg_n_fds));
+        ASSERT_OK(write_string_file(store_path, store_contents, WRITE_STRING_FILE_CREATE));
+
+        ASSERT_OK(setenv_unit_path(unit_dir));
+
+        run_benchmark();
+
+        return EXIT_SUCCESS;
+}
@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include "memory-util.h"
 #include "mempool.h"
 #include "random-util.h"
 #include "tests.h"
@@ -18,6 +19,7 @@ TEST(mempool_trim) {
 
         assert_se(!test_mempool.first_pool);
         assert_se(!test_mempool.freelist);
+        assert_se(mempool_allocated(&test_mempool) == 0);
 
         mempool_trim(&test_mempool);
 
@@ -26,6 +28,8 @@ TEST(mempool_trim) {
                 a[i]->value = i;
         }
 
+        assert_se(mempool_allocated(&test_mempool) >= NN * sizeof(struct element));
+
         mempool_trim(&test_mempool);
 
         /* free up to one third randomly */
@@ -87,6 +91,41 @@ TEST(mempool_trim) {
 
         assert_se(!test_mempool.first_pool);
         assert_se(!test_mempool.freelist);
+        assert_se(mempool_allocated(&test_mempool) == 0);
+}
+
+struct big_element {
+        uint8_t data[512];
+};
+
+TEST(mempool_at_most) {
+        static struct mempool pool = {
+                .tile_size = sizeof(struct big_element),
+                .at_least = 8,
+                .at_most = 32,
+        };
+        struct big_element *a[1000];
+
+        FOREACH_ELEMENT(e, a)
+                ASSERT_NOT_NULL(*e = mempool_alloc_tile(&pool));
+
+        /* Freed tiles are reused */
+        a[0] = mempool_free_tile(&pool, a[0]);
+        ASSERT_NOT_NULL(a[0] = mempool_alloc_tile(&pool));
+        ASSERT_GE(mempool_allocated(&pool), ELEMENTSOF(a) * sizeof(struct big_element));
+
+        /* Keep the most recently allocated tile, which sits in the newest chunk, and release the rest */
+        for (size_t i = 0; i < ELEMENTSOF(a) - 1; i++)
+                a[i] = mempool_free_tile(&pool, a[i]);
+
+        mempool_trim(&pool);
+        ASSERT_GT(mempool_allocated(&pool), 0U);
+        ASSERT_LE(mempool_allocated(&pool), 32 * sizeof(struct big_element) + page_size());
+
+        a[ELEMENTSOF(a) - 1] = mempool_free_tile(&pool, a[ELEMENTSOF(a) - 1]);
+        mempool_trim(&pool);
+        ASSERT_NULL(pool.first_pool);
+        ASSERT_NULL(pool.freelist);
 }
 
 DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -11,6 +11,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
+#include "hashmap.h"
 #include "libmount-util.h"
 #include "mkdir.h"
 #include "mount-util.h"
@@ -604,4 +605,82 @@ TEST(mount_fd_clone) {
         }
 }
 
+TEST(mount_options_equal) {
+        ASSERT_OK_POSITIVE(mount_options_equal(NULL, NULL));
+        ASSERT_OK_POSITIVE(mount_options_equal("", NULL));
+        ASSERT_OK_POSITIVE(mount_options_equal("rw,nosuid", "rw,nosuid"));
+        ASSERT_OK_POSITIVE(mount_options_equal("rw,nosuid,nodev,relatime", "nodev,rw,relatime,nosuid"));
+        ASSERT_OK_POSITIVE(mount_options_equal("rw,relatime,rw", "relatime,rw"));
+        ASSERT_OK_POSITIVE(mount_options_equal("rw,context=\"system_u:object_r:tmp_t:s0,c1\"", "context=\"system_u:object_r:tmp_t:s0,c1\",rw"));
+
+        ASSERT_OK_ZERO(mount_options_equal("rw", NULL));
+        ASSERT_OK_ZERO(mount_options_equal("rw,nosuid", "ro,nosuid"));
+        ASSERT_OK_ZERO(mount_options_equal("rw,size=10k", "rw,size=20k"));
+        ASSERT_OK_ZERO(mount_options_equal("rw,context=\"a,b\"", "rw,context=\"a\",b"));
+}
+
+TEST(statmount_to_mountinfo) {
+        _cleanup_(mnt_free_tablep) struct libmnt_table *table = NULL;
+        _cleanup_(mnt_free_iterp) struct libmnt_iter *iter = NULL;
+        _cleanup_hashmap_free_ Hashmap *by_id = NULL;
+        _cleanup_free_ uint64_t *ids = NULL;
+        size_t n_ids, n_compared = 0;
+        int r;
+
+        r = listmount_all(&ids, &n_ids);
+        if (ERRNO_IS_NEG_NOT_SUPPORTED(r) || ERRNO_IS_NEG_PRIVILEGE(r))
+                return (void) log_tests_skipped_errno(r, "listmount() not available");
+        ASSERT_OK(r);
+        ASSERT_GT(n_ids, 0U);
+
+        r = libmount_parse_mountinfo(/* source= */ NULL, &table, &iter);
+        if (ERRNO_IS_NEG_NOT_SUPPORTED(r))
+                return (void) log_tests_skipped_errno(r, "libmount not available");
+        ASSERT_OK(r);
+
+        for (;;) {
+                struct libmnt_fs *fs;
+
+                r = sym_mnt_table_next_fs(table, iter, &fs);
+                if (r == 1)
+                        break;
+                ASSERT_OK(r);
+
+                ASSERT_OK(hashmap_ensure_put(&by_id, &trivial_hash_ops, UINT32_TO_PTR(sym_mnt_fs_get_id(fs)), fs));
+        }
+
+        /* The strings derived from statmount() must match what libmount reports for the same mount in
+         * /proc/self/mountinfo, otherwise mount units would be considered changed on every rescan. */
+
+        FOREACH_ARRAY(id, ids, n_ids) {
+                _cleanup_free_ char *what = NULL, *where = NULL, *options = NULL, *fstype = NULL;
+                _cleanup_free_ struct statmount *sm = NULL;
+                struct libmnt_fs *fs = NULL;
+
+                r = statmount_alloc(*id,
+                                    STATMOUNT_SB_BASIC|STATMOUNT_MNT_BASIC|STATMOUNT_MNT_POINT|STATMOUNT_FS_TYPE|
+                                    STATMOUNT_FS_SUBTYPE|STATMOUNT_SB_SOURCE|STATMOUNT_MNT_OPTS,
+                                    &sm);
+                if (r == -ENOENT) /* Unmounted in the meantime */
+                        continue;
+                ASSERT_OK(r);
+
+                ASSERT_OK(statmount_to_mountinfo(sm, &what, &where, &options, &fstype));
+
+                fs = hashmap_get(by_id, UINT32_TO_PTR(sm->mnt_id_old));
+                if (!fs) /* Mounted in the meantime */
+                        continue;
+
+                log_debug("%s: %s %s %s", where, what, fstype, options);
+
+                ASSERT_STREQ(where, sym_mnt_fs_get_target(fs));
+                ASSERT_STREQ(what, sym_mnt_fs_get_source(fs) ?: "none");
+                ASSERT_STREQ(fstype, sym_mnt_fs_get_fstype(fs));
+                ASSERT_OK_POSITIVE(mount_options_equal(options, sym_mnt_fs_get_options(fs)));
+                n_compared++;
+        }
+
+        ASSERT_GT(n_compared, 0U);
+}
+
 DEFINE_TEST_MAIN(LOG_DEBUG);
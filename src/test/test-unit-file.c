@@ -1,8 +1,12 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "argv-util.h"
+#include "fd-util.h"
 #include "fileio.h"
 #include "initrd-util.h"
 #include "path-lookup.h"
@@ -14,6 +18,7 @@
 #include "strv.h"
 #include "tests.h"
 #include "time-util.h"
+#include "tmpfile-util.h"
 #include "unit-file.h"
 
 TEST(unit_validate_alias_symlink_and_warn) {
@@ -46,7 +51,7 @@ TEST(unit_file_build_name_map) {
 
         assert_se(lookup_paths_init(&lp, RUNTIME_SCOPE_SYSTEM, 0, NULL) >= 0);
 
-        assert_se(unit_file_build_name_map(&lp, &mtime, &unit_ids, &unit_names, NULL) == 1);
+        assert_se(unit_file_build_name_map(&lp, &mtime, NULL, &unit_ids, &unit_names, NULL) == 1);
 
         HASHMAP_FOREACH_KEY(dst, k, unit_ids)
                 log_info("ids: %s → %s", k, dst);
@@ -59,7 +64,7 @@ TEST(unit_file_build_name_map) {
         char buf[FORMAT_TIMESTAMP_MAX];
         log_debug("Last modification time: %s", format_timestamp(buf, sizeof buf, mtime));
 
-        r = unit_file_build_name_map(&lp, &mtime, &unit_ids, &unit_names, NULL);
+        r = unit_file_build_name_map(&lp, &mtime, NULL, &unit_ids, &unit_names, NULL);
         assert_se(IN_SET(r, 0, 1));
         if (r == 0)
                 log_debug("Cache rebuild skipped based on mtime.");
@@ -101,7 +106,7 @@ static bool test_unit_file_remove_from_name_map_trail(const LookupPaths *lp, siz
 
         _cleanup_hashmap_free_ Hashmap *unit_ids = NULL, *unit_names = NULL;
         _cleanup_set_free_ Set *path_cache = NULL;
-        ASSERT_OK_POSITIVE(unit_file_build_name_map(lp, NULL, &unit_ids, &unit_names, &path_cache));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(lp, NULL, NULL, &unit_ids, &unit_names, &path_cache));
 
         _cleanup_free_ char *name = NULL;
         for (size_t i = 0; i < 100; i++) {
@@ -117,7 +122,7 @@ static bool test_unit_file_remove_from_name_map_trail(const LookupPaths *lp, siz
         ASSERT_OK(write_string_file(path, "[Unit]\n", WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_MKDIR_0755));
 
         uint64_t cache_timestamp_hash = 0;
-        ASSERT_OK_POSITIVE(unit_file_build_name_map(lp, &cache_timestamp_hash, &unit_ids, &unit_names, &path_cache));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(lp, &cache_timestamp_hash, NULL, &unit_ids, &unit_names, &path_cache));
 
         ASSERT_STREQ(hashmap_get(unit_ids, name), path);
         ASSERT_TRUE(strv_equal(hashmap_get(unit_names, name), STRV_MAKE(name)));
@@ -125,7 +130,7 @@ static bool test_unit_file_remove_from_name_map_trail(const LookupPaths *lp, siz
 
         ASSERT_OK_ERRNO(unlink(path));
 
-        ASSERT_OK(r = unit_file_remove_from_name_map(lp, &cache_timestamp_hash, &unit_ids, &unit_names, &path_cache, path));
+        ASSERT_OK(r = unit_file_remove_from_name_map(lp, &cache_timestamp_hash, NULL, &unit_ids, &unit_names, &path_cache, path));
         if (r > 0)
                 return false; /* someone touches unit files. Retrying. */
 
@@ -135,7 +140,7 @@ static bool test_unit_file_remove_from_name_map_trail(const LookupPaths *lp, siz
 
         _cleanup_hashmap_free_ Hashmap *unit_ids_2 = NULL, *unit_names_2 = NULL;
         _cleanup_set_free_ Set *path_cache_2 = NULL;
-        ASSERT_OK_POSITIVE(unit_file_build_name_map(lp, NULL, &unit_ids_2, &unit_names_2, &path_cache_2));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(lp, NULL, NULL, &unit_ids_2, &unit_names_2, &path_cache_2));
 
         if (hashmap_size(unit_ids) != hashmap_size(unit_ids_2) ||
             hashmap_size(unit_names) != hashmap_size(unit_names_2) ||
@@ -170,6 +175,89 @@ TEST(unit_file_remove_from_name_map) {
         assert_not_reached();
 }
 
+static void assert_name_maps_equal(Hashmap *a, Set *a_paths, Hashmap *b, Set *b_paths) {
+        const char *k, *v;
+
+        ASSERT_EQ(hashmap_size(a), hashmap_size(b));
+        HASHMAP_FOREACH_KEY(v, k, a)
+                ASSERT_STREQ(hashmap_get(b, k), v);
+
+        ASSERT_TRUE(set_equal(a_paths, b_paths));
+}
+
+TEST(unit_directory_cache) {
+        _cleanup_(unit_directory_cache_freep) UnitDirectoryCache *c = NULL, *c2 = NULL;
+        _cleanup_(unlink_tempfilep) char p[] = "/tmp/test-unit-directory-cache.XXXXXX";
+        _cleanup_(lookup_paths_done) LookupPaths lp = {};
+        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL, *ids2 = NULL, *names2 = NULL;
+        _cleanup_set_free_ Set *paths = NULL, *paths2 = NULL;
+        _cleanup_close_ int fd = -EBADF;
+
+        ASSERT_OK(lookup_paths_init(&lp, RUNTIME_SCOPE_SYSTEM, 0, NULL));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, NULL, &ids, &names, &paths));
+
+        /* Populate the cache, then use it, the result must be the same as without */
+        ASSERT_NOT_NULL(c = unit_directory_cache_new());
+        for (unsigned i = 0; i < 2; i++) {
+                ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, c, &ids2, &names2, &paths2));
+                assert_name_maps_equal(ids, paths, ids2, paths2);
+        }
+
+        /* And the same after a round trip through the file */
+        ASSERT_OK(fd = mkostemp_safe(p));
+        ASSERT_OK(unit_directory_cache_save(c, p));
+        ASSERT_OK_ZERO(unit_directory_cache_save(c, p)); /* Not dirty anymore */
+
+        ASSERT_NOT_NULL(c2 = unit_directory_cache_new());
+        ASSERT_OK_POSITIVE(unit_directory_cache_load(c2, p));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, c2, &ids2, &names2, &paths2));
+        assert_name_maps_equal(ids, paths, ids2, paths2);
+}
+
+TEST(unit_directory_cache_stale) {
+        _cleanup_(unit_directory_cache_freep) UnitDirectoryCache *c = NULL;
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_(lookup_paths_done) LookupPaths lp = {};
+        _cleanup_hashmap_free_ Hashmap *ids = NULL, *names = NULL;
+        _cleanup_free_ char *d = NULL, *n = NULL;
+        const struct timespec ts[2] = {
+                { .tv_sec = 1 },
+                { .tv_sec = 1 },
+        };
+
+        ASSERT_OK(mkdtemp_malloc("/tmp/test-unit-directory-cache.XXXXXX", &t));
+        ASSERT_NOT_NULL(d = path_join(t, "units"));
+        ASSERT_NOT_NULL(n = path_join(t, "units.new"));
+        ASSERT_NOT_NULL(lp.search_path = strv_new(d));
+
+        ASSERT_OK(write_string_file(strjoina(d, "/a.service"), "[Unit]\n",
+                                    WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_MKDIR_0755));
+
+        ASSERT_NOT_NULL(c = unit_directory_cache_new());
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, c, &ids, &names, NULL));
+        ASSERT_TRUE(hashmap_contains(ids, "a.service"));
+        ASSERT_FALSE(hashmap_contains(ids, "b.service"));
+
+        /* A directory whose mtime changed is read again. Set it explicitly, as the new file might have been
+         * created within the granularity of the file system timestamps. */
+        ASSERT_OK(write_string_file(strjoina(d, "/b.service"), "[Unit]\n", WRITE_STRING_FILE_CREATE));
+        ASSERT_OK_ERRNO(utimensat(AT_FDCWD, d, ts, 0));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, c, &ids, &names, NULL));
+        ASSERT_TRUE(hashmap_contains(ids, "a.service"));
+        ASSERT_TRUE(hashmap_contains(ids, "b.service"));
+
+        /* A directory that was replaced by a different one is read again, even if the mtime is the same */
+        ASSERT_OK(write_string_file(strjoina(n, "/c.service"), "[Unit]\n",
+                                    WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_MKDIR_0755));
+        ASSERT_OK_ERRNO(utimensat(AT_FDCWD, n, ts, 0));
+        ASSERT_OK(rm_rf(d, REMOVE_ROOT|REMOVE_PHYSICAL));
+        ASSERT_OK_ERRNO(rename(n, d));
+        ASSERT_OK_POSITIVE(unit_file_build_name_map(&lp, NULL, c, &ids, &names, NULL));
+        ASSERT_FALSE(hashmap_contains(ids, "a.service"));
+        ASSERT_FALSE(hashmap_contains(ids, "b.service"));
+        ASSERT_TRUE(hashmap_contains(ids, "c.service"));
+}
+
 TEST(runlevel_to_target) {
         in_initrd_force(false);
         ASSERT_STREQ(runlevel_to_target(NULL), NULL);
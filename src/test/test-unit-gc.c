@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "manager.h"
+#include "rm-rf.h"
+#include "service.h"
+#include "tests.h"
+
+static char *runtime_dir = NULL;
+
+STATIC_DESTRUCTOR_REGISTER(runtime_dir, rm_rf_physical_and_freep);
+
+TEST(gc_pause_bucket_max) {
+        ASSERT_EQ(manager_gc_pause_bucket_max(0), 10U);
+        ASSERT_EQ(manager_gc_pause_bucket_max(1), 100U);
+        ASSERT_EQ(manager_gc_pause_bucket_max(4), 100 * USEC_PER_MSEC);
+        ASSERT_EQ(manager_gc_pause_bucket_max(MANAGER_GC_PAUSE_BUCKETS - 1), USEC_INFINITY);
+}
+
+TEST(gc_unit_queue_budget) {
+        _cleanup_(manager_freep) Manager *m = NULL;
+        Unit *units[100], *keeper, *kept;
+        uint64_t n_pauses = 0;
+        int r;
+
+        r = manager_new(RUNTIME_SCOPE_USER, MANAGER_TEST_RUN_MINIMAL, &m);
+        if (manager_errno_skip_test(r))
+                return (void) log_tests_skipped_errno(r, "manager_new");
+        ASSERT_OK(r);
+
+        for (size_t i = 0; i < ELEMENTSOF(units); i++) {
+                _cleanup_free_ char *name = NULL;
+
+                ASSERT_OK(asprintf(&name, "gc-%zu.service", i));
+                ASSERT_OK(unit_new_for_name(m, sizeof(Service), name, &units[i]));
+        }
+
+        /* A unit referenced by one that can't be collected stays around */
+        ASSERT_OK(unit_new_for_name(m, sizeof(Service), "gc-keeper.service", &keeper));
+        ASSERT_OK(unit_new_for_name(m, sizeof(Service), "gc-kept.service", &kept));
+        keeper->perpetual = true;
+        ASSERT_OK(unit_add_dependency(keeper, UNIT_WANTS, kept, /* add_reference= */ true, UNIT_DEPENDENCY_FILE));
+
+        FOREACH_ELEMENT(u, units)
+                unit_add_to_gc_queue(*u);
+        unit_add_to_gc_queue(keeper);
+        unit_add_to_gc_queue(kept);
+        ASSERT_TRUE(units[0]->in_gc_queue);
+        ASSERT_FALSE(keeper->in_gc_queue);
+        ASSERT_TRUE(kept->in_gc_queue);
+
+        /* With the budget of this event loop iteration used up, nothing happens */
+        m->gc_budget_used_usec = MANAGER_GC_BUDGET_USEC;
+        ASSERT_EQ(manager_dispatch_gc_unit_queue(m), 0U);
+        ASSERT_EQ(m->n_gc_runs, 0U);
+        FOREACH_ELEMENT(u, units)
+                ASSERT_TRUE((*u)->in_gc_queue);
+
+        /* With some budget left, at least one unit is swept, and if the queue isn't drained 0 is returned
+         * so that the event loop gets its turn */
+        m->gc_budget_used_usec = MANAGER_GC_BUDGET_USEC - 1;
+        r = manager_dispatch_gc_unit_queue(m);
+        ASSERT_EQ(m->n_gc_runs, 1U);
+        ASSERT_GE(m->n_gc_collected_units, 1U);
+        ASSERT_GE(m->gc_budget_used_usec, MANAGER_GC_BUDGET_USEC - 1);
+        if (m->gc_unit_queue)
+                ASSERT_EQ(r, 0);
+
+        /* In the next iteration the rest is swept */
+        m->gc_budget_used_usec = 0;
+        if (m->gc_unit_queue)
+                ASSERT_GT(manager_dispatch_gc_unit_queue(m), 0U);
+        ASSERT_NULL(m->gc_unit_queue);
+
+        FOREACH_ELEMENT(u, units)
+                ASSERT_TRUE((*u)->in_cleanup_queue);
+        ASSERT_FALSE(kept->in_cleanup_queue);
+        ASSERT_FALSE(keeper->in_cleanup_queue);
+        ASSERT_EQ(m->n_gc_collected_units, (uint64_t) ELEMENTSOF(units));
+
+        FOREACH_ELEMENT(b, m->gc_pause_histogram)
+                n_pauses += *b;
+        ASSERT_EQ(n_pauses, m->n_gc_runs);
+}
+
+static int intro(void) {
+        if (enter_cgroup_subroot(NULL) == -ENOMEDIUM)
+                return log_tests_skipped("cgroupfs not available");
+
+        ASSERT_NOT_NULL(runtime_dir = setup_fake_runtime_dir());
+        return EXIT_SUCCESS;
+}
+
+DEFINE_TEST_MAIN_WITH_INTRO(LOG_DEBUG, intro);
@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "manager.h"
+#include "memory-util.h"
+#include "mempool.h"
+#include "rm-rf.h"
+#include "service.h"
+#include "slice.h"
+#include "tests.h"
+
+static char *runtime_dir = NULL;
+
+STATIC_DESTRUCTOR_REGISTER(runtime_dir, rm_rf_physical_and_freep);
+
+TEST(unit_pools_trim) {
+        _cleanup_(manager_freep) Manager *m = NULL;
+        Unit *services[3000], *slices[100];
+        size_t jobs;
+        int r;
+
+        if (!(mempool_enabled && mempool_enabled()))
+                return (void) log_tests_skipped("memory pools are disabled");
+
+        r = manager_new(RUNTIME_SCOPE_USER, MANAGER_TEST_RUN_MINIMAL, &m);
+        if (manager_errno_skip_test(r))
+                return (void) log_tests_skipped_errno(r, "manager_new");
+        ASSERT_OK(r);
+
+        ASSERT_EQ(manager_pools_allocated(m, &jobs), 0U);
+
+        FOREACH_ELEMENT(u, services)
+                ASSERT_NOT_NULL(*u = unit_new(m, sizeof(Service)));
+        FOREACH_ELEMENT(u, slices)
+                ASSERT_NOT_NULL(*u = unit_new(m, sizeof(Slice)));
+
+        /* Units are allocated from one pool per object size */
+        FOREACH_ELEMENT(u, services)
+                ASSERT_PTR_EQ((*u)->mempool, services[0]->mempool);
+        FOREACH_ELEMENT(u, slices)
+                ASSERT_PTR_EQ((*u)->mempool, slices[0]->mempool);
+        ASSERT_TRUE(services[0]->mempool != slices[0]->mempool);
+
+        ASSERT_GE(manager_pools_allocated(m, NULL), ELEMENTSOF(services) * sizeof(Service) + ELEMENTSOF(slices) * sizeof(Slice));
+
+        /* Freeing a few units doesn't return memory, the tiles are kept for reuse */
+        unit_free(slices[0]);
+        slices[0] = NULL;
+        manager_trim_pools(m);
+        ASSERT_GE(manager_pools_allocated(m, NULL), ELEMENTSOF(services) * sizeof(Service));
+
+        /* A single unit that stays around only keeps its own chunk, and chunks don't grow without bounds */
+        for (size_t i = 1; i < ELEMENTSOF(services); i++)
+                services[i] = unit_free(services[i]);
+        FOREACH_ELEMENT(u, slices)
+                *u = unit_free(*u);
+
+        manager_trim_pools(m);
+        ASSERT_GT(manager_pools_allocated(m, NULL), 0U);
+        ASSERT_LE(manager_pools_allocated(m, NULL), MANAGER_UNIT_POOL_TILES_MAX * sizeof(Service) + page_size());
+
+        /* Once everything is gone, trimming returns all of it */
+        services[0] = unit_free(services[0]);
+        manager_trim_pools(m);
+        ASSERT_EQ(manager_pools_allocated(m, NULL), 0U);
+}
+
+static int intro(void) {
+        if (enter_cgroup_subroot(NULL) == -ENOMEDIUM)
+                return log_tests_skipped("cgroupfs not available");
+
+        ASSERT_NOT_NULL(runtime_dir = setup_fake_runtime_dir());
+        return EXIT_SUCCESS;
+}
+
+DEFINE_TEST_MAIN_WITH_INTRO(LOG_DEBUG, intro);
@@ -31,6 +31,15 @@ TEST(utf8_n_is_valid) {
         assert_se( utf8_is_valid_n("<ZZ>", 3));
         assert_se( utf8_is_valid_n("<ZZ>", 4));
         assert_se(!utf8_is_valid_n("<ZZ>", 5));
+
+        /* Exercise the word-at-a-time ASCII fast path */
+        assert_se( utf8_is_valid_n("0123456789abcdef0123456789abcdef", 32));
+        assert_se( utf8_is_valid_n("0123456789abcdef0123456789abcdef", 31));
+        assert_se(!utf8_is_valid_n("0123456\0" "89abcdef", 16));
+        assert_se(!utf8_is_valid_n("0123456789abcd\0f", 16));
+        assert_se( utf8_is_valid_n("01234567\342\204\242" "89abcdef", 19));
+        assert_se(!utf8_is_valid_n("01234567\342\204" "89abcdef", 18));
+        assert_se(!utf8_is_valid_n("0123456789abcdef\377", 17));
 }
 
 TEST(utf8_is_valid) {
@@ -0,0 +1,90 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: LGPL-2.1-or-later
+set -eux
+set -o pipefail
+
+# shellcheck source=test/units/util.sh
+. "$(dirname "$0")"/util.sh
+
+# Tests that reloading doesn't generate UnitRemoved/UnitNew for units that survive it, and that
+# PropertiesChangedIntervalSec= limits PropertiesChanged signals without reordering UnitNew and job signals.
+
+# The manager only sends signals while somebody is subscribed, which logind is
+if ! systemctl is-active --quiet systemd-logind.service; then
+    echo "systemd-logind is not running, skipping the test."
+    exit 0
+fi
+
+UNIT_NAME="TEST-07-PID1-dbus-signals-$RANDOM"
+MONITOR="$UNIT_NAME-monitor.service"
+
+at_exit() {
+    set +e
+
+    systemctl stop "$MONITOR" "$UNIT_NAME.service"
+    rm -f /run/systemd/system/"$UNIT_NAME.service" /run/systemd/system.conf.d/99-"$UNIT_NAME.conf"
+    systemctl daemon-reload
+}
+
+trap at_exit EXIT
+
+monitor_start() {
+    systemd-run --unit "$MONITOR" --service-type=notify \
+        busctl monitor --json=short "$@"
+}
+
+monitor_stop() {
+    # Make sure all signals sent so far made it into the journal
+    sleep 1
+    systemctl stop "$MONITOR"
+    journalctl --sync
+    journalctl -q -o cat -u "$MONITOR" _COMM=busctl
+    systemctl reset-failed "$MONITOR" 2>/dev/null || :
+    journalctl --rotate >/dev/null
+}
+
+cat >/run/systemd/system/"$UNIT_NAME.service" <<EOF
+[Service]
+Type=oneshot
+ExecStart=true
+EOF
+
+systemctl daemon-reload
+systemctl start "$UNIT_NAME.service"
+
+: "Units surviving a reload are neither removed nor announced again"
+monitor_start --match="type=signal,sender=org.freedesktop.systemd1,path=/org/freedesktop/systemd1,member=UnitRemoved" \
+              --match="type=signal,sender=org.freedesktop.systemd1,path=/org/freedesktop/systemd1,member=UnitNew"
+systemctl daemon-reload
+systemd-run --wait --unit "$UNIT_NAME-sentinel.service" true
+OUTPUT="$(monitor_stop)"
+grep -F "$UNIT_NAME-sentinel.service" <<<"$OUTPUT"
+(! grep -F "\"$UNIT_NAME.service\"" <<<"$OUTPUT")
+
+: "PropertiesChangedIntervalSec= coalesces state changes"
+mkdir -p /run/systemd/system.conf.d
+cat >/run/systemd/system.conf.d/99-"$UNIT_NAME.conf" <<EOF
+[Manager]
+PropertiesChangedIntervalSec=1min
+EOF
+systemctl daemon-reload
+
+UNIT_PATH="$(busctl call org.freedesktop.systemd1 /org/freedesktop/systemd1 org.freedesktop.systemd1.Manager GetUnit s "$UNIT_NAME.service" | cut -d'"' -f2)"
+
+monitor_start --match="type=signal,sender=org.freedesktop.systemd1,path=$UNIT_PATH,member=PropertiesChanged"
+for _ in {0..4}; do
+    systemctl start "$UNIT_NAME.service"
+done
+OUTPUT="$(monitor_stop)"
+# Each start goes through several states, but within the interval at most the first change is sent
+# right away, everything else is deferred until the interval passed.
+(( $(grep -c . <<<"$OUTPUT" || :) <= 2 ))
+
+: "UnitNew and job signals are not deferred and stay ordered"
+monitor_start --match="type=signal,sender=org.freedesktop.systemd1,path=/org/freedesktop/systemd1,member=UnitNew" \
+              --match="type=signal,sender=org.freedesktop.systemd1,path=/org/freedesktop/systemd1,member=JobNew" \
+              --match="type=signal,sender=org.freedesktop.systemd1,path=/org/freedesktop/systemd1,member=JobRemoved"
+systemd-run --wait --unit "$UNIT_NAME-transient.service" true
+OUTPUT="$(monitor_stop)"
+MEMBERS="$(jq -r "select(.payload.data | tostring | contains(\"$UNIT_NAME-transient.service\")) | .member" <<<"$OUTPUT" | uniq | tr '\n' ' ')"
+[[ "$MEMBERS" =~ ^"UnitNew JobNew JobRemoved" ]]
@@ -210,6 +210,22 @@ varlinkctl call /run/systemd/io.systemd.Manager io.systemd.Unit.List '{"cgroup":
 invocation_id="$(systemctl show -P InvocationID systemd-journald.service)"
 varlinkctl call /run/systemd/io.systemd.Manager io.systemd.Unit.List "{\"invocationID\": \"$invocation_id\"}"
 
+varlinkctl --more call /run/systemd/io.systemd.Manager io.systemd.Unit.ListAccounting '{}' | grep -F '"init.scope"' >/dev/null
+(! varlinkctl call /run/systemd/io.systemd.Manager io.systemd.Unit.ListAccounting '{}')
+(! varlinkctl --more call /run/systemd/io.systemd.Manager io.systemd.Unit.ListAccounting '{"name": "init.scope"}')
+
+# test io.systemd.Unit.Subscribe
+(! varlinkctl call /run/systemd/io.systemd.Manager io.systemd.Unit.Subscribe '{}')
+(! varlinkctl --more call /run/systemd/io.systemd.Manager io.systemd.Unit.Subscribe '{"since": "foo"}')
+timeout 10 varlinkctl --more call /run/systemd/io.systemd.Manager io.systemd.Unit.Subscribe '{}' >/tmp/unit-state-stream &
+subscriber=$!
+sleep 2
+systemd-run --wait --unit=varlinkctl-subscribe-test.service true
+wait "$subscriber" || :
+grep -q '"multi-user.target"' /tmp/unit-state-stream
+grep -q '"varlinkctl-subscribe-test.service"' /tmp/unit-state-stream
+rm -f /tmp/unit-state-stream
+
 # test io.systemd.Manager in user manager
 testuser_uid=$(id -u testuser)
 systemd-run --wait --pipe --user --machine testuser@ \